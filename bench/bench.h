@@ -0,0 +1,94 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#pragma once
+
+#include <lm/lm.h>
+#include <chrono>
+#include <functional>
+
+#define LM_BENCH_NAMESPACE lmbench
+
+LM_NAMESPACE_BEGIN(LM_BENCH_NAMESPACE)
+
+// Prevent the compiler from optimizing out the computation of the value
+template <typename T>
+void doNotOptimize(const T& v) {
+    #if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&v) : "memory");
+    #else
+    static volatile const void* sink;
+    sink = &v;
+    #endif
+}
+
+// Measurement of a benchmark
+struct Result {
+    std::string name;           // Name of the benchmark
+    long long iterations;       // Number of iterations per repetition
+    double nsPerOp;             // Median of the time per operation in nanoseconds
+    double nsPerOpMin;          // Minimum of the time per operation in nanoseconds
+    double itemsPerSec;         // Processed items per second computed from the median
+};
+
+// Runner of the benchmarks
+class Bench {
+public:
+    using Func = std::function<void(long long iterations)>;
+
+    struct Config {
+        std::string filter;         // Run only the benchmarks containing the string
+        double minTime = .1;        // Minimum time of a repetition in seconds
+        int repeat = 5;             // Number of repetitions
+        std::vector<std::string> accels = { "accel::sahbvh" };  // Acceleration structures
+    };
+
+public:
+    Bench(const Config& config) : config_(config) {}
+
+    const Config& config() const {
+        return config_;
+    }
+
+    const std::vector<Result>& results() const {
+        return results_;
+    }
+
+    // Check if the benchmark with the name is enabled
+    bool enabled(const std::string& name) const {
+        return name.find(config_.filter) != std::string::npos;
+    }
+
+    /*
+        Measure the time of a benchmark.
+        func(n) performs n operations, each of which processes itemsPerOp items.
+        The number of iterations is increased until a repetition takes minTime,
+        and the median over the repetitions is reported.
+    */
+    void run(const std::string& name, long long itemsPerOp, const Func& func);
+
+private:
+    Config config_;
+    std::vector<Result> results_;
+};
+
+// Benchmark group registered by LM_BENCHMARK
+using BenchGroupFunc = void(*)(Bench& bench);
+std::vector<std::pair<std::string, BenchGroupFunc>>& benchGroups();
+
+struct BenchGroupRegEntry {
+    BenchGroupRegEntry(const char* name, BenchGroupFunc func) {
+        benchGroups().emplace_back(name, func);
+    }
+};
+
+LM_NAMESPACE_END(LM_BENCH_NAMESPACE)
+
+// Define a group of benchmarks
+#define LM_BENCHMARK(name) \
+    static void LM_TOKENPASTE2(lmbench_, name)(LM_BENCH_NAMESPACE::Bench& bench); \
+    static LM_BENCH_NAMESPACE::BenchGroupRegEntry LM_TOKENPASTE2(lmbench_reg_, name)( \
+        #name, LM_TOKENPASTE2(lmbench_, name)); \
+    static void LM_TOKENPASTE2(lmbench_, name)(LM_BENCH_NAMESPACE::Bench& bench)
@@ -0,0 +1,159 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "bench.h"
+
+namespace {
+
+// Create a mesh with the triangles of random positions and orientations in the unit cube.
+// One triangle covering the cube is created if numTriangles is one.
+lm::Json triangleSoup(int numTriangles) {
+    using namespace lm;
+    std::vector<Float> ps;
+    std::vector<int> fs;
+    if (numTriangles == 1) {
+        ps = { -2,-2,0, 2,-2,0, 0,2,0 };
+        fs = { 0,1,2 };
+    }
+    else {
+        Rng rng(42);
+        const auto size = 4_f / std::cbrt(Float(numTriangles));
+        for (int i = 0; i < numTriangles; i++) {
+            const auto c = Vec3(rng.u(), rng.u(), rng.u()) - .5_f;
+            for (int j = 0; j < 3; j++) {
+                const auto p = c + (Vec3(rng.u(), rng.u(), rng.u()) - .5_f) * size;
+                ps.insert(ps.end(), { p.x, p.y, p.z });
+                fs.push_back(3*i + j);
+            }
+        }
+    }
+    return {
+        {"ps", ps},
+        {"ns", {0,0,1}},
+        {"ts", {0,0}},
+        {"fs", {
+            {"p", fs},
+            {"n", std::vector<int>(fs.size(), 0)},
+            {"t", std::vector<int>(fs.size(), 0)}
+        }}
+    };
+}
+
+// Create spheres of random positions in the unit cube with the radius
+// comparable to the size of the triangles in the triangle soup.
+lm::Json sphereSoup(int numSpheres) {
+    using namespace lm;
+    std::vector<Float> ps;
+    Rng rng(42);
+    for (int i = 0; i < numSpheres; i++) {
+        const auto c = Vec3(rng.u(), rng.u(), rng.u()) - .5_f;
+        ps.insert(ps.end(), { c.x, c.y, c.z });
+    }
+    return {
+        {"ps", ps},
+        {"radius", 1_f / std::cbrt(Float(numSpheres))}
+    };
+}
+
+}
+
+LM_BENCHMARK(accel) {
+    using namespace lm;
+
+    // Random rays toward the unit cube
+    constexpr int NumRays = 1024;
+    std::vector<Ray> rays(NumRays);
+    {
+        Rng rng(42);
+        for (auto& ray : rays) {
+            const auto o = math::sampleUniformSphere(rng) * 3_f;
+            const auto target = Vec3(rng.u(), rng.u(), rng.u()) - .5_f;
+            ray = { o, glm::normalize(target - o) };
+        }
+    }
+
+    // One triangle measures the ray-triangle kernel with the overhead of the traversal
+    for (const int numTriangles : { 1, 1000, 100000 }) {
+        const auto mesh = triangleSoup(numTriangles);
+        for (const auto& accel : bench.config().accels) {
+            const auto name = fmt::format("accel/intersect/{}/{}", accel, numTriangles);
+            const auto buildName = fmt::format("accel/build/{}/{}", accel, numTriangles);
+            const auto occludedName = fmt::format("accel/occluded/{}/{}", accel, numTriangles);
+            if (!bench.enabled(name) && !bench.enabled(buildName) && !bench.enabled(occludedName)) {
+                continue;
+            }
+
+            lm::reset();
+            lm::asset("mesh", "mesh::raw", mesh);
+            lm::asset("material", "material::diffuse", {{"Kd", {1,1,1}}});
+            lm::primitive(Mat4(1), {
+                {"mesh", lm::asset("mesh")},
+                {"material", lm::asset("material")}
+            });
+
+            bench.run(buildName, numTriangles, [&](long long n) {
+                for (long long i = 0; i < n; i++) {
+                    lm::build(accel);
+                }
+            });
+
+            lm::build(accel);
+            const auto* scene = comp::get<Scene>("$.scene");
+            bench.run(name, 1, [&](long long n) {
+                long long hits = 0;
+                for (long long i = 0; i < n; i++) {
+                    hits += scene->intersect(rays[i % NumRays]) ? 1 : 0;
+                }
+                lmbench::doNotOptimize(hits);
+            });
+
+            // Visibility query without the evaluation of the surface attributes
+            bench.run(occludedName, 1, [&](long long n) {
+                long long hits = 0;
+                for (long long i = 0; i < n; i++) {
+                    hits += scene->occluded(rays[i % NumRays]) ? 1 : 0;
+                }
+                lmbench::doNotOptimize(hits);
+            });
+        }
+    }
+
+    // Analytic spheres intersected without tessellation
+    for (const int numSpheres : { 1000, 100000 }) {
+        const auto mesh = sphereSoup(numSpheres);
+        for (const auto& accel : bench.config().accels) {
+            const auto name = fmt::format("accel/intersect_spheres/{}/{}", accel, numSpheres);
+            const auto buildName = fmt::format("accel/build_spheres/{}/{}", accel, numSpheres);
+            if (!bench.enabled(name) && !bench.enabled(buildName)) {
+                continue;
+            }
+
+            lm::reset();
+            lm::asset("mesh", "mesh::spheres", mesh);
+            lm::asset("material", "material::diffuse", {{"Kd", {1,1,1}}});
+            lm::primitive(Mat4(1), {
+                {"mesh", lm::asset("mesh")},
+                {"material", lm::asset("material")}
+            });
+
+            bench.run(buildName, numSpheres, [&](long long n) {
+                for (long long i = 0; i < n; i++) {
+                    lm::build(accel);
+                }
+            });
+
+            lm::build(accel);
+            const auto* scene = comp::get<Scene>("$.scene");
+            bench.run(name, 1, [&](long long n) {
+                long long hits = 0;
+                for (long long i = 0; i < n; i++) {
+                    hits += scene->intersect(rays[i % NumRays]) ? 1 : 0;
+                }
+                lmbench::doNotOptimize(hits);
+            });
+        }
+    }
+}
@@ -0,0 +1,30 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "bench.h"
+
+LM_BENCHMARK(film) {
+    using namespace lm;
+
+    // Splat to the random positions from the varying number of threads.
+    // The smaller film causes the higher contention.
+    const int origNumThreads = parallel::numThreads();
+    for (const int numThreads : { 1, 2, 4, 8, 16, 32, 64 }) {
+        parallel::init("parallel::openmp", {{"numThreads", numThreads}});
+        for (const int size : { 4, 256 }) {
+            lm::asset("film", "film::bitmap", {{"w", size}, {"h", size}});
+            auto* film = comp::get<Film>(lm::asset("film"));
+            bench.run(fmt::format("film/splat/{}x{}/t{}", size, size, numThreads), 1, [&](long long n) {
+                parallel::foreach(n, [&](long long index, int) {
+                    const auto h = std::uint64_t(index) * 0x9e3779b97f4a7c15ULL;
+                    const Vec2 rp(Float(h >> 40 & 0xffff) / 65536_f, Float(h >> 16 & 0xffff) / 65536_f);
+                    film->splat(rp, Vec3(1_f));
+                });
+            });
+        }
+    }
+    parallel::init("parallel::openmp", {{"numThreads", origNumThreads}});
+}
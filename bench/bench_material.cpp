@@ -0,0 +1,56 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "bench.h"
+
+LM_BENCHMARK(material) {
+    using namespace lm;
+
+    const std::vector<std::pair<std::string, Json>> materials = {
+        { "material::diffuse", {{"Kd", {1,1,1}}} },
+        { "material::glossy", {{"Ks", {1,1,1}}, {"ax", .1}, {"ay", .2}} },
+        { "material::glass", {{"Ni", 1.5}} },
+        { "material::mirror", Json::object() }
+    };
+
+    // Random incident directions in the upper hemisphere
+    constexpr int NumDirs = 1024;
+    std::vector<Vec3> wis(NumDirs);
+    {
+        Rng rng(42);
+        for (auto& wi : wis) {
+            wi = math::sampleCosineWeighted(rng);
+        }
+    }
+    const auto geom = PointGeometry::makeOnSurface(Vec3(0_f), Vec3(0_f, 0_f, 1_f));
+
+    for (const auto& [key, prop] : materials) {
+        lm::asset("material", key, prop);
+        const auto* material = comp::get<Material>(lm::asset("material"));
+
+        bench.run(fmt::format("material/sample/{}", key), 1, [&](long long n) {
+            Rng rng(42);
+            Vec3 sum(0_f);
+            for (long long i = 0; i < n; i++) {
+                const auto s = material->sample(rng, geom, wis[i % NumDirs]);
+                if (s) {
+                    sum += s->weight;
+                }
+            }
+            lmbench::doNotOptimize(sum);
+        });
+
+        bench.run(fmt::format("material/eval/{}", key), 1, [&](long long n) {
+            Vec3 sum(0_f);
+            for (long long i = 0; i < n; i++) {
+                const auto wi = wis[i % NumDirs];
+                const auto wo = wis[(i * 7 + 1) % NumDirs];
+                sum += material->eval(geom, 0, wi, wo);
+            }
+            lmbench::doNotOptimize(sum);
+        });
+    }
+}
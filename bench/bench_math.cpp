@@ -0,0 +1,79 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "bench.h"
+
+LM_BENCHMARK(math) {
+    using namespace lm;
+
+    bench.run("math/rng_u", 1, [](long long n) {
+        Rng rng(42);
+        Float sum = 0_f;
+        for (long long i = 0; i < n; i++) {
+            sum += rng.u();
+        }
+        lmbench::doNotOptimize(sum);
+    });
+
+    // Random rays hitting the unit cube with high probability
+    constexpr int NumRays = 1024;
+    std::vector<Ray> rays(NumRays);
+    {
+        Rng rng(42);
+        for (auto& ray : rays) {
+            const auto o = math::sampleUniformSphere(rng) * 3_f;
+            const auto target = Vec3(rng.u(), rng.u(), rng.u()) * 1.5_f - .75_f;
+            ray = { o, glm::normalize(target - o) };
+        }
+    }
+
+    bench.run("math/ray_box", 1, [&](long long n) {
+        const Bound b{ Vec3(-.5_f), Vec3(.5_f) };
+        long long hits = 0;
+        for (long long i = 0; i < n; i++) {
+            hits += b.isect(rays[i % NumRays], 0_f, Inf) ? 1 : 0;
+        }
+        lmbench::doNotOptimize(hits);
+    });
+
+    // Discrete distributions with the random weights
+    for (const int size : { 64, 4096 }) {
+        Rng rng(42);
+        std::vector<Float> vs(size_t(size) * size);
+        for (auto& v : vs) {
+            v = rng.u();
+        }
+
+        Dist dist;
+        for (int i = 0; i < size; i++) {
+            dist.add(vs[i]);
+        }
+        dist.norm();
+        bench.run(fmt::format("math/dist_samp/{}", size), 1, [&](long long n) {
+            Rng rng(42);
+            long long sum = 0;
+            for (long long i = 0; i < n; i++) {
+                sum += dist.samp(rng);
+            }
+            lmbench::doNotOptimize(sum);
+        });
+
+        if (size > 1024) {
+            // Skip too large 2d distribution
+            continue;
+        }
+        Dist2 dist2;
+        dist2.init(vs, size, size);
+        bench.run(fmt::format("math/dist2_samp/{}x{}", size, size), 1, [&](long long n) {
+            Rng rng(42);
+            Vec2 sum(0_f);
+            for (long long i = 0; i < n; i++) {
+                sum += dist2.samp(rng);
+            }
+            lmbench::doNotOptimize(sum);
+        });
+    }
+}
@@ -0,0 +1,55 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "bench.h"
+
+LM_BENCHMARK(objloader) {
+    using namespace lm;
+
+    // Generate an OBJ file of a grid with size*size quads
+    constexpr int Size = 300;
+    const auto path = (fs::temp_directory_path() / "lm_bench_grid.obj").string();
+    long long bytes = 0;
+    {
+        std::ofstream os(path);
+        for (int y = 0; y <= Size; y++) {
+            for (int x = 0; x <= Size; x++) {
+                os << fmt::format("v {} {} 0\n", Float(x) / Size, Float(y) / Size);
+                os << fmt::format("vt {} {}\n", Float(x) / Size, Float(y) / Size);
+            }
+        }
+        os << "vn 0 0 1\n";
+        for (int y = 0; y < Size; y++) {
+            for (int x = 0; x < Size; x++) {
+                const int i00 = y * (Size + 1) + x + 1;
+                const int i10 = i00 + 1;
+                const int i01 = i00 + Size + 1;
+                const int i11 = i01 + 1;
+                os << fmt::format("f {0}/{0}/1 {1}/{1}/1 {2}/{2}/1 {3}/{3}/1\n", i00, i10, i11, i01);
+            }
+        }
+        bytes = (long long)(os.tellp());
+    }
+
+    // Throughput is reported in bytes per second
+    bench.run("objloader/load/grid", bytes, [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            objloader::OBJSurfaceGeometry geo;
+            long long faces = 0;
+            objloader::load(path, geo,
+                [&](const objloader::OBJMeshFace& face, const objloader::MTLMatParams&) {
+                    faces += (long long)(face.size());
+                    return true;
+                },
+                [&](const objloader::MTLMatParams&) {
+                    return true;
+                });
+            lmbench::doNotOptimize(faces);
+        }
+    });
+
+    fs::remove(path);
+}
@@ -0,0 +1,28 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "bench.h"
+
+LM_BENCHMARK(parallel) {
+    using namespace lm;
+
+    // Overhead of a dispatch with the empty body
+    bench.run("parallel/foreach_dispatch", 1, [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            parallel::foreach(parallel::numThreads(), [](long long, int) {});
+        }
+    });
+
+    // Overhead per element with the trivial body.
+    // The counters are padded to avoid false sharing.
+    bench.run("parallel/foreach_element", 1, [&](long long n) {
+        std::vector<std::array<long long, 8>> counts(parallel::numThreads(), {});
+        parallel::foreach(n, [&](long long, int threadid) {
+            counts[threadid][0]++;
+        });
+        lmbench::doNotOptimize(counts);
+    });
+}
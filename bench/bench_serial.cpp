@@ -0,0 +1,72 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "bench.h"
+
+LM_BENCHMARK(serial) {
+    using namespace lm;
+
+    // One million positions, e.g., of a mesh
+    constexpr int N = 1000000;
+    std::vector<Vec3> ps(N);
+    {
+        Rng rng(42);
+        for (auto& p : ps) {
+            p = Vec3(rng.u(), rng.u(), rng.u());
+        }
+    }
+
+    // Default archive serializing elements one by one
+    bench.run("serial/roundtrip/vec3", N, [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            std::stringstream ss;
+            serial::save(ss, ps);
+            std::vector<Vec3> loaded;
+            serial::load(ss, loaded);
+            lmbench::doNotOptimize(loaded);
+        }
+    });
+
+    // Raw block
+    bench.run("serial/roundtrip/vec3_raw", N, [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            std::stringstream ss;
+            serial::save(ss, serial::raw(ps));
+            std::vector<Vec3> loaded;
+            auto loadedRaw = serial::raw(loaded);
+            serial::load(ss, loadedRaw);
+            lmbench::doNotOptimize(loaded);
+        }
+    });
+
+    // Whole state of the framework with a mesh asset
+    {
+        std::vector<Float> psFlat;
+        std::vector<int> fs;
+        for (int i = 0; i < 100000 * 3; i++) {
+            const auto& p = ps[i];
+            psFlat.insert(psFlat.end(), { p.x, p.y, p.z });
+            fs.push_back(i);
+        }
+        lm::asset("mesh", "mesh::raw", {
+            {"ps", psFlat},
+            {"ns", {0,0,1}},
+            {"ts", {0,0}},
+            {"fs", {
+                {"p", fs},
+                {"n", std::vector<int>(fs.size(), 0)},
+                {"t", std::vector<int>(fs.size(), 0)}
+            }}
+        });
+        bench.run("serial/roundtrip/state_mesh", 100000, [&](long long n) {
+            for (long long i = 0; i < n; i++) {
+                std::stringstream ss;
+                lm::serialize(ss);
+                lm::deserialize(ss);
+            }
+        });
+    }
+}
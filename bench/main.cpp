@@ -0,0 +1,186 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "bench.h"
+
+LM_NAMESPACE_BEGIN(LM_BENCH_NAMESPACE)
+
+std::vector<std::pair<std::string, BenchGroupFunc>>& benchGroups() {
+    static std::vector<std::pair<std::string, BenchGroupFunc>> groups;
+    return groups;
+}
+
+void Bench::run(const std::string& name, long long itemsPerOp, const Func& func) {
+    if (!enabled(name)) {
+        return;
+    }
+
+    using Clock = std::chrono::high_resolution_clock;
+    const auto measure = [&](long long n) -> double {
+        const auto start = Clock::now();
+        func(n);
+        const auto end = Clock::now();
+        return std::chrono::duration<double>(end - start).count();
+    };
+
+    // Find the number of iterations taking minTime
+    long long n = 1;
+    while (true) {
+        const auto t = measure(n);
+        if (t >= config_.minTime) {
+            break;
+        }
+        // Estimate the required iterations with 20% margin
+        const auto estimated = t > 0 ? (long long)(n * config_.minTime * 1.2 / t) : n * 100;
+        n = std::clamp(estimated, n + 1, n * 100);
+    }
+
+    // Repeat the measurement
+    std::vector<double> ts;
+    for (int i = 0; i < config_.repeat; i++) {
+        ts.push_back(measure(n) * 1e9 / n);
+    }
+    std::sort(ts.begin(), ts.end());
+    const auto median = ts[ts.size() / 2];
+
+    results_.push_back({ name, n, median, ts.front(), itemsPerOp * 1e9 / median });
+    fmt::print("{:<50} {:>14.2f} ns/op {:>16.0f} items/s\n", name, median, itemsPerOp * 1e9 / median);
+}
+
+LM_NAMESPACE_END(LM_BENCH_NAMESPACE)
+
+// ------------------------------------------------------------------------------------------------
+
+namespace {
+
+void printUsage() {
+    fmt::print(
+        "Usage: lm_bench [options]\n"
+        "  --filter <str>      Run the benchmarks whose names contain <str>\n"
+        "  --out <path>        Write the results as JSON to <path>\n"
+        "  --min-time <sec>    Minimum time of a repetition (default: 0.1)\n"
+        "  --repeat <n>        Number of repetitions (default: 5)\n"
+        "  --plugin <path>     Load a plugin (e.g., accel_embree). Can be specified multiple times\n"
+        "  --accel <names>     Comma-separated acceleration structures (default: accel::sahbvh)\n"
+        "  --num-threads <n>   Number of threads. Non-positive values are relative to the number of cores (default: 0)\n");
+}
+
+std::vector<std::string> split(const std::string& s, char delim) {
+    std::vector<std::string> result;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, delim)) {
+        if (!item.empty()) {
+            result.push_back(item);
+        }
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char** argv) {
+    using namespace lmbench;
+
+    // Parse arguments
+    Bench::Config config;
+    std::string outPath;
+    std::vector<std::string> plugins;
+    int numThreads = 0;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error(fmt::format("Missing value for '{}'", arg));
+            }
+            return argv[++i];
+        };
+        try {
+            if (arg == "--filter") {
+                config.filter = next();
+            }
+            else if (arg == "--out") {
+                outPath = next();
+            }
+            else if (arg == "--min-time") {
+                config.minTime = std::stod(next());
+            }
+            else if (arg == "--repeat") {
+                config.repeat = std::max(1, std::stoi(next()));
+            }
+            else if (arg == "--plugin") {
+                plugins.push_back(next());
+            }
+            else if (arg == "--accel") {
+                config.accels = split(next(), ',');
+            }
+            else if (arg == "--num-threads") {
+                numThreads = std::stoi(next());
+            }
+            else if (arg == "--help" || arg == "-h") {
+                printUsage();
+                return EXIT_SUCCESS;
+            }
+            else {
+                throw std::runtime_error(fmt::format("Unknown option '{}'", arg));
+            }
+        }
+        catch (const std::exception& e) {
+            fmt::print(stderr, "{}\n", e.what());
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Initialize the framework.
+    // Only warnings and errors are reported not to disturb the results.
+    lm::init("user::default", {
+        {"numThreads", numThreads}
+    });
+    lm::log::setSeverity(lm::log::LogLevel::Warn);
+    for (const auto& plugin : plugins) {
+        if (!lm::comp::loadPlugin(plugin)) {
+            fmt::print(stderr, "Failed to load plugin [path='{}']\n", plugin);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Run benchmarks
+    Bench bench(config);
+    for (const auto& [name, func] : benchGroups()) {
+        lm::reset();
+        func(bench);
+    }
+
+    // Output results as JSON
+    if (!outPath.empty()) {
+        lm::Json results = lm::Json::array();
+        for (const auto& r : bench.results()) {
+            results.push_back({
+                {"name", r.name},
+                {"iterations", r.iterations},
+                {"ns_per_op", r.nsPerOp},
+                {"ns_per_op_min", r.nsPerOpMin},
+                {"items_per_sec", r.itemsPerSec}
+            });
+        }
+        const lm::Json out = {
+            {"version", lm::version::formatted()},
+            {"config", {
+                {"min_time", config.minTime},
+                {"repeat", config.repeat},
+                {"num_threads", numThreads},
+                {"accels", config.accels}
+            }},
+            {"results", results}
+        };
+        std::ofstream os(outPath);
+        os << out.dump(2) << std::endl;
+    }
+
+    lm::shutdown();
+    return EXIT_SUCCESS;
+}
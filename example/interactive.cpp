@@ -81,15 +81,22 @@ int main(int argc, char** argv) {
         app.run([&](int display_w, int display_h) {
             // Renderer configuration
             ImGui::Begin("Renderer configuration");
-            static int spp = 10;
             static int maxLength = 20;
-            ImGui::SliderInt("spp", &spp, 1, 1000);
             ImGui::SliderInt("maxLength", &maxLength, 1, 100);
 
-            // Dispatch rendering
-            static std::atomic<bool> rendering = false;
-            static std::atomic<bool> renderingFinished = false;
-            if (ImGui::ButtonEx("Render [R]", ImVec2(0, 0), rendering ? ImGuiButtonFlags_Disabled : 0) || ImGui::IsKeyReleased('R')) {
+            // Dispatch progressive rendering.
+            // The session is restarted when the camera or the configuration is changed.
+            static bool rendering = false;
+            static lm::Vec3 lastEye;
+            static lm::Vec3 lastCenter;
+            static lm::Float lastFov;
+            static int lastMaxLength;
+            const bool changed = rendering && (
+                app.glcamera.eye() != lastEye ||
+                app.glcamera.center() != lastCenter ||
+                app.glcamera.fov() != lastFov ||
+                maxLength != lastMaxLength);
+            if (ImGui::ButtonEx("Render [R]", ImVec2(0, 0), 0) || ImGui::IsKeyReleased('R') || changed) {
                 // Create film to store rendered image
                 lm::asset("film_render", "film::bitmap", {
                     {"w", display_w},
@@ -105,21 +112,28 @@ int main(int argc, char** argv) {
                     {"vfov", app.glcamera.fov()}
                 });
 
-                // Renderer
+                // Renderer rendering a single sample per pixel for each pass
                 lm::renderer("renderer::pt", {
                     {"output", lm::asset("film_render")},
-                    {"spp", spp},
-                    {"maxLength", maxLength}
+                    {"scheduler", "sample"},
+                    {"spp", 1},
+                    {"max_length", maxLength}
                 });
 
-                // Create a new thread and dispatch rendering
+                // Start a new session accumulating the passes in background.
+                // Acceleration structure is reused.
+                lm::startSession(lm::asset("film_render"));
                 rendering = true;
-                std::thread([]() {
-                    lm::render(true);
-                    rendering = false;
-                    renderingFinished = true;
-                }).detach();
+                lastEye = app.glcamera.eye();
+                lastCenter = app.glcamera.center();
+                lastFov = app.glcamera.fov();
+                lastMaxLength = maxLength;
             }
+            if (ImGui::ButtonEx("Stop [S]", ImVec2(0, 0), rendering ? 0 : ImGuiButtonFlags_Disabled) || ImGui::IsKeyReleased('S')) {
+                lm::stopSession();
+                rendering = false;
+            }
+            ImGui::Text("Passes: %lld", lm::sessionPasses());
 
             ImGui::End();
 
@@ -128,8 +142,11 @@ int main(int argc, char** argv) {
             // Checking rendered image
             static std::optional<GLuint> texture;
             const auto updateTexture = [&]() {
-                // Underlying data
-                auto [w, h, data] = lm::buffer(lm::asset("film_render"));
+                // Snapshot of the accumulated image
+                auto [w, h, data] = lm::sessionBuffer();
+                if (w * h == 0) {
+                    return;
+                }
 
                 // Convert data to float
                 std::vector<float> data_(w*h * 3);
@@ -164,10 +181,6 @@ int main(int argc, char** argv) {
                     lastupdated = now;
                 }
             }
-            if (renderingFinished) {
-                updateTexture();
-                renderingFinished = false;
-            }
             if (texture) {
                 // Update rendered image
                 int w, h;
@@ -0,0 +1,97 @@
+# ---
+# jupyter:
+#   jupytext:
+#     formats: ipynb,py:light
+#     text_representation:
+#       extension: .py
+#       format_name: light
+#       format_version: '1.4'
+#       jupytext_version: 1.2.4
+#   kernelspec:
+#     display_name: Python 3
+#     language: python
+#     name: python3
+# ---
+
+# ## Time-to-quality of bidirectional path tracing
+#
+# This test compares the error of ``renderer::bdpt`` against ``renderer::pt`` in equal rendering time. The error is measured by RMSE against the reference image rendered by ``renderer::pt`` with high spp.
+
+import os
+import pandas as pd
+import numpy as np
+import timeit
+# %matplotlib inline
+import matplotlib.pyplot as plt
+import lmfunctest as ft
+import lmscene
+import lightmetrica as lm
+
+# %load_ext lightmetrica_jupyter
+
+lm.init('user::default', {})
+lm.parallel.init('parallel::openmp', {
+    'numThreads': -1
+})
+lm.log.init('logger::jupyter', {})
+lm.progress.init('progress::jupyter')
+lm.info()
+
+lm.comp.loadPlugin(os.path.join(ft.env.bin_path, 'accel_embree'))
+
+scenes = lmscene.scenes_small()
+spps = [4, 16, 64]
+
+def render(scene, name, params):
+    lm.render(name, {
+        'output': lm.asset('film_output'),
+        'max_length': 20,
+        **params
+    })
+    return np.copy(lm.buffer(lm.asset('film_output')))
+
+result = {}
+for scene in scenes:
+    lm.reset()
+    lm.asset('film_output', 'film::bitmap', {
+        'w': 640,
+        'h': 360
+    })
+    lmscene.load(ft.env.scene_path, scene)
+    lm.build('accel::embree', {})
+
+    # Reference
+    ref = render(scene, 'renderer::pt', {'scheduler': 'sample', 'spp': 1024})
+
+    # Error and time for each spp
+    df = pd.DataFrame(columns=['renderer', 'spp', 'time', 'rmse'])
+    for spp in spps:
+        for name, params in [
+            ('renderer::pt', {'scheduler': 'sample', 'spp': spp}),
+            ('renderer::bdpt', {'scheduler': 'sample', 'spp': spp})
+        ]:
+            img = None
+            def run():
+                global img
+                img = render(scene, name, params)
+            t = timeit.timeit(stmt=run, number=1)
+            df = df.append({
+                'renderer': name,
+                'spp': spp,
+                'time': t,
+                'rmse': ft.rmse(img, ref)
+            }, ignore_index=True)
+    result[scene] = df
+
+for scene, df in result.items():
+    fig, ax = plt.subplots(figsize=(8,5))
+    for name, g in df.groupby('renderer'):
+        ax.plot(g['time'], g['rmse'], marker='o', label=name)
+    ax.set_xscale('log')
+    ax.set_yscale('log')
+    ax.set_xlabel('time [s]')
+    ax.set_ylabel('RMSE')
+    ax.set_title(scene)
+    ax.legend()
+    plt.show()
+    display(df)
@@ -49,7 +49,9 @@ if __name__ == '__main__':
         'func_update_asset',
         'perf_accel',
         'perf_obj_loader',
-        'perf_serial'
+        'perf_serial',
+        'perf_pt_guided',
+        'perf_bdpt'
     ]
 
     # Execute tests
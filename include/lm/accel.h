@@ -42,18 +42,35 @@ public:
 
         \rst
         Shows information associated to the hit point of the ray.
+        The record is kept compact so that it can be returned from the traversal cheaply.
         More additional information like surface positions can be obtained
-        from querying appropriate data types from these information.
+        from querying appropriate data types from these information,
+        e.g., the global transformation of the hit primitive by :cpp:func:`instanceTransform`.
+        For the analytic shapes of a mesh (see :cpp:func:`lm::Mesh::shapeType`),
+        the surface coordinates are computed from the hit point by the scene,
+        so the implementation only needs to find the distance and the face index.
         \endrst
     */
     struct Hit {
         Float t;                    //!< Distance to the hit point.
-        Vec2 uv;                    //!< Barycentric coordinates.
-        Transform globalTransform;  //!< Global transformation.
+        Vec2 uv;                    //!< Barycentric coordinates. Unused for the analytic shapes.
+        int instance;               //!< Index of the instance. The meaning depends on the implementation.
         int primitive;              //!< Primitive node index.
         int face;                   //!< Face index.
     };
 
+    /*!
+        \brief Get global transformation of the instance.
+        \param instance Index of the instance given by :cpp:member:`Hit::instance`.
+
+        \rst
+        Returns the global transformation of the primitive associated to the hit point.
+        The transformation is only required when the surface attributes of the hit point are evaluated,
+        so the implementation can defer the computation until this function is called.
+        \endrst
+    */
+    virtual Transform instanceTransform(int instance) const = 0;
+
     /*!
         \brief Compute closest intersection point.
         \param ray Ray.
@@ -68,6 +85,24 @@ public:
         \endrst
     */
     virtual std::optional<Hit> intersect(Ray ray, Float tmin, Float tmax) const = 0;
+
+    /*!
+        \brief Check if the ray is occluded.
+        \param ray Ray.
+        \param tmin Lower valid range of the ray.
+        \param tmax Higher valid range of the ray.
+
+        \rst
+        Returns true if the ray intersects any primitive in the range ``[tmin, tmax]``.
+        Unlike :cpp:func:`intersect`, the implementation can terminate the traversal
+        at the first intersection found, which makes shadow rays cheaper.
+        The default implementation falls back to :cpp:func:`intersect`
+        for the implementations without any-hit traversal.
+        \endrst
+    */
+    virtual bool occluded(Ray ray, Float tmin, Float tmax) const {
+        return intersect(ray, tmin, tmax).has_value();
+    }
 };
 
 /*!
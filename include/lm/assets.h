@@ -6,6 +6,7 @@
 #pragma once
 
 #include "component.h"
+#include "serial.h"
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
@@ -50,6 +51,35 @@ public:
         \endrst
     */
     virtual std::optional<std::string> loadAsset(const std::string& name, const std::string& implKey, const Json& prop) = 0;
+
+    /*!
+        \brief Save assets as snapshot blocks.
+        \param os Output stream.
+        \return Table of contents of the saved blocks.
+
+        \rst
+        Saves each asset into an independent block aligned to
+        :cpp:var:`lm::serial::SnapshotAlignment` in the output stream.
+        The returned entries are used to locate the blocks in
+        :cpp:func:`lm::Assets::loadSnapshot` function.
+        \endrst
+    */
+    virtual std::vector<serial::SnapshotEntry> saveSnapshot(std::ostream& os) = 0;
+
+    /*!
+        \brief Load assets lazily from snapshot blocks.
+        \param file Mapped snapshot file.
+        \param toc Table of contents of the blocks.
+
+        \rst
+        Replaces the current assets with the assets in the snapshot.
+        The function only registers the entries and
+        an asset is deserialized when it is first accessed by
+        :cpp:func:`lm::Component::underlying`, e.g., via :cpp:func:`lm::comp::get`.
+        The mapped file is kept alive until all assets are deserialized.
+        \endrst
+    */
+    virtual void loadSnapshot(const std::shared_ptr<serial::MappedFile>& file, const std::vector<serial::SnapshotEntry>& toc) = 0;
 };
 
 /*!
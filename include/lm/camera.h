@@ -65,6 +65,23 @@ public:
     */
     virtual Ray primaryRay(Vec2 rp, Float aspectRatio) const = 0;
 
+    /*!
+        \brief Compute the differential of a primary ray.
+        \param rp Raster position.
+        \param drp Offsets of the raster position in x and y directions.
+        \param aspectRatio Aspect ratio of the film.
+        \return Differential of the primary ray. nullopt if unsupported.
+
+        \rst
+        This function computes the differential of the ray generated by :cpp:func:`primaryRay`
+        with respect to the offsets of the raster position ``(drp.x, 0)`` and ``(0, drp.y)``.
+        \endrst
+    */
+    virtual std::optional<RayDifferential> primaryRayDifferential(Vec2 rp, Vec2 drp, Float aspectRatio) const {
+        LM_UNUSED(rp, drp, aspectRatio);
+        return {};
+    }
+
     /*!
         \brief Compute a raser position.
         \param wo Primary ray direction.
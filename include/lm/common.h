@@ -280,6 +280,7 @@ struct RaySample;
 struct LightSample;
 class Scene;
 class Renderer;           // renderer.h
+class Sampler;            // sampler.h
 LM_FORWARD_DECLARE_WITH_NAMESPACE(comp::detail, struct Access)
 
 // ----------------------------------------------------------------------------
@@ -11,9 +11,17 @@
 #include <string>
 #include <optional>
 #include <functional>
+#include <vector>
+#include <unordered_set>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
+LM_NAMESPACE_BEGIN(comp)
+LM_NAMESPACE_BEGIN(detail)
+LM_PUBLIC_API void unregisterLoc(Component* p);
+LM_NAMESPACE_END(detail)
+LM_NAMESPACE_END(comp)
+
 /*!
     \addtogroup comp
     @{
@@ -104,7 +112,11 @@ private:
 
 public:
     Component() = default;
-    virtual ~Component() = default;
+    virtual ~Component() {
+        // Invalidate the entries of the locator registry and the index of the weak references.
+        // The component might be in the index without locator, e.g., an underlying component of an asset.
+        comp::detail::unregisterLoc(this);
+    }
     LM_DISABLE_COPY_AND_MOVE(Component)
 
 public:
@@ -468,6 +480,86 @@ LM_PUBLIC_API void registerRootComp(Component* p);
 */
 LM_PUBLIC_API Component* get(const std::string& locator);
 
+/*!
+    \brief Register the locator of a component.
+    \param p Component instance with a locator.
+
+    \rst
+    This function registers the instance to the locator registry
+    so that :cpp:func:`get` can find the instance without tracing down
+    the component hierarchy. The function is called internally
+    when a component is created with a locator.
+    \endrst
+*/
+LM_PUBLIC_API void registerLoc(Component* p);
+
+/*!
+    \brief Unregister the locator of a component.
+    \param p Component instance.
+
+    \rst
+    This function removes the entry of the registry if it points to the given instance,
+    and the entries of the instance in the reverse index of the weak references.
+    The function is called internally when a component is destructed.
+    \endrst
+*/
+LM_PUBLIC_API void unregisterLoc(Component* p);
+
+/*!
+    \brief State of the reverse index of the weak references.
+
+    \rst
+    The index from the components to the components referring to them by weak references
+    is used to update the weak references to the replaced instances without visiting
+    all components in the hierarchy.
+    The index is invalidated when the hierarchy might be changed,
+    i.e., a component is created or a locator is resolved by :cpp:func:`get`.
+    The mark records the number of the changes to tell the changes by the current thread from the others.
+    \endrst
+*/
+struct WeakRefIndexMark {
+    long long global;   //!< Number of the changes by all threads.
+    long long local;    //!< Number of the changes by the current thread.
+};
+
+/*!
+    \brief Get the current state of the reverse index of the weak references.
+    \return State of the index.
+*/
+LM_PUBLIC_API WeakRefIndexMark weakRefIndexMark();
+
+/*!
+    \brief Find the components referring to the given instances by weak references.
+    \param owner Component whose hierarchy contains the referring components, e.g., a user context.
+    \param targets Instances being replaced.
+    \param added Component added by the current thread after the mark, e.g., the replacing instance.
+    \param mark State of the index before the replacement. Updated to the state of the returned index.
+    \return Locators of the referring components.
+            `std::nullopt` if some of them have no locator and the hierarchy must be visited entirely.
+
+    \rst
+    If the hierarchy is changed only by the current thread after the mark,
+    the index is updated with the weak references in the hierarchy of ``added``.
+    Otherwise, the entries in the hierarchy of ``owner`` are rebuilt by visiting it.
+    \endrst
+*/
+LM_PUBLIC_API std::optional<std::vector<std::string>> weakReferrers(
+    Component* owner, const std::unordered_set<Component*>& targets, Component* added, WeakRefIndexMark& mark);
+
+/*!
+    \brief Add the weak references to the reverse index.
+    \param owner Component given to :cpp:func:`weakReferrers`.
+    \param refs Pairs of the referring components and the referred instances.
+    \param mark State of the index returned by :cpp:func:`weakReferrers`.
+
+    \rst
+    The function is called after the weak references to the replaced instances are updated.
+    The index is kept valid if the hierarchy is not changed by the other threads after the mark.
+    The entries of the components are removed when they are destructed.
+    \endrst
+*/
+LM_PUBLIC_API void addWeakRefs(Component* owner, const std::vector<std::pair<Component*, Component*>>& refs, WeakRefIndexMark mark);
+
 /*!
     @}
 */
@@ -556,6 +648,7 @@ Component::Ptr<InterfaceT> create(const std::string& key, const std::string& loc
         return {};
     }
     detail::Access::loc(inst) = loc;
+    detail::registerLoc(inst);
     return Component::Ptr<InterfaceT>(dynamic_cast<InterfaceT*>(inst));
 }
 
@@ -0,0 +1,131 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#pragma once
+
+#include "common.h"
+#include <string>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+LM_NAMESPACE_BEGIN(cpu)
+
+// ----------------------------------------------------------------------------
+
+/*!
+    \addtogroup cpu
+    @{
+*/
+
+/*!
+    \brief Instruction set architecture used by the kernels.
+
+    \rst
+    The values are ordered so that a larger value is a superset of a smaller one.
+    \endrst
+*/
+enum class ISA {
+    Baseline,   //!< Instructions available in all supported CPUs.
+    SSE42,      //!< SSE4.2.
+    AVX2,       //!< AVX2 and FMA.
+    AVX512,     //!< AVX-512 (F, DQ, VL) in addition to AVX2.
+};
+
+/*!
+    \brief Detect the best ISA supported by the CPU and the OS.
+    \return Detected ISA.
+
+    \rst
+    The result is computed with CPUID instruction once and cached.
+    The support of the OS for saving the extended registers is checked as well.
+    ``ISA::Baseline`` is returned for the non-x86 architectures.
+    \endrst
+*/
+LM_PUBLIC_API ISA detect();
+
+/*!
+    \brief Select ISA of the kernels.
+    \param name Name of the ISA (``auto``, ``baseline``, ``sse42``, ``avx2``, or ``avx512``).
+    \return `false` if the name is invalid.
+
+    \rst
+    ``auto`` selects the ISA detected by :cpp:func:`lm::cpu::detect`.
+    An ISA unsupported by the CPU is capped by the detected one with warning.
+    The function is called by the framework on initialization
+    with the ``isa`` property given to :cpp:func:`lm::init`.
+    \endrst
+*/
+LM_PUBLIC_API bool select(const std::string& name);
+
+/*!
+    \brief Get the selected ISA.
+    \return Selected ISA.
+*/
+LM_PUBLIC_API ISA selected();
+
+/*!
+    \brief Get the name of an ISA.
+    \param isa ISA.
+    \return Name of the ISA.
+*/
+LM_PUBLIC_API std::string name(ISA isa);
+
+/*!
+    \brief Select the implementation according to the selected ISA.
+    \param baseline Implementation for the baseline ISA.
+    \param sse42 Implementation for SSE4.2.
+    \param avx2 Implementation for AVX2.
+    \param avx512 Implementation for AVX-512.
+    \return Selected implementation.
+
+    \rst
+    The implementations are usually the same function compiled for each ISA
+    with :c:macro:`LM_CPU_TARGET_SSE42`, :c:macro:`LM_CPU_TARGET_AVX2`,
+    or :c:macro:`LM_CPU_TARGET_AVX512`.
+    \endrst
+*/
+template <typename F>
+F dispatch(F baseline, F sse42, F avx2, F avx512) {
+    switch (selected()) {
+        case ISA::SSE42:  return sse42;
+        case ISA::AVX2:   return avx2;
+        case ISA::AVX512: return avx512;
+        default:          return baseline;
+    }
+}
+
+/*!
+    @}
+*/
+
+LM_NAMESPACE_END(cpu)
+LM_NAMESPACE_END(LM_NAMESPACE)
+
+// ----------------------------------------------------------------------------
+
+/*!
+    \brief Compile the function for the ISA.
+
+    \rst
+    Functions with these attributes may use the instructions of the ISA
+    and must be called only if the ISA is selected, e.g., via :cpp:func:`lm::cpu::dispatch`.
+    The inline functions called from the function are compiled for the ISA when inlined,
+    so write the body of the kernel as an inline function
+    and instantiate it with each attribute.
+    The attributes expand to nothing in the compilers without per-function targets (MSVC),
+    where all the variants are compiled for the baseline ISA.
+    \endrst
+*/
+#if LM_COMPILER_GCC || LM_COMPILER_CLANG
+#if LM_ARCH_X64 || LM_ARCH_X86
+#define LM_CPU_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define LM_CPU_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define LM_CPU_TARGET_AVX512 __attribute__((target("avx512f,avx512dq,avx512vl,avx2,fma")))
+#endif
+#endif
+#ifndef LM_CPU_TARGET_SSE42
+#define LM_CPU_TARGET_SSE42
+#define LM_CPU_TARGET_AVX2
+#define LM_CPU_TARGET_AVX512
+#endif
@@ -122,11 +122,16 @@ public:
     using PixelUpdateFunc = std::function<Vec3(Vec3 curr)>;
 
     /*!
-        \brief Atomically update a pixel value based on the current value.
+        \brief Update a pixel value based on the current value.
 
         \rst
-        This function is useful to implement user-defined atomic operation
-        to update a pixel value. The given function might be called more than once.
+        This function is useful to implement user-defined operation
+        to update a pixel value, e.g., incremental average.
+        The update is atomic with respect to the concurrent calls of this function for the same pixel.
+        It is not necessarily atomic with respect to the other functions writing the pixel,
+        e.g., :cpp:func:`lm::Film::splat` or :cpp:func:`lm::Film::setPixel`,
+        so do not mix them for the same pixel in a parallel loop.
+        The given function might be called more than once.
         \endrst
     */
     virtual void updatePixel(int x, int y, const PixelUpdateFunc& updateFunc) = 0;
@@ -142,6 +147,110 @@ public:
     */
     virtual void clear() = 0;
 
+    /*!
+        \brief Take a snapshot of the film.
+        \return `false` if the film does not support snapshots.
+
+        \rst
+        The snapshot keeps the pixel values of the color and all layers.
+        The schedulers take a snapshot after each completed pass
+        to discard the samples of a pass interrupted by the cancellation
+        with :cpp:func:`restoreSnapshot`.
+        \endrst
+    */
+    virtual bool takeSnapshot() {
+        return false;
+    }
+
+    /*!
+        \brief Restore the film to the last snapshot.
+        \return `false` if no snapshot is available.
+    */
+    virtual bool restoreSnapshot() {
+        return false;
+    }
+
+    // --------------------------------------------------------------------------------------------
+
+    /*!
+        \brief Get index of a layer.
+        \param name Name of the layer.
+        \return Index of the layer. -1 if the film has no layer of the name.
+
+        \rst
+        A film can hold named layers of arbitrary output variables (AOVs)
+        in addition to the color, e.g., ``albedo``, ``normal``, ``depth``, or ``variance``.
+        The color is the layer of index 0 named ``color``.
+        Renderers query the indices once and write the layers with :cpp:func:`splatLayer`.
+        The layers are scaled by :cpp:func:`rescale` and cleared by :cpp:func:`clear` with the color.
+        \endrst
+    */
+    virtual int layerIndex(const std::string& name) const {
+        return name == "color" ? 0 : -1;
+    }
+
+    /*!
+        \brief Splat the value to a layer by pixel coordinates.
+        \param layer Index of the layer.
+        \param x x coordinate of the film.
+        \param y y coordinate of the film.
+        \param v Value.
+    */
+    virtual void splatLayer(int layer, int x, int y, Vec3 v) {
+        if (layer == 0) {
+            splatPixel(x, y, v);
+        }
+    }
+
+    /*!
+        \brief Set the value of a layer by pixel coordinates.
+        \param layer Index of the layer.
+        \param x x coordinate of the film.
+        \param y y coordinate of the film.
+        \param v Value.
+    */
+    virtual void setLayerPixel(int layer, int x, int y, Vec3 v) {
+        if (layer == 0) {
+            setPixel(x, y, v);
+        }
+    }
+
+    /*!
+        \brief Get the value of a layer by pixel coordinates.
+        \param layer Index of the layer.
+        \param x x coordinate of the film.
+        \param y y coordinate of the film.
+        \return Value.
+    */
+    virtual Vec3 layerPixel(int layer, int x, int y) const {
+        LM_UNUSED(layer, x, y);
+        return {};
+    }
+
+    /*!
+        \brief Get buffer of a layer.
+        \param layer Index of the layer.
+        \return Film buffer.
+
+        \rst
+        Same as :cpp:func:`buffer` for the layer.
+        The buffer is valid until the next call of the function for the same layer.
+        \endrst
+    */
+    virtual FilmBuffer layerBuffer(int layer) {
+        return layer == 0 ? buffer() : FilmBuffer{};
+    }
+
+    /*!
+        \brief Save a layer.
+        \param layer Index of the layer.
+        \param outpath Output image path.
+        \return `false` if it fails to save the layer.
+    */
+    virtual bool saveLayer(int layer, const std::string& outpath) const {
+        return layer == 0 ? save(outpath) : false;
+    }
+
 public:
     /*!
         \brief Get aspect ratio.
@@ -112,6 +112,57 @@ public:
         \endrst
     */
     virtual Vec3 eval(const PointGeometry& geom, int comp, Vec3 wo) const = 0;
+
+    /*!
+        \brief Sample an emission ray from the light.
+        \param rng Random number generator.
+        \param transform Transformation of the light source.
+
+        \rst
+        This function samples a position :math:`\mathbf{y}` on the light source
+        and a direction :math:`\omega` emitted from the position.
+        Unlike :cpp:func:`lm::Light::sample`, the sampling does not depend on a point in the scene.
+        The weight is :math:`L_e(\mathbf{y},\omega) / (p_A(\mathbf{y}) p_{\sigma^\perp}(\omega\mid\mathbf{y}))`
+        where :math:`p_A` and :math:`p_{\sigma^\perp}` are evaluated by
+        :cpp:func:`lm::Light::pdfPosition` and :cpp:func:`lm::Light::pdfDirection` respectively.
+        The default implementation returns ``nullopt``, which means the light cannot be a start of light subpaths,
+        e.g., infinite lights.
+        \endrst
+    */
+    virtual std::optional<LightRaySample> sampleRay(Rng& rng, const Transform& transform) const {
+        LM_UNUSED(rng, transform);
+        return {};
+    }
+
+    /*!
+        \brief Evaluate pdf for position sampling in area measure.
+        \param geomL Point geometry on the light source.
+        \param transform Transformation of the light source.
+
+        \rst
+        This function evaluates the pdf of the position sampled by :cpp:func:`lm::Light::sampleRay`.
+        If the light source is degenerated (e.g., point light), the pdf is with respect to the counting measure.
+        \endrst
+    */
+    virtual Float pdfPosition(const PointGeometry& geomL, const Transform& transform) const {
+        LM_UNUSED(geomL, transform);
+        return 0_f;
+    }
+
+    /*!
+        \brief Evaluate pdf for direction sampling in projected solid angle measure.
+        \param geomL Point geometry on the light source.
+        \param comp Component index.
+        \param wo Outgoing direction from the point of the light source.
+
+        \rst
+        This function evaluates the pdf of the direction sampled by :cpp:func:`lm::Light::sampleRay`.
+        \endrst
+    */
+    virtual Float pdfDirection(const PointGeometry& geomL, int comp, Vec3 wo) const {
+        LM_UNUSED(geomL, comp, wo);
+        return 0_f;
+    }
 };
 
 /*!
@@ -18,6 +18,7 @@
 #include "debugio.h"
 #include "dist.h"
 #include "parallel.h"
+#include "cpu.h"
 #include "math.h"
 #include "assets.h"
 #include "mesh.h"
@@ -31,3 +32,4 @@
 #include "model.h"
 #include "objloader.h"
 #include "renderer.h"
+#include "sampler.h"
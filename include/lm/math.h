@@ -68,6 +68,26 @@ struct Ray {
     }
 };
 
+/*!
+    \brief Ray differential.
+
+    \rst
+    Differentials of the origin and direction of a ray
+    with respect to the offsets in the raster space [Igehy 1999].
+    The offsets are usually one pixel in horizontal (x) and vertical (y) directions.
+    Used to estimate the footprint of a ray on the surface for texture filtering.
+    \endrst
+*/
+struct RayDifferential {
+    Vec3 dodx, dody;    //!< Differentials of the origin.
+    Vec3 dddx, dddy;    //!< Differentials of the direction.
+
+    template <typename Archive>
+    void serialize(Archive& ar) {
+        ar(dodx, dody, dddx, dddy);
+    }
+};
+
 /*!
     \brief Axis-aligned bounding box
 */
@@ -176,11 +196,24 @@ struct Bound {
 
 LM_NAMESPACE_BEGIN(detail)
 
+/*
+    Generate a sample from the sample generator.
+    Defined in sampler.cpp to avoid the dependency to sampler.h.
+*/
+LM_PUBLIC_API double samplerU(const Sampler* sampler, int x, int y, long long sampleIndex, int dim);
+
 class RngImplBase {
 private:
     std::mt19937 eng;
     std::uniform_real_distribution<double> dist;  // Always use double
 
+    // Attached sample generator and the current sample
+    const Sampler* sampler_ = nullptr;
+    int x_ = 0;
+    int y_ = 0;
+    long long sampleIndex_ = 0;
+    int dim_ = 0;
+
 protected:
     RngImplBase() {
         // Initialize eng with random_device
@@ -189,7 +222,21 @@ protected:
     RngImplBase(int seed) {
         eng.seed(seed);
     }
-    double u() { return dist(eng); }
+    double u() {
+        if (sampler_) {
+            return samplerU(sampler_, x_, y_, sampleIndex_, dim_++);
+        }
+        return dist(eng);
+    }
+
+public:
+    void attach(const Sampler* sampler, int x, int y, long long sampleIndex) {
+        sampler_ = sampler;
+        x_ = x;
+        y_ = y;
+        sampleIndex_ = sampleIndex;
+        dim_ = 0;
+    }
 };
 
 template <typename F>
@@ -258,6 +305,13 @@ LM_NAMESPACE_END(detail)
     .. cpp:function:: Float u()
 
        Generate an uniform random number in [0,1).
+
+    .. cpp:function:: void attach(const Sampler* sampler, int x, int y, long long sampleIndex)
+
+       Draw the subsequent numbers from the sample generator
+       for the ``sampleIndex``-th sample of the pixel ``(x,y)``.
+       Each call of ``u()`` consumes the next dimension of the sample.
+       Passing ``nullptr`` restores the pseudo random number generator.
     \endrst
 */
 using Rng = detail::RngImpl<Float>;
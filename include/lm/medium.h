@@ -31,6 +31,20 @@ class Medium : public Component {
 public:
     /*!
         \brief Sample a distance in a ray direction.
+
+        \rst
+        The sampling must be consistent with respect to ``tmax``, that is,
+        a medium interaction sampled at the distance ``t`` must be sampled in the same way
+        with any ``tmax > t``, and the weight of the surface interaction must be one.
+        The scene utilizes this property to sample a distance with ``tmax = Inf``
+        and to trace the ray only up to the sampled distance.
+
+        Chromatic media (see :cpp:func:`Medium::chromatic`) are exempted from the requirement
+        on the weight of the surface interaction. The distance is sampled once for all channels
+        and the weight of the surface interaction is the ratio of the per-channel transmittance
+        to the probability of passing through the medium.
+        The scene samples chromatic media with ``tmax`` set to the distance to the next surface.
+        \endrst
     */
     virtual std::optional<MediumDistanceSample> sampleDistance(Rng& rng, Ray ray, Float tmin, Float tmax) const = 0;
 
@@ -39,6 +53,21 @@ public:
     */
     virtual std::optional<Vec3> evalTransmittance(Rng& rng, Ray ray, Float tmin, Float tmax) const = 0;
 
+    /*!
+        \brief Get the bound of the region occupied by the medium.
+
+        \rst
+        The medium must not affect the rays outside of the bound.
+        The scene uses the bound to skip the media which do not overlap with the ray.
+        \endrst
+    */
+    virtual Bound bound() const = 0;
+
+    /*!
+        \brief Check if the extinction coefficient differs among color channels.
+    */
+    virtual bool chromatic() const = 0;
+
     /*!
         \brief Check if the medium has emissive component.
     */
@@ -21,6 +21,9 @@ LM_NAMESPACE_BEGIN(LM_NAMESPACE)
     \rst
     This component interface represents a triangle mesh,
     respondible for handling or manipulating triangle mesh.
+    A mesh can also represent a set of analytic shapes like spheres, disks, or curves
+    instead of triangles, so that the primitives like particles or hairs
+    can be rendered without tessellation. See :cpp:func:`shapeType`.
     \endrst
 */
 class Mesh : public Component {
@@ -51,6 +54,34 @@ public:
         Point p3;   //!< Third vertex.
     };
 
+    /*!
+        \brief Type of the shapes of a mesh.
+    */
+    enum class ShapeType {
+        Triangle,       //!< Triangle.
+        Sphere,         //!< Sphere.
+        Disk,           //!< Oriented disk.
+        RoundCurve,     //!< Linear curve segment with circular cross section.
+        FlatCurve,      //!< Linear curve segment as a ribbon facing the ray.
+    };
+
+    /*!
+        \brief Analytic shape.
+
+        \rst
+        Represents an element of the mesh defined by an analytic shape.
+        For a sphere, ``p1`` is the center.
+        For a disk, ``p1`` is the center and ``p2`` is the normal.
+        For a curve segment, ``p1`` and ``p2`` are the end points.
+        \endrst
+    */
+    struct Shape {
+        ShapeType type;     //!< Type of the shape.
+        Vec3 p1;            //!< First point.
+        Vec3 p2;            //!< Second point or normal.
+        Float r;            //!< Radius.
+    };
+
 public:
     /*!
         \brief Callback function for processing a triangle.
@@ -86,10 +117,108 @@ public:
     virtual Point surfacePoint(int face, Vec2 uv) const = 0;
 
     /*!
+        \brief Get the number of triangles.
     */
     virtual int numTriangles() const = 0;
+
+    // --------------------------------------------------------------------------------------------
+
+    /*!
+        \brief Get the type of the shapes of the mesh.
+
+        \rst
+        A mesh consists of the shapes of a single type.
+        If the type is not :cpp:enumerator:`ShapeType::Triangle`,
+        the mesh has no triangles and the shapes are enumerated by :cpp:func:`foreachShape`.
+        Then the surface coordinates given to :cpp:func:`surfacePoint`
+        are computed by :cpp:func:`lm::mesh::shapeCoordinates`.
+        \endrst
+    */
+    virtual ShapeType shapeType() const {
+        return ShapeType::Triangle;
+    }
+
+    /*!
+        \brief Callback function for processing an analytic shape.
+        \param face Face index.
+        \param shape Shape.
+    */
+    using ProcessShapeFunc = std::function<void(int face, const Shape& shape)>;
+
+    /*!
+        \brief Iterate analytic shapes in the mesh.
+        \param processShape Callback function to process a shape.
+    */
+    virtual void foreachShape(const ProcessShapeFunc& processShape) const {
+        LM_UNUSED(processShape);
+    }
+
+    /*!
+        \brief Get analytic shape by face index.
+    */
+    virtual Shape shapeAt(int face) const {
+        LM_UNUSED(face);
+        LM_UNREACHABLE_RETURN();
+    }
+
+    /*!
+        \brief Get the number of analytic shapes.
+    */
+    virtual int numShapes() const {
+        return 0;
+    }
 };
 
+// ------------------------------------------------------------------------------------------------
+
+LM_NAMESPACE_BEGIN(mesh)
+
+/*!
+    \brief Transform an analytic shape.
+    \param shape Shape.
+    \param transform Transformation.
+
+    \rst
+    The radius is scaled uniformly, so the transformation is expected to be a similarity transformation.
+    \endrst
+*/
+LM_PUBLIC_API Mesh::Shape transformShape(const Mesh::Shape& shape, const Transform& transform);
+
+/*!
+    \brief Compute the bound of an analytic shape.
+*/
+LM_PUBLIC_API Bound shapeBound(const Mesh::Shape& shape);
+
+/*!
+    \brief Compute the surface coordinates of a point on an analytic shape.
+    \param shape Shape.
+    \param p Point on the shape.
+    \param d Direction of the ray hitting the point.
+
+    \rst
+    The coordinates are the spherical coordinates for a sphere,
+    the polar coordinates for a disk, and the pair of the position along the segment and the angle around it for a curve.
+    The point and the direction must be in the same coordinates as the shape.
+    The direction is used for the flat curves whose orientation depends on the ray.
+    \endrst
+*/
+LM_PUBLIC_API Vec2 shapeCoordinates(const Mesh::Shape& shape, Vec3 p, Vec3 d);
+
+/*!
+    \brief Compute surface geometry information at a point on an analytic shape.
+    \param shape Shape.
+    \param uv Surface coordinates given by :cpp:func:`shapeCoordinates`.
+
+    \rst
+    The texture coordinates are the surface coordinates.
+    The point of a flat curve is on its center line
+    because the offset across the ribbon facing the ray is not in the coordinates.
+    \endrst
+*/
+LM_PUBLIC_API Mesh::Point shapePoint(const Mesh::Shape& shape, Vec2 uv);
+
+LM_NAMESPACE_END(mesh)
+
 /*!
     @}
 */
@@ -7,6 +7,7 @@
 
 #include "component.h"
 #include "math.h"
+#include "serial.h"
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 LM_NAMESPACE_BEGIN(objloader)
@@ -26,7 +27,7 @@ struct OBJSurfaceGeometry {
 
     template <typename Archive>
     void serialize(Archive& ar) {
-        ar(ps, ns, ts);
+        ar(serial::raw(ps), serial::raw(ns), serial::raw(ts));
     }
 };
 
@@ -107,6 +108,11 @@ LM_PUBLIC_API bool load(
 
 /*!
     \brief OBJ loader context.
+
+    \rst
+    The user contexts used from the different threads might call :cpp:func:`load` concurrently,
+    so the implementation must not keep the states of the file being loaded in the members.
+    \endrst
 */
 class OBJLoaderContext : public Component {
 public:
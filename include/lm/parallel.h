@@ -6,6 +6,7 @@
 #pragma once
 
 #include "component.h"
+#include <atomic>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 LM_NAMESPACE_BEGIN(parallel)
@@ -90,6 +91,67 @@ LM_INLINE void foreach(long long numSamples, const ParallelProcessFunc& processF
     foreach(numSamples, processFunc, [](long long) {});
 }
 
+/*!
+    \brief Cancellation flag of parallel loops.
+*/
+using CancelFlag = std::atomic<bool>;
+
+/*!
+    \brief Bind a cancellation flag to the current thread.
+    \param flag Cancellation flag. nullptr to use the flag shared by the threads without binding.
+
+    \rst
+    The parallel loops started from the current thread, as well as
+    :cpp:func:`lm::parallel::requestCancel`, :cpp:func:`lm::parallel::resetCancel`,
+    and :cpp:func:`lm::parallel::cancelRequested` called from the thread, use the bound flag.
+    Independent jobs, e.g., the render sessions of the user contexts,
+    bind their own flags so that cancelling one of them does not affect the others.
+    The flag must outlive the binding.
+    \endrst
+*/
+LM_PUBLIC_API void bindCancelFlag(CancelFlag* flag);
+
+/*!
+    \brief Get the cancellation flag used by the current thread.
+    \return Reference to the cancellation flag.
+*/
+LM_PUBLIC_API CancelFlag& cancelFlag();
+
+/*!
+    \brief Scope guard of :cpp:func:`lm::parallel::bindCancelFlag`.
+*/
+class ScopedCancelFlag {
+private:
+    CancelFlag* prev_;
+
+public:
+    ScopedCancelFlag(CancelFlag* flag) : prev_(&cancelFlag()) { bindCancelFlag(flag); }
+    ~ScopedCancelFlag() { bindCancelFlag(prev_); }
+    LM_DISABLE_COPY_AND_MOVE(ScopedCancelFlag)
+};
+
+/*!
+    \brief Request cancellation of parallel loops.
+
+    \rst
+    This function requests the running and subsequent parallel loops
+    using the cancellation flag bound to the current thread to skip the remaining iterations.
+    The request is kept until :cpp:func:`lm::parallel::resetCancel` is called.
+    \endrst
+*/
+LM_PUBLIC_API void requestCancel();
+
+/*!
+    \brief Reset the cancellation request.
+*/
+LM_PUBLIC_API void resetCancel();
+
+/*!
+    \brief Check if the cancellation is requested.
+    \return `true` if the cancellation is requested.
+*/
+LM_PUBLIC_API bool cancelRequested();
+
 /*!
     \brief Parallel context.
     
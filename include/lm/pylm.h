@@ -354,6 +354,7 @@ static pybind11::object createCompWrap(const char* name, const char* loc) {
         return pybind11::object();
     }
     lm::comp::detail::Access::loc(inst) = loc;
+    lm::comp::detail::registerLoc(inst);
     return castToPythonObject<InterfaceT>(inst);
 }
 
@@ -367,6 +368,7 @@ static pybind11::object createCompWrap(const char* name, const char* loc, const
         return pybind11::object();
     }
     lm::comp::detail::Access::loc(inst) = loc;
+    lm::comp::detail::registerLoc(inst);
     if (!inst->construct(prop)) {
         return pybind11::object();
     }
@@ -24,6 +24,19 @@ public:
     */
     virtual bool requiresScene() const { return true; }
 
+    /*!
+        \brief Continue the sample indices from the previous rendering.
+        \param enable If true, the subsequent renderings continue the sample indices.
+
+        \rst
+        The render session calls this function between the progressive passes
+        so that the accumulated passes do not repeat the same samples.
+        The renderers dispatching a scheduler forward it to
+        :cpp:func:`lm::scheduler::Scheduler::continueSamples`.
+        \endrst
+    */
+    virtual void continueSamples(bool enable) { LM_UNUSED(enable); }
+
     /*!
         \brief Process rendering.
     */
@@ -0,0 +1,53 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#pragma once
+
+#include "component.h"
+#include "math.h"
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+/*!
+    \addtogroup sampler
+    @{
+*/
+
+/*!
+    \brief Sample generator.
+
+    \rst
+    This interface provides an abstraction of the sequences of samples
+    used to generate the paths. A sample is a point in the infinite dimensional
+    unit hypercube identified by a pixel and a sample index of the pixel,
+    and the function returns a coordinate of the sample.
+    Unlike the pseudo random number generator, the generated values do not depend on
+    the order of the evaluation and thus on how the scheduler distributes the work.
+    The implementation must be thread-safe.
+
+    The renderers attach a sample generator to the random number generator with
+    :cpp:func:`Rng::attach` so that the values consumed by
+    :cpp:func:`Scene::sampleRay`, :cpp:func:`Scene::sampleLight`, etc. are
+    drawn from the sample generator.
+    \endrst
+*/
+class Sampler : public Component {
+public:
+    /*!
+        \brief Generate a coordinate of a sample.
+        \param x Pixel x coordinate.
+        \param y Pixel y coordinate.
+        \param sampleIndex Index of the sample in the pixel.
+        \param dim Dimension of the coordinate.
+        \return Generated value in [0,1).
+    */
+    virtual Float u(int x, int y, long long sampleIndex, int dim) const = 0;
+};
+
+/*!
+    @}
+*/
+
+LM_NAMESPACE_END(LM_NAMESPACE)
@@ -51,6 +51,12 @@ struct DistanceSample {
     Vec3 weight;            //!< Contribution divided by probability.
 };
 
+// Path states are kept on the stack of the render loop and copied by value,
+// so they must not own any heap memory.
+static_assert(std::is_trivially_copyable_v<SceneInteraction>);
+static_assert(std::is_trivially_copyable_v<RaySample>);
+static_assert(std::is_trivially_copyable_v<DistanceSample>);
+
 // ------------------------------------------------------------------------------------------------
 
 enum class SceneNodeType {
@@ -246,6 +252,13 @@ public:
         \brief Build acceleration structure.
         \param name Name of the acceleration structure.
         \param prop Property for configuration.
+
+        \rst
+        If ``prop`` contains ``"cache": true``, the existing acceleration structure
+        (e.g., one restored from a snapshot) is reused when it was built with the same
+        name and property from the scene with the same content.
+        Otherwise the acceleration structure is always rebuilt.
+        \endrst
     */
     virtual void build(const std::string& name, const Json& prop) = 0;
 
@@ -255,6 +268,36 @@ public:
     virtual std::optional<SceneInteraction> intersect(
         Ray ray, Float tmin = Eps, Float tmax = Inf) const = 0;
 
+    /*!
+        \brief Compute closest intersection point with ray differential.
+
+        \rst
+        In addition to :cpp:func:`intersect`, this function computes the differentials of
+        the texture coordinates of the surface point (``dtdx`` and ``dtdy`` in :cpp:class:`PointGeometry`)
+        from the ray differential ``rd``, which are used for texture filtering.
+        \endrst
+    */
+    virtual std::optional<SceneInteraction> intersect(
+        Ray ray, const RayDifferential& rd, Float tmin = Eps, Float tmax = Inf) const
+    {
+        LM_UNUSED(rd);
+        return intersect(ray, tmin, tmax);
+    }
+
+    /*!
+        \brief Check if the ray segment intersects with a surface.
+
+        \rst
+        Unlike :cpp:func:`intersect`, this function does not evaluate the surface attributes
+        of the hit point, and the environment light is not considered as a hit.
+        The function is used for the visibility tests.
+        \endrst
+    */
+    virtual bool occluded(Ray ray, Float tmin = Eps, Float tmax = Inf) const {
+        const auto hit = intersect(ray, tmin, tmax);
+        return hit && !hit->geom.infinite;
+    }
+
     /*!
         \brief Check if two surface points are mutually visible.
     */
@@ -270,8 +313,7 @@ public:
                     const auto d = glm::distance(sp1.geom.p, sp2.geom.p);
                     return d * (1_f - Eps);
                 }();
-            // Exclude environent light from intersection test with tmax < Inf
-            return !intersect(Ray{sp1.geom.p, wo}, Eps, tmax);
+            return !occluded(Ray{sp1.geom.p, wo}, Eps, tmax);
         };
         if (sp1.geom.infinite) {
             return visible_(sp2, sp1);
@@ -299,22 +341,49 @@ public:
         \brief Generate a primary ray.
         \param rp Raster position in [0,1]^2.
         \param aspectRatio Aspect ratio of the film.
+        \param camera Index of the camera primitive node. -1 for the camera of the scene.
         \return Generated primary ray.
+
+        \rst
+        The scene can contain multiple camera primitives, e.g., to render multiple views
+        of the scene in a batch. The camera of the scene is the camera primitive added last.
+        The functions taking ``camera`` parameter use the specified camera instead of the camera of the scene.
+        \endrst
     */
-    virtual Ray primaryRay(Vec2 rp, Float aspectRatio) const = 0;
+    virtual Ray primaryRay(Vec2 rp, Float aspectRatio, int camera = -1) const = 0;
+
+    /*!
+        \brief Compute the differential of a primary ray.
+        \param rp Raster position in [0,1]^2.
+        \param drp Offsets of the raster position, usually the size of a pixel.
+        \param aspectRatio Aspect ratio of the film.
+        \param camera Index of the camera primitive node. -1 for the camera of the scene.
+        \return Differential of the primary ray. nullopt if unsupported by the camera.
+    */
+    virtual std::optional<RayDifferential> primaryRayDifferential(Vec2 rp, Vec2 drp, Float aspectRatio, int camera = -1) const {
+        LM_UNUSED(rp, drp, aspectRatio, camera);
+        return {};
+    }
 
     /*!
         \brief Compute a raser position.
         \param wo Primary ray direction.
         \param aspectRatio Aspect ratio of the film.
+        \param camera Index of the camera primitive node. -1 for the camera of the scene.
         \return Raster position.
     */
-    virtual std::optional<Vec2> rasterPosition(Vec3 wo, Float aspectRatio) const = 0;
+    virtual std::optional<Vec2> rasterPosition(Vec3 wo, Float aspectRatio, int camera = -1) const = 0;
     
     /*!
         \brief Sample a ray given surface point and incident direction.
         \rst
         (x,wo) ~ p(x,wo|sp,wi)
+
+        If ``sp`` is the camera terminator, the function samples a primary ray
+        from the camera specified by the terminator.
+        If ``sp`` is the light terminator, the function samples an emission ray
+        from a light selected uniformly, where the sampled position is returned as the light endpoint.
+        Lights not supporting :cpp:func:`lm::Light::sampleRay` (e.g., infinite lights) yield ``nullopt``.
         \endrst
     */
     virtual std::optional<RaySample> sampleRay(Rng& rng, const SceneInteraction& sp, Vec3 wi) const = 0;
@@ -325,7 +394,7 @@ public:
         (x,wo) ~ p(x,wo|raster window)
         \endrst
     */
-    virtual std::optional<RaySample> samplePrimaryRay(Rng& rng, Vec4 window, Float aspectRatio) const = 0;
+    virtual std::optional<RaySample> samplePrimaryRay(Rng& rng, Vec4 window, Float aspectRatio, int camera = -1) const = 0;
 
     /*!
         \brief Sample a position on a light.
@@ -347,6 +416,15 @@ public:
     */
     virtual Float pdfLight(const SceneInteraction& sp, const SceneInteraction& spL, Vec3 wo) const = 0;
 
+    /*!
+        \brief Evaluate pdf for position sampling of a light endpoint.
+        \rst
+        Pdf in area measure of the position of light endpoint sampled by :cpp:func:`lm::Scene::sampleRay`
+        with the light terminator, including the probability of the light selection.
+        \endrst
+    */
+    virtual Float pdfLightPosition(const SceneInteraction& spL) const = 0;
+
     // --------------------------------------------------------------------------------------------
 
     /*!
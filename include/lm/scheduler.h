@@ -6,6 +6,8 @@
 #pragma once
 
 #include "component.h"
+#include "math.h"
+#include "parallel.h"
 #include <chrono>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
@@ -39,6 +41,78 @@ public:
         \return Processed samples per pixel.
     */
     virtual long long run(const ProcessFunc& process) const = 0;
+
+    /*!
+        \brief Number of samples restored from the checkpoint.
+        \return Samples per pixel restored by the last invocation of run().
+
+        \rst
+        When the scheduler resumes the rendering from a checkpoint,
+        the sample indices given to the callback function start from this value.
+        :cpp:class:`lm::scheduler::ThreadRngs` mixes the value to the fixed seed
+        so that the resumed rendering does not repeat the random numbers of the restored samples.
+        \endrst
+    */
+    virtual long long restoredSamples() const { return 0; }
+
+    /*!
+        \brief Continue the sample indices from the previous run.
+        \param enable If true, the sample indices of the subsequent runs continue from the end of the previous run.
+                      Otherwise they start from zero.
+
+        \rst
+        The render session repeats the rendering with the same renderer as progressive passes.
+        Continuing the sample indices prevents the passes from repeating the same samples
+        of the sample generators or of the fixed seed.
+        \endrst
+    */
+    virtual void continueSamples(bool enable) { LM_UNUSED(enable); }
+
+    /*!
+        \brief Offset of the sample indices.
+        \return Sample index given to the callback function first in the last invocation of run(),
+                excluding the samples restored from the checkpoint.
+    */
+    virtual long long sampleOffset() const { return 0; }
+};
+
+/*!
+    \brief Random number generators of the threads for a run of a scheduler.
+
+    \rst
+    The renderers create an instance for each invocation of :cpp:func:`Scheduler::run`
+    and get the generator of the thread in the callback function.
+    A generator is seeded when it is first used in the run, that is,
+    after the scheduler has restored the checkpoint.
+    If ``seed`` is given, the generator of the thread ``threadid`` is seeded with ``seed + threadid``
+    offset by the sample offset and the samples restored from the checkpoint. Otherwise it is seeded randomly.
+    \endrst
+*/
+class ThreadRngs {
+private:
+    std::optional<unsigned int> seed_;
+    const Scheduler* sched_;
+    std::vector<std::optional<Rng>> rngs_;
+
+public:
+    ThreadRngs(std::optional<unsigned int> seed, const Scheduler* sched = nullptr)
+        : seed_(seed)
+        , sched_(sched)
+        , rngs_(parallel::numThreads())
+    {}
+
+    /*!
+        \brief Get the generator of the thread.
+        \param threadid Thread index.
+    */
+    Rng& operator[](int threadid) {
+        auto& rng = rngs_[threadid];
+        if (!rng) {
+            const auto first = sched_ ? sched_->sampleOffset() + sched_->restoredSamples() : 0;
+            rng.emplace(seed_ ? int(*seed_) + threadid + int(first) * int(rngs_.size()) : math::rngSeed());
+        }
+        return *rng;
+    }
 };
 
 /*!
@@ -238,6 +238,207 @@ LM_NAMESPACE_BEGIN(serial)
     @{
 */
 
+LM_NAMESPACE_BEGIN(detail)
+
+// Marker written in front of each raw block.
+// The marker is stored in the native byte order so that
+// a mismatch of the byte order can be detected on load.
+constexpr std::uint32_t RawBlockMarker = 0x4c4d5242;  // 'LMRB'
+
+LM_NAMESPACE_END(detail)
+
+/*!
+    \brief Raw binary block of trivially copyable elements.
+    \tparam T Element type.
+
+    \rst
+    Wrapper to serialize ``std::vector<T>`` as a single length-prefixed raw block.
+    The default archive serializes compound elements like ``Vec3`` one scalar at a time
+    with byte order conversion, which dominates the cost of serializing large arrays
+    such as mesh positions or BVH nodes.
+    The raw block is instead written in the native byte order with a single write
+    and read back to the (aligned) storage of the vector with a single read.
+    The byte order of the block is validated with a marker on load.
+    Use :cpp:func:`lm::serial::raw` function to create the wrapper.
+    \endrst
+*/
+template <typename T>
+struct RawVector {
+    static_assert(std::is_trivially_copyable_v<T>, "Raw block requires trivially copyable type");
+
+    std::vector<T>& v;  //!< Reference to the serialized vector.
+
+    template <typename Archive>
+    void save(Archive& ar) const {
+        #if LM_USE_JSON_ARCHIVE
+        ar(v);
+        #else
+        const auto marker = detail::RawBlockMarker;
+        ar(cereal::binary_data(reinterpret_cast<const std::uint8_t*>(&marker), sizeof(marker)));
+        ar(std::uint32_t(sizeof(T)), std::uint64_t(v.size()));
+        if (!v.empty()) {
+            ar(cereal::binary_data(reinterpret_cast<const std::uint8_t*>(v.data()), sizeof(T) * v.size()));
+        }
+        #endif
+    }
+
+    template <typename Archive>
+    void load(Archive& ar) {
+        #if LM_USE_JSON_ARCHIVE
+        ar(v);
+        #else
+        std::uint32_t marker;
+        ar(cereal::binary_data(reinterpret_cast<std::uint8_t*>(&marker), sizeof(marker)));
+        if (marker != detail::RawBlockMarker) {
+            throw std::runtime_error(
+                "Invalid raw block. Serialized data might be created on the platform with different byte order.");
+        }
+        std::uint32_t elementSize;
+        std::uint64_t n;
+        ar(elementSize, n);
+        if (elementSize != sizeof(T)) {
+            throw std::runtime_error(fmt::format(
+                "Inconsistent element size of raw block [expected='{}', actual='{}']", sizeof(T), elementSize));
+        }
+        v.resize(n);
+        if (n > 0) {
+            ar(cereal::binary_data(reinterpret_cast<std::uint8_t*>(v.data()), sizeof(T) * n));
+        }
+        #endif
+    }
+};
+
+/*!
+    \brief Make raw block wrapper of a vector.
+    \param v Vector of trivially copyable elements.
+
+    \rst
+    Use this function inside the serialization function
+    to enable fast-path serialization of large arrays. Example:
+
+    .. code-block:: cpp
+
+        LM_SERIALIZE_IMPL(ar) {
+            ar(serial::raw(ps_), serial::raw(ns_));
+        }
+    \endrst
+*/
+template <typename T>
+RawVector<T> raw(std::vector<T>& v) {
+    return RawVector<T>{ v };
+}
+
+// ----------------------------------------------------------------------------
+
+/*!
+    \brief Read-only memory-mapped file.
+
+    \rst
+    The contents of the file are mapped as shared read-only pages,
+    thus multiple processes mapping the same file share the physical memory.
+    Use :cpp:func:`lm::serial::mapFile` function to create an instance.
+    \endrst
+*/
+class MappedFile {
+public:
+    virtual ~MappedFile() = default;
+
+    /*!
+        \brief Get pointer to the beginning of the mapped region.
+    */
+    virtual const char* data() const = 0;
+
+    /*!
+        \brief Get size of the mapped region in bytes.
+    */
+    virtual std::size_t size() const = 0;
+};
+
+/*!
+    \brief Map a file into memory.
+    \param path Path to the file.
+    \return Mapped file. nullptr if failed.
+*/
+LM_PUBLIC_API std::shared_ptr<MappedFile> mapFile(const std::string& path);
+
+/*!
+    \brief Stream buffer reading from a memory region.
+
+    \rst
+    The stream buffer refers to the memory region without copying.
+    Combined with ``std::istream``, we can deserialize an object
+    directly from a part of :cpp:class:`lm::serial::MappedFile`.
+    \endrst
+*/
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(const char* data, std::size_t size) {
+        auto* p = const_cast<char*>(data);
+        setg(p, p, p + size);
+    }
+};
+
+// ----------------------------------------------------------------------------
+
+/*!
+    \brief Entry of the table of contents of a snapshot.
+
+    \rst
+    A snapshot is a container of the serialized state where
+    each asset is stored in an independent block.
+    An entry associates an asset with the location of the block.
+    \endrst
+*/
+struct SnapshotEntry {
+    std::string name;       //!< Name of the asset.
+    std::string key;        //!< Implementation key of the asset.
+    std::uint64_t offset;   //!< Offset of the block from the beginning of the snapshot.
+    std::uint64_t size;     //!< Size of the block in bytes.
+
+    template <typename Archive>
+    void serialize(Archive& ar) {
+        ar(name, key, offset, size);
+    }
+};
+
+/*!
+    \brief Header of a snapshot.
+*/
+struct SnapshotHeader {
+    char magic[8];              //!< Magic number.
+    std::uint32_t marker;       //!< Byte order marker.
+    std::uint32_t version;      //!< Version of the format.
+    std::uint64_t tocOffset;    //!< Offset of the table of contents.
+    std::uint64_t tocSize;      //!< Size of the table of contents.
+    std::uint64_t stateOffset;  //!< Offset of the block containing non-asset states.
+    std::uint64_t stateSize;    //!< Size of the block containing non-asset states.
+};
+
+//! Magic number of the snapshot.
+constexpr char SnapshotMagic[8] = { 'L', 'M', 'S', 'N', 'A', 'P', 'S', 'H' };
+
+//! Current version of the snapshot format.
+constexpr std::uint32_t SnapshotVersion = 1;
+
+//! Alignment of the blocks in a snapshot. Blocks are aligned to the page boundary.
+constexpr std::uint64_t SnapshotAlignment = 4096;
+
+/*!
+    \brief Pad the stream to the alignment of the snapshot blocks.
+    \param os Output stream.
+    \return Aligned offset.
+*/
+LM_INLINE std::uint64_t padSnapshot(std::ostream& os) {
+    const auto pos = std::uint64_t(os.tellp());
+    const auto aligned = (pos + SnapshotAlignment - 1) / SnapshotAlignment * SnapshotAlignment;
+    for (auto i = pos; i < aligned; i++) {
+        os.put(0);
+    }
+    return aligned;
+}
+
+// ----------------------------------------------------------------------------
+
 /*!
     \brief Serialize an object with given type.
 */
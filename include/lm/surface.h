@@ -56,6 +56,7 @@ struct PointGeometry {
     };
     Vec2 t;                 //!< Texture coordinates.
     Vec3 u, v;              //!< Orthogonal tangent vectors.
+    Vec2 dtdx, dtdy;        //!< Differentials of texture coordinates in raster space. Zero if unavailable.
 
     /*!
         \brief Make degenerated point.
@@ -71,6 +72,8 @@ struct PointGeometry {
         geom.degenerated = true;
         geom.infinite = false;
         geom.p = p;
+        geom.dtdx = Vec2(0_f);
+        geom.dtdy = Vec2(0_f);
         return geom;
     }
 
@@ -88,6 +91,8 @@ struct PointGeometry {
         geom.degenerated = false;
         geom.infinite = true;
         geom.wo = wo;
+        geom.dtdx = Vec2(0_f);
+        geom.dtdy = Vec2(0_f);
         return geom;
     }
 
@@ -110,6 +115,8 @@ struct PointGeometry {
         geom.n = n;
         geom.t = t;
         std::tie(geom.u, geom.v) = math::orthonormalBasis(n);
+        geom.dtdx = Vec2(0_f);
+        geom.dtdy = Vec2(0_f);
         return geom;
     }
 
@@ -274,9 +281,13 @@ struct SceneInteraction {
 
     /*!
         \brief Make camera terminator.
+        \param window Raster window.
+        \param aspectRatio Aspect ratio of the film.
+        \param camera Index of the camera primitive node. -1 for the camera of the scene.
     */
-    static SceneInteraction makeCameraTerminator(Vec4 window, Float aspectRatio) {
+    static SceneInteraction makeCameraTerminator(Vec4 window, Float aspectRatio, int camera = -1) {
         SceneInteraction si;
+        si.primitive = camera;
         si.endpoint = false;
         si.medium = false;
         si.terminator = TerminatorType::Camera;
@@ -284,6 +295,17 @@ struct SceneInteraction {
         si.cameraCond.aspectRatio = aspectRatio;
         return si;
     }
+
+    /*!
+        \brief Make light terminator.
+    */
+    static SceneInteraction makeLightTerminator() {
+        SceneInteraction si;
+        si.endpoint = false;
+        si.medium = false;
+        si.terminator = TerminatorType::Light;
+        return si;
+    }
 };
 
 /*!
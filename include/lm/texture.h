@@ -74,6 +74,24 @@ public:
     */
     virtual Vec3 eval(Vec2 t) const = 0;
 
+    /*!
+        \brief Evaluate color component of the texture with filtering.
+        \param t Texture coordinates.
+        \param dtdx Differential of the texture coordinates in x direction of raster space.
+        \param dtdy Differential of the texture coordinates in y direction of raster space.
+
+        \rst
+        This function evaluates color of the texture filtered over the footprint
+        spanned by the differentials ``dtdx`` and ``dtdy``,
+        which are usually given by :cpp:class:`PointGeometry`.
+        The default implementation ignores the footprint and calls :cpp:func:`lm::Texture::eval`.
+        \endrst
+    */
+    virtual Vec3 eval(Vec2 t, Vec2 dtdx, Vec2 dtdy) const {
+        LM_UNUSED(dtdx, dtdy);
+        return eval(t);
+    }
+
     /*!
         \brief Evaluate color component of the texture by pixel coordinates.
         \param x x coordinate of the texture.
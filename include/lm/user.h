@@ -184,6 +184,56 @@ LM_PUBLIC_API FilmBuffer buffer(const std::string& filmName);
 
 // ----------------------------------------------------------------------------
 
+/*!
+    \brief Start an interactive render session.
+    \param filmName Identifier of the film asset which the renderer outputs to.
+
+    \rst
+    This function starts progressive rendering in a background thread and returns immediately.
+    The session repeatedly dispatches the current renderer and accumulates the result
+    of each completed pass, which can be queried with :cpp:func:`lm::sessionBuffer`.
+    Configure the renderer with a small number of samples per pass, e.g., ``spp=1``.
+    Each pass continues the sample indices of the previous pass
+    so that the passes do not repeat the samples of the sample generator or the fixed seed.
+
+    The session is cancelled when the state of the framework is modified
+    via the API, e.g., replacing the camera by :cpp:func:`lm::asset`.
+    The cancellation only affects the parallel loops of the context owning the session.
+    Call this function again after the modification to restart the session.
+    The acceleration structure and the threads are reused for the restarted session.
+    If a session is already running, it is restarted with the cleared accumulation.
+    \endrst
+*/
+LM_PUBLIC_API void startSession(const std::string& filmName);
+
+/*!
+    \brief Stop the interactive render session.
+
+    \rst
+    This function cancels the in-flight rendering pass and waits for the session to finish.
+    The accumulated image is kept until the next session starts.
+    \endrst
+*/
+LM_PUBLIC_API void stopSession();
+
+/*!
+    \brief Get the snapshot of the image accumulated in the session.
+    \return Film buffer.
+
+    \rst
+    The returned buffer is averaged over the passes completed so far.
+    The buffer is owned by the framework and valid until the next call of the function.
+    \endrst
+*/
+LM_PUBLIC_API FilmBuffer sessionBuffer();
+
+/*!
+    \brief Get the number of passes completed in the session.
+*/
+LM_PUBLIC_API long long sessionPasses();
+
+// ----------------------------------------------------------------------------
+
 /*!
     \brief Serialize the internal state of the framework to a stream.
     \param os Output stream.
@@ -214,6 +264,32 @@ LM_INLINE void deserialize(const std::string& path) {
     deserialize(is);
 }
 
+/*!
+    \brief Serialize the internal state to a snapshot file.
+    \param path Path to the snapshot file.
+
+    \rst
+    Unlike :cpp:func:`lm::serialize`, each asset is stored in an independent block
+    in the snapshot file indexed by a table of contents.
+    The snapshot can be loaded with :cpp:func:`lm::deserializeSnapshot` function.
+    \endrst
+*/
+LM_PUBLIC_API void serializeSnapshot(const std::string& path);
+
+/*!
+    \brief Deserialize the internal state from a snapshot file.
+    \param path Path to the snapshot file.
+
+    \rst
+    The snapshot file is memory-mapped and the read-only pages are shared
+    among the processes loading the same file.
+    The scene and renderer are loaded immediately, while the assets are
+    deserialized lazily when they are first accessed, e.g., by :cpp:func:`lm::comp::get`.
+    Thus the assets not referenced by the scene are never deserialized.
+    \endrst
+*/
+LM_PUBLIC_API void deserializeSnapshot(const std::string& path);
+
 // ----------------------------------------------------------------------------
 
 /*!
@@ -277,6 +353,140 @@ LM_PUBLIC_API void addChildFromModel(int parent, const std::string& modelLoc);
 */
 LM_PUBLIC_API void primitive(Mat4 transform, const Json& prop);
 
+// ----------------------------------------------------------------------------
+
+/*!
+    \brief Create an independent user context.
+    \param name Name of the context.
+    \param prop Properties for configuration.
+
+    \rst
+    This function creates a user context holding its own assets, scene, and renderer,
+    independent of the default context created by :cpp:func:`lm::init`.
+    The user contexts are used to render multiple scenes concurrently in a process,
+    e.g., by binding a context to each thread processing a rendering job.
+
+    The context is a child of the default context, and the locators of its components
+    start with ``$.<name>``. The assets of the default context can be referenced from the context
+    by the locators, so that the large assets like meshes or textures can be loaded once
+    and shared among the contexts. Replacing a shared asset waits for the renderings of the other contexts
+    and updates their references to it. The assets of a context can only be referenced
+    from the same context.
+    The subsystems like logger, parallel, and progress are shared among the contexts.
+    The parallel loops of the concurrent renderings divide the threads given by
+    the ``numThreads`` property of the parallel subsystem instead of creating the threads for each context.
+    The progress is reported only for one of the concurrent renderings.
+    \endrst
+*/
+LM_PUBLIC_API void createContext(const std::string& name, const Json& prop = {});
+
+/*!
+    \brief Release the user context.
+    \param name Name of the context.
+
+    \rst
+    The context must not be bound to any thread.
+    \endrst
+*/
+LM_PUBLIC_API void releaseContext(const std::string& name);
+
+/*!
+    \brief Bind the user context to the current thread.
+    \param name Name of the context. Empty string binds the default context.
+
+    \rst
+    The user APIs called from the current thread, e.g., :cpp:func:`lm::asset` or :cpp:func:`lm::render`,
+    operate on the bound context. The binding is local to the thread.
+    \endrst
+*/
+LM_PUBLIC_API void bindContext(const std::string& name);
+
+/*!
+    \brief Get the name of the user context bound to the current thread.
+    \return Name of the context. Empty string if the default context is bound.
+*/
+LM_PUBLIC_API std::string boundContext();
+
+/*!
+    \brief Scoped guard of :cpp:func:`lm::bindContext`.
+
+    \rst
+    The previously bound context is restored on destruction.
+
+    Example:
+
+    .. code-block:: cpp
+
+       lm::createContext("job1");
+       std::thread th([] {
+           lm::ScopedContext ctx_("job1");
+           lm::asset("film", "film::bitmap", {{"w", 1920}, {"h", 1080}});
+           // ...
+           lm::render();
+       });
+    \endrst
+*/
+class ScopedContext {
+private:
+    std::string prev_;
+
+public:
+    ScopedContext(const std::string& name) : prev_(boundContext()) { bindContext(name); }
+    ~ScopedContext() { bindContext(prev_); }
+    LM_DISABLE_COPY_AND_MOVE(ScopedContext)
+};
+
+// ----------------------------------------------------------------------------
+
+/*!
+    \brief Function to set up a frame of a sequence.
+    \param frame Frame index.
+*/
+using SequenceFrameFunc = std::function<void(int frame)>;
+
+/*!
+    \brief Render an animation sequence.
+    \param numFrames Number of frames.
+    \param setupFrame Function to set up a frame.
+    \param filmName Name of the film asset created by ``setupFrame``.
+    \param outpath Output path of the frames formatted with the frame index, e.g., ``out_{:04}.pfm``.
+
+    \rst
+    This function renders the frames of an animation sequence
+    by overlapping the preparation, rendering, and saving of the consecutive frames.
+    While the frame :math:`n` is rendered, the assets and the acceleration structure
+    of the frame :math:`n+1` are prepared in a separate thread,
+    and the image of the frame :math:`n-1` is saved asynchronously.
+
+    The frames are processed with three user contexts used in rotation.
+    ``setupFrame`` is called in the preparation thread with the context of the frame bound,
+    and is expected to create the assets, the primitives, the acceleration structure, and the renderer
+    of the frame with the user APIs, e.g., :cpp:func:`lm::asset`, :cpp:func:`lm::primitive`,
+    :cpp:func:`lm::build`, and :cpp:func:`lm::renderer`.
+    The scene is cleared before ``setupFrame`` is called, but the assets and the renderer are kept.
+    An asset created with the same type and properties as the last frame rendered with the context
+    is not reloaded, so that the unchanged assets are reused between the frames.
+    The assets shared by all frames, e.g., static meshes or textures,
+    should be created in the default context and referenced by the locators.
+
+    The function must be called from the default context.
+
+    Example:
+
+    .. code-block:: cpp
+
+       const auto staticMesh = lm::asset("static", "mesh::wavefrontobj", {{"path", "static.obj"}});
+       lm::renderSequence(100, [&](int frame) {
+           lm::asset("film", "film::bitmap", {{"w", 1920}, {"h", 1080}});
+           lm::asset("mesh", "mesh::wavefrontobj", {{"path", fmt::format("anim_{}.obj", frame)}});
+           // ...
+           lm::build("accel::sahbvh");
+           lm::renderer("renderer::pt", {{"output", lm::asset("film")}, ...});
+       }, "film", "out_{:04}.pfm");
+    \endrst
+*/
+LM_PUBLIC_API void renderSequence(int numFrames, const SequenceFrameFunc& setupFrame, const std::string& filmName, const std::string& outpath);
+
 /*!
     @}
 */
@@ -310,8 +520,14 @@ public:
     virtual void render(bool verbose) = 0;
     virtual void save(const std::string& filmName, const std::string& outpath) = 0;
     virtual FilmBuffer buffer(const std::string& filmName) = 0;
+    virtual void startSession(const std::string& filmName) = 0;
+    virtual void stopSession() = 0;
+    virtual FilmBuffer sessionBuffer() = 0;
+    virtual long long sessionPasses() = 0;
     virtual void serialize(std::ostream& os) = 0;
     virtual void deserialize(std::istream& is) = 0;
+    virtual void serializeSnapshot(const std::string& path) = 0;
+    virtual void deserializeSnapshot(const std::string& path) = 0;
     virtual int rootNode() = 0;
     virtual int primitiveNode(const Json& prop) = 0;
     virtual int groupNode() = 0;
@@ -319,6 +535,10 @@ public:
     virtual int transformNode(Mat4 transform) = 0;
     virtual void addChild(int parent, int child) = 0;
     virtual void addChildFromModel(int parent, const std::string& modelLoc) = 0;
+    virtual void createContext(const std::string& name, const Json& prop) = 0;
+    virtual void releaseContext(const std::string& name) = 0;
+    virtual UserContext* context(const std::string& name) = 0;
+    virtual void renderSequence(int numFrames, const SequenceFrameFunc& setupFrame, const std::string& filmName, const std::string& outpath) = 0;
 };
 
 /*!
@@ -7,6 +7,7 @@
 #include <lm/scene.h>
 #include <lm/mesh.h>
 #include <lm/exception.h>
+#include <lm/serial.h>
 #include "embree.h"
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
@@ -16,6 +17,13 @@ namespace {
 struct FlattenedPrimitiveNode {
     Transform globalTransform;  // Global transform of the primitive
     int primitive;              // Primitive node index
+    int vertexOffset;           // Offset to the flattened vertex buffer
+    int faceOffset;             // Offset to the flattened index buffer
+    int numTriangles;           // Number of triangles
+    Mesh::ShapeType type;       // Type of the shapes of the mesh
+    int shapeOffset;            // Offset to the flattened shape vertex buffer
+    int indexOffset;            // Offset to the flattened curve index buffer
+    int numShapes;              // Number of analytic shapes
 };
 
 }
@@ -27,6 +35,10 @@ struct FlattenedPrimitiveNode {
 .. function:: accel::embree
 
    Acceleration structure with Embree library.
+
+   The analytic shapes are mapped to the native geometries of Embree,
+   i.e., spheres to ``RTC_GEOMETRY_TYPE_SPHERE_POINT``, disks to ``RTC_GEOMETRY_TYPE_ORIENTED_DISC_POINT``,
+   and curves to ``RTC_GEOMETRY_TYPE_ROUND_LINEAR_CURVE`` or ``RTC_GEOMETRY_TYPE_FLAT_LINEAR_CURVE``.
 \endrst
 */
 class Accel_Embree final : public Accel {
@@ -34,6 +46,22 @@ private:
     RTCDevice device_ = nullptr;
     RTCScene scene_ = nullptr;
     std::vector<FlattenedPrimitiveNode> flattenedNodes_;
+    std::vector<glm::vec3> vs_;     // Flattened vertices in world space
+    std::vector<glm::uvec3> fs_;    // Flattened faces (local to each primitive)
+    std::vector<glm::vec4> shapeVs_;        // Flattened positions and radii of the shapes in world space
+    std::vector<glm::vec3> shapeNs_;        // Flattened normals of the disks in world space
+    std::vector<unsigned int> shapeIs_;     // Flattened first vertex indices of the curve segments
+
+public:
+    // Embree cannot export the built BVH, so we keep the flattened buffers
+    // and only rerun the commit on deserialization, skipping the scene traversal.
+    LM_SERIALIZE_IMPL(ar) {
+        ar(serial::raw(flattenedNodes_), serial::raw(vs_), serial::raw(fs_),
+           serial::raw(shapeVs_), serial::raw(shapeNs_), serial::raw(shapeIs_));
+        if constexpr (std::is_same_v<Archive, InputArchive>) {
+            commitScene();
+        }
+    }
 
 public:
     Accel_Embree() {
@@ -55,6 +83,65 @@ private:
             scene_ = nullptr;
         }
         flattenedNodes_.clear();
+        vs_.clear();
+        fs_.clear();
+        shapeVs_.clear();
+        shapeNs_.clear();
+        shapeIs_.clear();
+    }
+
+    // Create embree scene from the flattened buffers
+    void commitScene() {
+        exception::ScopedDisableFPEx guard_;
+        if (scene_) {
+            rtcReleaseScene(scene_);
+        }
+        scene_ = rtcNewScene(device_);
+        for (int i = 0; i < int(flattenedNodes_.size()); i++) {
+            const auto& fn = flattenedNodes_[i];
+            const auto geom = createGeometry(fn);
+            rtcCommitGeometry(geom);
+            rtcAttachGeometryByID(scene_, geom, i);
+            rtcReleaseGeometry(geom);
+        }
+        LM_INFO("Building");
+        rtcCommitScene(scene_);
+    }
+
+    // Create embree geometry of the flattened primitive
+    RTCGeometry createGeometry(const FlattenedPrimitiveNode& fn) const {
+        switch (fn.type) {
+            case Mesh::ShapeType::Sphere:
+            case Mesh::ShapeType::Disk: {
+                const bool disk = fn.type == Mesh::ShapeType::Disk;
+                auto geom = rtcNewGeometry(device_, disk ? RTC_GEOMETRY_TYPE_ORIENTED_DISC_POINT : RTC_GEOMETRY_TYPE_SPHERE_POINT);
+                rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT4, shapeVs_.data(),
+                    sizeof(glm::vec4) * fn.shapeOffset, sizeof(glm::vec4), fn.numShapes);
+                if (disk) {
+                    rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_NORMAL, 0, RTC_FORMAT_FLOAT3, shapeNs_.data(),
+                        sizeof(glm::vec3) * fn.shapeOffset, sizeof(glm::vec3), fn.numShapes);
+                }
+                return geom;
+            }
+            case Mesh::ShapeType::RoundCurve:
+            case Mesh::ShapeType::FlatCurve: {
+                auto geom = rtcNewGeometry(device_, fn.type == Mesh::ShapeType::RoundCurve
+                    ? RTC_GEOMETRY_TYPE_ROUND_LINEAR_CURVE : RTC_GEOMETRY_TYPE_FLAT_LINEAR_CURVE);
+                rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT4, shapeVs_.data(),
+                    sizeof(glm::vec4) * fn.shapeOffset, sizeof(glm::vec4), fn.numShapes*2);
+                rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT, shapeIs_.data(),
+                    sizeof(unsigned int) * fn.indexOffset, sizeof(unsigned int), fn.numShapes);
+                return geom;
+            }
+            default: {
+                auto geom = rtcNewGeometry(device_, RTC_GEOMETRY_TYPE_TRIANGLE);
+                rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, vs_.data(),
+                    sizeof(glm::vec3) * fn.vertexOffset, sizeof(glm::vec3), fn.numTriangles*3);
+                rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, fs_.data(),
+                    sizeof(glm::uvec3) * fn.faceOffset, sizeof(glm::uvec3), fn.numTriangles);
+                return geom;
+            }
+        }
     }
 
 public:
@@ -62,9 +149,8 @@ public:
         exception::ScopedDisableFPEx guard_;
 
         reset();
-        scene_ = rtcNewScene(device_);
 
-        // Flatten the scene graph and setup geometries
+        // Flatten the scene graph into the vertex and index buffers
         LM_INFO("Flattening scene");
         scene.traverseNodes([&](const SceneNode& node, Mat4 globalTransform) {
             if (node.type != SceneNodeType::Primitive) {
@@ -75,14 +161,38 @@ public:
             }
 
             // Record flattened primitive
-            const int flattenNodeIndex = int(flattenedNodes_.size());
-            flattenedNodes_.push_back({ Transform(globalTransform), node.index });
-
-            // Create triangle mesh
-            auto geom = rtcNewGeometry(device_, RTC_GEOMETRY_TYPE_TRIANGLE);
-            const int numTriangles = node.primitive.mesh->numTriangles();
-            auto* vs = (glm::vec3*)rtcSetNewGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, sizeof(glm::vec3), numTriangles*3);
-            auto* fs = (glm::uvec3*)rtcSetNewGeometryBuffer(geom, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, sizeof(glm::uvec3), numTriangles);
+            const auto* mesh = node.primitive.mesh;
+            const Transform transform(globalTransform);
+            const int vertexOffset = int(vs_.size());
+            const int faceOffset = int(fs_.size());
+            const int numTriangles = mesh->numTriangles();
+            const int shapeOffset = int(shapeVs_.size());
+            const int indexOffset = int(shapeIs_.size());
+            const int numShapes = mesh->numShapes();
+            flattenedNodes_.push_back({ transform, node.index, vertexOffset, faceOffset, numTriangles,
+                mesh->shapeType(), shapeOffset, indexOffset, numShapes });
+
+            // Append analytic shapes.
+            // The curve segments have their own vertices, and the normals of the disks
+            // are stored with the same indices as the vertices.
+            mesh->foreachShape([&](int face, const Mesh::Shape& shape) {
+                const auto s = mesh::transformShape(shape, transform);
+                shapeVs_.emplace_back(glm::vec3(s.p1), float(s.r));
+                if (s.type == Mesh::ShapeType::RoundCurve || s.type == Mesh::ShapeType::FlatCurve) {
+                    shapeVs_.emplace_back(glm::vec3(s.p2), float(s.r));
+                    shapeIs_.push_back(2*face);
+                }
+                else if (s.type == Mesh::ShapeType::Disk) {
+                    shapeNs_.resize(shapeVs_.size() - 1);
+                    shapeNs_.emplace_back(s.p2);
+                }
+            });
+
+            // Append triangles
+            vs_.resize(vertexOffset + numTriangles*3);
+            fs_.resize(faceOffset + numTriangles);
+            auto* vs = vs_.data() + vertexOffset;
+            auto* fs = fs_.data() + faceOffset;
             node.primitive.mesh->foreachTriangle([&](int face, const Mesh::Tri& tri) {
                 const auto p1 = globalTransform * Vec4(tri.p1.p, 1_f);
                 const auto p2 = globalTransform * Vec4(tri.p2.p, 1_f);
@@ -94,13 +204,14 @@ public:
                 fs[face][1] = 3*face+1;
                 fs[face][2] = 3*face+2;
             });
-            rtcCommitGeometry(geom);
-            rtcAttachGeometryByID(scene_, geom, flattenNodeIndex);
-            rtcReleaseGeometry(geom);
         });
 
-        LM_INFO("Building");
-        rtcCommitScene(scene_);
+        // Embree reads vertex buffers with 16-byte loads,
+        // so the last vertex needs padding.
+        vs_.emplace_back(0.f);
+        shapeNs_.emplace_back(0.f);
+
+        commitScene();
     }
 
     virtual std::optional<Hit> intersect(Ray ray, Float tmin, Float tmax) const override {
@@ -132,15 +243,43 @@ public:
         }
         
         // Store hit information
-        const auto& fn = flattenedNodes_.at(rayhit.hit.geomID);
         return Hit{
             Float(rayhit.ray.tfar),
             Vec2(Float(rayhit.hit.u), Float(rayhit.hit.v)),
-            fn.globalTransform,
-            fn.primitive,
+            int(rayhit.hit.geomID),
+            flattenedNodes_.at(rayhit.hit.geomID).primitive,
             int(rayhit.hit.primID)
         };
     }
+
+    virtual bool occluded(Ray ray, Float tmin, Float tmax) const override {
+        exception::ScopedDisableFPEx guard_;
+
+        RTCIntersectContext context;
+        rtcInitIntersectContext(&context);
+
+        // Setup ray
+        RTCRay r;
+        r.org_x = float(ray.o.x);
+        r.org_y = float(ray.o.y);
+        r.org_z = float(ray.o.z);
+        r.tnear = float(tmin);
+        r.dir_x = float(ray.d.x);
+        r.dir_y = float(ray.d.y);
+        r.dir_z = float(ray.d.z);
+        r.time = 0.f;
+        r.tfar = float(tmax);
+        r.mask = unsigned(-1);
+        r.flags = 0;
+
+        // Occlusion query. tfar is set to -inf if any intersection is found.
+        rtcOccluded1(scene_, &context, &r);
+        return r.tfar < 0.f;
+    }
+
+    virtual Transform instanceTransform(int instance) const override {
+        return flattenedNodes_.at(instance).globalTransform;
+    }
 };
 
 LM_COMP_REG_IMPL(Accel_Embree, "accel::embree");
@@ -7,6 +7,7 @@
 #include <lm/scene.h>
 #include <lm/mesh.h>
 #include <lm/exception.h>
+#include <lm/serial.h>
 #include "embree.h"
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
@@ -24,6 +25,9 @@ struct FlattenedSceneNode {
     Transform globalTransform;      // Global transform of the flattened node
     int nodeIndex;                  // Index of (unflattened) scene node
     int flattenedSceneIndex;        // Index of flattened scene only used for InstancedScene type
+    int vertexOffset;               // Offset to the flattened vertex buffer (Primitive type)
+    int faceOffset;                 // Offset to the flattened index buffer (Primitive type)
+    int numTriangles;               // Number of triangles (Primitive type)
 };
 
 using FlattenedScene = std::vector<FlattenedSceneNode>;
@@ -37,6 +41,25 @@ private:
     RTCDevice device_ = nullptr;
     RTCScene scene_ = nullptr;
     std::vector<FlattenedScene> flattenedScenes_;    // Flattened scenes (index 0: root)
+    std::vector<glm::vec3> vs_;                      // Flattened vertices in the space of each flattened scene
+    std::vector<glm::uvec3> fs_;                     // Flattened faces (local to each primitive)
+    std::vector<int> instanceOffsets_;               // Offsets of the instance indices for the nodes of the root scene
+
+public:
+    // Embree cannot export the built BVH, so we keep the flattened buffers
+    // and only rerun the commit on deserialization, skipping the scene traversal.
+    LM_SERIALIZE_IMPL(ar) {
+        auto numScenes = flattenedScenes_.size();
+        ar(numScenes);
+        flattenedScenes_.resize(numScenes);
+        for (auto& fscene : flattenedScenes_) {
+            ar(serial::raw(fscene));
+        }
+        ar(serial::raw(vs_), serial::raw(fs_));
+        if constexpr (std::is_same_v<Archive, InputArchive>) {
+            commitScene();
+        }
+    }
 
 public:
     Accel_Embree_Instanced() {
@@ -58,6 +81,84 @@ private:
             scene_ = nullptr;
         }
         flattenedScenes_.clear();
+        vs_.clear();
+        fs_.clear();
+        instanceOffsets_.clear();
+    }
+
+    // Create embree scenes from the flattened scenes and buffers.
+    // Process from backward because the instanced scene must be created prior to the scene.
+    void commitScene() {
+        exception::ScopedDisableFPEx guard_;
+        if (scene_) {
+            rtcReleaseScene(scene_);
+            scene_ = nullptr;
+        }
+        if (flattenedScenes_.empty()) {
+            return;
+        }
+
+        // Assign the instance indices to the primitives reachable from the root scene.
+        // A node of the root scene occupies one index if it is a primitive,
+        // or the number of the nodes of the instanced scene otherwise.
+        instanceOffsets_.clear();
+        int numInstances = 0;
+        for (const auto& fnode : flattenedScenes_.at(0)) {
+            instanceOffsets_.push_back(numInstances);
+            numInstances += fnode.type == FlattenedSceneNodeType::Primitive
+                ? 1 : int(flattenedScenes_.at(fnode.flattenedSceneIndex).size());
+        }
+
+        LM_INFO("Building");
+        std::vector<RTCScene> rtcscenes(flattenedScenes_.size());
+        for (int i = int(flattenedScenes_.size())-1; i >= 0; i--) {
+            const auto& fscene = flattenedScenes_.at(i);
+
+            // Create a new embree scene
+            auto& rtcscene = rtcscenes[i];
+            rtcscene = rtcNewScene(device_);
+
+            // Create triangle meshes
+            for (const auto& fnode : fscene) {
+                // Primitive
+                if (fnode.type == FlattenedSceneNodeType::Primitive) {
+                    if (fnode.numTriangles == 0) {
+                        continue;
+                    }
+
+                    // Create embree's triangle mesh sharing the flattened buffers
+                    auto geom = rtcNewGeometry(device_, RTC_GEOMETRY_TYPE_TRIANGLE);
+                    rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, vs_.data(),
+                        sizeof(glm::vec3) * fnode.vertexOffset, sizeof(glm::vec3), fnode.numTriangles * 3);
+                    rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, fs_.data(),
+                        sizeof(glm::uvec3) * fnode.faceOffset, sizeof(glm::uvec3), fnode.numTriangles);
+                    rtcCommitGeometry(geom);
+                    rtcAttachGeometryByID(rtcscene, geom, fnode.index);
+                    rtcReleaseGeometry(geom);
+                }
+
+                // Instanced scene
+                else if (fnode.type == FlattenedSceneNodeType::InstancedScene) {
+                    // Index must to be zero
+                    assert(i == 0);
+
+                    // Create instanced geometry
+                    auto inst = rtcNewGeometry(device_, RTC_GEOMETRY_TYPE_INSTANCE);
+                    rtcSetGeometryInstancedScene(inst, rtcscenes.at(fnode.flattenedSceneIndex));
+                    glm::mat4 M(fnode.globalTransform.M);
+                    rtcSetGeometryTransform(inst, 0, RTC_FORMAT_FLOAT4X4_COLUMN_MAJOR, &M[0].x);
+                    rtcCommitGeometry(inst);
+                    rtcAttachGeometryByID(rtcscene, inst, fnode.index);
+                    rtcReleaseGeometry(inst);
+                }
+            }
+
+            // Commit the embree scene
+            rtcCommitScene(rtcscene);
+        }
+
+        // Keep the root embree scene
+        scene_ = rtcscenes[0];
     }
 
 public:
@@ -145,71 +246,54 @@ public:
 
         // --------------------------------------------------------------------
 
-        // Traverse the flattened scene and create embree scene
-        // Process from backward because the instanced scene must be created prior to the scene.
-        LM_INFO("Building");
-        std::vector<RTCScene> rtcscenes(flattenedScenes_.size());
-        for (int i = int(flattenedScenes_.size())-1; i >= 0; i--) {
-            const auto& fscene = flattenedScenes_.at(i);
-
-            // Create a new embree scene
-            auto& rtcscene = rtcscenes[i];
-            rtcscene = rtcNewScene(device_);
-
-            // Create triangle meshes
-            for (const auto& fnode : fscene) {
-                // Primitive
-                if (fnode.type == FlattenedSceneNodeType::Primitive) {
-                    // Get unflattened primitive node
-                    const auto& node = scene.nodeAt(fnode.nodeIndex);
-                    assert(node.type == SceneNodeType::Primitive);
-                    if (!node.primitive.mesh) {
-                        continue;
-                    }
-
-                    // Create embree's triangle mesh
-                    auto geom = rtcNewGeometry(device_, RTC_GEOMETRY_TYPE_TRIANGLE);
-                    const int numTriangles = node.primitive.mesh->numTriangles();
-                    auto* vs = (glm::vec3*)rtcSetNewGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, sizeof(glm::vec3), numTriangles * 3);
-                    auto* fs = (glm::uvec3*)rtcSetNewGeometryBuffer(geom, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, sizeof(glm::uvec3), numTriangles);
-                    node.primitive.mesh->foreachTriangle([&](int face, const Mesh::Tri& tri) {
-                        const auto p1 = fnode.globalTransform.M * Vec4(tri.p1.p, 1_f);
-                        const auto p2 = fnode.globalTransform.M * Vec4(tri.p2.p, 1_f);
-                        const auto p3 = fnode.globalTransform.M * Vec4(tri.p3.p, 1_f);
-                        vs[3 * face] = glm::vec3(p1);
-                        vs[3 * face + 1] = glm::vec3(p2);
-                        vs[3 * face + 2] = glm::vec3(p3);
-                        fs[face][0] = 3 * face;
-                        fs[face][1] = 3 * face + 1;
-                        fs[face][2] = 3 * face + 2;
-                    });
-                    rtcCommitGeometry(geom);
-                    rtcAttachGeometryByID(rtcscene, geom, fnode.index);
-                    rtcReleaseGeometry(geom);
+        // Flatten the triangles of the primitives
+        for (auto& fscene : flattenedScenes_) {
+            for (auto& fnode : fscene) {
+                if (fnode.type != FlattenedSceneNodeType::Primitive) {
+                    continue;
                 }
 
-                // Instanced scene
-                else if (fnode.type == FlattenedSceneNodeType::InstancedScene) {
-                    // Index must to be zero
-                    assert(i == 0);
-
-                    // Create instanced geometry
-                    auto inst = rtcNewGeometry(device_, RTC_GEOMETRY_TYPE_INSTANCE);
-                    rtcSetGeometryInstancedScene(inst, rtcscenes.at(fnode.flattenedSceneIndex));
-                    glm::mat4 M(fnode.globalTransform.M);
-                    rtcSetGeometryTransform(inst, 0, RTC_FORMAT_FLOAT4X4_COLUMN_MAJOR, &M[0].x);
-                    rtcCommitGeometry(inst);
-                    rtcAttachGeometryByID(rtcscene, inst, fnode.index);
-                    rtcReleaseGeometry(inst);
+                // Get unflattened primitive node
+                const auto& node = scene.nodeAt(fnode.nodeIndex);
+                assert(node.type == SceneNodeType::Primitive);
+                fnode.vertexOffset = int(vs_.size());
+                fnode.faceOffset = int(fs_.size());
+                fnode.numTriangles = 0;
+                if (!node.primitive.mesh) {
+                    continue;
+                }
+                if (node.primitive.mesh->shapeType() != Mesh::ShapeType::Triangle) {
+                    LM_WARN("Analytic shapes are not supported. Skipping [mesh='{}']", node.primitive.mesh->loc());
+                    continue;
                 }
-            }
 
-            // Commit the embree scene
-            rtcCommitScene(rtcscene);
+                // Append triangles
+                fnode.numTriangles = node.primitive.mesh->numTriangles();
+                vs_.resize(fnode.vertexOffset + fnode.numTriangles * 3);
+                fs_.resize(fnode.faceOffset + fnode.numTriangles);
+                auto* vs = vs_.data() + fnode.vertexOffset;
+                auto* fs = fs_.data() + fnode.faceOffset;
+                node.primitive.mesh->foreachTriangle([&](int face, const Mesh::Tri& tri) {
+                    const auto p1 = fnode.globalTransform.M * Vec4(tri.p1.p, 1_f);
+                    const auto p2 = fnode.globalTransform.M * Vec4(tri.p2.p, 1_f);
+                    const auto p3 = fnode.globalTransform.M * Vec4(tri.p3.p, 1_f);
+                    vs[3 * face] = glm::vec3(p1);
+                    vs[3 * face + 1] = glm::vec3(p2);
+                    vs[3 * face + 2] = glm::vec3(p3);
+                    fs[face][0] = 3 * face;
+                    fs[face][1] = 3 * face + 1;
+                    fs[face][2] = 3 * face + 2;
+                });
+            }
         }
 
-        // Keep the root embree scene
-        scene_ = rtcscenes[0];
+        // Embree reads vertex buffers with 16-byte loads,
+        // so the last vertex needs padding.
+        vs_.emplace_back(0.f);
+
+        // --------------------------------------------------------------------
+
+        commitScene();
     }
 
     virtual std::optional<Hit> intersect(Ray ray, Float tmin, Float tmax) const override {
@@ -246,18 +330,20 @@ public:
 
         // --------------------------------------------------------------------
 
-        // Get global transform and (unflattened) node index
-        // corresponding to the intersected (instanced) geometry
-        const auto [M, nodeIndex] = [&]() -> std::tuple<Mat4, int> {
+        // Get instance index and (unflattened) node index
+        // corresponding to the intersected (instanced) geometry.
+        // The global transform is computed on demand by instanceTransform().
+        const auto [instance, nodeIndex] = [&]() -> std::tuple<int, int> {
             const auto instID = rayhit.hit.instID[0];
+            const auto geomID = rayhit.hit.geomID;
             if (instID != RTC_INVALID_GEOMETRY_ID) {
                 const auto& fn1 = flattenedScenes_.at(0).at(instID);
-                const auto& fn2 = flattenedScenes_.at(fn1.flattenedSceneIndex).at(rayhit.hit.geomID);
-                return { fn1.globalTransform.M * fn2.globalTransform.M, fn2.nodeIndex };
+                const auto& fn2 = flattenedScenes_.at(fn1.flattenedSceneIndex).at(geomID);
+                return { instanceOffsets_.at(instID) + int(geomID), fn2.nodeIndex };
             }
             else {
-                const auto& fn = flattenedScenes_.at(0).at(rayhit.hit.geomID);
-                return { fn.globalTransform.M, fn.nodeIndex };
+                const auto& fn = flattenedScenes_.at(0).at(geomID);
+                return { instanceOffsets_.at(geomID), fn.nodeIndex };
             }
         }();
 
@@ -267,11 +353,48 @@ public:
         return Hit{
             Float(rayhit.ray.tfar),
             Vec2(Float(rayhit.hit.u), Float(rayhit.hit.v)),
-            Transform(M),
+            instance,
             nodeIndex,
             int(rayhit.hit.primID)
         };
     }
+
+    virtual bool occluded(Ray ray, Float tmin, Float tmax) const override {
+        exception::ScopedDisableFPEx guard_;
+
+        RTCIntersectContext context;
+        rtcInitIntersectContext(&context);
+
+        // Setup ray
+        RTCRay r;
+        r.org_x = float(ray.o.x);
+        r.org_y = float(ray.o.y);
+        r.org_z = float(ray.o.z);
+        r.tnear = float(tmin);
+        r.dir_x = float(ray.d.x);
+        r.dir_y = float(ray.d.y);
+        r.dir_z = float(ray.d.z);
+        r.time = 0.f;
+        r.tfar = float(tmax);
+        r.mask = unsigned(-1);
+        r.flags = 0;
+
+        // Occlusion query. tfar is set to -inf if any intersection is found.
+        rtcOccluded1(scene_, &context, &r);
+        return r.tfar < 0.f;
+    }
+
+    virtual Transform instanceTransform(int instance) const override {
+        // Find the node of the root scene containing the instance
+        const auto it = std::upper_bound(instanceOffsets_.begin(), instanceOffsets_.end(), instance);
+        const int i = int(it - instanceOffsets_.begin()) - 1;
+        const auto& fn1 = flattenedScenes_.at(0).at(i);
+        if (fn1.type == FlattenedSceneNodeType::Primitive) {
+            return fn1.globalTransform;
+        }
+        const auto& fn2 = flattenedScenes_.at(fn1.flattenedSceneIndex).at(instance - instanceOffsets_[i]);
+        return Transform(fn1.globalTransform.M * fn2.globalTransform.M);
+    }
 };
 
 LM_COMP_REG_IMPL(Accel_Embree_Instanced, "accel::embreeinstanced");
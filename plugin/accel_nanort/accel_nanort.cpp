@@ -8,6 +8,7 @@
 #include <lm/mesh.h>
 #include <lm/exception.h>
 #include <lm/logger.h>
+#include <lm/serial.h>
 #include <nanort.h>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
@@ -17,11 +18,17 @@ struct FlattenedPrimitiveNode {
     int primitive;              // Primitive node index
 };
 
+struct FlattenedNodeAndFace {
+    int node;   // Index of flattened primitive node
+    int face;   // Face index of the mesh
+};
+
 /*
 \rst
 .. function:: accel::nanort
 
    Acceleration structure with nanort library.
+   Only the triangle meshes are supported.
 \endrst
 */
 class Accel_NanoRT final : public Accel {
@@ -29,9 +36,24 @@ private:
     std::vector<Float> vs_;
     std::vector<unsigned int> fs_;
     nanort::BVHAccel<Float> accel_;
-    std::vector<std::tuple<int, int>> flattenNodeAndFacePerTriangle_;
+    std::vector<FlattenedNodeAndFace> flattenNodeAndFacePerTriangle_;
     std::vector<FlattenedPrimitiveNode> flattenedNodes_;
 
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(serial::raw(vs_), serial::raw(fs_), serial::raw(flattenNodeAndFacePerTriangle_), serial::raw(flattenedNodes_));
+        serializeBVH(ar);
+    }
+
+private:
+    // Serialize the built BVH nodes and indices of nanort.
+    // nanort can only restore a BVH from a file, so the arrays are restored directly
+    // with the non-const accessors added to nanort.h by the build script (see CMakeLists.txt).
+    template <typename Archive>
+    void serializeBVH(Archive& ar) {
+        ar(serial::raw(accel_.GetNodes()), serial::raw(accel_.GetIndices()));
+    }
+
 public:
     virtual void build(const Scene& scene) override {
         // Make a combined mesh
@@ -48,6 +70,11 @@ public:
                 return;
             }
 
+            if (node.primitive.mesh->shapeType() != Mesh::ShapeType::Triangle) {
+                LM_WARN("Analytic shapes are not supported. Skipping [mesh='{}']", node.primitive.mesh->loc());
+                return;
+            }
+
             // Record flattened primitive
             const int flattenNodeIndex = int(flattenedNodes_.size());
             flattenedNodes_.push_back({ Transform(globalTransform), node.index });
@@ -92,8 +119,11 @@ public:
         }
         
         const auto [node, face] = flattenNodeAndFacePerTriangle_.at(isect.prim_id);
-        const auto& fn = flattenedNodes_.at(node);
-        return Hit{ isect.t, Vec2(isect.u, isect.v), fn.globalTransform, fn.primitive, face };
+        return Hit{ isect.t, Vec2(isect.u, isect.v), node, flattenedNodes_.at(node).primitive, face };
+    }
+
+    virtual Transform instanceTransform(int instance) const override {
+        return flattenedNodes_.at(instance).globalTransform;
     }
 };
 
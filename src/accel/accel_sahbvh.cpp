@@ -8,6 +8,7 @@
 #include <lm/accel.h>
 #include <lm/scene.h>
 #include <lm/mesh.h>
+#include <lm/cpu.h>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
@@ -23,23 +24,26 @@ struct FlattenedPrimitiveNode {
     }
 };
 
-struct Tri {
-    Vec3 p1;            // One vertex of the triangle
-    Vec3 e1, e2;        // Two edges incident to p1
-    Bound b;            // Bound of the triangle
+// Primitive of the BVH, i.e., a triangle or an analytic shape
+struct Prim {
+    Mesh::ShapeType type;  // Type of the primitive
+    Vec3 p1;            // One vertex of the triangle, or the first point of the shape
+    Vec3 e1, e2;        // Two edges incident to p1, or the second point of the shape in e1
+    Float radius;       // Radius of the shape
+    Bound b;            // Bound of the primitive
     Vec3 c;             // Center of the bound
-    int flattenedNode;  // Index of flattened primitive associated to the triangle
-    int face;           // Face index of the mesh associated to the triangle
+    int flattenedNode;  // Index of flattened primitive associated to the primitive
+    int face;           // Face index of the mesh associated to the primitive
 
     template <typename Archive>
     void serialize(Archive& ar) {
-        ar(p1, e1, e2, b, c, flattenedNode, face);
+        ar(type, p1, e1, e2, radius, b, c, flattenedNode, face);
     }
 
-    Tri() {}
+    Prim() {}
 
-    Tri(Vec3 p1, Vec3 p2, Vec3 p3, int flattenedNode, int face)
-        : p1(p1), flattenedNode(flattenedNode), face(face) {
+    Prim(Vec3 p1, Vec3 p2, Vec3 p3, int flattenedNode, int face)
+        : type(Mesh::ShapeType::Triangle), p1(p1), radius(0_f), flattenedNode(flattenedNode), face(face) {
         e1 = p2 - p1;
         e2 = p3 - p1;
         b = merge(b, p1);
@@ -48,14 +52,36 @@ struct Tri {
         c = b.center();
     }
 
+    Prim(const Mesh::Shape& shape, int flattenedNode, int face)
+        : type(shape.type), p1(shape.p1), e1(shape.p2), e2(0_f), radius(shape.r), flattenedNode(flattenedNode), face(face) {
+        b = mesh::shapeBound(shape);
+        c = b.center();
+    }
+
     // Hit information
     struct Hit {
-        Float t;     // Distance to the triangle
-        Float u, v;  // Hitpoint in barycentric coordinates
+        Float t;     // Distance to the primitive
+        Float u, v;  // Hitpoint in barycentric coordinates. Unused for the shapes.
     };
 
-    // Checks intersection with a ray [Möller & Trumbore 1997]
-    std::optional<Hit> isect(Ray r, Float tl, Float th) const {
+    LM_INLINE std::optional<Hit> isect(Ray r, Float tl, Float th) const {
+        switch (type) {
+            case Mesh::ShapeType::Triangle:
+                return isectTriangle(r, tl, th);
+            case Mesh::ShapeType::Sphere:
+                return isectSphere(r, tl, th);
+            case Mesh::ShapeType::Disk:
+                return isectDisk(r, tl, th);
+            case Mesh::ShapeType::RoundCurve:
+                return isectRoundCurve(r, tl, th);
+            case Mesh::ShapeType::FlatCurve:
+                return isectFlatCurve(r, tl, th);
+        }
+        return {};
+    }
+
+    // Checks intersection with a triangle [Möller & Trumbore 1997]
+    LM_INLINE std::optional<Hit> isectTriangle(Ray r, Float tl, Float th) const {
         auto p = glm::cross(r.d, e2);
         auto tv = r.o - p1;
         auto q = glm::cross(tv, e1);
@@ -73,13 +99,123 @@ struct Tri {
         }
         return Hit{ t, u / ad, v / ad };
     }
+
+    // Checks intersection with a sphere centered at p1
+    LM_INLINE std::optional<Hit> isectSphere(Ray r, Float tl, Float th) const {
+        const auto oc = r.o - p1;
+        const auto a = glm::dot(r.d, r.d);
+        const auto hb = glm::dot(oc, r.d);
+        const auto h = hb * hb - a * (glm::dot(oc, oc) - radius * radius);
+        if (h < 0_f) {
+            return {};
+        }
+        const auto sq = std::sqrt(h);
+        auto t = (-hb - sq) / a;
+        if (t < tl) {
+            t = (-hb + sq) / a;
+        }
+        if (t < tl || th < t) {
+            return {};
+        }
+        return Hit{ t, 0_f, 0_f };
+    }
+
+    // Checks intersection with a disk centered at p1 with normal e1
+    LM_INLINE std::optional<Hit> isectDisk(Ray r, Float tl, Float th) const {
+        const auto dn = glm::dot(e1, r.d);
+        if (glm::abs(dn) < 1e-12_f) {
+            return {};
+        }
+        const auto t = glm::dot(e1, p1 - r.o) / dn;
+        if (t < tl || th < t) {
+            return {};
+        }
+        const auto q = r.o + r.d * t - p1;
+        if (glm::dot(q, q) > radius * radius) {
+            return {};
+        }
+        return Hit{ t, 0_f, 0_f };
+    }
+
+    // Checks intersection with a capsule with the axis from p1 to e1
+    LM_INLINE std::optional<Hit> isectRoundCurve(Ray r, Float tl, Float th) const {
+        const auto w = e1 - p1;
+        const auto ww = glm::dot(w, w);
+        const auto oc = r.o - p1;
+        const auto dw = glm::dot(r.d, w);
+        const auto ow = glm::dot(oc, w);
+        const auto rr = radius * radius;
+        std::optional<Hit> hit;
+
+        // Side of the cylinder
+        const auto qa = ww * glm::dot(r.d, r.d) - dw * dw;
+        const auto qb = ww * glm::dot(oc, r.d) - ow * dw;
+        const auto qc = ww * glm::dot(oc, oc) - ow * ow - rr * ww;
+        if (const auto h = qb * qb - qa * qc; qa > 0_f && h >= 0_f) {
+            const auto sq = std::sqrt(h);
+            for (const auto t : { (-qb - sq) / qa, (-qb + sq) / qa }) {
+                const auto y = ow + t * dw;
+                if (tl <= t && t <= th && 0_f <= y && y <= ww) {
+                    hit = Hit{ t, 0_f, 0_f };
+                    th = t;
+                    break;
+                }
+            }
+        }
+
+        // Spherical caps at the end points.
+        // Only the hemispheres outside of the cylinder are the surface of the capsule.
+        for (int i = 0; i < 2; i++) {
+            const auto oci = i == 0 ? oc : r.o - e1;
+            const auto bs = glm::dot(oci, r.d);
+            const auto as = glm::dot(r.d, r.d);
+            const auto hs = bs * bs - as * (glm::dot(oci, oci) - rr);
+            if (hs < 0_f) {
+                continue;
+            }
+            const auto sq = std::sqrt(hs);
+            for (const auto t : { (-bs - sq) / as, (-bs + sq) / as }) {
+                const auto y = ow + t * dw;
+                if (tl <= t && t <= th && (i == 0 ? y <= 0_f : y >= ww)) {
+                    hit = Hit{ t, 0_f, 0_f };
+                    th = t;
+                    break;
+                }
+            }
+        }
+
+        return hit;
+    }
+
+    // Checks intersection with a ribbon facing the ray with the axis from p1 to e1.
+    // The ray hits the ribbon at the closest point to the axis if the distance is within the radius.
+    LM_INLINE std::optional<Hit> isectFlatCurve(Ray r, Float tl, Float th) const {
+        const auto w = e1 - p1;
+        const auto oc = r.o - p1;
+        const auto dd = glm::dot(r.d, r.d);
+        const auto dw = glm::dot(r.d, w);
+        const auto ww = glm::dot(w, w);
+        const auto doc = glm::dot(r.d, oc);
+        const auto woc = glm::dot(w, oc);
+        const auto den = dd * ww - dw * dw;
+        const auto s = den > 0_f ? glm::clamp((dd * woc - dw * doc) / den, 0_f, 1_f) : 0_f;
+        const auto t = (s * dw - doc) / dd;
+        if (t < tl || th < t) {
+            return {};
+        }
+        const auto q = oc + r.d * t - w * s;
+        if (glm::dot(q, q) > radius * radius) {
+            return {};
+        }
+        return Hit{ t, 0_f, 0_f };
+    }
 };
 
 // BVH node
 struct Node {
     Bound b;        // Bound of the node
     bool leaf = 0;  // True if the node is leaf
-    int s, e;       // Range of triangle indices (valid only in leaf nodes)
+    int s, e;       // Range of primitive indices (valid only in leaf nodes)
     int c1, c2;     // Index to the child nodes
 
     template <typename Archive>
@@ -88,6 +224,54 @@ struct Node {
     }
 };
 
+// BVH traversal kernel finding the closest primitive intersected by the ray.
+// If AnyHit is true, the traversal terminates at the first primitive found.
+// Returns the index to the primitive indices, or -1 if not found.
+// The kernel is compiled for each ISA with the functions defined below.
+template <bool AnyHit>
+LM_INLINE int traverse(const Node* nodes, const Prim* trs, const int* indices, Ray ray, Float tmin, Float tmax, Prim::Hit& mh) {
+    int mi = -1;
+    int s[99]{};
+    int si = 0;
+    while (si >= 0) {
+        const auto& n = nodes[s[si--]];
+        if (!n.b.isect(ray, tmin, tmax)) {
+            continue;
+        }
+        if (!n.leaf) {
+            s[++si] = n.c1;
+            s[++si] = n.c2;
+            continue;
+        }
+        for (int i = n.s; i < n.e; i++) {
+            if (const auto h = trs[indices[i]].isect(ray, tmin, tmax)) {
+                mh = *h;
+                if constexpr (AnyHit) {
+                    return i;
+                }
+                tmax = h->t;
+                mi = i;
+            }
+        }
+    }
+    return mi;
+}
+
+using TraverseFunc = int(*)(const Node*, const Prim*, const int*, Ray, Float, Float, Prim::Hit&);
+
+#define LM_SAHBVH_TRAVERSE_FUNC(Name, Target) \
+    Target int Name(const Node* nodes, const Prim* trs, const int* indices, Ray ray, Float tmin, Float tmax, Prim::Hit& mh) { \
+        return traverse<false>(nodes, trs, indices, ray, tmin, tmax, mh); \
+    } \
+    Target int Name##AnyHit(const Node* nodes, const Prim* trs, const int* indices, Ray ray, Float tmin, Float tmax, Prim::Hit& mh) { \
+        return traverse<true>(nodes, trs, indices, ray, tmin, tmax, mh); \
+    }
+LM_SAHBVH_TRAVERSE_FUNC(traverseBaseline, )
+LM_SAHBVH_TRAVERSE_FUNC(traverseSSE42, LM_CPU_TARGET_SSE42)
+LM_SAHBVH_TRAVERSE_FUNC(traverseAVX2, LM_CPU_TARGET_AVX2)
+LM_SAHBVH_TRAVERSE_FUNC(traverseAVX512, LM_CPU_TARGET_AVX512)
+#undef LM_SAHBVH_TRAVERSE_FUNC
+
 }
 
 // ----------------------------------------------------------------------------
@@ -105,6 +289,9 @@ struct Node {
    - Split position is determined by minimum SAH cost.
    - Uses full-sort of underlying geometries.
    - Uses triangle intersection by Möller and Trumbore [Möller1997]_.
+   - Intersects the analytic shapes (spheres, disks, and curves) without tessellation.
+   - Traversal is compiled for each ISA and selected at runtime (see :cpp:func:`lm::cpu::select`).
+   - Occlusion queries terminate the traversal at the first intersection.
 
    .. [Möller1997] T. Möller & B. Trumbore.
                    Fast, Minimum Storage Ray-Triangle Intersection.
@@ -114,18 +301,18 @@ struct Node {
 class Accel_SAHBVH final : public Accel {
 private:
     std::vector<Node> nodes_;                             // Nodes
-    std::vector<Tri> trs_;                                // Triangles
-    std::vector<int> indices_;                            // Triangle indices
+    std::vector<Prim> trs_;                               // Primitives
+    std::vector<int> indices_;                            // Primitive indices
     std::vector<FlattenedPrimitiveNode> flattenedNodes_;  // Flattened scene graph
     
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(nodes_, trs_, indices_, flattenedNodes_);
+        ar(serial::raw(nodes_), serial::raw(trs_), serial::raw(indices_), serial::raw(flattenedNodes_));
     }
 
 public:
     virtual void build(const Scene& scene) override {
-        // Flatten the scene graph and setup triangle list
+        // Flatten the scene graph and setup primitive list
         LM_INFO("Flattening scene");
         trs_.clear();
         flattenedNodes_.clear();
@@ -148,6 +335,12 @@ public:
                 const auto p3 = globalTransform * Vec4(tri.p3.p, 1_f);
                 trs_.emplace_back(p1, p2, p3, flattenNodeIndex, face);
             });
+
+            // Record analytic shapes
+            const auto& transform = flattenedNodes_.back().globalTransform;
+            node.primitive.mesh->foreachShape([&](int face, const Mesh::Shape& shape) {
+                trs_.emplace_back(mesh::transformShape(shape, transform), flattenNodeIndex, face);
+            });
         });
 
         // --------------------------------------------------------------------
@@ -268,34 +461,33 @@ public:
 
     virtual std::optional<Hit> intersect(Ray ray, Float tmin, Float tmax) const override {
         exception::ScopedDisableFPEx guard_;  // Disable floating point exceptions
-        std::optional<Tri::Hit> mh, h;
-        int mi = -1;
-        int s[99]{};
-        int si = 0;
-        while (si >= 0) {
-            auto& n = nodes_.at(s[si--]);
-            if (!n.b.isect(ray, tmin, tmax)) {
-                continue;
-            }
-            if (!n.leaf) {
-                s[++si] = n.c1;
-                s[++si] = n.c2;
-                continue;
-            }
-            for (int i = n.s; i < n.e; i++) {
-                if (h = trs_[indices_[i]].isect(ray, tmin, tmax)) {
-                    mh = h;
-                    tmax = h->t;
-                    mi = i;
-                }
-            }
+        if (nodes_.empty()) {
+            return {};
         }
-        if (!mh) {
+        const auto traverseFunc = cpu::dispatch<TraverseFunc>(
+            traverseBaseline, traverseSSE42, traverseAVX2, traverseAVX512);
+        Prim::Hit mh;
+        const int mi = traverseFunc(nodes_.data(), trs_.data(), indices_.data(), ray, tmin, tmax, mh);
+        if (mi < 0) {
             return {};
         }
-        const auto& tr = trs_.at(indices_.at(mi));
-        const auto& fn = flattenedNodes_.at(tr.flattenedNode);
-        return Hit{ tmax, Vec2(mh->u, mh->v), fn.globalTransform, fn.primitive, tr.face };
+        const auto& tr = trs_[indices_[mi]];
+        return Hit{ mh.t, Vec2(mh.u, mh.v), tr.flattenedNode, flattenedNodes_[tr.flattenedNode].primitive, tr.face };
+    }
+
+    virtual bool occluded(Ray ray, Float tmin, Float tmax) const override {
+        exception::ScopedDisableFPEx guard_;
+        if (nodes_.empty()) {
+            return false;
+        }
+        const auto traverseFunc = cpu::dispatch<TraverseFunc>(
+            traverseBaselineAnyHit, traverseSSE42AnyHit, traverseAVX2AnyHit, traverseAVX512AnyHit);
+        Prim::Hit mh;
+        return traverseFunc(nodes_.data(), trs_.data(), indices_.data(), ray, tmin, tmax, mh) >= 0;
+    }
+
+    virtual Transform instanceTransform(int instance) const override {
+        return flattenedNodes_.at(instance).globalTransform;
     }
 };
 
@@ -11,11 +11,31 @@ LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
 class Assets_ final : public Assets {
 private:
-    std::vector<Component::Ptr<Component>> assets_;
+    // Assets. An entry is nullptr until it is loaded if the assets are loaded from a snapshot.
+    // The entries are mutable because the lazy loading happens in underlying() function.
+    mutable std::vector<Component::Ptr<Component>> assets_;
     std::unordered_map<std::string, int> assetIndexMap_;
 
+    // Snapshot entries of the assets not yet loaded
+    mutable std::vector<std::optional<serial::SnapshotEntry>> lazyEntries_;
+    mutable std::shared_ptr<serial::MappedFile> snapshot_;
+    mutable int numLazyEntries_ = 0;
+    mutable int numLoading_ = 0;    // Number of the nested loads in progress
+    mutable std::recursive_mutex lazyMutex_;
+
+    // True while some assets are not yet loaded or being loaded.
+    // Cleared after the outermost load completes, so the accesses checking the flag
+    // can skip the lock once all assets are loaded.
+    mutable std::atomic<bool> hasLazyEntries_ = false;
+
 public:
     LM_SERIALIZE_IMPL(ar) {
+        if constexpr (std::is_same_v<Archive, InputArchive>) {
+            resetSnapshot();
+        }
+        else {
+            loadAllLazyAssets();
+        }
         ar(assetIndexMap_, assets_);
     }
 
@@ -39,7 +59,7 @@ public:
             LM_ERROR("Invalid asset name [name='{}']", name);
             return nullptr;
         }
-        return assets_.at(it->second).get();
+        return loadLazyAsset(it->second);
     }
 
     virtual std::optional<std::string> loadAsset(const std::string& name, const std::string& implKey, const Json& prop) override {
@@ -59,6 +79,9 @@ public:
             LM_INFO("Asset [name='{}'] has been already loaded. Replacing..", name);
         }
 
+        // State of the index of the weak references before the hierarchy is changed
+        auto mark = comp::detail::weakRefIndexMark();
+
         // Create an instance of the asset
         auto p = comp::create<Component>(implKey, makeLoc(loc(), name));
         if (!p) {
@@ -71,6 +94,9 @@ public:
         // the instance could be accessed by underlying() while initialization.
         Component* asset;
         if (found) {
+            // Discard the asset in the snapshot if not yet loaded
+            discardLazyAsset(it->second);
+
             // Move existing instance
             // This must not be released until the end of this scope
             // because weak references needs to find locator in the existing instance.
@@ -87,7 +113,43 @@ public:
                 return {};
             }
 
-            // Notify to update the weak references in the object tree
+            // Collect the instances being replaced, i.e., the old asset and its underlying components
+            std::unordered_set<Component*> stale;
+            const lm::Component::ComponentVisitor collect = [&](lm::Component*& comp, bool weak) {
+                if (!comp || weak) {
+                    return;
+                }
+                stale.insert(comp);
+                comp->foreachUnderlying(collect);
+            };
+            Component* oldp = old.get();
+            collect(oldp, false);
+
+            // Update the weak references in the object tree of the owner,
+            // i.e., the user context holding the assets, or the assets itself if it is the root.
+            // The reverse index of the weak references gives the components referring to the replaced instances,
+            // so only the paths to them are visited. The owner locks the object trees of the contexts while they are visited.
+            const auto ownerLoc = parentLoc();
+            auto* owner = ownerLoc.empty() ? this : comp::get<lm::Component>(ownerLoc);
+            if (!owner) {
+                return asset->loc();
+            }
+            const auto referrers = comp::detail::weakReferrers(owner, stale, asset, mark);
+            std::unordered_set<std::string> paths;
+            if (referrers) {
+                for (const auto& loc : *referrers) {
+                    for (auto i = loc.size(); i != std::string::npos; i = loc.find_last_of('.', i - 1)) {
+                        paths.insert(loc.substr(0, i));
+                        if (i == 0) {
+                            break;
+                        }
+                    }
+                }
+            }
+
+            // Visit the components on the paths. All components are visited if some referrers have no locator.
+            std::vector<std::pair<Component*, Component*>> updated;
+            std::vector<Component*> parents{ owner };
             const lm::Component::ComponentVisitor visitor = [&](lm::Component*& comp, bool weak) {
                 if (!comp) {
                     return;
@@ -97,13 +159,19 @@ public:
                     return;
                 }
                 if (!weak) {
-                    comp->foreachUnderlying(visitor);
+                    if (!referrers || paths.find(comp->loc()) != paths.end()) {
+                        parents.push_back(comp);
+                        comp->foreachUnderlying(visitor);
+                        parents.pop_back();
+                    }
                 }
-                else {
+                else if (stale.find(comp) != stale.end()) {
                     comp::updateWeakRef(comp);
+                    updated.push_back({ parents.back(), comp });
                 }
             };
-            comp::get<lm::Component>("$")->foreachUnderlying(visitor);
+            owner->foreachUnderlying(visitor);
+            comp::detail::addWeakRefs(owner, updated, mark);
         }
         else {
             // Register as a new asset
@@ -121,6 +189,142 @@ public:
 
         return asset->loc();
     }
+
+    virtual std::vector<serial::SnapshotEntry> saveSnapshot(std::ostream& os) override {
+        loadAllLazyAssets();
+
+        // Names of the assets ordered by index
+        std::vector<std::string> names(assets_.size());
+        for (const auto& [name, index] : assetIndexMap_) {
+            names[index] = name;
+        }
+
+        // Save each asset into an independent block
+        std::vector<serial::SnapshotEntry> toc;
+        for (int i = 0; i < int(assets_.size()); i++) {
+            auto* asset = assets_[i].get();
+            if (!asset) {
+                continue;
+            }
+            const auto offset = serial::padSnapshot(os);
+            {
+                OutputArchive ar(os);
+                asset->save(ar);
+            }
+            const auto size = std::uint64_t(os.tellp()) - offset;
+            toc.push_back({ names[i], asset->key(), offset, size });
+        }
+
+        return toc;
+    }
+
+    virtual void loadSnapshot(const std::shared_ptr<serial::MappedFile>& file, const std::vector<serial::SnapshotEntry>& toc) override {
+        std::lock_guard<std::recursive_mutex> lock(lazyMutex_);
+        assets_.clear();
+        assetIndexMap_.clear();
+        lazyEntries_.clear();
+        for (const auto& entry : toc) {
+            if (entry.offset + entry.size > file->size()) {
+                LM_ERROR("Invalid snapshot entry [name='{}', offset='{}', size='{}']", entry.name, entry.offset, entry.size);
+                continue;
+            }
+            assetIndexMap_[entry.name] = int(assets_.size());
+            assets_.emplace_back();
+            lazyEntries_.push_back(entry);
+        }
+        numLazyEntries_ = int(lazyEntries_.size());
+        snapshot_ = numLazyEntries_ > 0 ? file : nullptr;
+        hasLazyEntries_.store(numLazyEntries_ > 0, std::memory_order_release);
+    }
+
+private:
+    // Get the asset by index, loading it from the snapshot if not yet loaded.
+    // Until all assets are loaded, the lock is taken before any access
+    // because another thread may be loading the same slot or releasing the snapshot.
+    Component* loadLazyAsset(int index) const {
+        if (!hasLazyEntries_.load(std::memory_order_acquire)) {
+            return assets_.at(index).get();
+        }
+        std::lock_guard<std::recursive_mutex> lock(lazyMutex_);
+        numLoading_++;
+        auto* p = loadLazyAssetLocked(index);
+        numLoading_--;
+        updateHasLazyEntries();
+        return p;
+    }
+
+    Component* loadLazyAssetLocked(int index) const {
+        if (!snapshot_ || index >= int(lazyEntries_.size()) || !lazyEntries_[index]) {
+            return assets_.at(index).get();
+        }
+
+        // Take the entry before loading because the asset being loaded
+        // can be accessed recursively via weak references.
+        auto entry = std::move(*lazyEntries_[index]);
+        const auto file = snapshot_;
+        lazyEntries_[index].reset();
+        if (--numLazyEntries_ == 0) {
+            snapshot_.reset();
+            lazyEntries_.clear();
+        }
+
+        LM_INFO("Loading asset from snapshot [name='{}']", entry.name);
+        LM_INDENT();
+
+        // Create an instance and register it before loading the contents
+        auto p = comp::create<Component>(entry.key, makeLoc(loc(), entry.name));
+        if (!p) {
+            LM_ERROR("Failed to create an asset [name='{}', key='{}']", entry.name, entry.key);
+            return nullptr;
+        }
+        assets_[index] = std::move(p);
+
+        // Deserialize directly from the mapped memory
+        serial::MemoryStreamBuf buf(file->data() + entry.offset, std::size_t(entry.size));
+        std::istream is(&buf);
+        InputArchive ar(is);
+        assets_[index]->load(ar);
+
+        return assets_[index].get();
+    }
+
+    // Load all assets not yet loaded.
+    void loadAllLazyAssets() {
+        std::lock_guard<std::recursive_mutex> lock(lazyMutex_);
+        for (int i = 0; i < int(assets_.size()) && snapshot_; i++) {
+            loadLazyAsset(i);
+        }
+    }
+
+    // Discard the asset in the snapshot.
+    void discardLazyAsset(int index) {
+        std::lock_guard<std::recursive_mutex> lock(lazyMutex_);
+        if (index >= int(lazyEntries_.size()) || !lazyEntries_[index]) {
+            return;
+        }
+        lazyEntries_[index].reset();
+        if (--numLazyEntries_ == 0) {
+            snapshot_.reset();
+            lazyEntries_.clear();
+        }
+        updateHasLazyEntries();
+    }
+
+    // Discard all entries of the snapshot.
+    void resetSnapshot() {
+        std::lock_guard<std::recursive_mutex> lock(lazyMutex_);
+        lazyEntries_.clear();
+        numLazyEntries_ = 0;
+        snapshot_.reset();
+        updateHasLazyEntries();
+    }
+
+    // Clear the flag if all assets are loaded. Called with the lock held.
+    void updateHasLazyEntries() const {
+        if (numLazyEntries_ == 0 && numLoading_ == 0) {
+            hasLazyEntries_.store(false, std::memory_order_release);
+        }
+    }
 };
 
 LM_COMP_REG_IMPL(Assets_, "assets::default");
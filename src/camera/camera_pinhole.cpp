@@ -87,6 +87,18 @@ public:
         return { position_, u_*d.x+v_*d.y+w_*d.z };
     }
 
+    virtual std::optional<RayDifferential> primaryRayDifferential(Vec2 rp, Vec2 drp, Float aspectRatio) const override {
+        // All rays share the origin, and the differentials of the directions
+        // are given by the rays of the offset raster positions.
+        const auto d = primaryRay(rp, aspectRatio).d;
+        return RayDifferential{
+            Vec3(0_f),
+            Vec3(0_f),
+            primaryRay(rp + Vec2(drp.x, 0_f), aspectRatio).d - d,
+            primaryRay(rp + Vec2(0_f, drp.y), aspectRatio).d - d
+        };
+    }
+
     virtual std::optional<Vec2> rasterPosition(Vec3 wo, Float aspectRatio) const override {
         // Convert to camera space
         const auto toEye = glm::transpose(Mat3(u_, v_, w_));
@@ -131,6 +131,171 @@ private:
 
 // ----------------------------------------------------------------------------
 
+// Reverse index from the components to the components referring to them by weak references.
+// The index is built for the hierarchy of each owner, e.g., a user context, by visiting it once,
+// and updated incrementally as long as the hierarchies are changed only by the thread replacing the instances.
+// The index is intentionally leaked for the same reason as the locator registry.
+class WeakRefIndex {
+public:
+    static WeakRefIndex& instance() {
+        static auto* index = new WeakRefIndex();
+        return *index;
+    }
+
+    // Record a change of the hierarchy, which might add weak references
+    static void changed() {
+        instance().changes_++;
+        localChanges_++;
+    }
+
+    WeakRefIndexMark mark() const {
+        return { changes_, localChanges_ };
+    }
+
+    std::optional<std::vector<std::string>> referrers(const std::unordered_set<Component*>& targets, Component* added, Component* owner, WeakRefIndexMark& mark) {
+        // The weak references are collected without holding the lock of the index,
+        // because the visit waits for the locks of the user contexts,
+        // whose threads might destruct the components requiring the lock of the index.
+        const bool valid = [&]() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto it = built_.find(owner);
+            return it != built_.end() && it->second == mark.global && onlyLocalChanges(mark);
+        }();
+        const auto start = this->mark();
+        std::vector<std::pair<Component*, Component*>> refs;
+        collect(valid ? added : owner, refs);
+        mark = this->mark();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!valid) {
+            // Rebuild the entries in the hierarchy of the owner.
+            // The other hierarchies might share the removed entries, so they are rebuilt when used.
+            const auto& prefix = owner->loc();
+            std::vector<Component*> removed;
+            for (const auto& [referrer, loc] : locs_) {
+                if (loc.empty() || loc == prefix || loc.rfind(prefix + ".", 0) == 0) {
+                    removed.push_back(referrer);
+                }
+            }
+            for (auto* referrer : removed) {
+                removeLocked(referrer);
+            }
+            built_.clear();
+        }
+        addLocked(refs);
+        if (onlyLocalChanges(start)) {
+            built_[owner] = changes_;
+        }
+        else {
+            built_.erase(owner);
+        }
+
+        std::vector<std::string> locs;
+        for (auto* target : targets) {
+            const auto it = referrers_.find(target);
+            if (it == referrers_.end()) {
+                continue;
+            }
+            for (auto* referrer : it->second) {
+                const auto& loc = locs_.at(referrer);
+                if (loc.empty()) {
+                    return {};
+                }
+                locs.push_back(loc);
+            }
+        }
+        return locs;
+    }
+
+    void add(const std::vector<std::pair<Component*, Component*>>& refs, Component* owner, WeakRefIndexMark mark) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        addLocked(refs);
+        if (onlyLocalChanges(mark)) {
+            built_[owner] = changes_;
+        }
+        else {
+            built_.erase(owner);
+        }
+    }
+
+    // Remove the entries of the destructed component
+    void remove(Component* p) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        removeLocked(p);
+        if (const auto it = referrers_.find(p); it != referrers_.end()) {
+            for (auto* referrer : it->second) {
+                targets_[referrer].erase(p);
+            }
+            referrers_.erase(it);
+        }
+        built_.erase(p);
+    }
+
+private:
+    // True if the hierarchy is changed only by the current thread after the mark
+    bool onlyLocalChanges(WeakRefIndexMark mark) const {
+        return changes_ - mark.global == localChanges_ - mark.local;
+    }
+
+    // Collect the weak references in the hierarchy of the component
+    static void collect(Component* p, std::vector<std::pair<Component*, Component*>>& refs) {
+        if (!p) {
+            return;
+        }
+        p->foreachUnderlying([&](Component*& comp, bool weak) {
+            if (!comp) {
+                return;
+            }
+            if (weak) {
+                refs.push_back({ p, comp });
+            }
+            else {
+                collect(comp, refs);
+            }
+        });
+    }
+
+    void addLocked(const std::vector<std::pair<Component*, Component*>>& refs) {
+        for (const auto& [referrer, target] : refs) {
+            referrers_[target].insert(referrer);
+            targets_[referrer].insert(target);
+            locs_[referrer] = referrer->loc();
+        }
+    }
+
+    // Remove the entries of the referring component
+    void removeLocked(Component* referrer) {
+        if (const auto it = targets_.find(referrer); it != targets_.end()) {
+            for (auto* target : it->second) {
+                if (const auto r = referrers_.find(target); r != referrers_.end()) {
+                    r->second.erase(referrer);
+                }
+            }
+            targets_.erase(it);
+        }
+        locs_.erase(referrer);
+    }
+
+private:
+    std::mutex mutex_;
+    std::atomic<long long> changes_ = 0;
+    static thread_local long long localChanges_;
+
+    // Number of the changes when the index is built for each owner
+    std::unordered_map<Component*, long long> built_;
+
+    // Referring components for each referred instance
+    std::unordered_map<Component*, std::unordered_set<Component*>> referrers_;
+
+    // Referred instances and locator for each referring component
+    std::unordered_map<Component*, std::unordered_set<Component*>> targets_;
+    std::unordered_map<Component*, std::string> locs_;
+};
+
+thread_local long long WeakRefIndex::localChanges_ = 0;
+
+// ----------------------------------------------------------------------------
+
 class ComponentContext {
 public:
     static ComponentContext& instance() {
@@ -149,6 +314,7 @@ public:
             return nullptr;
         }
         auto* p = it->second.createFunc();
+        WeakRefIndex::changed();
         Access::key(p) = key;
         Access::createFunc(p) = it->second.createFunc;
         Access::releaseFunc(p) = it->second.releaseFunc;
@@ -244,6 +410,10 @@ public:
 
     void registerRootComp(Component* p) {
         root_ = p;
+
+        // The registered locators might belong to the previous hierarchy
+        std::lock_guard<std::mutex> lock(locMutex());
+        locRegistry().clear();
     }
 
     Component* get(const std::string& locator) {
@@ -257,6 +427,72 @@ public:
             return nullptr;
         }
 
+        if (locator == "$") {
+            return root_;
+        }
+
+        // Find the component from the locator registry.
+        // The registry is shared by the user contexts used from the different threads.
+        auto& registry = locRegistry();
+        {
+            std::lock_guard<std::mutex> lock(locMutex());
+            if (const auto it = registry.find(locator); it != registry.end()) {
+                // The locator of the instance might be modified after the registration
+                if (it->second->loc() == locator) {
+                    return it->second;
+                }
+                registry.erase(it);
+            }
+        }
+
+        // Trace down the component hierarchy if not found.
+        // The result is cached only if the locator is the canonical one of the instance,
+        // because the alias locators (e.g., via underlying()) are not removed on destruction.
+        auto* p = trace(locator);
+        if (p && p->loc() == locator) {
+            std::lock_guard<std::mutex> lock(locMutex());
+            registry[locator] = p;
+        }
+        return p;
+    }
+
+    static void registerLoc(Component* p) {
+        const auto& loc = p->loc();
+        if (loc.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(locMutex());
+        locRegistry()[loc] = p;
+    }
+
+    static void unregisterLoc(Component* p) {
+        if (p->loc().empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(locMutex());
+        auto& registry = locRegistry();
+        if (const auto it = registry.find(p->loc()); it != registry.end() && it->second == p) {
+            registry.erase(it);
+        }
+    }
+
+private:
+    // Map from component locators to instances.
+    // The registry is intentionally leaked because components can be destructed
+    // after the deinitialization of the static variables, e.g., in global variables.
+    static std::unordered_map<std::string, Component*>& locRegistry() {
+        static auto* registry = new std::unordered_map<std::string, Component*>();
+        return *registry;
+    }
+
+    // Mutex guarding the locator registry, leaked for the same reason
+    static std::mutex& locMutex() {
+        static auto* mutex = new std::mutex();
+        return *mutex;
+    }
+
+    // Find a component by tracing down the component hierarchy from the root
+    Component* trace(const std::string& locator) {
         // Given 'xxx.yyy.zzz', returns the pair of 'xxx' and 'yyy.zzz'.
         const auto splitFirst = [&](const std::string& s) -> std::tuple<std::string, std::string> {
             const auto i = s.find_first_of('.', 0);
@@ -341,7 +577,35 @@ LM_PUBLIC_API void registerRootComp(Component* p) {
 }
 
 LM_PUBLIC_API Component* get(const std::string& locator) {
-    return ComponentContext::instance().get(locator);
+    // The resolved instance might be stored as a weak reference
+    auto* p = ComponentContext::instance().get(locator);
+    if (p) {
+        WeakRefIndex::changed();
+    }
+    return p;
+}
+
+LM_PUBLIC_API void registerLoc(Component* p) {
+    ComponentContext::registerLoc(p);
+}
+
+LM_PUBLIC_API void unregisterLoc(Component* p) {
+    // Not using instance() since this can be called after the context is destructed
+    ComponentContext::unregisterLoc(p);
+    WeakRefIndex::instance().remove(p);
+}
+
+LM_PUBLIC_API WeakRefIndexMark weakRefIndexMark() {
+    return WeakRefIndex::instance().mark();
+}
+
+LM_PUBLIC_API std::optional<std::vector<std::string>> weakReferrers(
+    Component* owner, const std::unordered_set<Component*>& targets, Component* added, WeakRefIndexMark& mark) {
+    return WeakRefIndex::instance().referrers(targets, added, owner, mark);
+}
+
+LM_PUBLIC_API void addWeakRefs(Component* owner, const std::vector<std::pair<Component*, Component*>>& refs, WeakRefIndexMark mark) {
+    WeakRefIndex::instance().add(refs, owner, mark);
 }
 
 // ----------------------------------------------------------------------------
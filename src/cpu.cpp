@@ -0,0 +1,146 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/cpu.h>
+#include <lm/logger.h>
+#if LM_ARCH_X64 || LM_ARCH_X86
+#if LM_COMPILER_MSVC
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE::cpu)
+
+namespace {
+
+#if LM_ARCH_X64 || LM_ARCH_X86
+
+// Execute CPUID instruction. Returns EAX, EBX, ECX, EDX in order.
+std::array<unsigned int, 4> cpuid(unsigned int leaf, unsigned int subleaf) {
+    std::array<unsigned int, 4> r{};
+    #if LM_COMPILER_MSVC
+    int ri[4];
+    __cpuidex(ri, int(leaf), int(subleaf));
+    for (int i = 0; i < 4; i++) {
+        r[i] = unsigned(ri[i]);
+    }
+    #else
+    __cpuid_count(leaf, subleaf, r[0], r[1], r[2], r[3]);
+    #endif
+    return r;
+}
+
+// Read extended control register XCR0 to check the registers saved by the OS
+unsigned long long xcr0() {
+    #if LM_COMPILER_MSVC
+    return _xgetbv(0);
+    #else
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<unsigned long long>(hi) << 32) | lo;
+    #endif
+}
+
+ISA detectImpl() {
+    const auto bit = [](unsigned int v, int i) { return ((v >> i) & 1) != 0; };
+    const auto maxLeaf = cpuid(0, 0)[0];
+    if (maxLeaf < 1) {
+        return ISA::Baseline;
+    }
+
+    // Leaf 1
+    const auto r1 = cpuid(1, 0);
+    const bool sse42 = bit(r1[2], 20);
+    const bool fma = bit(r1[2], 12);
+    const bool osxsave = bit(r1[2], 27);
+    const bool avx = bit(r1[2], 28);
+    if (!sse42) {
+        return ISA::Baseline;
+    }
+
+    // YMM (bits 1,2) and ZMM/opmask (bits 5,6,7) states must be enabled by the OS
+    const auto xcr = osxsave ? xcr0() : 0;
+    const bool osAVX = (xcr & 0x6) == 0x6;
+    const bool osAVX512 = (xcr & 0xe6) == 0xe6;
+    if (!(avx && fma && osAVX) || maxLeaf < 7) {
+        return ISA::SSE42;
+    }
+
+    // Leaf 7
+    const auto r7 = cpuid(7, 0);
+    const bool avx2 = bit(r7[1], 5);
+    const bool avx512f = bit(r7[1], 16);
+    const bool avx512dq = bit(r7[1], 17);
+    const bool avx512vl = bit(r7[1], 31);
+    if (!avx2) {
+        return ISA::SSE42;
+    }
+    if (avx512f && avx512dq && avx512vl && osAVX512) {
+        return ISA::AVX512;
+    }
+    return ISA::AVX2;
+}
+
+#else
+
+ISA detectImpl() {
+    return ISA::Baseline;
+}
+
+#endif
+
+const std::array<std::pair<ISA, const char*>, 4> Names = {{
+    { ISA::Baseline, "baseline" },
+    { ISA::SSE42,    "sse42"    },
+    { ISA::AVX2,     "avx2"     },
+    { ISA::AVX512,   "avx512"   },
+}};
+
+// Selected ISA. Initialized by the detected one.
+std::atomic<int> selected_ = -1;
+
+}
+
+LM_PUBLIC_API ISA detect() {
+    static const ISA isa = detectImpl();
+    return isa;
+}
+
+LM_PUBLIC_API bool select(const std::string& name) {
+    const auto detected = detect();
+    if (name == "auto") {
+        selected_ = int(detected);
+        return true;
+    }
+    const auto it = std::find_if(Names.begin(), Names.end(), [&](const auto& p) {
+        return name == p.second;
+    });
+    if (it == Names.end()) {
+        LM_ERROR("Invalid ISA [name='{}']", name);
+        return false;
+    }
+    if (int(it->first) > int(detected)) {
+        LM_WARN("ISA is not supported by the CPU. Using detected one [requested='{}', detected='{}']",
+            name, cpu::name(detected));
+        selected_ = int(detected);
+        return true;
+    }
+    selected_ = int(it->first);
+    return true;
+}
+
+LM_PUBLIC_API ISA selected() {
+    const int isa = selected_;
+    return isa < 0 ? detect() : ISA(isa);
+}
+
+LM_PUBLIC_API std::string name(ISA isa) {
+    return Names.at(int(isa)).second;
+}
+
+LM_NAMESPACE_END(LM_NAMESPACE::cpu)
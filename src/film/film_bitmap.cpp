@@ -9,48 +9,57 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb/stb_image_write.h>
 #include <lm/parallel.h>
+#include <array>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
-// Wrapper for std::atomic.
-// Extending std::vector with std::atomic generates a compilation error
-// because std::atomic is neither copy nor move constructable.
-// cf. https://stackoverflow.com/questions/13193484/how-to-declare-a-vector-of-atomic-in-c
-template <typename T>
-struct AtomicWrapper {
-    std::atomic<T> v_;
-
-    template <typename Archive>
-    void serialize(Archive& ar) {
-        ar(v_);
+// Pixel of RGB values with per-channel atomic operations.
+// std::atomic<Vec3> is not lock-free because of its size,
+// so that the operations fall back to a lock inside the runtime library
+// and concurrent splats to the different pixels contend for the same lock.
+// The channels are updated independently with lock-free operations instead.
+struct AtomicPixel {
+    std::atomic<Float> c[3];
+
+    AtomicPixel() : AtomicPixel(Vec3(0_f)) {}
+    AtomicPixel(Vec3 v) {
+        store(v);
     }
+    AtomicPixel(const AtomicPixel& o) : AtomicPixel(o.load()) {}
 
-    AtomicWrapper() = default;
-    AtomicWrapper(T& v)
-        : v_(v) {}
-    AtomicWrapper(const std::atomic<T>& v)
-        : v_(v.load()) {}
-    AtomicWrapper(const AtomicWrapper& o)
-        : v_(o.v_.load()) {}
-
-    AtomicWrapper& operator=(const AtomicWrapper& o) {
-        v_.store(o.v_.load());
+    AtomicPixel& operator=(const AtomicPixel& o) {
+        store(o.load());
         return *this;
     }
-    
-    void update(const T& src) {
-        auto expected = v_.load();
-        while (!v_.compare_exchange_weak(expected, src));
+
+    Vec3 load() const {
+        return {
+            c[0].load(std::memory_order_relaxed),
+            c[1].load(std::memory_order_relaxed),
+            c[2].load(std::memory_order_relaxed)
+        };
     }
 
-    void add(const T& v) {
-        auto expected = v_.load();
-        while (!v_.compare_exchange_weak(expected, expected + v));
+    void store(Vec3 v) {
+        for (int i = 0; i < 3; i++) {
+            c[i].store(v[i], std::memory_order_relaxed);
+        }
     }
 
-    void updateWithFunc(const std::function<T(T curr)>& updateFunc) {
-        auto expected = v_.load();
-        while (!v_.compare_exchange_weak(expected, updateFunc(expected)));
+    // The ordering is not required because the values are
+    // read after the synchronization of the threads.
+    void add(Vec3 v) {
+        for (int i = 0; i < 3; i++) {
+            if (v[i] == 0_f) {
+                continue;
+            }
+            #if __cpp_lib_atomic_float
+            c[i].fetch_add(v[i], std::memory_order_relaxed);
+            #else
+            auto expected = c[i].load(std::memory_order_relaxed);
+            while (!c[i].compare_exchange_weak(expected, expected + v[i], std::memory_order_relaxed));
+            #endif
+        }
     }
 };
 
@@ -115,9 +124,21 @@ namespace image {
 
    :param int w: Width of the film.
    :param int h: Height of the film.
+   :param list aovs: Names of additional layers (e.g., ``["albedo", "normal", "depth", "variance"]``).
+                     Default is empty.
 
    This component implements thread-safe bitmap film.
    The invocation of :cpp:func:`lm::Film::setPixel()` function is thread safe.
+   The splats are accumulated with lock-free atomic addition for each channel,
+   so that the concurrent splats from many threads scale even for the scatter-heavy renderers
+   like :cpp:func:`renderer::bdpt`.
+   Note that the channels of a pixel are updated independently.
+   :cpp:func:`lm::Film::updatePixel()` is serialized with striped locks
+   only among its own invocations.
+   :cpp:func:`lm::Film::takeSnapshot()` keeps a copy of the pixels in a buffer
+   reused over the passes.
+   Each layer specified by ``aovs`` holds the same number of RGB pixels as the color,
+   indexed from 1 in the order of the list.
 \endrst
 */
 class Film_Bitmap final : public Film {
@@ -125,12 +146,35 @@ private:
     int w_;
     int h_;
     int quality_;
-    std::vector<AtomicWrapper<Vec3>> data_;
+    using Data = std::vector<AtomicPixel>;
+    Data data_;
     std::vector<Vec3> dataTemp_;  // Temporary buffer for external reference
+    std::vector<Vec3> snapshot_;  // Snapshot of the pixels, reused not to allocate per pass
+    bool hasSnapshot_ = false;
+
+    // Additional layer
+    struct Layer {
+        std::string name;
+        Data data;
+        std::vector<Vec3> temp;
+        std::vector<Vec3> snapshot;
+
+        template <typename Archive>
+        void serialize(Archive& ar) {
+            ar(name);
+            serializeData(ar, data, temp);
+        }
+    };
+    std::vector<Layer> aovs_;
+
+    // Striped locks for updatePixel()
+    std::array<std::mutex, 64> updateLocks_;
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(w_, h_, quality_, data_);
+        ar(w_, h_, quality_);
+        serializeData(ar, data_, dataTemp_);
+        ar(aovs_);
     }
 
 public:
@@ -139,6 +183,15 @@ public:
         h_ = prop["h"];
         quality_ = json::value<int>(prop, "quality", 90);
         data_.assign(w_*h_, {});
+        hasSnapshot_ = false;
+        aovs_.clear();
+        for (const std::string name : json::value<std::vector<std::string>>(prop, "aovs", {})) {
+            if (name == "color" || layerIndex(name) >= 0) {
+                LM_ERROR("Duplicated layer [name='{}']", name);
+                return false;
+            }
+            aovs_.push_back({ name, Data(w_*h_), {}, {} });
+        }
         return true;
     }
 
@@ -151,10 +204,180 @@ public:
     }
 
     virtual void setPixel(int x, int y, Vec3 v) override {
-        data_[y*w_ + x].update(v);
+        data_[y*w_ + x].store(v);
     }
 
     virtual bool save(const std::string& outpath) const override {
+        return saveData(data_, outpath);
+    }
+
+    virtual FilmBuffer buffer() override {
+        return makeBuffer(data_, dataTemp_);
+    }
+
+    virtual void accum(const Film* film_) override {
+        const auto* film = dynamic_cast<const Film_Bitmap*>(film_);
+        if (!film) {
+            LM_ERROR("Could not accumuate film. Invalid film type.");
+            return;
+        }
+        if (w_ != film->w_ || h_ != film->h_) {
+            LM_ERROR("Film size is different [expected='({},{})', actual='({},{})']", w_, h_, film->w_, film->h_);
+            return;
+        }
+        accumData(data_, film->data_);
+        for (auto& aov : aovs_) {
+            // Layers missing in the other film are ignored
+            const int i = film->layerIndex(aov.name);
+            if (i > 0) {
+                accumData(aov.data, film->aovs_[i-1].data);
+            }
+        }
+    }
+
+    virtual void splatPixel(int x, int y, Vec3 v) override {
+        data_[y*w_+x].add(v);
+    }
+
+    virtual void updatePixel(int x, int y, const PixelUpdateFunc& updateFunc) override {
+        // The update is atomic only among the calls of this function
+        std::lock_guard<std::mutex> lock(updateLocks_[(y*w_+x) % updateLocks_.size()]);
+        auto& p = data_[y*w_+x];
+        p.store(updateFunc(p.load()));
+    }
+
+    virtual void rescale(Float s) override {
+        parallel::foreach(w_ * h_, [&](long long i, int) {
+            data_[i].store(data_[i].load() * s);
+            for (auto& aov : aovs_) {
+                aov.data[i].store(aov.data[i].load() * s);
+            }
+        });
+    }
+
+    virtual void clear() override {
+        data_.assign(w_*h_, {});
+        for (auto& aov : aovs_) {
+            aov.data.assign(w_*h_, {});
+        }
+    }
+
+    virtual bool takeSnapshot() override {
+        copyData(snapshot_, data_);
+        for (auto& aov : aovs_) {
+            copyData(aov.snapshot, aov.data);
+        }
+        hasSnapshot_ = true;
+        return true;
+    }
+
+    virtual bool restoreSnapshot() override {
+        if (!hasSnapshot_ || snapshot_.size() != data_.size()) {
+            return false;
+        }
+        restoreData(data_, snapshot_);
+        for (auto& aov : aovs_) {
+            restoreData(aov.data, aov.snapshot);
+        }
+        return true;
+    }
+
+    virtual int layerIndex(const std::string& name) const override {
+        if (name == "color") {
+            return 0;
+        }
+        for (int i = 0; i < int(aovs_.size()); i++) {
+            if (aovs_[i].name == name) {
+                return i + 1;
+            }
+        }
+        return -1;
+    }
+
+    virtual void splatLayer(int layer, int x, int y, Vec3 v) override {
+        layerData(layer)[y*w_+x].add(v);
+    }
+
+    virtual void setLayerPixel(int layer, int x, int y, Vec3 v) override {
+        layerData(layer)[y*w_+x].store(v);
+    }
+
+    virtual Vec3 layerPixel(int layer, int x, int y) const override {
+        return layerData(layer)[y*w_+x].load();
+    }
+
+    virtual FilmBuffer layerBuffer(int layer) override {
+        if (layer == 0) {
+            return buffer();
+        }
+        auto& aov = aovs_.at(layer-1);
+        return makeBuffer(aov.data, aov.temp);
+    }
+
+    virtual bool saveLayer(int layer, const std::string& outpath) const override {
+        if (layer < 0 || layer > int(aovs_.size())) {
+            LM_ERROR("Invalid layer [layer={}]", layer);
+            return false;
+        }
+        return saveData(layer == 0 ? data_ : aovs_[layer-1].data, outpath);
+    }
+
+private:
+    Data& layerData(int layer) {
+        return layer == 0 ? data_ : aovs_[layer-1].data;
+    }
+
+    const Data& layerData(int layer) const {
+        return layer == 0 ? data_ : aovs_[layer-1].data;
+    }
+
+    // Pixels are serialized as a raw block via the temporary buffer
+    // because std::atomic is not trivially copyable.
+    template <typename Archive>
+    static void serializeData(Archive& ar, Data& data, std::vector<Vec3>& temp) {
+        if constexpr (std::is_same_v<Archive, OutputArchive>) {
+            temp.resize(data.size());
+            for (size_t i = 0; i < data.size(); i++) {
+                temp[i] = data[i].load();
+            }
+        }
+        ar(serial::raw(temp));
+        if constexpr (std::is_same_v<Archive, InputArchive>) {
+            data.assign(temp.size(), {});
+            for (size_t i = 0; i < temp.size(); i++) {
+                data[i].store(temp[i]);
+            }
+        }
+    }
+
+    FilmBuffer makeBuffer(const Data& data, std::vector<Vec3>& temp) const {
+        temp.clear();
+        for (const auto& v : data) {
+            temp.push_back(v.load());
+        }
+        return FilmBuffer{ w_, h_, &temp[0].x };
+    }
+
+    void copyData(std::vector<Vec3>& dst, const Data& src) const {
+        dst.resize(src.size());
+        for (size_t i = 0; i < src.size(); i++) {
+            dst[i] = src[i].load();
+        }
+    }
+
+    void restoreData(Data& dst, const std::vector<Vec3>& src) const {
+        for (size_t i = 0; i < src.size(); i++) {
+            dst[i].store(src[i]);
+        }
+    }
+
+    void accumData(Data& dst, const Data& src) const {
+        for (int i = 0; i < w_*h_; i++) {
+            dst[i].add(src[i].load());
+        }
+    }
+
+    bool saveData(const Data& data, const std::string& outpath) const {
         // Disable floating-point exception for stb_image
         exception::ScopedDisableFPEx disableFp_;
 
@@ -175,30 +398,30 @@ public:
         // Check extension of the output file
         const auto ext = fs::path(outpath).extension().string();
         if (ext == ".png") {
-            const auto data = copy<unsigned char>(true);
-            if (!stbi_write_png(outpath.c_str(), w_, h_, 3, data.data(), w_*3)) {
+            const auto pixels = copy<unsigned char>(data, true);
+            if (!stbi_write_png(outpath.c_str(), w_, h_, 3, pixels.data(), w_*3)) {
                 return false;
             }
         }
         #if 0
         else if (ext == ".jpg") {
-            const auto data = copy<unsigned char>(true);
-            if (!stbi_write_jpg(outpath.c_str(), w_, h_, 3, data.data(), quality_)) {
+            const auto pixels = copy<unsigned char>(data, true);
+            if (!stbi_write_jpg(outpath.c_str(), w_, h_, 3, pixels.data(), quality_)) {
                 return false;
             }
         }
         #endif
         else if (ext == ".hdr") {
-            auto data = copy<float>(true);
-            image::sanityCheck(w_, h_, data);
-            if (!stbi_write_hdr(outpath.c_str(), w_, h_, 3, data.data())) {
+            auto pixels = copy<float>(data, true);
+            image::sanityCheck(w_, h_, pixels);
+            if (!stbi_write_hdr(outpath.c_str(), w_, h_, 3, pixels.data())) {
                 return false;
             }
         }
         else if (ext == ".pfm") {
-            const auto data = copy<float>(false);
-            image::sanityCheck(w_, h_, data);
-            if (!image::writePfm(outpath, w_, h_, data)) {
+            const auto pixels = copy<float>(data, false);
+            image::sanityCheck(w_, h_, pixels);
+            if (!image::writePfm(outpath, w_, h_, pixels)) {
                 return false;
             }
         }
@@ -210,57 +433,14 @@ public:
         return true;
     }
 
-    virtual FilmBuffer buffer() override {
-        dataTemp_.clear();
-        for (const auto& v : data_) {
-            dataTemp_.push_back(v.v_);
-        }
-        return FilmBuffer{ w_, h_, &dataTemp_[0].x };
-    }
-
-    virtual void accum(const Film* film_) override {
-        const auto* film = dynamic_cast<const Film_Bitmap*>(film_);
-        if (!film) {
-            LM_ERROR("Could not accumuate film. Invalid film type.");
-            return;
-        }
-        if (w_ != film->w_ || h_ != film->h_) {
-            LM_ERROR("Film size is different [expected='({},{})', actual='({},{})']", w_, h_, film->w_, film->h_);
-            return;
-        }
-        for (int i = 0; i < w_*h_; i++) {
-            const auto v = film->data_[i].v_.load();
-            data_[i].add(v);
-        }
-    }
-
-    virtual void splatPixel(int x, int y, Vec3 v) override {
-        data_[y*w_+x].add(v);
-    }
-
-    virtual void updatePixel(int x, int y, const PixelUpdateFunc& updateFunc) override {
-        data_[y*w_+x].updateWithFunc(updateFunc);
-    }
-
-    virtual void rescale(Float s) override {
-        parallel::foreach(w_ * h_, [&](long long i, int) {
-            data_[i].v_ = data_[i].v_.load() * s;
-        });
-    }
-
-    virtual void clear() override {
-        data_.assign(w_*h_, {});
-    }
-
-private:
     template <typename T>
-    std::vector<T> copy(bool flip) const {
+    std::vector<T> copy(const Data& data, bool flip) const {
         std::vector<T> v(w_*h_*3, {});
         for (int y = 0; y < h_; y++) {
             const int yy = !flip ? y : h_-y-1;
             for (int x = 0; x < w_; x++) {
                 for (int i = 0; i < 3; i++) {
-                    const Float t = data_[y*w_+x].v_.load()[i];
+                    const Float t = data[y*w_+x].load()[i];
                     if constexpr (std::is_same_v<T, float>) {
                         v[3*(yy*w_+x)+i] = T(t);
                     }
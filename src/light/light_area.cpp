@@ -48,6 +48,10 @@ public:
     virtual bool construct(const Json& prop) override {
         Ke_ = json::value<Vec3>(prop, "Ke");
         mesh_ = json::compRef<Mesh>(prop, "mesh");
+        if (mesh_->shapeType() != Mesh::ShapeType::Triangle) {
+            LM_ERROR("Area light requires triangle mesh [mesh='{}']", mesh_->loc());
+            return false;
+        }
         
         // Construct CDF for surface sampling
         // Note we construct the CDF before transformation
@@ -88,6 +92,42 @@ public:
         };
     }
 
+    virtual std::optional<LightRaySample> sampleRay(Rng& rng, const Transform& transform) const override {
+        // Position uniformly on the surface and cosine-weighted direction around the normal
+        const int i = dist_.samp(rng);
+        const auto s = math::safeSqrt(rng.u());
+        const auto tri = mesh_->triangleAt(i);
+        const auto a = tri.p1.p;
+        const auto b = tri.p2.p;
+        const auto c = tri.p3.p;
+        const auto p = math::mixBarycentric(a, b, c, Vec2(1_f-s, rng.u()*s));
+        const auto n = glm::normalize(glm::cross(b - a, c - a));
+        const auto geomL = PointGeometry::makeOnSurface(
+            transform.M * Vec4(p, 1_f),
+            glm::normalize(transform.normalM * n));
+        const auto d = math::sampleCosineWeighted(rng);
+        const auto wo = geomL.u*d.x + geomL.v*d.y + geomL.n*d.z;
+        const auto pA = pdfPosition(geomL, transform);
+        const auto pD = pdfDirection(geomL, 0, wo);
+        if (pA == 0_f || pD == 0_f) {
+            return {};
+        }
+        return LightRaySample{
+            geomL,
+            wo,
+            0,
+            eval(geomL, 0, wo) / (pA * pD)
+        };
+    }
+
+    virtual Float pdfPosition(const PointGeometry&, const Transform& transform) const override {
+        return tranformedInvA(transform);
+    }
+
+    virtual Float pdfDirection(const PointGeometry& geomL, int, Vec3 wo) const override {
+        return glm::dot(wo, geomL.n) <= 0_f ? 0_f : 1_f / Pi;
+    }
+
     virtual Float pdf(const PointGeometry& geom, const PointGeometry& geomL, int, const Transform& transform, Vec3) const override {
         const auto G = surface::geometryTerm(geom, geomL);
         return G == 0_f ? 0_f : tranformedInvA(transform) / G;
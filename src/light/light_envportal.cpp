@@ -7,6 +7,7 @@
 #include <lm/core.h>
 #include <lm/light.h>
 #include <lm/texture.h>
+#include <lm/parallel.h>
 
 #define LM_LIGHT_ENV_PORTAL_AVOID_FIREFRIES 1
 
@@ -51,6 +52,11 @@ struct Portal {
     Mat3 toWorld;
     Mat3 toLocal;
 
+    template <typename Archive>
+    void serialize(Archive& ar) {
+        ar(ps, ex, ey, ez, toWorld, toLocal);
+    }
+
     Portal() = default;
     Portal(const std::vector<Vec3>& ps) : ps(ps) {
         // ex and ey must be orthogonal (we don't check it)
@@ -115,16 +121,29 @@ struct Dist2Sub {
     std::vector<Float> sat;
     int w, h;
 
+    template <typename Archive>
+    void serialize(Archive& ar) {
+        ar(serial::raw(sat), w, h);
+    }
+
     void init(const std::vector<Float>& v, int cols, int rows) {
-        // Compute SAT
+        // Compute SAT by the prefix sums along the rows and then along the columns.
+        // Each pass is independent for each row or column.
         w = cols;
         h = rows;
         sat.assign((w+1)*(h+1), 0_f);
-        for (int y = 1; y <= h; y++) {
+        parallel::foreach(h, [&](long long i, int) {
+            const int y = int(i) + 1;
             for (int x = 1; x <= w; x++) {
-                sat[si(x,y)] = v[(y-1)*w+x-1] + sat[si(x-1,y)] + sat[si(x,y-1)] - sat[si(x-1,y-1)];
+                sat[si(x,y)] = v[(y-1)*w+x-1] + sat[si(x-1,y)];
             }
-        }
+        });
+        parallel::foreach(w, [&](long long i, int) {
+            const int x = int(i) + 1;
+            for (int y = 1; y <= h; y++) {
+                sat[si(x,y)] += sat[si(x,y-1)];
+            }
+        });
     }
 
     Float R(Vec2 mi, Vec2 ma) const {
@@ -190,7 +209,8 @@ public:
         return t1+t2+t3+t4;
     }
 
-    using CDFFunc = std::function<Float(Float v, const Bound2&)>;
+    // CDFFunc: Float(Float v, const Bound2&)
+    template <typename CDFFunc>
     Float sample1D(Rng& rng, const Bound2& b, Float lb_, Float ub_, const CDFFunc& cdf) const {
         int lb = int(lb_);
         int ub = int(ub_)+1;
@@ -214,14 +234,89 @@ public:
 
 // ----------------------------------------------------------------------------
 
-// Width and height of the precomputed distributions
-constexpr int DistSize = 4096;
-
 // Information associated with a single portal
 struct PortalContext {
-    Portal portal;                      // Portal
-    Dist2Sub dist[2];                   // SATs for front and back faces
-    std::vector<Vec3> rectEnvmap[2];    // Rectified envmap for front and back faces
+    Portal portal;                          // Portal
+    Dist2Sub dist[2];                       // SATs for front and back faces
+    std::vector<glm::vec3> rectEnvmap[2];   // Rectified envmap for front and back faces.
+                                            // Stored in single precision to save the memory.
+
+    template <typename Archive>
+    void serialize(Archive& ar) {
+        ar(portal, dist[0], dist[1], serial::raw(rectEnvmap[0]), serial::raw(rectEnvmap[1]));
+    }
+};
+
+// Quantities of a portal depending on the shading point
+struct PortalQuery {
+    int face;       // Face of the portal seen from the shading point
+    Bound2 b_rect;  // Extent of the portal in rectified coordinates
+    Float I;        // Integral of the distribution inside the extent
+};
+
+// Discrete distribution to select a portal seen from a shading point.
+// The quantities are stored in the fixed-size storage on the stack
+// unless the number of portals exceeds the capacity, so that
+// the selection is free from the heap allocation in the typical scenes.
+class PortalSelection {
+private:
+    static constexpr int InlineCapacity = 16;
+    std::array<PortalQuery, InlineCapacity> inline_;
+    std::vector<PortalQuery> heap_;
+    PortalQuery* qs_;
+    int n_;
+    Float sum_ = 0_f;
+
+public:
+    PortalSelection(const std::vector<PortalContext>& portals, Vec3 p) {
+        n_ = int(portals.size());
+        if (n_ <= InlineCapacity) {
+            qs_ = inline_.data();
+        }
+        else {
+            heap_.resize(n_);
+            qs_ = heap_.data();
+        }
+        for (int i = 0; i < n_; i++) {
+            const auto& portal = portals[i];
+            auto& q = qs_[i];
+            q.face = portal.portal.checkFrontOrBackFace(p);
+            q.b_rect = portal.portal.rectifiedPortalBound(p, q.face);
+            q.I = portal.dist[q.face].R(q.b_rect.mi, q.b_rect.ma);
+            sum_ += q.I;
+        }
+    }
+
+    // qs_ points to the internal storage
+    PortalSelection(const PortalSelection&) = delete;
+    PortalSelection& operator=(const PortalSelection&) = delete;
+
+    const PortalQuery& operator[](int i) const {
+        return qs_[i];
+    }
+
+    // Check if any portal can be selected
+    bool valid() const {
+        return sum_ > 0_f;
+    }
+
+    // Selection probability
+    Float p(int i) const {
+        return qs_[i].I / sum_;
+    }
+
+    // Select a portal
+    int samp(Rng& rng) const {
+        const auto u = rng.u() * sum_;
+        Float c = 0_f;
+        for (int i = 0; i < n_ - 1; i++) {
+            c += qs_[i].I;
+            if (u < c) {
+                return i;
+            }
+        }
+        return n_ - 1;
+    }
 };
 
 // ----------------------------------------------------------------------------
@@ -230,9 +325,14 @@ class Light_EnvPortal final : public Light {
 private:
     Component::Ptr<Texture> envmap_;
     Float rot_;
+    int distSize_;                          // Width and height of the precomputed distributions
     std::vector<PortalContext> portals_;
 
 public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(envmap_, rot_, distSize_, portals_);
+    }
+
     virtual void foreachUnderlying(const ComponentVisitor& visitor) override {
         comp::visit(visitor, envmap_);
     }
@@ -242,24 +342,92 @@ private:
     Bound2 rectifiedToDist(Bound2 p_rect) const {
         const auto piover2 = Pi * .5_f;
         return {
-            (p_rect.mi/piover2+1_f)*.5_f*Float(DistSize),
-            (p_rect.ma/piover2+1_f)*.5_f*Float(DistSize)
+            (p_rect.mi/piover2+1_f)*.5_f*Float(distSize_),
+            (p_rect.ma/piover2+1_f)*.5_f*Float(distSize_)
         };
     }
 
-    // Create a distribution to select a portal
-    Dist selectionDist(const PointGeometry& geom) const {
-        Dist selectionDist;
+    // Key of the cache of the precomputed distributions.
+    // FNV-1a hash of the envmap, the rotation, the resolution, and the portal geometry.
+    std::uint64_t cacheKey() const {
+        std::uint64_t h = 14695981039346656037ULL;
+        const auto hashBytes = [&](const void* data, size_t size) {
+            const auto* p = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++) {
+                h = (h ^ p[i]) * 1099511628211ULL;
+            }
+        };
+        const auto buf = envmap_->buffer();
+        hashBytes(&buf.w, sizeof(int));
+        hashBytes(&buf.h, sizeof(int));
+        hashBytes(&buf.c, sizeof(int));
+        if (buf.data) {
+            hashBytes(buf.data, sizeof(float) * size_t(buf.w) * buf.h * buf.c);
+        }
+        hashBytes(&rot_, sizeof(Float));
+        hashBytes(&distSize_, sizeof(int));
+        for (const auto& portal : portals_) {
+            hashBytes(portal.portal.ps.data(), sizeof(Vec3) * portal.portal.ps.size());
+        }
+        return h;
+    }
+
+    // Evaluate pdf with the portal selection computed for the shading point
+    Float pdf(const PortalSelection& sel, const PointGeometry& geom, const PointGeometry& geomL, int portalIndex) const {
+        if (!sel.valid()) {
+            return 0_f;
+        }
+
+        // PDF of sampling the direction with the selected portal
+        const auto d_world = -geomL.wo;
+        const auto p_portal = [&]() -> Float {
+            const auto& portal = portals_[portalIndex];
+
+            // Portal face orientation and the extent of the portal in rectified coordinates
+            const int face = sel[portalIndex].face;
+            const auto& b_rect = sel[portalIndex].b_rect;
+
+            // Direction in world coordinates to rectified coordinates
+            const auto p_rect = portal.portal.worldDirToRectified(d_world, face);
+
+            // Check if p_rect is inside the portal
+            if (!b_rect.contains(p_rect)) {
+                return 0_f;
+            }
+
+            // Compute pdf
+            const auto p_dist = (p_rect-b_rect.mi)/(b_rect.ma-b_rect.mi);  // Be careful of the range
+            const auto b_dist = rectifiedToDist(b_rect);
+            const auto p = portal.dist[face].pdf(p_dist.x, p_dist.y, b_dist) / b_rect.area();
+        
+            // Jacobian
+            const auto d_cano = portal.portal.rectifiedToCanonical(p_rect, face);
+            const auto J = std::abs(d_cano.z) / ((1_f - d_cano.x*d_cano.x) * (1_f - d_cano.y*d_cano.y));
+
+            return p * J / glm::abs(glm::dot(d_world, geom.n));
+        }();
+        
+        // Selection probability of the portal
+        const auto p_sel = sel.p(portalIndex);
+
+        // Count the number of overlapping portals
+        int overlappingPortals = 1;
         for (int i = 0; i < (int)(portals_.size()); i++) {
+            if (i == portalIndex) {
+                continue;
+            }
             const auto& portal = portals_[i];
-            const int face = portal.portal.checkFrontOrBackFace(geom.p);
-            const auto& dist = portal.dist[face];
-            const auto b_rect = portal.portal.rectifiedPortalBound(geom.p, face);
-            const auto I = dist.R(b_rect.mi, b_rect.ma);
-            selectionDist.add(I);
+            const auto p_rect = portal.portal.worldDirToRectified(d_world, sel[i].face);
+            if (sel[i].b_rect.contains(p_rect)) {
+                overlappingPortals++;
+            }
         }
-        selectionDist.norm();
-        return selectionDist;
+
+        // MIS weight
+        const auto inv_misw = (Float)(overlappingPortals);
+
+        // Solid angle measure to projected solid anglme measure
+        return p_portal * p_sel * inv_misw;
     }
 
 public:
@@ -271,28 +439,71 @@ public:
         }
         rot_ = glm::radians(json::value(prop, "rot", 0_f));
 
+        // Resolution of the precomputed distributions.
+        // If not specified, use the power of two not smaller than the envmap resolution,
+        // which keeps the distribution as fine as the envmap without wasting the memory.
+        distSize_ = [&]() -> int {
+            if (const auto size = json::valueOrNone<int>(prop, "dist_size")) {
+                return *size;
+            }
+            const auto envSize = envmap_->size();
+            int size = 256;
+            while (size < std::max(envSize.w, envSize.h) && size < 4096) {
+                size *= 2;
+            }
+            return size;
+        }();
+        if (distSize_ <= 0) {
+            LM_ERROR("Invalid distribution size [dist_size='{}']", distSize_);
+            return false;
+        }
+
         // Portal
         auto ps = prop["portal"];
         for (const auto& p : ps) {
             portals_.emplace_back();
             portals_.back().portal = Portal({ p[0], p[1], p[2], p[3] });
         }
+
+        // Load the precomputed distributions from the cache if available
+        const auto cacheDir = json::valueOrNone<std::string>(prop, "cache_dir");
+        const auto cachePath = cacheDir
+            ? (fs::path(*cacheDir) / fmt::format("envportal_{:016x}.bin", cacheKey())).string()
+            : std::string();
+        if (cacheDir && fs::exists(cachePath)) {
+            // Load into a separate storage not to break the portals on failure
+            try {
+                std::vector<PortalContext> cached;
+                serial::load(cachePath, cached);
+                if (cached.size() != portals_.size()) {
+                    throw std::runtime_error("Inconsistent number of portals");
+                }
+                portals_ = std::move(cached);
+                LM_INFO("Loaded precomputed distributions [path='{}']", cachePath);
+                return true;
+            }
+            catch (const std::exception& e) {
+                LM_WARN("Failed to load cache. Recomputing distributions [path='{}', error='{}']", cachePath, e.what());
+            }
+        }
         
         // Precompute 2D distributions of the intensities of environment light
         // in rectified coordinates seen from the front and the back respectively.
+        const int n = distSize_;
+        std::vector<Float> ls(size_t(n)*n);
         for (auto& portal : portals_) {
             for (int face = 0; face <= 1; face++) {
                 auto& rectEnvmap = portal.rectEnvmap[face];
-                rectEnvmap.assign(DistSize*DistSize, Vec3());
+                rectEnvmap.assign(size_t(n)*n, glm::vec3());
 
                 // Compute environment map in rectified coordinates
-                std::vector<Float> ls(DistSize*DistSize);
-                for (int y = 0; y < DistSize; y++) {
-                    for (int x = 0; x < DistSize; x++) {
+                parallel::foreach(n, [&](long long i, int) {
+                    const int y = int(i);
+                    for (int x = 0; x < n; x++) {
                         // Rectified coodinates ranges in [-pi/2,pi/2]
                         Vec2 p_rect(
-                            (2_f*(x + .5_f) / DistSize - 1_f)*Pi*.5_f,
-                            (2_f*(y + .5_f) / DistSize - 1_f)*Pi*.5_f);
+                            (2_f*(x + .5_f) / n - 1_f)*Pi*.5_f,
+                            (2_f*(y + .5_f) / n - 1_f)*Pi*.5_f);
 
                         // To world
                         const auto d_world = portal.portal.rectifiedtoWorldDir(p_rect, face);
@@ -301,13 +512,46 @@ public:
                         const auto C = eval(PointGeometry::makeInfinite(-d_world), 0, -d_world);
 
                         // Record contribution
-                        rectEnvmap[y*DistSize + x] = C;
-                        ls[y*DistSize + x] = glm::compMax(C);
+                        rectEnvmap[size_t(y)*n + x] = glm::vec3(C);
+                        ls[size_t(y)*n + x] = glm::compMax(C);
                     }
-                }
+                });
 
                 // Create 2D distribution
-                portal.dist[face].init(ls, DistSize, DistSize);
+                portal.dist[face].init(ls, n, n);
+            }
+        }
+
+        // The distributions are incomplete if the precomputation is cancelled
+        if (parallel::cancelRequested()) {
+            LM_ERROR("Precomputation of the distributions is cancelled");
+            return false;
+        }
+
+        // Save the precomputed distributions to the cache.
+        // The cache is written to a temporary file and replaced with it
+        // so that the other processes sharing the directory never read a partially written file.
+        if (cacheDir) {
+            std::error_code ec;
+            fs::create_directories(*cacheDir, ec);
+            const auto tempPath = fmt::format("{}.{:08x}.tmp", cachePath, math::rngSeed());
+            if (!ec) {
+                std::ofstream os(tempPath, std::ios::out | std::ios::binary);
+                serial::save(os, portals_);
+                os.flush();
+                if (!os) {
+                    ec = std::make_error_code(std::errc::io_error);
+                }
+            }
+            if (!ec) {
+                fs::rename(tempPath, cachePath, ec);
+            }
+            if (ec) {
+                LM_WARN("Failed to save cache [path='{}', error='{}']", cachePath, ec.message());
+                fs::remove(tempPath, ec);
+            }
+            else {
+                LM_INFO("Saved precomputed distributions [path='{}']", cachePath);
             }
         }
         
@@ -315,19 +559,22 @@ public:
     }
 
     virtual std::optional<LightRaySample> sample(Rng& rng, const PointGeometry& geom, const Transform&) const override {
-        // Create a distribution to select a portal
-        const auto sdist = selectionDist(geom);
+        // Create a distribution to select a portal.
+        // The distribution is shared with the evaluation of pdf.
+        const PortalSelection sel(portals_, geom.p);
+        if (!sel.valid()) {
+            return {};
+        }
         
         // Randomly select a portal
-        const int portalIndex = sdist.samp(rng);
+        const int portalIndex = sel.samp(rng);
         const auto& portal = portals_[portalIndex];
 
-        // Check how the portal is seen from the shading point
-        const int face = portal.portal.checkFrontOrBackFace(geom.p);
+        // How the portal is seen from the shading point and
+        // the extent of the portal in rectified coordinates
+        const int face = sel[portalIndex].face;
         const auto& dist = portal.dist[face];
-
-        // Compute the extent of the portal in rectified coordinates
-        const auto b_rect = portal.portal.rectifiedPortalBound(geom.p, face);
+        const auto& b_rect = sel[portalIndex].b_rect;
 
         // Sample a position on the portal in rectified coordinates
         const auto b_dist = rectifiedToDist(b_rect);
@@ -341,7 +588,7 @@ public:
         const auto geomL = PointGeometry::makeInfinite(wo);
 
         // Evaluate pdf
-        const auto pL = pdf(geom, geomL, portalIndex, {}, wo);
+        const auto pL = pdf(sel, geom, geomL, portalIndex);
         if (pL == 0_f) {
             return {};
         }
@@ -359,10 +606,10 @@ public:
         const auto Le = [&] {
             // Pixel position of rectified envmap
             const auto piover2 = Pi * .5_f;
-            const auto t = (p_rect/piover2+1_f)*.5_f*Float(DistSize);
+            const auto t = (p_rect/piover2+1_f)*.5_f*Float(distSize_);
             const int x = glm::clamp(int(t.x), 0, dist.w-1);
             const int y = glm::clamp(int(t.y), 0, dist.h-1);
-            return portal.rectEnvmap[face][y*DistSize+x];
+            return Vec3(portal.rectEnvmap[face][size_t(y)*distSize_+x]);
         }();
         #endif
         return LightRaySample{
@@ -375,65 +622,8 @@ public:
 
     virtual Float pdf(const PointGeometry& geom, const PointGeometry& geomL, int comp, const Transform&, Vec3) const override {
         // Component index represents portal index
-        const int portalIndex = comp;
-
-        // PDF of sampling the direction with the selected portal
-        const auto p_portal = [&]() -> Float {
-            const auto& portal = portals_[portalIndex];
-
-            // Portal face orientation
-            const int face = portal.portal.checkFrontOrBackFace(geom.p);
-
-            // Direction in world coordinates to rectified coordinates
-            const auto d_world = -geomL.wo;
-            const auto p_rect = portal.portal.worldDirToRectified(d_world, face);
-        
-            // Compute the extent of the portal in rectified coordinates
-            const auto b_rect = portal.portal.rectifiedPortalBound(geom.p, face);
-
-            // Check if p_rect is inside the portal
-            if (!b_rect.contains(p_rect)) {
-                return 0_f;
-            }
-
-            // Compute pdf
-            const auto piover2 = Pi * .5_f;
-            const auto p_dist = (p_rect-b_rect.mi)/(b_rect.ma-b_rect.mi);  // Be careful of the range
-            const auto b_dist = rectifiedToDist(b_rect);
-            const auto p = portal.dist[face].pdf(p_dist.x, p_dist.y, b_dist) / b_rect.area();
-        
-            // Jacobian
-            const auto d_cano = portal.portal.rectifiedToCanonical(p_rect, face);
-            const auto J = std::abs(d_cano.z) / ((1_f - d_cano.x*d_cano.x) * (1_f - d_cano.y*d_cano.y));
-
-            return p * J / glm::abs(glm::dot(d_world, geom.n));
-        }();
-        
-        // Selection probability of the portal
-        const auto sdist = selectionDist(geom);
-        const auto p_sel = sdist.p(portalIndex);
-
-        // Count the number of overlapping portals
-        int overlappingPortals = 1;
-        for (int i = 0; i < (int)(portals_.size()); i++) {
-            if (i == portalIndex) {
-                continue;
-            }
-            const auto& portal = portals_[i];
-            const int face = portal.portal.checkFrontOrBackFace(geom.p);
-            const auto d_world = -geomL.wo;
-            const auto p_rect = portal.portal.worldDirToRectified(d_world, face);
-            const auto b_rect = portal.portal.rectifiedPortalBound(geom.p, face);
-            if (b_rect.contains(p_rect)) {
-                overlappingPortals++;
-            }
-        }
-
-        // MIS weight
-        const auto inv_misw = (Float)(overlappingPortals);
-
-        // Solid angle measure to projected solid anglme measure
-        return p_portal * p_sel * inv_misw;
+        const PortalSelection sel(portals_, geom.p);
+        return pdf(sel, geom, geomL, comp);
     }
 
     virtual bool isSpecular(const PointGeometry&, int) const override {
@@ -56,6 +56,26 @@ public:
         return G == 0_f ? 0_f : 1_f / G;
     }
 
+    virtual std::optional<LightRaySample> sampleRay(Rng& rng, const Transform&) const override {
+        const auto geomL = PointGeometry::makeDegenerated(position_);
+        const auto wo = math::sampleUniformSphere(rng);
+        return LightRaySample{
+            geomL,
+            wo,
+            0,
+            Le_ / math::pdfUniformSphere()
+        };
+    }
+
+    virtual Float pdfPosition(const PointGeometry&, const Transform&) const override {
+        return 1_f;
+    }
+
+    virtual Float pdfDirection(const PointGeometry&, int, Vec3) const override {
+        // Projected solid angle measure is the solid angle measure for degenerated points
+        return math::pdfUniformSphere();
+    }
+
     virtual bool isSpecular(const PointGeometry&, int) const override {
         return false;
     }
@@ -68,7 +68,7 @@ public:
 
     virtual std::optional<MaterialDirectionSample> sample(Rng& rng, const PointGeometry& geom, Vec3 wi) const override {
         const auto[n, u, v] = geom.orthonormalBasis(wi);
-        const auto Kd = mapKd_ ? mapKd_->eval(geom.t) : Kd_;
+        const auto Kd = mapKd_ ? mapKd_->eval(geom.t, geom.dtdx, geom.dtdy) : Kd_;
         const auto d = math::sampleCosineWeighted(rng);
         return MaterialDirectionSample{
             u*d.x + v * d.y + n * d.z,
@@ -78,7 +78,7 @@ public:
     }
 
     virtual std::optional<Vec3> reflectance(const PointGeometry& geom, int) const override {
-        return mapKd_ ? mapKd_->eval(geom.t) : Kd_;
+        return mapKd_ ? mapKd_->eval(geom.t, geom.dtdx, geom.dtdy) : Kd_;
     }
 
     virtual Float pdf(const PointGeometry& geom, int, Vec3 wi, Vec3 wo) const override {
@@ -94,7 +94,7 @@ public:
             return {};
         }
         const auto a = (mapKd_ && mapKd_->hasAlpha()) ? mapKd_->evalAlpha(geom.t) : 1_f;
-        return (mapKd_ ? mapKd_->eval(geom.t) : Kd_) * (a / Pi);
+        return (mapKd_ ? mapKd_->eval(geom.t, geom.dtdx, geom.dtdy) : Kd_) * (a / Pi);
     }
 };
 
@@ -17,10 +17,12 @@ private:
 	const Volume* volumeDensity_;	// Density volume. density := \mu_t = \mu_a + \mu_s
 	const Volume* volmeAlbedo_;		// Albedo volume. albedo := \mu_s / \mu_t
     const Phase* phase_;			// Underlying phase function.
+    Vec3 densityScale_;             // Per-channel scale of the density.
+    bool chromatic_;                // True if the density scale depends on the channel.
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(volumeDensity_, volmeAlbedo_, phase_);
+        ar(volumeDensity_, volmeAlbedo_, phase_, densityScale_, chromatic_);
     }
 
 public:
@@ -28,6 +30,8 @@ public:
 		volumeDensity_ = json::compRef<Volume>(prop, "volume_density");
 		volmeAlbedo_ = json::compRef<Volume>(prop, "volume_albedo");
         phase_ = json::compRef<Phase>(prop, "phase");
+        densityScale_ = json::value<Vec3>(prop, "density_scale", Vec3(1_f));
+        chromatic_ = densityScale_.x != densityScale_.y || densityScale_.y != densityScale_.z;
         return true;
     }
 
@@ -37,10 +41,15 @@ public:
             // No intersection with the volume, use surface interaction
             return {};
         }
+
+        if (chromatic_) {
+            return sampleDistanceChromatic(rng, ray, tmin, tmax);
+        }
         
         // Sample distance by delta tracking
         Float t = tmin;
-        const auto invMaxDensity = 1_f / volumeDensity_->maxScalar();
+        const auto scale = densityScale_.x;
+        const auto invMaxDensity = 1_f / (volumeDensity_->maxScalar() * scale);
         while (true) {
             // Sample a distance from the 'homogenized' volume
             t -= glm::log(1_f-rng.u()) * invMaxDensity;
@@ -51,7 +60,7 @@ public:
 
             // Density at the sampled point
             const auto p = ray.o + ray.d*t;
-            const auto density = volumeDensity_->evalScalar(p);
+            const auto density = volumeDensity_->evalScalar(p) * scale;
 
             // Determine scattering collision or null collision
             // Continue tracking if null collusion is seleced
@@ -78,20 +87,30 @@ public:
         }
 
         // Perform ratio tracking [Novak et al. 2014]
-        Float Tr = 1_f;
+        // The majorant is shared among the channels and
+        // the transmittance of the channels are estimated at once.
+        Vec3 Tr(1_f);
         Float t = tmin;
-        const auto invMaxDensity = 1_f / volumeDensity_->maxScalar();
+        const auto invMaxDensity = 1_f / (volumeDensity_->maxScalar() * glm::compMax(densityScale_));
         while (true) {
             t -= glm::log(1_f - rng.u()) * invMaxDensity;
             if (t >= tmax) {
                 break;
             }
             const auto p = ray.o + ray.d*t;
-            const auto density = volumeDensity_->evalScalar(p);
+            const auto density = volumeDensity_->evalScalar(p) * densityScale_;
             Tr *= 1_f - density * invMaxDensity;
         }
 
-        return Vec3(Tr);
+        return Tr;
+    }
+
+    virtual bool chromatic() const override {
+        return chromatic_;
+    }
+
+    virtual Bound bound() const override {
+        return volumeDensity_->bound();
     }
 
     virtual bool isEmitter() const override {
@@ -101,6 +120,61 @@ public:
     virtual const Phase* phase() const override {
         return phase_;
     }
+
+private:
+    /*
+        Spectral tracking [Kutz et al. 2017].
+        - A single majorant \bar{\mu} = max_i \mu_{t,i} is shared among the channels.
+        - The collision types are selected with the history-aware probabilities
+          P_s \propto |w \mu_s|, P_n \propto |w \mu_n| where \mu_n = \bar{\mu} - \mu_t.
+        - The path throughput w of all channels is updated at once.
+    */
+    MediumDistanceSample sampleDistanceChromatic(Rng& rng, Ray ray, Float tmin, Float tmax) const {
+        Vec3 w(1_f);
+        Float t = tmin;
+        const auto maxDensity = volumeDensity_->maxScalar() * glm::compMax(densityScale_);
+        const auto invMaxDensity = 1_f / maxDensity;
+        while (true) {
+            t -= glm::log(1_f-rng.u()) * invMaxDensity;
+            if (t >= tmax) {
+                // Hit with boundary, use surface interaction
+                return MediumDistanceSample{ ray.o + ray.d*tmax, w, false };
+            }
+
+            // Collision coefficients at the sampled point
+            const auto p = ray.o + ray.d*t;
+            const auto muT = volumeDensity_->evalScalar(p) * densityScale_;
+            const auto muS = muT * volmeAlbedo_->evalColor(p);
+            const auto muN = maxDensity - muT;
+
+            // Probabilities of the collision types
+            const auto Ps = glm::compAdd(glm::abs(w * muS));
+            const auto Pn = glm::compAdd(glm::abs(w * muN));
+            const auto Pa = glm::compAdd(glm::abs(w * (muT - muS)));
+            const auto c = Ps + Pn + Pa;
+            if (c == 0_f) {
+                return MediumDistanceSample{ ray.o + ray.d*tmax, Vec3(0_f), false };
+            }
+
+            // Select the collision type
+            const auto u = rng.u() * c;
+            if (u < Ps) {
+                // Scattering collision
+                w *= muS * c / (maxDensity * Ps);
+                return MediumDistanceSample{ p, w, true };
+            }
+            else if (u < Ps + Pn) {
+                // Null collision
+                w *= muN * c / (maxDensity * Pn);
+            }
+            else {
+                // Absorption
+                return MediumDistanceSample{ ray.o + ray.d*tmax, Vec3(0_f), false };
+            }
+        }
+
+        LM_UNREACHABLE_RETURN();
+    }
 };
 
 LM_COMP_REG_IMPL(Medium_Heterogeneous, "medium::heterogeneous");
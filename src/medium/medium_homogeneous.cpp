@@ -15,22 +15,32 @@ class Medium_Homogeneous final : public Medium {
 private:
     Float density_;         // Density of volume := extinction coefficient \mu_t
     Vec3 albedo_;           // Albedo of volume := \mu_s / \mu_t
+    Vec3 muT_;              // Extinction coefficient per channel.
     Vec3 muA_;              // Absorption coefficient.
     Vec3 muS_;              // Scattering coefficient.
+    bool chromatic_;        // True if the extinction coefficient depends on the channel.
     const Phase* phase_;    // Underlying phase function.
     Bound bound_;
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(density_, muA_, muS_, phase_, bound_);
+        ar(density_, albedo_, muT_, muA_, muS_, chromatic_, phase_, bound_);
     }
 
 public:
     virtual bool construct(const Json& prop) override {
-        density_ = json::value<Float>(prop, "density");
+        // Density can be specified per channel for chromatic media
+        if (prop["density"].is_array()) {
+            muT_ = json::value<Vec3>(prop, "density");
+        }
+        else {
+            muT_ = Vec3(json::value<Float>(prop, "density"));
+        }
+        density_ = glm::compMax(muT_);
+        chromatic_ = muT_.x != muT_.y || muT_.y != muT_.z;
         albedo_ = json::value<Vec3>(prop, "albedo");
-        muS_ = albedo_ * density_;
-        muA_ = density_ - muS_;
+        muS_ = albedo_ * muT_;
+        muA_ = muT_ - muS_;
         phase_ = comp::get<Phase>(prop["phase"]);
         if (!phase_) {
             return false;
@@ -49,6 +59,14 @@ public:
         - Prob. of surface interaction P[t>s] = 1-F(s) = T(s).
         - Weight for medium interaction. \mu_s T(t)/p(t) = \mu_s/\mu_t
         - Weight for surface interaction. T(s)/P[t>s] = 1
+
+        Chromatic media.
+        - A distance is sampled with the extinction coefficient of a channel
+          selected uniformly, and the decision is shared among the channels.
+        - One-sample MIS over channels [Wilkie et al. 2014] gives
+          the average PDF \bar{p}(t) = 1/3 \sum_i \mu_{t,i} exp[-\mu_{t,i} t].
+        - Weight for medium interaction. \mu_s T(t)/\bar{p}(t)
+        - Weight for surface interaction. T(s)/\bar{P}[t>s] = T(s) / (1/3 \sum_i T_i(s))
     */
     virtual std::optional<MediumDistanceSample> sampleDistance(Rng& rng, Ray ray, Float tmin, Float tmax) const override {
         // Compute overlapping range between volume and bound
@@ -57,6 +75,10 @@ public:
             return {};
         }
         
+        if (chromatic_) {
+            return sampleDistanceChromatic(rng, ray, tmin, tmax);
+        }
+
         // Sample a distance
         const auto t = -std::log(1_f-rng.u()) / density_;
         
@@ -84,9 +106,20 @@ public:
             // No intersection with the volume, no attenuation
             return Vec3(1_f);
         }
+        if (chromatic_) {
+            return glm::exp(-muT_ * (tmax - tmin));
+        }
         return Vec3(std::exp(-density_ * (tmax - tmin)));
     }
 
+    virtual bool chromatic() const override {
+        return chromatic_;
+    }
+
+    virtual Bound bound() const override {
+        return bound_;
+    }
+
     virtual bool isEmitter() const override {
         return false;
     }
@@ -94,6 +127,36 @@ public:
     virtual const Phase* phase() const override {
         return phase_;
     }
+
+private:
+    // Distance sampling with spectral MIS.
+    // The weights for the three channels are computed at once.
+    MediumDistanceSample sampleDistanceChromatic(Rng& rng, Ray ray, Float tmin, Float tmax) const {
+        // Select a channel and sample a distance
+        const int c = glm::clamp(int(rng.u() * 3_f), 0, 2);
+        const auto t = -std::log(1_f-rng.u()) / muT_[c];
+
+        if (t < tmax - tmin) {
+            // Medium interaction
+            const auto Tr = glm::exp(-muT_ * t);
+            const auto pdf = glm::compAdd(muT_ * Tr) / 3_f;
+            return MediumDistanceSample{
+                ray.o + ray.d*(tmin+t),
+                muS_ * Tr / pdf,
+                true
+            };
+        }
+        else {
+            // Surface interaction
+            const auto Tr = glm::exp(-muT_ * (tmax - tmin));
+            const auto prob = glm::compAdd(Tr) / 3_f;
+            return MediumDistanceSample{
+                ray.o + ray.d*tmax,
+                Tr / prob,
+                false
+            };
+        }
+    }
 };
 
 LM_COMP_REG_IMPL(Medium_Homogeneous, "medium::homogeneous");
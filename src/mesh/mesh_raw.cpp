@@ -29,7 +29,7 @@ private:
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(ps_, ns_, ts_, fs_);
+        ar(serial::raw(ps_), serial::raw(ns_), serial::raw(ts_), serial::raw(fs_));
     }
 
 public:
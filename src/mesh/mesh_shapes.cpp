@@ -0,0 +1,341 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/core.h>
+#include <lm/mesh.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+LM_NAMESPACE_BEGIN(mesh)
+
+namespace {
+
+// Angle around the axis normalized to [0,1)
+Float normalizedAngle(Float y, Float x) {
+    const auto a = std::atan2(y, x) / (2_f * Pi);
+    return a < 0_f ? a + 1_f : a;
+}
+
+// Direction of the normalized angle in the plane spanned by u and v
+Vec3 angleDirection(Float a, Vec3 u, Vec3 v) {
+    const auto phi = 2_f * Pi * a;
+    return u * std::cos(phi) + v * std::sin(phi);
+}
+
+}
+
+LM_PUBLIC_API Mesh::Shape transformShape(const Mesh::Shape& shape, const Transform& transform) {
+    auto s = shape;
+    s.p1 = Vec3(transform.M * Vec4(shape.p1, 1_f));
+    if (shape.type == Mesh::ShapeType::Disk) {
+        s.p2 = glm::normalize(transform.normalM * shape.p2);
+    }
+    else if (shape.type == Mesh::ShapeType::RoundCurve || shape.type == Mesh::ShapeType::FlatCurve) {
+        s.p2 = Vec3(transform.M * Vec4(shape.p2, 1_f));
+    }
+    s.r = shape.r * std::cbrt(transform.J);
+    return s;
+}
+
+LM_PUBLIC_API Bound shapeBound(const Mesh::Shape& shape) {
+    Bound b;
+    switch (shape.type) {
+        case Mesh::ShapeType::Sphere: {
+            b.mi = shape.p1 - shape.r;
+            b.ma = shape.p1 + shape.r;
+            break;
+        }
+        case Mesh::ShapeType::Disk: {
+            // Extent of the disk along each axis
+            const auto n = shape.p2;
+            const auto e = shape.r * glm::sqrt(glm::max(Vec3(0_f), 1_f - n * n));
+            b.mi = shape.p1 - e;
+            b.ma = shape.p1 + e;
+            break;
+        }
+        case Mesh::ShapeType::RoundCurve:
+        case Mesh::ShapeType::FlatCurve: {
+            b.mi = glm::min(shape.p1, shape.p2) - shape.r;
+            b.ma = glm::max(shape.p1, shape.p2) + shape.r;
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+    return b;
+}
+
+LM_PUBLIC_API Vec2 shapeCoordinates(const Mesh::Shape& shape, Vec3 p, Vec3 d) {
+    switch (shape.type) {
+        case Mesh::ShapeType::Sphere: {
+            const auto q = glm::normalize(p - shape.p1);
+            return { normalizedAngle(q.y, q.x), std::acos(glm::clamp(q.z, -1_f, 1_f)) / Pi };
+        }
+        case Mesh::ShapeType::Disk: {
+            const auto [u, v] = math::orthonormalBasis(shape.p2);
+            const auto q = p - shape.p1;
+            return { glm::length(q) / shape.r, normalizedAngle(glm::dot(q, v), glm::dot(q, u)) };
+        }
+        case Mesh::ShapeType::RoundCurve:
+        case Mesh::ShapeType::FlatCurve: {
+            // Position along the segment and the angle of the normal around it.
+            // The position is out of [0,1] on the spherical caps of the round curve.
+            // The normal of the flat curve faces the ray.
+            const auto w = shape.p2 - shape.p1;
+            const auto ww = glm::dot(w, w);
+            const bool round = shape.type == Mesh::ShapeType::RoundCurve;
+            auto s = glm::dot(p - shape.p1, w) / ww;
+            if (!round) {
+                s = glm::clamp(s, 0_f, 1_f);
+            }
+            auto q = round ? p - (shape.p1 + w * s) : -d;
+            q -= w * (glm::dot(q, w) / ww);
+            const auto [u, v] = math::orthonormalBasis(w / glm::sqrt(ww));
+            return { s, normalizedAngle(glm::dot(q, v), glm::dot(q, u)) };
+        }
+        default: {
+            break;
+        }
+    }
+    LM_UNREACHABLE_RETURN();
+}
+
+LM_PUBLIC_API Mesh::Point shapePoint(const Mesh::Shape& shape, Vec2 uv) {
+    switch (shape.type) {
+        case Mesh::ShapeType::Sphere: {
+            const auto phi = 2_f * Pi * uv.x;
+            const auto theta = Pi * uv.y;
+            const Vec3 n(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+            return { shape.p1 + shape.r * n, n, uv };
+        }
+        case Mesh::ShapeType::Disk: {
+            const auto [u, v] = math::orthonormalBasis(shape.p2);
+            return { shape.p1 + shape.r * uv.x * angleDirection(uv.y, u, v), shape.p2, uv };
+        }
+        case Mesh::ShapeType::RoundCurve:
+        case Mesh::ShapeType::FlatCurve: {
+            const auto w = shape.p2 - shape.p1;
+            const auto l = glm::length(w);
+            const auto [u, v] = math::orthonormalBasis(w / l);
+            const auto n = angleDirection(uv.y, u, v);
+            const auto s = glm::clamp(uv.x, 0_f, 1_f);
+            const auto c = shape.p1 + w * s;
+            if (shape.type == Mesh::ShapeType::FlatCurve) {
+                // The point of the flat curve is on the center line.
+                // The offset across the ribbon depends on the ray, so the hit point is used for intersections.
+                return { c, n, uv };
+            }
+
+            // Point on the side or on the spherical caps at the offset h along the axis
+            const auto h = (uv.x - s) * l;
+            const auto p = c + w * (h / l) + n * math::safeSqrt(shape.r * shape.r - h * h);
+            return { p, glm::normalize(p - c), uv };
+        }
+        default: {
+            break;
+        }
+    }
+    LM_UNREACHABLE_RETURN();
+}
+
+LM_NAMESPACE_END(mesh)
+
+// ------------------------------------------------------------------------------------------------
+
+// Common implementation of the meshes of analytic shapes
+class Mesh_Shapes : public Mesh {
+protected:
+    ShapeType type_;
+    std::vector<Vec4> ps_;      // Positions and radii
+    std::vector<Vec3> ns_;      // Normals of the disks
+    std::vector<int> fs_;       // Index of the first position of the curve segments
+
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(type_, serial::raw(ps_), serial::raw(ns_), serial::raw(fs_));
+    }
+
+protected:
+    // Load positions and radii from "ps" and "radius" or "rs" properties
+    bool loadPositions(const Json& prop) {
+        const auto& ps = prop["ps"];
+        const int n = int(ps.size()) / 3;
+        const auto rs = prop.find("rs");
+        if (rs != prop.end() && int(rs->size()) != n) {
+            LM_ERROR("Invalid number of radii [expected={}, actual={}]", n, rs->size());
+            return false;
+        }
+        const auto radius = rs == prop.end() ? json::value<Float>(prop, "radius") : 0_f;
+        ps_.reserve(n);
+        for (int i = 0; i < n; i++) {
+            ps_.push_back(Vec4(ps[3*i], ps[3*i+1], ps[3*i+2], rs == prop.end() ? radius : Float((*rs)[i])));
+        }
+        return true;
+    }
+
+public:
+    virtual void foreachTriangle(const ProcessTriangleFunc&) const override {}
+
+    virtual Tri triangleAt(int) const override {
+        LM_UNREACHABLE_RETURN();
+    }
+
+    virtual Point surfacePoint(int face, Vec2 uv) const override {
+        return mesh::shapePoint(shapeAt(face), uv);
+    }
+
+    virtual int numTriangles() const override {
+        return 0;
+    }
+
+    virtual ShapeType shapeType() const override {
+        return type_;
+    }
+
+    virtual void foreachShape(const ProcessShapeFunc& processShape) const override {
+        const int n = numShapes();
+        for (int i = 0; i < n; i++) {
+            processShape(i, shapeAt(i));
+        }
+    }
+
+    virtual Shape shapeAt(int face) const override {
+        if (type_ == ShapeType::Sphere) {
+            const auto& p = ps_[face];
+            return { type_, Vec3(p), Vec3(0_f), p.w };
+        }
+        else if (type_ == ShapeType::Disk) {
+            const auto& p = ps_[face];
+            return { type_, Vec3(p), ns_[face], p.w };
+        }
+        else {
+            const auto& p1 = ps_[fs_[face]];
+            const auto& p2 = ps_[fs_[face]+1];
+            return { type_, Vec3(p1), Vec3(p2), (p1.w + p2.w) * .5_f };
+        }
+    }
+
+    virtual int numShapes() const override {
+        return type_ == ShapeType::RoundCurve || type_ == ShapeType::FlatCurve ? int(fs_.size()) : int(ps_.size());
+    }
+};
+
+// ------------------------------------------------------------------------------------------------
+
+/*
+\rst
+.. function:: mesh::spheres
+
+   Set of spheres.
+
+   :param list ps: Centers of the spheres (flattened).
+   :param float radius: Radius of the spheres.
+   :param list rs: Radii of the spheres. Used instead of ``radius`` if specified.
+
+   The spheres are intersected analytically by the acceleration structures
+   supporting the analytic shapes (``accel::sahbvh`` and ``accel::embree``).
+   The texture coordinates are the spherical coordinates normalized to :math:`[0,1]^2`.
+
+.. function:: mesh::disks
+
+   Set of oriented disks.
+
+   :param list ps: Centers of the disks (flattened).
+   :param list ns: Normals of the disks (flattened).
+   :param float radius: Radius of the disks.
+   :param list rs: Radii of the disks. Used instead of ``radius`` if specified.
+
+   The texture coordinates are the polar coordinates normalized to :math:`[0,1]^2`.
+
+.. function:: mesh::curves
+
+   Set of curves composed of linear segments, e.g., for hairs.
+
+   :param list ps: Vertices of the curves (flattened).
+   :param list strands: Number of vertices of each curve. Default: all vertices form a curve.
+   :param float radius: Radius of the curves.
+   :param list rs: Radii at the vertices. Used instead of ``radius`` if specified.
+   :param str mode: Cross section of the curves (``round`` or ``flat``). Default: ``round``.
+
+   The ``round`` curves are the segments with circular cross section.
+   The ``flat`` curves are the ribbons always facing the ray,
+   which are cheaper to intersect and suitable for the thin curves.
+   The radius of a segment is the average of the radii at its vertices.
+   The texture coordinates are the position along the segment and the angle around the segment.
+\endrst
+*/
+class Mesh_Spheres final : public Mesh_Shapes {
+public:
+    virtual bool construct(const Json& prop) override {
+        type_ = ShapeType::Sphere;
+        return loadPositions(prop);
+    }
+};
+
+LM_COMP_REG_IMPL(Mesh_Spheres, "mesh::spheres");
+
+class Mesh_Disks final : public Mesh_Shapes {
+public:
+    virtual bool construct(const Json& prop) override {
+        type_ = ShapeType::Disk;
+        if (!loadPositions(prop)) {
+            return false;
+        }
+        const auto& ns = prop["ns"];
+        if (ns.size() != 3 * ps_.size()) {
+            LM_ERROR("Invalid number of normals [expected={}, actual={}]", ps_.size(), ns.size() / 3);
+            return false;
+        }
+        ns_.reserve(ps_.size());
+        for (size_t i = 0; i < ps_.size(); i++) {
+            ns_.push_back(glm::normalize(Vec3(ns[3*i], ns[3*i+1], ns[3*i+2])));
+        }
+        return true;
+    }
+};
+
+LM_COMP_REG_IMPL(Mesh_Disks, "mesh::disks");
+
+class Mesh_Curves final : public Mesh_Shapes {
+public:
+    virtual bool construct(const Json& prop) override {
+        const auto mode = json::value<std::string>(prop, "mode", "round");
+        if (mode == "round") {
+            type_ = ShapeType::RoundCurve;
+        }
+        else if (mode == "flat") {
+            type_ = ShapeType::FlatCurve;
+        }
+        else {
+            LM_ERROR("Invalid mode [mode='{}']", mode);
+            return false;
+        }
+        if (!loadPositions(prop)) {
+            return false;
+        }
+
+        // Segments of the strands. Degenerated segments are skipped.
+        const auto strands = json::value<std::vector<int>>(prop, "strands", std::vector<int>{ int(ps_.size()) });
+        int offset = 0;
+        for (const int n : strands) {
+            if (n < 0 || offset + n > int(ps_.size())) {
+                LM_ERROR("Invalid strand [vertices={}]", n);
+                return false;
+            }
+            for (int i = offset; i < offset + n - 1; i++) {
+                if (Vec3(ps_[i]) != Vec3(ps_[i+1])) {
+                    fs_.push_back(i);
+                }
+            }
+            offset += n;
+        }
+        return true;
+    }
+};
+
+LM_COMP_REG_IMPL(Mesh_Curves, "mesh::curves");
+
+LM_NAMESPACE_END(LM_NAMESPACE)
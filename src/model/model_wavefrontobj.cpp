@@ -182,7 +182,7 @@ private:
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(model_, fs_);
+        ar(model_, serial::raw(fs_));
     }
 
     virtual void foreachUnderlying(const ComponentVisitor& visit) override {
@@ -9,12 +9,15 @@
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE::objloader)
 
-// Wavefront OBJ/MTL file parser
+// Wavefront OBJ/MTL file parser.
+// The parser keeps no state so that the user contexts can load the files concurrently.
 class OBJLoaderContext_Simple : public OBJLoaderContext {
-public:
-    // Material parameters
-    std::vector<MTLMatParams> ms_;
-    std::unordered_map<std::string, int> msmap_;
+private:
+    // Material parameters of the file being loaded
+    struct Materials {
+        std::vector<MTLMatParams> ms;
+        std::unordered_map<std::string, int> msmap;
+    };
 
 public:
     virtual bool load(
@@ -23,8 +26,8 @@ public:
         const ProcessMeshFunc& processMesh,
         const ProcessMaterialFunc& processMaterial) override
     {
-        ms_.clear();
-        msmap_.clear();
+        Materials mats;
+        auto& ms = mats.ms;
 
         LM_INFO("Loading OBJ file [path='{}']", fs::path(path).filename().string());
         char l[4096], name[256];
@@ -50,10 +53,10 @@ public:
                 geo.ts.emplace_back(nextVec3(t += 3));
             } else if (command(t, "f", 1)) {
                 t += 2;
-                if (ms_.empty()) {
+                if (ms.empty()) {
                     // Process the case where MTL file is missing
-                    ms_.push_back({ "default", -1, Vec3(1) });
-                    if (!processMaterial(ms_.back())) {
+                    ms.push_back({ "default", -1, Vec3(1) });
+                    if (!processMaterial(ms.back())) {
                         return false;
                     }
                     currMaterialIdx = 0;
@@ -73,15 +76,15 @@ public:
                 nextString(t, name);
                 if (!currfs.empty()) {
                     // 'usemtl' indicates end of mesh groups
-                    if (!processMesh(currfs, ms_.at(currMaterialIdx))) {
+                    if (!processMesh(currfs, ms.at(currMaterialIdx))) {
                         return false;
                     }
                     currfs.clear();
                 }
-                currMaterialIdx = msmap_.at(name);
+                currMaterialIdx = mats.msmap.at(name);
             } else if (command(t, "mtllib", 6)) {
                 nextString(t += 7, name);
-                if (!loadmtl((fs::path(path).remove_filename() / name).string(), processMaterial)) {
+                if (!loadmtl((fs::path(path).remove_filename() / name).string(), mats, processMaterial)) {
                     return false;
                 }
             } else {
@@ -89,7 +92,7 @@ public:
             }
         }
         if (!currfs.empty()) {
-            if (!processMesh(currfs, ms_.at(currMaterialIdx))) {
+            if (!processMesh(currfs, ms.at(currMaterialIdx))) {
                 return false;
             }
         }
@@ -165,28 +168,29 @@ private:
     };
 
     // Parses .mtl file
-    bool loadmtl(std::string p, const ProcessMaterialFunc& processMaterial) {
+    bool loadmtl(std::string p, Materials& mats, const ProcessMaterialFunc& processMaterial) {
         LM_INFO("Loading MTL file [path='{}']", fs::path(p).filename().string());
         std::ifstream f(p);
         if (!f) {
             LM_ERROR("Missing MLT file [path='{}']", p);
             return false;
         }
+        auto& ms = mats.ms;
         char l[4096], name[256];
         while (f.getline(l, 4096)) {
             auto *t = l;
             skipSpaces(t);
             if (command(t, "newmtl", 6)) {
                 nextString(t += 7, name);
-                msmap_[name] = int(ms_.size());
-                ms_.emplace_back();
-                ms_.back().name = name;
+                mats.msmap[name] = int(ms.size());
+                ms.emplace_back();
+                ms.back().name = name;
                 continue;
             }
-            if (ms_.empty()) {
+            if (ms.empty()) {
                 continue;
             }
-            auto& m = ms_.back();
+            auto& m = ms.back();
             if      (command(t, "Kd", 2))     { m.Kd = nextVec3(t += 3); }
             else if (command(t, "Ks", 2))     { m.Ks = nextVec3(t += 3); }
             else if (command(t, "Ni", 2))     { m.Ni = nextFloat(t += 3); }
@@ -197,7 +201,7 @@ private:
             else if (command(t, "map_Kd", 6)) { nextString(t += 7, name); m.mapKd = name; }
         }
         // Let the user to process materials
-        for (const auto& m : ms_) {
+        for (const auto& m : ms) {
             if (!processMaterial(m)) {
                 return false;
             }
@@ -10,6 +10,12 @@ LM_NAMESPACE_BEGIN(LM_NAMESPACE::parallel)
 
 using Instance = comp::detail::ContextInstance<ParallelContext>;
 
+// Cancellation flag shared by the threads without binding
+static CancelFlag defaultCancelFlag_ = false;
+
+// Cancellation flag bound to the current thread
+static thread_local CancelFlag* boundCancelFlag_ = nullptr;
+
 LM_PUBLIC_API void init(const std::string& type, const Json& prop) {
     Instance::init(type, prop);
 }
@@ -30,4 +36,24 @@ LM_PUBLIC_API void foreach(long long numSamples, const ParallelProcessFunc& proc
 	Instance::get().foreach(numSamples, processFunc, progressFunc);
 }
 
+LM_PUBLIC_API void bindCancelFlag(CancelFlag* flag) {
+    boundCancelFlag_ = flag == &defaultCancelFlag_ ? nullptr : flag;
+}
+
+LM_PUBLIC_API CancelFlag& cancelFlag() {
+    return boundCancelFlag_ ? *boundCancelFlag_ : defaultCancelFlag_;
+}
+
+LM_PUBLIC_API void requestCancel() {
+    cancelFlag() = true;
+}
+
+LM_PUBLIC_API void resetCancel() {
+    cancelFlag() = false;
+}
+
+LM_PUBLIC_API bool cancelRequested() {
+    return cancelFlag();
+}
+
 LM_NAMESPACE_END(LM_NAMESPACE::parallel)
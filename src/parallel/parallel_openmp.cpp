@@ -11,10 +11,59 @@
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE::parallel)
 
+namespace {
+
+/*
+    Threads shared by the parallel loops dispatched concurrently,
+    e.g., by the user contexts rendering in the different threads.
+    Each OpenMP parallel region creates its own team of threads,
+    so a loop takes a share of the threads from the budget
+    and the total number of threads does not exceed the budget.
+    The share is the equal division among the loops running or waiting at the time of the request.
+    Since the renderers dispatch a loop for each pass, the threads are redistributed between the passes.
+*/
+class ThreadBudget {
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int total_ = 0;
+    int available_ = 0;
+    int users_ = 0;     // Number of loops running or waiting for the threads
+
+public:
+    void reset(int numThreads) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        total_ = numThreads;
+        available_ = numThreads;
+    }
+
+    // Wait for the share of the threads and take them. Returns the number of threads.
+    int acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        users_++;
+        const int share = std::max(1, total_ / users_);
+        cv_.wait(lock, [&] { return available_ >= share; });
+        available_ -= share;
+        return share;
+    }
+
+    void release(int n) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            available_ += n;
+            users_--;
+        }
+        cv_.notify_all();
+    }
+};
+
+}
+
 class ParallelContext_OpenMP final : public ParallelContext {
 private:
     long long progressUpdateInterval_;	// Number of samples per progress update
     int numThreads_;					// Number of threads
+    mutable ThreadBudget budget_;       // Threads shared by the concurrent loops
 
 public:
     virtual bool construct(const Json& prop) override {
@@ -24,6 +73,7 @@ public:
             numThreads_ = std::thread::hardware_concurrency() + numThreads_;
         }
         omp_set_num_threads(numThreads_);
+        budget_.reset(numThreads_);
         return true;
     }
 
@@ -41,12 +91,33 @@ public:
         std::exception_ptr exp;
         std::mutex explock;
 
+        // Cancellation flag of the calling thread.
+        // The worker threads do not have the binding of the calling thread.
+        const auto& cancel = parallel::cancelFlag();
+
+        // Take the threads from the budget shared by the concurrent loops.
+        // The nested loop runs in the thread of the enclosing loop without the budget.
+        const bool nested = omp_in_parallel() != 0;
+        const int numThreads = nested ? 1 : budget_.acquire();
+        struct BudgetGuard {
+            ThreadBudget& budget;
+            int n;
+            bool nested;
+            ~BudgetGuard() {
+                if (!nested) {
+                    budget.release(n);
+                }
+            }
+        } budgetGuard_{ budget_, numThreads, nested };
+
         // Execute parallel loop
         std::atomic<long long> processed = 0;
-        #pragma omp parallel for schedule(dynamic, 1)
+        // The number of threads is given explicitly because omp_set_num_threads()
+        // only affects the thread calling construct(), e.g., not the threads of user contexts.
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads)
         for (long long i = 0; i < numSamples; i++) {
             // Spin the loop if cancellation is requested
-            if (done) {
+            if (done || cancel) {
                 continue;
             }
 
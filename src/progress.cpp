@@ -195,19 +195,58 @@ LM_PUBLIC_API void shutdown() {
     Instance::shutdown();
 }
 
+// The progress reporter is shared by the user contexts used from the different threads.
+// Only the thread starting the report first reports the progress until it ends the report,
+// and the reports from the other threads are ignored.
+// The updates are invoked from the thread starting the report
+// because the parallel loop updates the progress only in the calling thread.
+namespace {
+std::mutex ReportMutex;
+std::atomic<std::thread::id> ReportOwner;   // Default id if no thread reports
+int ReportDepth = 0;
+
+bool ownsReport() {
+    return ReportOwner.load(std::memory_order_relaxed) == std::this_thread::get_id();
+}
+}
+
 LM_PUBLIC_API void start(ProgressMode mode, long long total, double totalTime) {
+    {
+        std::lock_guard<std::mutex> lock(ReportMutex);
+        const auto owner = ReportOwner.load();
+        if (owner != std::thread::id() && owner != std::this_thread::get_id()) {
+            return;
+        }
+        ReportOwner = std::this_thread::get_id();
+        ReportDepth++;
+    }
     Instance::get().start(mode, total, totalTime);
 }
 
 LM_PUBLIC_API void update(long long processed) {
+    if (!ownsReport()) {
+        return;
+    }
     Instance::get().update(processed);
 }
 
 LM_PUBLIC_API void updateTime(Float elapsed) {
+    if (!ownsReport()) {
+        return;
+    }
     Instance::get().updateTime(elapsed);
 }
 
 LM_PUBLIC_API void end() {
+    {
+        std::lock_guard<std::mutex> lock(ReportMutex);
+        if (!ownsReport()) {
+            return;
+        }
+        if (--ReportDepth == 0) {
+            ReportOwner = std::thread::id();
+        }
+    }
     Instance::get().end();
 }
 
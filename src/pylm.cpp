@@ -129,6 +129,14 @@ static void bind(pybind11::module& m) {
         .def_readwrite("o", &Ray::o)
         .def_readwrite("d", &Ray::d);
 
+    // Ray differential
+    pybind11::class_<RayDifferential>(m, "RayDifferential")
+        .def(pybind11::init<>())
+        .def_readwrite("dodx", &RayDifferential::dodx)
+        .def_readwrite("dody", &RayDifferential::dody)
+        .def_readwrite("dddx", &RayDifferential::dddx)
+        .def_readwrite("dddy", &RayDifferential::dddy);
+
     // Rng
     pybind11::class_<Rng>(m, "Rng")
         .def(pybind11::init<>())
@@ -231,8 +239,14 @@ static void bind(pybind11::module& m) {
     m.def("render", (void(*)(const std::string&, const Json&))&render, pybind11::call_guard<pybind11::gil_scoped_release>());
     m.def("save", &save);
     m.def("buffer", &buffer);
+    m.def("startSession", &startSession);
+    m.def("stopSession", &stopSession, pybind11::call_guard<pybind11::gil_scoped_release>());
+    m.def("sessionBuffer", &sessionBuffer);
+    m.def("sessionPasses", &sessionPasses);
     m.def("serialize", (void(*)(const std::string&))&serialize);
     m.def("deserialize", (void(*)(const std::string&))&deserialize);
+    m.def("serializeSnapshot", &serializeSnapshot);
+    m.def("deserializeSnapshot", &deserializeSnapshot);
     m.def("rootNode", &rootNode);
     m.def("primitiveNode", &primitiveNode);
     m.def("groupNode", &groupNode);
@@ -240,6 +254,11 @@ static void bind(pybind11::module& m) {
     m.def("transformNode", &transformNode);
     m.def("addChild", &addChild);
     m.def("primitive", &primitive);
+    m.def("createContext", &createContext, "name"_a, "prop"_a = Json{});
+    m.def("releaseContext", &releaseContext);
+    m.def("bindContext", &bindContext);
+    m.def("boundContext", &boundContext);
+    m.def("renderSequence", &renderSequence, "numFrames"_a, "setupFrame"_a, "filmName"_a, "outpath"_a, pybind11::call_guard<pybind11::gil_scoped_release>());
     #pragma endregion
 
     // ------------------------------------------------------------------------
@@ -313,6 +332,23 @@ static void bind(pybind11::module& m) {
 
     // ------------------------------------------------------------------------
 
+    #pragma region cpu.h
+    {
+        auto sm = m.def_submodule("cpu");
+        pybind11::enum_<cpu::ISA>(sm, "ISA")
+            .value("Baseline", cpu::ISA::Baseline)
+            .value("SSE42", cpu::ISA::SSE42)
+            .value("AVX2", cpu::ISA::AVX2)
+            .value("AVX512", cpu::ISA::AVX512);
+        sm.def("detect", &cpu::detect);
+        sm.def("select", &cpu::select);
+        sm.def("selected", &cpu::selected);
+        sm.def("name", &cpu::name);
+    }
+    #pragma endregion
+
+    // ------------------------------------------------------------------------
+
     #pragma region objloader.h
     {
         auto sm = m.def_submodule("objloader");
@@ -493,6 +529,12 @@ static void bind(pybind11::module& m) {
         .def("save", &Film::save)
         .def("aspectRatio", &Film::aspectRatio)
         .def("buffer", &Film::buffer)
+        .def("layerIndex", &Film::layerIndex)
+        .def("splatLayer", &Film::splatLayer)
+        .def("setLayerPixel", &Film::setLayerPixel)
+        .def("layerPixel", &Film::layerPixel)
+        .def("layerBuffer", &Film::layerBuffer)
+        .def("saveLayer", &Film::saveLayer)
         .PYLM_DEF_COMP_BIND(Film);
 
     #pragma endregion
@@ -511,6 +553,8 @@ static void bind(pybind11::module& m) {
         .def_readwrite("t", &PointGeometry::t)
         .def_readwrite("u", &PointGeometry::u)
         .def_readwrite("v", &PointGeometry::v)
+        .def_readwrite("dtdx", &PointGeometry::dtdx)
+        .def_readwrite("dtdy", &PointGeometry::dtdy)
         .def_static("makeDegenerated", &PointGeometry::makeDegenerated)
         .def_static("makeInfinite", &PointGeometry::makeInfinite)
         .def_static("makeOnSurface", (PointGeometry(*)(Vec3, Vec3, Vec2))&PointGeometry::makeOnSurface)
@@ -586,17 +630,17 @@ static void bind(pybind11::module& m) {
         virtual bool isSpecular(const SceneInteraction& sp) const override {
             PYBIND11_OVERLOAD_PURE(bool, Scene, isSpecular, sp);
         }
-        virtual Ray primaryRay(Vec2 rp, Float aspectRatio) const override {
-            PYBIND11_OVERLOAD_PURE(Ray, Scene, primaryRay, rp, aspectRatio);
+        virtual Ray primaryRay(Vec2 rp, Float aspectRatio, int camera) const override {
+            PYBIND11_OVERLOAD_PURE(Ray, Scene, primaryRay, rp, aspectRatio, camera);
         }
-        virtual std::optional<Vec2> rasterPosition(Vec3 wo, Float aspectRatio) const override {
-            PYBIND11_OVERLOAD_PURE(std::optional<Vec2>, Scene, rasterPosition, wo, aspectRatio);
+        virtual std::optional<Vec2> rasterPosition(Vec3 wo, Float aspectRatio, int camera) const override {
+            PYBIND11_OVERLOAD_PURE(std::optional<Vec2>, Scene, rasterPosition, wo, aspectRatio, camera);
         }
         virtual std::optional<RaySample> sampleRay(Rng& rng, const SceneInteraction& sp, Vec3 wi) const override {
             PYBIND11_OVERLOAD_PURE(std::optional<RaySample>, Scene, sampleRay, rng, sp, wi);
         }
-        virtual std::optional<RaySample> samplePrimaryRay(Rng& rng, Vec4 window, Float aspectRatio) const override {
-            PYBIND11_OVERLOAD_PURE(std::optional<RaySample>, Scene, samplePrimaryRay, rng, window, aspectRatio);
+        virtual std::optional<RaySample> samplePrimaryRay(Rng& rng, Vec4 window, Float aspectRatio, int camera) const override {
+            PYBIND11_OVERLOAD_PURE(std::optional<RaySample>, Scene, samplePrimaryRay, rng, window, aspectRatio, camera);
         }
         virtual std::optional<RaySample> sampleLight(Rng& rng, const SceneInteraction& sp) const override {
             PYBIND11_OVERLOAD_PURE(std::optional<RaySample>, Scene, sampleLight, rng, sp);
@@ -610,6 +654,9 @@ static void bind(pybind11::module& m) {
         virtual Float pdfLight(const SceneInteraction& sp, const SceneInteraction& spL, Vec3 wo) const override {
             PYBIND11_OVERLOAD_PURE(Float, Scene, pdfLight, sp, spL, wo);
         }
+        virtual Float pdfLightPosition(const SceneInteraction& spL) const override {
+            PYBIND11_OVERLOAD_PURE(Float, Scene, pdfLightPosition, spL);
+        }
         virtual std::optional<DistanceSample> sampleDistance(Rng& rng, const SceneInteraction& sp, Vec3 wo) const override {
             PYBIND11_OVERLOAD_PURE(std::optional<DistanceSample>, Scene, sampleDistance, rng, sp, wo);
         }
@@ -635,12 +682,17 @@ static void bind(pybind11::module& m) {
         .def("addChildFromModel", &Scene::addChildFromModel)
         .def("traverseNodes", &Scene::traverseNodes)
         .def("build", &Scene::build)
-        .def("intersect", &Scene::intersect, "ray"_a = Ray{}, "tmin"_a = Eps, "tmax"_a = Inf)
+        .def("intersect", pybind11::overload_cast<Ray, Float, Float>(&Scene::intersect, pybind11::const_),
+            "ray"_a = Ray{}, "tmin"_a = Eps, "tmax"_a = Inf)
+        .def("intersect", pybind11::overload_cast<Ray, const RayDifferential&, Float, Float>(&Scene::intersect, pybind11::const_),
+            "ray"_a, "rd"_a, "tmin"_a = Eps, "tmax"_a = Inf)
+        .def("occluded", &Scene::occluded, "ray"_a, "tmin"_a = Eps, "tmax"_a = Inf)
         .def("isLight", &Scene::isLight)
         .def("isSpecular", &Scene::isSpecular)
-        .def("primaryRay", &Scene::primaryRay)
+        .def("primaryRay", &Scene::primaryRay, "rp"_a, "aspectRatio"_a, "camera"_a = -1)
+        .def("primaryRayDifferential", &Scene::primaryRayDifferential, "rp"_a, "drp"_a, "aspectRatio"_a, "camera"_a = -1)
         .def("sampleRay", &Scene::sampleRay)
-        .def("samplePrimaryRay", &Scene::samplePrimaryRay)
+        .def("samplePrimaryRay", &Scene::samplePrimaryRay, "rng"_a, "window"_a, "aspectRatio"_a, "camera"_a = -1)
         .def("evalContrbEndpoint", &Scene::evalContrbEndpoint)
         .def("reflectance", &Scene::reflectance)
         .PYLM_DEF_COMP_BIND(Scene);
@@ -685,7 +737,8 @@ static void bind(pybind11::module& m) {
     pybind11::class_<Texture, Texture_Py, Component::Ptr<Texture>>(m, "Texture")
         .def(pybind11::init<>())
         .def("size", &Texture::size)
-        .def("eval", &Texture::eval)
+        .def("eval", pybind11::overload_cast<Vec2>(&Texture::eval, pybind11::const_))
+        .def("eval", pybind11::overload_cast<Vec2, Vec2, Vec2>(&Texture::eval, pybind11::const_))
         .def("evalByPixelCoords", &Texture::evalByPixelCoords)
         .PYLM_DEF_COMP_BIND(Texture);
     #pragma endregion
@@ -0,0 +1,441 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/core.h>
+#include <lm/renderer.h>
+#include <lm/scene.h>
+#include <lm/film.h>
+#include <lm/scheduler.h>
+#include <lm/parallel.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+namespace {
+
+// Vertex of a subpath
+struct Vertex {
+    SceneInteraction sp;    // Scene interaction. The component is selected if connectable.
+    Vec3 throughput;        // Throughput of the subpath up to the vertex
+    Vec3 wi;                // Direction to the previous vertex on the subpath
+    Float pdfFwd;           // Pdf of sampling the vertex from the previous vertex in area measure
+    Float pdfRev;           // Pdf of sampling the vertex from the next vertex in area measure
+    bool delta;             // True if the vertex is specular
+    bool connectable;       // True if the vertex can be connected to the other subpath
+};
+
+// Direction from a to b
+Vec3 direction(const PointGeometry& a, const PointGeometry& b) {
+    if (b.infinite) {
+        return -b.wo;
+    }
+    if (a.infinite) {
+        return a.wo;
+    }
+    return glm::normalize(b.p - a.p);
+}
+
+// Convert pdf in projected solid angle measure at `from` to the area measure at `to`.
+// Points at infinity keep the projected solid angle measure,
+// which is consistent among the strategies sampling the same point.
+Float toArea(Float pdf, const PointGeometry& from, const PointGeometry& to) {
+    if (from.infinite || to.infinite) {
+        return pdf;
+    }
+    return pdf * surface::geometryTerm(from, to);
+}
+
+// Light endpoint at the point on a light hit by a ray
+SceneInteraction asLightEndpoint(const SceneInteraction& sp) {
+    if (sp.endpoint) {
+        return sp;
+    }
+    return SceneInteraction::makeLightEndpoint(sp.primitive, 0, sp.geom);
+}
+
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/*
+\rst
+.. function:: renderer::bdpt
+
+   Bidirectional path tracing [Veach1997]_.
+
+   :param str output: Underlying film specified by asset name or locator.
+   :param int max_length: Maximum number of path edges.
+   :param str scheduler: Scheduler of the samples, e.g., ``sample`` or ``time``.
+   :param str checkpoint: Path of the checkpoint file. If specified, the state of the rendering
+                          is periodically written to the file, and the rendering resumes from the file if it exists.
+                          Optional.
+   :param float checkpoint_interval: Interval of the checkpoints in seconds. Default: 600.
+   :param int seed: Random seed. Optional.
+
+   For each sample of a pixel, the renderer traces a camera subpath from the pixel
+   and a light subpath from a light, and connects every pair of their vertices.
+   The contributions of all the strategies are combined by multiple importance sampling
+   with the balance heuristic. The strategies are
+
+   - :math:`s=0`: the camera subpath hits a light,
+   - :math:`s=1`: next event estimation from the camera subpath,
+   - :math:`t=1`: the light subpath is connected to the camera and splatted to the film,
+   - otherwise: the vertices of the two subpaths are connected.
+
+   The light subpaths start from the lights supporting :cpp:func:`lm::Light::sampleRay`.
+   The infinite lights contribute only by the strategies :math:`s=0,1`.
+   Participating media are ignored.
+   The path length is counted in the same way as :cpp:func:`renderer::pt`,
+   so both renderers converge to the same image with the same ``max_length``.
+
+   The subpaths are stored in per-thread buffers allocated before rendering,
+   so that no memory is allocated while tracing the paths.
+
+   .. [Veach1997] E. Veach.
+                  Robust Monte Carlo Methods for Light Transport Simulation.
+                  Ph.D. dissertation, Stanford University. 1997.
+\endrst
+*/
+class Renderer_BDPT final : public Renderer {
+private:
+    Film* film_;
+    int maxLength_;
+    std::optional<unsigned int> seed_;
+    Component::Ptr<scheduler::Scheduler> sched_;
+
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(film_, maxLength_, seed_, sched_);
+    }
+
+    virtual void foreachUnderlying(const ComponentVisitor& visit) override {
+        comp::visit(visit, film_);
+        comp::visit(visit, sched_);
+    }
+
+public:
+    virtual bool construct(const Json& prop) override {
+        film_ = json::compRef<Film>(prop, "output");
+        maxLength_ = json::value<int>(prop, "max_length");
+        seed_ = json::valueOrNone<unsigned int>(prop, "seed");
+        if (maxLength_ <= 0) {
+            LM_ERROR("Invalid max_length [max_length={}]", maxLength_);
+            return false;
+        }
+        const auto schedName = json::value<std::string>(prop, "scheduler");
+        sched_ = comp::create<scheduler::Scheduler>(
+            "scheduler::spp::" + schedName, makeLoc("scheduler"), prop);
+        if (!sched_) {
+            return false;
+        }
+        return true;
+    }
+
+    virtual void continueSamples(bool enable) override {
+        sched_->continueSamples(enable);
+    }
+
+    virtual void render(const Scene* scene) const override {
+        film_->clear();
+        const auto size = film_->size();
+
+        // Per-thread storage of the subpaths
+        struct Subpaths {
+            std::vector<Vertex> light;
+            std::vector<Vertex> camera;
+        };
+        std::vector<Subpaths> subpaths(parallel::numThreads());
+        for (auto& p : subpaths) {
+            p.light.reserve(maxLength_);
+            p.camera.reserve(maxLength_ + 1);
+        }
+
+        scheduler::ThreadRngs rngs(seed_, sched_.get());
+        const auto processed = sched_->run([&](long long pixelIndex, long long, int threadid) {
+            auto& rng = rngs[threadid];
+            auto& [lightPath, cameraPath] = subpaths[threadid];
+
+            // Sample subpaths
+            const int x = int(pixelIndex % size.w);
+            const int y = int(pixelIndex / size.w);
+            const auto dx = 1_f / size.w;
+            const auto dy = 1_f / size.h;
+            const auto aspectRatio = film_->aspectRatio();
+            randomWalk(scene, rng, SceneInteraction::makeCameraTerminator({ dx*x, dy*y, dx, dy }, aspectRatio),
+                maxLength_ + 1, cameraPath);
+            if (cameraPath.empty()) {
+                return;
+            }
+            randomWalk(scene, rng, SceneInteraction::makeLightTerminator(), maxLength_, lightPath);
+            const auto& z0 = cameraPath[0];
+
+            // Raster position of the camera subpath
+            const auto rasterPos = cameraPath.size() > 1
+                ? scene->rasterPosition(-cameraPath[1].wi, aspectRatio)
+                : std::nullopt;
+
+            // Camera subpath hits a light (s=0)
+            for (int t = 2; t <= int(cameraPath.size()); t++) {
+                const auto& z = cameraPath[t-1];
+                if (!scene->isLight(z.sp)) {
+                    continue;
+                }
+                const auto C = z.throughput * scene->evalContrbEndpoint(z.sp, z.wi);
+                if (math::isZero(C) || !rasterPos) {
+                    continue;
+                }
+                film_->splat(*rasterPos, C * misWeight(scene, lightPath, 0, cameraPath, t, nullptr));
+            }
+
+            // Next event estimation (s=1)
+            for (int t = 2; t <= std::min(int(cameraPath.size()), maxLength_); t++) {
+                const auto& z = cameraPath[t-1];
+                if (!z.connectable || z.delta || !rasterPos) {
+                    continue;
+                }
+                const auto sL = scene->sampleLight(rng, z.sp);
+                if (!sL) {
+                    continue;
+                }
+                const auto fs = scene->evalContrb(z.sp, z.wi, -sL->wo) / scene->pdfComp(z.sp, z.wi);
+                const auto C = z.throughput * fs * sL->weight;
+                if (math::isZero(C) || !scene->visible(z.sp, sL->sp)) {
+                    continue;
+                }
+                const Vertex y0{ sL->sp, Vec3(1_f), Vec3(0_f), 0_f, 0_f, false, true };
+                film_->splat(*rasterPos, C * misWeight(scene, lightPath, 1, cameraPath, t, &y0));
+            }
+
+            // Connection to the camera (t=1)
+            for (int s = 2; s <= std::min(int(lightPath.size()), maxLength_); s++) {
+                const auto& yv = lightPath[s-1];
+                if (!yv.connectable || yv.delta) {
+                    continue;
+                }
+                const auto d = direction(yv.sp.geom, z0.sp.geom);
+                const auto rp = scene->rasterPosition(-d, aspectRatio);
+                if (!rp) {
+                    continue;
+                }
+                const auto fs = scene->evalContrb(yv.sp, yv.wi, d) / scene->pdfComp(yv.sp, yv.wi);
+                const auto We = scene->evalContrb(z0.sp, {}, -d);
+                const auto C = yv.throughput * fs * surface::geometryTerm(yv.sp.geom, z0.sp.geom) * We;
+                if (math::isZero(C) || !scene->visible(yv.sp, z0.sp)) {
+                    continue;
+                }
+                film_->splat(*rp, C * misWeight(scene, lightPath, s, cameraPath, 1, nullptr));
+            }
+
+            // Connection of the inner vertices (s>=2, t>=2)
+            if (!rasterPos) {
+                return;
+            }
+            for (int s = 2; s <= int(lightPath.size()); s++) {
+                const auto& yv = lightPath[s-1];
+                if (!yv.connectable || yv.delta) {
+                    continue;
+                }
+                for (int t = 2; t <= int(cameraPath.size()) && s + t <= maxLength_ + 1; t++) {
+                    const auto& z = cameraPath[t-1];
+                    if (!z.connectable || z.delta) {
+                        continue;
+                    }
+                    const auto d = direction(yv.sp.geom, z.sp.geom);
+                    const auto fsL = scene->evalContrb(yv.sp, yv.wi, d) / scene->pdfComp(yv.sp, yv.wi);
+                    const auto fsE = scene->evalContrb(z.sp, z.wi, -d) / scene->pdfComp(z.sp, z.wi);
+                    const auto G = surface::geometryTerm(yv.sp.geom, z.sp.geom);
+                    const auto C = yv.throughput * fsL * G * fsE * z.throughput;
+                    if (math::isZero(C) || !scene->visible(yv.sp, z.sp)) {
+                        continue;
+                    }
+                    film_->splat(*rasterPos, C * misWeight(scene, lightPath, s, cameraPath, t, nullptr));
+                }
+            }
+        });
+
+        // One light subpath is traced for each camera subpath,
+        // so the contributions of both subpaths are scaled by the same factor.
+        // No sample is left if the rendering is cancelled in the first pass.
+        if (processed > 0) {
+            film_->rescale(1_f / processed);
+        }
+    }
+
+private:
+    // Sample a subpath from the terminator and store it to `path`.
+    // The buffer is reused and does not allocate when the capacity is enough.
+    void randomWalk(const Scene* scene, Rng& rng, const SceneInteraction& terminator, int maxVertices, std::vector<Vertex>& path) const {
+        path.clear();
+
+        // Endpoint
+        const auto s0 = scene->sampleRay(rng, terminator, {});
+        if (!s0 || math::isZero(s0->weight)) {
+            return;
+        }
+        const bool isLightPath = terminator.terminator == TerminatorType::Light;
+        path.push_back({
+            s0->sp,
+            Vec3(1_f),
+            Vec3(0_f),
+            isLightPath ? scene->pdfLightPosition(s0->sp) : 1_f,
+            0_f,
+            false,
+            true
+        });
+
+        // Current ray
+        Vec3 throughput = s0->weight;
+        Ray ray = s0->ray();
+        Float pdfDir = scene->pdf(s0->sp, {}, s0->wo);
+        while (int(path.size()) < maxVertices) {
+            const auto hit = scene->intersect(ray);
+            if (!hit) {
+                break;
+            }
+            path.push_back({
+                *hit,
+                throughput,
+                -ray.d,
+                toArea(pdfDir, path.back().sp.geom, hit->geom),
+                0_f,
+                false,
+                false
+            });
+            if (hit->geom.infinite) {
+                break;
+            }
+
+            // Sample a direction. This also selects the component.
+            auto& v = path.back();
+            const auto s = scene->sampleRay(rng, v.sp, v.wi);
+            if (!s || math::isZero(s->weight)) {
+                break;
+            }
+            v.sp = s->sp;
+            v.delta = scene->isSpecular(s->sp);
+            v.connectable = true;
+
+            // Pdfs of the sampled direction and the reversed direction.
+            // Specular vertices have zero pdfs, which are ignored in the MIS weights.
+            const auto pdfComp = [&](Vec3 wi) { return scene->pdfComp(v.sp, wi); };
+            const auto pdfFwd = v.delta ? 0_f : pdfComp(v.wi) * scene->pdf(v.sp, v.wi, s->wo);
+            const auto pdfRev = v.delta ? 0_f : pdfComp(s->wo) * scene->pdf(v.sp, s->wo, v.wi);
+            auto& prev = path[path.size()-2];
+            prev.pdfRev = toArea(pdfRev, v.sp.geom, prev.sp.geom);
+
+            // Russian roulette
+            throughput *= s->weight;
+            if (path.size() > 4) {
+                const auto q = glm::max(.2_f, 1_f - glm::compMax(throughput));
+                if (rng.u() < q) {
+                    break;
+                }
+                throughput /= 1_f - q;
+            }
+
+            ray = s->ray();
+            pdfDir = pdfFwd;
+        }
+    }
+
+    // Pdf of sampling `to` from the non-specular vertex `from` reached from the direction `wi`, in area measure
+    Float pdfA(const Scene* scene, const SceneInteraction& from, Vec3 wi, const SceneInteraction& to) const {
+        const auto wo = direction(from.geom, to.geom);
+        const auto pdf = from.endpoint
+            ? scene->pdf(from, {}, wo)
+            : scene->pdfComp(from, wi) * scene->pdf(from, wi, wo);
+        return toArea(pdf, from.geom, to.geom);
+    }
+
+    // MIS weight of the path created by the strategy (s,t) with the balance heuristic.
+    // The path is x_0,...,x_k (k=s+t-1) where x_0 is on a light and x_k is the camera.
+    // Following [Veach1997], the weight is computed from the ratios of the pdfs of the strategies
+    // p_{i+1}/p_i = pL(x_i)/pE(x_i), where pL and pE are pdfs of sampling x_i from the light and camera side.
+    // For s=1, `y0` is the vertex on the light sampled by next event estimation.
+    // The position of a light endpoint is assumed to be sampled with the same pdf
+    // by the next event estimation and the light subpath, which holds for the built-in lights.
+    Float misWeight(const Scene* scene, const std::vector<Vertex>& lightPath, int s,
+        const std::vector<Vertex>& cameraPath, int t, const Vertex* y0) const {
+        const int k = s + t - 1;
+        const auto x = [&](int i) -> const Vertex& {
+            if (i < s) {
+                return i == 0 && y0 ? *y0 : lightPath[i];
+            }
+            return cameraPath[k-i];
+        };
+
+        // Light endpoint as a light
+        const auto spL = s == 0 ? asLightEndpoint(x(0).sp) : x(0).sp;
+        const bool hittable = !spL.geom.degenerated && !scene->isSpecular(spL);
+        const bool emittable = s >= 2 || (!spL.geom.infinite && scene->pdfLightPosition(spL) > 0_f);
+
+        // Pdfs of the vertices around the connection
+        const auto& xs1 = x(s-1 >= 0 ? s-1 : 0);
+        const auto& xs = x(s);
+        const Float pL0 = s >= 2 ? x(0).pdfFwd
+            : toArea(scene->pdfLight(x(1).sp, spL, direction(spL.geom, x(1).sp.geom)), x(1).sp.geom, spL.geom);
+        const Float pLs = s == 0 ? 0_f
+            : pdfA(scene, xs1.sp, xs1.wi, xs.sp);
+        const Float pLs1 = k < s+1 ? 0_f
+            : s == 0 ? pdfA(scene, spL, {}, x(1).sp)
+            : pdfA(scene, xs.sp, direction(xs.sp.geom, xs1.sp.geom), x(s+1).sp);
+        const Float pEs1 = s == 0 ? 0_f
+            : pdfA(scene, xs.sp, xs.wi, xs1.sp);
+        const Float pEs2 = s < 2 ? 0_f
+            : pdfA(scene, xs1.sp, direction(xs1.sp.geom, xs.sp.geom), x(s-2).sp);
+        const auto pL = [&](int i) -> Float {
+            if (i == 0) return pL0;
+            if (i < s) return x(i).pdfFwd;
+            if (i == s) return pLs;
+            if (i == s+1) return pLs1;
+            return x(i).pdfRev;
+        };
+        const auto pE = [&](int i) -> Float {
+            if (i >= s) return x(i).pdfFwd;
+            if (i == s-1) return pEs1;
+            if (i == s-2) return pEs2;
+            return x(i).pdfRev;
+        };
+
+        // Check if the strategy with s' light vertices is implemented and can sample the path
+        const auto delta = [&](int i) { return i > 0 && x(i).delta; };
+        const auto valid = [&](int sp) {
+            const int tp = k + 1 - sp;
+            if (tp == 0 || (tp == 1 && sp < 2)) {
+                return false;
+            }
+            if (sp == 0) {
+                return hittable;
+            }
+            if (sp == 1) {
+                return !delta(1);
+            }
+            return emittable && !delta(sp-1) && !delta(sp);
+        };
+
+        // Zero pdfs of specular vertices are replaced by one since they cancel out
+        const auto remap0 = [](Float p) { return p != 0_f ? p : 1_f; };
+        Float sum = 1_f;
+        Float r = 1_f;
+        for (int i = s; i < k; i++) {
+            r *= remap0(pL(i)) / remap0(pE(i));
+            if (valid(i+1)) {
+                sum += r;
+            }
+        }
+        r = 1_f;
+        for (int i = s-1; i >= 0; i--) {
+            r *= remap0(pE(i)) / remap0(pL(i));
+            if (valid(i)) {
+                sum += r;
+            }
+        }
+        return 1_f / sum;
+    }
+};
+
+LM_COMP_REG_IMPL(Renderer_BDPT, "renderer::bdpt");
+
+LM_NAMESPACE_END(LM_NAMESPACE)
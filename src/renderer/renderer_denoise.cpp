@@ -0,0 +1,200 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/core.h>
+#include <lm/renderer.h>
+#include <lm/film.h>
+#include <lm/parallel.h>
+#include <lm/progress.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+/*
+\rst
+.. function:: renderer::denoise
+
+   Feature-guided denoiser.
+
+   :param str input: Film containing the noisy image and the features,
+                     specified by asset name or locator.
+   :param str output: Output film. Can be the same as ``input``. Default: ``input``.
+   :param int radius: Radius of the filter in pixels. Default: 8.
+   :param float sigma_spatial: Standard deviation of the spatial term in pixels. Default: 4.
+   :param float sigma_color: Standard deviation of the color term. Default: 1.
+   :param float sigma_albedo: Standard deviation of the albedo term. Default: 0.1.
+   :param float sigma_normal: Standard deviation of the normal term. Default: 0.1.
+   :param float sigma_depth: Standard deviation of the relative depth term. Default: 0.1.
+   :param int tile_size: Size of the tiles processed in parallel. Default: 32.
+
+   This renderer is a post-process stage that does not use the scene.
+   It applies a joint cross-bilateral filter to the ``color`` layer of the input film,
+   guided by the feature layers ``albedo``, ``normal``, ``depth``, and ``variance``
+   written by the renderers, e.g., :cpp:func:`renderer::pt`
+   with a film created with ``aovs`` parameter.
+   The terms of missing layers are ignored.
+
+   If the ``albedo`` layer is available, the filter is applied to the color divided by the albedo
+   and the result is multiplied back by the albedo to preserve the texture details.
+   If the ``variance`` layer is available, the color distance is normalized by the variances
+   of the two pixels so that the noisy regions are filtered stronger.
+\endrst
+*/
+class Renderer_Denoise final : public Renderer {
+private:
+    Film* input_;
+    Film* output_;
+    int radius_;
+    Float sigmaSpatial_;
+    Float sigmaColor_;
+    Float sigmaAlbedo_;
+    Float sigmaNormal_;
+    Float sigmaDepth_;
+    int tileSize_;
+
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(input_, output_, radius_, sigmaSpatial_, sigmaColor_, sigmaAlbedo_, sigmaNormal_, sigmaDepth_, tileSize_);
+    }
+
+    virtual void foreachUnderlying(const ComponentVisitor& visit) override {
+        comp::visit(visit, input_);
+        comp::visit(visit, output_);
+    }
+
+public:
+    virtual bool construct(const Json& prop) override {
+        input_ = json::compRef<Film>(prop, "input");
+        output_ = prop.count("output") ? json::compRef<Film>(prop, "output") : input_;
+        radius_ = json::value<int>(prop, "radius", 8);
+        sigmaSpatial_ = json::value<Float>(prop, "sigma_spatial", 4_f);
+        sigmaColor_ = json::value<Float>(prop, "sigma_color", 1_f);
+        sigmaAlbedo_ = json::value<Float>(prop, "sigma_albedo", .1_f);
+        sigmaNormal_ = json::value<Float>(prop, "sigma_normal", .1_f);
+        sigmaDepth_ = json::value<Float>(prop, "sigma_depth", .1_f);
+        tileSize_ = json::value<int>(prop, "tile_size", 32);
+        if (radius_ < 0 || tileSize_ <= 0) {
+            LM_ERROR("Invalid parameters [radius={}, tile_size={}]", radius_, tileSize_);
+            return false;
+        }
+        return true;
+    }
+
+    virtual bool requiresScene() const override {
+        return false;
+    }
+
+    virtual void render(const Scene*) const override {
+        const int w = input_->size().w;
+        const int h = input_->size().h;
+        if (const auto size = output_->size(); size.w != w || size.h != h) {
+            LM_ERROR("Film size is different [input='({},{})', output='({},{})']", w, h, size.w, size.h);
+            return;
+        }
+
+        // Copy the layers, so that the output can be the same film as the input
+        const auto copyLayer = [&](const std::string& name) -> std::vector<Vec3> {
+            const int layer = input_->layerIndex(name);
+            if (layer < 0) {
+                return {};
+            }
+            const auto buf = input_->layerBuffer(layer);
+            std::vector<Vec3> v(w * h);
+            for (int i = 0; i < w * h; i++) {
+                v[i] = Vec3(buf.data[3*i], buf.data[3*i+1], buf.data[3*i+2]);
+            }
+            return v;
+        };
+        auto color = copyLayer("color");
+        const auto albedo = copyLayer("albedo");
+        const auto normal = copyLayer("normal");
+        const auto depth = copyLayer("depth");
+        const auto variance = copyLayer("variance");
+        LM_INFO("Denoising [albedo={}, normal={}, depth={}, variance={}]",
+            !albedo.empty(), !normal.empty(), !depth.empty(), !variance.empty());
+
+        // Demodulate albedo
+        constexpr Float Eps = 1e-4_f;
+        std::vector<Vec3> colorVar = variance;
+        if (!albedo.empty()) {
+            for (int i = 0; i < w * h; i++) {
+                const auto a = albedo[i] + Eps;
+                color[i] /= a;
+                if (!colorVar.empty()) {
+                    colorVar[i] /= a * a;
+                }
+            }
+        }
+
+        // Filter weights of the features
+        const auto invVar = [](Float sigma) { return 1_f / (2_f * sigma * sigma); };
+        const auto wSpatial = invVar(sigmaSpatial_);
+        const auto wColor = invVar(sigmaColor_);
+        const auto wAlbedo = invVar(sigmaAlbedo_);
+        const auto wNormal = invVar(sigmaNormal_);
+        const auto wDepth = invVar(sigmaDepth_);
+        const auto dist2 = [](Vec3 a, Vec3 b) {
+            const auto d = a - b;
+            return glm::dot(d, d);
+        };
+
+        // Filter the pixels in tiles
+        const int tw = (w + tileSize_ - 1) / tileSize_;
+        const int th = (h + tileSize_ - 1) / tileSize_;
+        progress::ScopedReport progress_(tw * th);
+        parallel::foreach(tw * th, [&](long long tileIndex, int) {
+            const int x0 = int(tileIndex % tw) * tileSize_;
+            const int y0 = int(tileIndex / tw) * tileSize_;
+            const int x1 = std::min(x0 + tileSize_, w);
+            const int y1 = std::min(y0 + tileSize_, h);
+            for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                const int p = y * w + x;
+                Vec3 sum(0_f);
+                Float sumW = 0_f;
+                for (int qy = std::max(0, y - radius_); qy <= std::min(h - 1, y + radius_); qy++) {
+                    for (int qx = std::max(0, x - radius_); qx <= std::min(w - 1, x + radius_); qx++) {
+                        const int q = qy * w + qx;
+                        Float e = wSpatial * Float((qx - x) * (qx - x) + (qy - y) * (qy - y));
+                        if (colorVar.empty()) {
+                            e += wColor * dist2(color[p], color[q]);
+                        }
+                        else {
+                            const auto v = glm::compAdd(colorVar[p] + colorVar[q]) + Eps;
+                            e += wColor * dist2(color[p], color[q]) / v;
+                        }
+                        if (!albedo.empty()) {
+                            e += wAlbedo * dist2(albedo[p], albedo[q]);
+                        }
+                        if (!normal.empty()) {
+                            e += wNormal * dist2(normal[p], normal[q]);
+                        }
+                        if (!depth.empty()) {
+                            const auto d = (depth[p].x - depth[q].x) / (std::max(depth[p].x, depth[q].x) + Eps);
+                            e += wDepth * d * d;
+                        }
+                        const auto weight = std::exp(-e);
+                        sum += weight * color[q];
+                        sumW += weight;
+                    }
+                }
+
+                // The weight of the center pixel is always one
+                auto C = sum / sumW;
+                if (!albedo.empty()) {
+                    C *= albedo[p] + Eps;
+                }
+                output_->setPixel(x, y, C);
+            }
+            }
+        }, [](long long processed) {
+            progress::update(processed);
+        });
+    }
+};
+
+LM_COMP_REG_IMPL(Renderer_Denoise, "renderer::denoise");
+
+LM_NAMESPACE_END(LM_NAMESPACE)
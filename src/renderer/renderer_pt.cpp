@@ -8,7 +8,11 @@
 #include <lm/renderer.h>
 #include <lm/scene.h>
 #include <lm/film.h>
+#include <lm/camera.h>
 #include <lm/scheduler.h>
+#include <lm/sampler.h>
+#include <lm/parallel.h>
+#include <lm/progress.h>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
@@ -25,6 +29,37 @@ enum class ImageSampleMode {
 
 // ------------------------------------------------------------------------------------------------
 
+/*
+\rst
+.. function:: renderer::pt
+
+   Path tracing.
+
+   :param str output: Underlying film specified by asset name or locator.
+   :param int max_length: Maximum number of path edges.
+   :param str mode: Light sampling strategy (``naive``, ``nee``, or ``mis``). Default: ``mis``.
+   :param str image_sample_mode: Sample space of the primary rays (``pixel`` or ``image``). Default: ``pixel``.
+   :param str scheduler: Scheduler of the samples, e.g., ``sample`` or ``time``.
+   :param bool ray_differentials: Filter the texture lookups at the primary hits. Default: true.
+   :param str sampler: Sample generator. Optional. Only available in ``pixel`` image sample mode.
+   :param int seed: Random seed. Optional.
+   :param list views: List of the views rendered in a batch. Optional.
+                      Each view is an object with ``camera`` (camera asset), ``output`` (film asset),
+                      and optional ``path`` (output image path).
+   :param int spp: Samples per pixel of the views.
+   :param int tile_size: Size of the tiles of the views. Default: 16.
+
+   If ``views`` is specified, the renderer renders the views of the scene in a batch
+   instead of the camera of the scene and ``output``.
+   The cameras of the views must be added to the scene as camera primitives.
+   The tiles of all views are processed in one parallel loop sharing the acceleration structure and the lights,
+   so that the threads are kept busy until the last tile of the last view.
+   Each view is finalized and saved to ``path`` as soon as its last tile is completed,
+   while the tiles of the other views are still being rendered.
+   The views finished before a cancellation are kept.
+   Only ``pixel`` image sample mode is supported for the batch rendering.
+\endrst
+*/
 class Renderer_PT : public Renderer {
 private:
     Film* film_;
@@ -32,23 +67,55 @@ private:
     std::optional<unsigned int> seed_;
     PTMode ptMode_;
     ImageSampleMode imageSampleMode_;
+    bool rayDifferentials_;
     Component::Ptr<scheduler::Scheduler> sched_;
+    Component::Ptr<Sampler> sampler_;
+
+    // View of the batch rendering
+    struct ViewEntry {
+        Camera* camera;     // Camera of the view
+        Film* film;         // Output film
+        std::string path;   // Output image path. Empty if not saved.
+
+        template <typename Archive>
+        void serialize(Archive& ar) {
+            ar(camera, film, path);
+        }
+    };
+    std::vector<ViewEntry> views_;
+    long long spp_ = 0;
+    int tileSize_ = 16;
+
+    // View being rendered
+    struct View {
+        Film* film;
+        int camera;         // Camera primitive node index. -1 for the camera of the scene.
+        int albedoLayer;    // Layers of arbitrary output variables. -1 if unavailable.
+        int normalLayer;
+        int depthLayer;
+        int varianceLayer;
+    };
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(film_, maxLength_, ptMode_, sched_);
+        ar(film_, maxLength_, ptMode_, rayDifferentials_, sched_, sampler_, views_, spp_, tileSize_);
     }
 
     virtual void foreachUnderlying(const ComponentVisitor& visit) override {
         comp::visit(visit, film_);
         comp::visit(visit, sched_);
+        comp::visit(visit, sampler_);
+        for (auto& view : views_) {
+            comp::visit(visit, view.camera);
+            comp::visit(visit, view.film);
+        }
     }
 
 public:
     virtual bool construct(const Json& prop) override {
-        film_ = json::compRef<Film>(prop, "output");
         maxLength_ = json::value<int>(prop, "max_length");
         seed_ = json::valueOrNone<unsigned int>(prop, "seed");
+        rayDifferentials_ = json::value<bool>(prop, "ray_differentials", true);
         {
             const auto s = json::value<std::string>(prop, "mode", "mis");
             if (s == "naive") {
@@ -61,6 +128,41 @@ public:
                 ptMode_ = PTMode::MIS;
             }
         }
+
+        // Sample generator. Use the pseudo random number generator if not specified.
+        if (const auto samplerName = json::valueOrNone<std::string>(prop, "sampler")) {
+            sampler_ = comp::create<Sampler>("sampler::" + *samplerName, makeLoc("sampler"), prop);
+            if (!sampler_) {
+                return false;
+            }
+        }
+
+        // Batch rendering of the views
+        views_.clear();
+        if (const auto it = prop.find("views"); it != prop.end()) {
+            film_ = nullptr;
+            imageSampleMode_ = ImageSampleMode::Pixel;
+            spp_ = json::value<long long>(prop, "spp");
+            tileSize_ = json::value<int>(prop, "tile_size", 16);
+            if (spp_ <= 0 || tileSize_ <= 0) {
+                LM_ERROR("Invalid parameters [spp={}, tile_size={}]", spp_, tileSize_);
+                return false;
+            }
+            for (const auto& v : *it) {
+                views_.push_back({
+                    json::compRef<Camera>(v, "camera"),
+                    json::compRef<Film>(v, "output"),
+                    json::value<std::string>(v, "path", "")
+                });
+            }
+            if (views_.empty()) {
+                LM_ERROR("Empty views");
+                return false;
+            }
+            return true;
+        }
+
+        film_ = json::compRef<Film>(prop, "output");
         {
             const auto schedName = json::value<std::string>(prop, "scheduler");
             const auto s = json::value<std::string>(prop, "image_sample_mode", "pixel");
@@ -75,193 +177,386 @@ public:
                     "scheduler::spi::" + schedName, makeLoc("scheduler"), prop);
             }
         }
+
+        // The sample generators are indexed by pixels, which are not known
+        // before the primary ray is sampled in the image sample mode.
+        if (sampler_ && imageSampleMode_ == ImageSampleMode::Image) {
+            LM_ERROR("Sample generator is not supported in the image sample mode");
+            return false;
+        }
         return true;
     }
 
+    // The views are rendered without the scheduler
+    virtual void continueSamples(bool enable) override {
+        if (sched_) {
+            sched_->continueSamples(enable);
+        }
+    }
+
     virtual void render(const Scene* scene) const override {
+        if (!views_.empty()) {
+            renderViews(scene);
+            return;
+        }
+
         // Clear film
         film_->clear();
-        const auto size = film_->size();
+        const auto view = makeView(film_, -1);
 
         // Dispatch rendering
-        const auto processed = sched_->run([&](long long pixelIndex, long long, int threadid) {
-            // Per-thread random number generator
-            thread_local Rng rng(seed_ ? *seed_ + threadid : math::rngSeed());
+        const auto size = film_->size();
+        scheduler::ThreadRngs rngs(seed_, sched_.get());
+        const auto processed = sched_->run([&](long long pixelIndex, long long sampleIndex, int threadid) {
+            auto& rng = rngs[threadid];
+            rng.attach(sampler_.get(), int(pixelIndex % size.w), int(pixelIndex / size.w), sampleIndex);
+            processSample(scene, rng, view, pixelIndex);
+        });
 
-            // ------------------------------------------------------------------------------------
+        // Rescale film
+        finalize(view, processed);
+    }
 
-            // Sample window
-            const auto window = [&]() -> Vec4 {
-                if (imageSampleMode_ == ImageSampleMode::Pixel) {
-                    const int x = int(pixelIndex % size.w);
-                    const int y = int(pixelIndex / size.w);
-                    const auto dx = 1_f / size.w;
-                    const auto dy = 1_f / size.h;
-                    return { dx * x, dy * y, dx, dy };
+private:
+    // Render the views in a batch
+    void renderViews(const Scene* scene) const {
+        // Find the camera primitives of the views
+        std::vector<View> views;
+        for (const auto& entry : views_) {
+            int camera = -1;
+            scene->traverseNodes([&](const SceneNode& node, Mat4) {
+                if (node.type == SceneNodeType::Primitive && node.primitive.camera == entry.camera) {
+                    camera = node.index;
                 }
-                else {
-                    return { 0_f, 0_f, 1_f, 1_f };
+            });
+            if (camera < 0) {
+                LM_ERROR("Camera of the view is not in the scene [camera='{}']", entry.camera->loc());
+                return;
+            }
+            entry.film->clear();
+            views.push_back(makeView(entry.film, camera));
+        }
+
+        // Tiles of all views
+        struct Tile {
+            int view;
+            int x0, y0, x1, y1;
+        };
+        std::vector<Tile> tiles;
+        for (int i = 0; i < int(views.size()); i++) {
+            const auto size = views[i].film->size();
+            for (int y = 0; y < size.h; y += tileSize_) {
+                for (int x = 0; x < size.w; x += tileSize_) {
+                    tiles.push_back({ i, x, y, std::min(x + tileSize_, size.w), std::min(y + tileSize_, size.h) });
                 }
-            }();
+            }
+        }
 
-            // ------------------------------------------------------------------------------------
+        // Number of the remaining tiles of each view
+        std::vector<std::atomic<int>> remaining(views.size());
+        for (const auto& tile : tiles) {
+            remaining[tile.view]++;
+        }
 
-            // Path throughput
-            Vec3 throughput(1_f);
+        // Process the tiles in one parallel loop.
+        // Each view is finalized and saved as soon as its last tile is finished,
+        // so the outputs are available before the other views are done.
+        std::mutex saveMutex;
+        progress::ScopedReport progress_(tiles.size());
+        scheduler::ThreadRngs rngs(seed_);
+        parallel::foreach(tiles.size(), [&](long long index, int threadid) {
+            auto& rng = rngs[threadid];
+            const auto& tile = tiles[index];
+            const auto& view = views[tile.view];
+            const auto w = view.film->size().w;
+            for (int y = tile.y0; y < tile.y1; y++) {
+                for (int x = tile.x0; x < tile.x1; x++) {
+                    for (long long sampleIndex = 0; sampleIndex < spp_; sampleIndex++) {
+                        rng.attach(sampler_.get(), x, y, sampleIndex);
+                        processSample(scene, rng, view, y * w + x);
+                    }
+                }
+            }
+            if (--remaining[tile.view] > 0) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(saveMutex);
+            finalizeInLoop(view, spp_);
+            const auto& path = views_[tile.view].path;
+            if (!path.empty() && !view.film->save(path)) {
+                LM_ERROR("Failed to save the view [path='{}']", path);
+            }
+        }, [](long long processed) {
+            progress::update(processed);
+        });
+    }
 
-            // Incident direction and current surface point
-            Vec3 wi = {};
-            auto sp = SceneInteraction::makeCameraTerminator(window, film_->aspectRatio());
+    // Find the layers of the film for the view.
+    // Per-pixel variance is only available in the pixel sample mode,
+    // where all contributions of a sample go to the same pixel.
+    View makeView(Film* film, int camera) const {
+        return View{
+            film,
+            camera,
+            film->layerIndex("albedo"),
+            film->layerIndex("normal"),
+            film->layerIndex("depth"),
+            imageSampleMode_ == ImageSampleMode::Pixel ? film->layerIndex("variance") : -1
+        };
+    }
 
-            // Raster position
-            Vec2 rasterPos{};
+    // Process a sample and accumulate the contributions to the film of the view
+    void processSample(const Scene* scene, Rng& rng, const View& view, long long pixelIndex) const {
+        const auto size = view.film->size();
+
+        // Sample window
+        const auto window = [&]() -> Vec4 {
+            if (imageSampleMode_ == ImageSampleMode::Pixel) {
+                const int x = int(pixelIndex % size.w);
+                const int y = int(pixelIndex / size.w);
+                const auto dx = 1_f / size.w;
+                const auto dy = 1_f / size.h;
+                return { dx * x, dy * y, dx, dy };
+            }
+            else {
+                return { 0_f, 0_f, 1_f, 1_f };
+            }
+        }();
 
-            // Perform random walk
-            for (int length = 0; length < maxLength_; length++) {
-                // Sample a ray
-                const auto s = scene->sampleRay(rng, sp, wi);
-                if (!s || math::isZero(s->weight)) {
-                    break;
+        // ------------------------------------------------------------------------------------
+
+        // Path throughput
+        Vec3 throughput(1_f);
+
+        // Incident direction and current surface point
+        Vec3 wi = {};
+        auto sp = SceneInteraction::makeCameraTerminator(window, view.film->aspectRatio(), view.camera);
+
+        // Raster position
+        Vec2 rasterPos{};
+
+        // Total contribution of the sample
+        Vec3 L(0_f);
+
+        // Perform random walk
+        for (int length = 0; length < maxLength_; length++) {
+            // Sample a ray
+            const auto s = scene->sampleRay(rng, sp, wi);
+            if (!s || math::isZero(s->weight)) {
+                break;
+            }
+            // Compute raster position for the primary ray
+            if (length == 0) {
+                rasterPos = *scene->rasterPosition(s->wo, view.film->aspectRatio(), view.camera);
+            }
+
+            // --------------------------------------------------------------------------------
+
+            // Sample a NEE edge
+            const bool nee = [&]() {
+                // Ignore NEE edge with naive direct sampling mode
+                if (ptMode_ == PTMode::Naive) {
+                    return false;
+                }
+                // NEE edge can be samplable if current direction sampler
+                // (according to BSDF / phase) doesn't contain delta component.
+                if (imageSampleMode_ == ImageSampleMode::Pixel) {
+                    // Primary ray is not samplable via NEE in the pixel space sample mode
+                    return length > 0 && !scene->isSpecular(s->sp);
+                }
+                else {
+                    // Primary ray is samplable via NEE in the image space sample mode
+                    return !scene->isSpecular(s->sp);
+                }
+            }();
+            if (nee) [&] {
+                // Sample a light
+                const auto sL = scene->sampleLight(rng, s->sp);
+                if (!sL) {
+                    return;
                 }
-                // Compute raster position for the primary ray
-                if (length == 0) {
-                    rasterPos = *scene->rasterPosition(s->wo, film_->aspectRatio());
+                if (!scene->visible(s->sp, sL->sp)) {
+                    return;
                 }
 
-                // --------------------------------------------------------------------------------
+                // Recompute raster position for the primary edge
+                const auto rp = [&]() -> std::optional<Vec2> {
+                    if (length == 0)
+                        return scene->rasterPosition(-sL->wo, view.film->aspectRatio(), view.camera);
+                    else
+                        return rasterPos;
+                }();
+                if (!rp) {
+                    return;
+                }
 
-                // Sample a NEE edge
-                const bool nee = [&]() {
-                    // Ignore NEE edge with naive direct sampling mode
-                    if (ptMode_ == PTMode::Naive) {
-                        return false;
-                    }
-                    // NEE edge can be samplable if current direction sampler
-                    // (according to BSDF / phase) doesn't contain delta component.
-                    if (imageSampleMode_ == ImageSampleMode::Pixel) {
-                        // Primary ray is not samplable via NEE in the pixel space sample mode
-                        return length > 0 && !scene->isSpecular(s->sp);
+                // This light is not samplable by direct strategy
+                // if the light contain delta component or degenerated.
+                const bool directL = !scene->isSpecular(sL->sp) && !sL->sp.geom.degenerated;
+
+                // Evaluate and accumulate contribution
+                const auto wo = -sL->wo;
+                const auto fs = scene->evalContrb(s->sp, wi, wo);
+                const auto pdfSel = scene->pdfComp(s->sp, wi);
+                const auto misw = [&]() -> Float {
+                    if (ptMode_ == PTMode::NEE) {
+                        return 1_f;
                     }
-                    else {
-                        // Primary ray is samplable via NEE in the image space sample mode
-                        return !scene->isSpecular(s->sp);
+                    if (!directL) {
+                        return 1_f;
                     }
+                    // Compute MIS weight only when wo can be sampled with both strategies.
+                    return math::balanceHeuristic(
+                        scene->pdfLight(s->sp, sL->sp, sL->wo), scene->pdf(s->sp, wi, wo));
                 }();
-                if (nee) [&] {
-                    // Sample a light
-                    const auto sL = scene->sampleLight(rng, s->sp);
-                    if (!sL) {
-                        return;
-                    }
-                    if (!scene->visible(s->sp, sL->sp)) {
-                        return;
-                    }
-
-                    // Recompute raster position for the primary edge
-                    const auto rp = [&]() -> std::optional<Vec2> {
-                        if (length == 0)
-                            return scene->rasterPosition(-sL->wo, film_->aspectRatio());
-                        else
-                            return rasterPos;
-                    }();
-                    if (!rp) {
-                        return;
-                    }
+                const auto C = throughput / pdfSel * fs * sL->weight * misw;
+                view.film->splat(*rp, C);
+                L += C;
+            }();
 
-                    // This light is not samplable by direct strategy
-                    // if the light contain delta component or degenerated.
-                    const bool directL = !scene->isSpecular(sL->sp) && !sL->sp.geom.degenerated;
-
-                    // Evaluate and accumulate contribution
-                    const auto wo = -sL->wo;
-                    const auto fs = scene->evalContrb(s->sp, wi, wo);
-                    const auto pdfSel = scene->pdfComp(s->sp, wi);
-                    const auto misw = [&]() -> Float {
-                        if (ptMode_ == PTMode::NEE) {
-                            return 1_f;
-                        }
-                        if (!directL) {
-                            return 1_f;
-                        }
-                        // Compute MIS weight only when wo can be sampled with both strategies.
-                        return math::balanceHeuristic(
-                            scene->pdfLight(s->sp, sL->sp, sL->wo), scene->pdf(s->sp, wi, wo));
-                    }();
-                    const auto C = throughput / pdfSel * fs * sL->weight * misw;
-                    film_->splat(*rp, C);
-                }();
+            // --------------------------------------------------------------------------------
 
-                // --------------------------------------------------------------------------------
+            // Intersection to next surface.
+            // Texture lookups at the primary hit are filtered by the pixel footprint.
+            const auto hit = [&]() {
+                if (length == 0 && rayDifferentials_) {
+                    const auto drp = Vec2(1_f / size.w, 1_f / size.h);
+                    if (const auto rd = scene->primaryRayDifferential(rasterPos, drp, view.film->aspectRatio(), view.camera)) {
+                        return scene->intersect(s->ray(), *rd);
+                    }
+                }
+                return scene->intersect(s->ray());
+            }();
+            if (!hit) {
+                break;
+            }
 
-                // Intersection to next surface
-                const auto hit = scene->intersect(s->ray());
-                if (!hit) {
-                    break;
+            // Primary-hit AOVs
+            if (length == 0) {
+                const auto p = view.film->rasterToPixel(rasterPos);
+                if (view.albedoLayer > 0) {
+                    const auto albedo = hit->geom.infinite ? std::nullopt : scene->reflectance(*hit);
+                    view.film->splatLayer(view.albedoLayer, p.x, p.y, albedo ? *albedo : Vec3(0_f));
+                }
+                if (view.normalLayer > 0 && !hit->geom.infinite) {
+                    view.film->splatLayer(view.normalLayer, p.x, p.y, hit->geom.n);
                 }
+                if (view.depthLayer > 0 && !hit->geom.infinite) {
+                    view.film->splatLayer(view.depthLayer, p.x, p.y, Vec3(glm::distance(s->sp.geom.p, hit->geom.p)));
+                }
+            }
 
-                // --------------------------------------------------------------------------------
+            // --------------------------------------------------------------------------------
 
-                // Update throughput
-                throughput *= s->weight;
+            // Update throughput
+            throughput *= s->weight;
 
-                // --------------------------------------------------------------------------------
+            // --------------------------------------------------------------------------------
 
-                // Accumulate contribution from light
-                const bool direct = [&]() -> bool {
-                    // Direct strategy is samplable if the ray hit with light
-                    if (ptMode_ == PTMode::NEE) {
-                        // In NEE mode, use direct strategy only when a NEE edge cannot be sampled.
-                        return !nee && scene->isLight(*hit);
+            // Accumulate contribution from light
+            const bool direct = [&]() -> bool {
+                // Direct strategy is samplable if the ray hit with light
+                if (ptMode_ == PTMode::NEE) {
+                    // In NEE mode, use direct strategy only when a NEE edge cannot be sampled.
+                    return !nee && scene->isLight(*hit);
+                }
+                else {
+                    return scene->isLight(*hit);
+                }
+            }();
+            if (direct) {
+                const auto woL = -s->wo;
+                const auto fs = scene->evalContrbEndpoint(*hit, woL);
+                const auto misw = [&]() -> Float {
+                    if (ptMode_ == PTMode::Naive) {
+                        return 1_f;
                     }
-                    else {
-                        return scene->isLight(*hit);
+                    if (!nee) {
+                        return 1_f;
                     }
+                    // The continuation edge can be sampled via both direct and NEE
+                    return math::balanceHeuristic(
+                        scene->pdf(s->sp, wi, s->wo), scene->pdfLight(s->sp, *hit, woL));
                 }();
-                if (direct) {
-                    const auto woL = -s->wo;
-                    const auto fs = scene->evalContrbEndpoint(*hit, woL);
-                    const auto misw = [&]() -> Float {
-                        if (ptMode_ == PTMode::Naive) {
-                            return 1_f;
-                        }
-                        if (!nee) {
-                            return 1_f;
-                        }
-                        // The continuation edge can be sampled via both direct and NEE
-                        return math::balanceHeuristic(
-                            scene->pdf(s->sp, wi, s->wo), scene->pdfLight(s->sp, *hit, woL));
-                    }();
-                    const auto C = throughput * fs * misw;
-                    film_->splat(rasterPos, C);
-                }
+                const auto C = throughput * fs * misw;
+                view.film->splat(rasterPos, C);
+                L += C;
+            }
 
-                // --------------------------------------------------------------------------------
+            // --------------------------------------------------------------------------------
 
-                // Russian roulette
-                if (length > 3) {
-                    const auto q = glm::max(.2_f, 1_f - glm::compMax(throughput));
-                    if (rng.u() < q) {
-                        break;
-                    }
-                    throughput /= 1_f - q;
+            // Russian roulette
+            if (length > 3) {
+                const auto q = glm::max(.2_f, 1_f - glm::compMax(throughput));
+                if (rng.u() < q) {
+                    break;
                 }
+                throughput /= 1_f - q;
+            }
 
-                // --------------------------------------------------------------------------------
+            // --------------------------------------------------------------------------------
 
-                // Update
-                wi = -s->wo;
-                sp = *hit;
+            // Update
+            wi = -s->wo;
+            sp = *hit;
+        }
+
+        // Accumulate second moment of the sample for the variance
+        if (view.varianceLayer > 0) {
+            const auto p = view.film->rasterToPixel(rasterPos);
+            view.film->splatLayer(view.varianceLayer, p.x, p.y, L * L);
+        }
+    }
+
+    // Rescale the film of a view finished inside the parallel loop of the tiles.
+    // Same as finalize() in the pixel sample mode, but the pixels are processed
+    // in the calling thread not to dispatch the nested parallel loops.
+    // Only the layers written by the renderer are rescaled.
+    void finalizeInLoop(const View& view, long long processed) const {
+        auto* film = view.film;
+        const auto size = film->size();
+        const auto s = 1_f / processed;
+        for (int y = 0; y < size.h; y++) {
+            for (int x = 0; x < size.w; x++) {
+                const auto mean = film->layerPixel(0, x, y) * s;
+                film->setLayerPixel(0, x, y, mean);
+                for (const int layer : { view.albedoLayer, view.normalLayer, view.depthLayer }) {
+                    if (layer > 0) {
+                        film->setLayerPixel(layer, x, y, film->layerPixel(layer, x, y) * s);
+                    }
+                }
+                if (view.varianceLayer > 0) {
+                    const auto m2 = film->layerPixel(view.varianceLayer, x, y) * s;
+                    film->setLayerPixel(view.varianceLayer, x, y, glm::max(Vec3(0_f), m2 - mean * mean) / Float(processed));
+                }
             }
-        });
+        }
+    }
 
-        // ----------------------------------------------------------------------------------------
-        
-        // Rescale film
+    // Rescale the film of the view by the number of processed samples
+    void finalize(const View& view, long long processed) const {
+        // No sample is left if the rendering is cancelled in the first pass
+        if (processed == 0) {
+            return;
+        }
+        auto* film = view.film;
+        const auto size = film->size();
         if (imageSampleMode_ == ImageSampleMode::Pixel) {
-            film_->rescale(1_f / processed);
+            film->rescale(1_f / processed);
+
+            // Convert the second moment to the variance of the pixel estimate
+            if (view.varianceLayer > 0) {
+                parallel::foreach(size.w * size.h, [&](long long i, int) {
+                    const int x = int(i % size.w);
+                    const int y = int(i / size.w);
+                    const auto mean = film->layerPixel(0, x, y);
+                    const auto m2 = film->layerPixel(view.varianceLayer, x, y);
+                    film->setLayerPixel(view.varianceLayer, x, y, glm::max(Vec3(0_f), m2 - mean * mean) / Float(processed));
+                });
+            }
         }
         else {
-            film_->rescale(Float(size.w * size.h) / processed);
+            film->rescale(Float(size.w * size.h) / processed);
         }
     }
 };
@@ -0,0 +1,703 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/core.h>
+#include <lm/renderer.h>
+#include <lm/scene.h>
+#include <lm/mesh.h>
+#include <lm/film.h>
+#include <lm/parallel.h>
+#include <lm/progress.h>
+#include <lm/scheduler.h>
+#include <lm/sampler.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+namespace {
+
+// Add a value to the atomic floating point number
+void atomicAdd(std::atomic<Float>& a, Float v) {
+    auto expected = a.load(std::memory_order_relaxed);
+    while (!a.compare_exchange_weak(expected, expected + v, std::memory_order_relaxed));
+}
+
+// Area-preserving map between the unit sphere and the canonical square [0,1]^2.
+// The uniform density in the square corresponds to the uniform density on the sphere.
+Vec2 dirToCanonical(Vec3 d) {
+    const auto cosTheta = std::clamp(d.z, -1_f, 1_f);
+    auto phi = std::atan2(d.y, d.x);
+    if (phi < 0_f) {
+        phi += 2_f * Pi;
+    }
+    return { (cosTheta + 1_f) * .5_f, phi / (2_f * Pi) };
+}
+
+Vec3 canonicalToDir(Vec2 p) {
+    const auto cosTheta = 2_f * p.x - 1_f;
+    const auto sinTheta = std::sqrt(std::max(0_f, 1_f - cosTheta * cosTheta));
+    const auto phi = 2_f * Pi * p.y;
+    return { sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta };
+}
+
+// ------------------------------------------------------------------------------------------------
+
+// Node of the directional quadtree
+struct DTreeNode {
+    std::array<std::atomic<Float>, 4> sums;   // Recorded energy of the quadrants
+    std::array<int, 4> children{};            // Index to the child nodes. 0 if the quadrant is a leaf.
+
+    DTreeNode() {
+        for (auto& s : sums) {
+            s.store(0_f, std::memory_order_relaxed);
+        }
+    }
+
+    DTreeNode(const DTreeNode& o) {
+        *this = o;
+    }
+
+    DTreeNode& operator=(const DTreeNode& o) {
+        children = o.children;
+        for (int i = 0; i < 4; i++) {
+            sums[i].store(o.sum(i), std::memory_order_relaxed);
+        }
+        return *this;
+    }
+
+    Float sum(int i) const {
+        return sums[i].load(std::memory_order_relaxed);
+    }
+
+    Float total() const {
+        return sum(0) + sum(1) + sum(2) + sum(3);
+    }
+};
+
+// Directional quadtree over the canonical square
+class DTree {
+private:
+    std::vector<DTreeNode> nodes_ = std::vector<DTreeNode>(1);
+
+public:
+    size_t numNodes() const {
+        return nodes_.size();
+    }
+
+    Float total() const {
+        return nodes_[0].total();
+    }
+
+    // Record the energy to the canonical point p.
+    // The energy is added to all nodes along the path from the root, thus the sum of
+    // the quadrants of a node is the energy of the parent quadrant.
+    void record(Vec2 p, Float v) {
+        int i = 0;
+        while (true) {
+            const int q = quadrant(p);
+            atomicAdd(nodes_[i].sums[q], v);
+            const int c = nodes_[i].children[q];
+            if (c == 0) {
+                break;
+            }
+            i = c;
+        }
+    }
+
+    // Evaluate the density w.r.t. the area measure of the canonical square
+    Float pdf(Vec2 p) const {
+        Float pdf = 1_f;
+        int i = 0;
+        while (true) {
+            const auto& n = nodes_[i];
+            const auto total = n.total();
+            if (total <= 0_f) {
+                return 0_f;
+            }
+            const int q = quadrant(p);
+            pdf *= 4_f * n.sum(q) / total;
+            const int c = n.children[q];
+            if (c == 0) {
+                return pdf;
+            }
+            i = c;
+        }
+    }
+
+    // Sample a canonical point proportional to the recorded energy
+    Vec2 sample(Rng& rng) const {
+        Vec2 origin(0_f);
+        Float size = 1_f;
+        int i = 0;
+        while (true) {
+            const auto& n = nodes_[i];
+            auto u = rng.u() * n.total();
+            int q = 0;
+            for (; q < 3; q++) {
+                const auto s = n.sum(q);
+                if (u < s) {
+                    break;
+                }
+                u -= s;
+            }
+            while (q > 0 && n.sum(q) <= 0_f) {
+                // Skip empty quadrants selected by rounding errors
+                q--;
+            }
+            size *= .5_f;
+            origin += Vec2(q & 1, q >> 1) * size;
+            const int c = n.children[q];
+            if (c == 0) {
+                return origin + Vec2(rng.u(), rng.u()) * size;
+            }
+            i = c;
+        }
+    }
+
+    // Rebuild the structure from the energy recorded in src.
+    // The quadrants having larger fraction of the total energy than threshold are subdivided.
+    // The nodes are created in breadth-first order and the subdivision stops at maxNodes nodes,
+    // so the tree keeps the coarse levels when it is truncated.
+    // The energy of the rebuilt tree is reset to zero.
+    void refineFrom(const DTree& src, Float threshold, int maxDepth, size_t maxNodes) {
+        nodes_.assign(1, DTreeNode());
+        const auto total = src.total();
+        if (total <= 0_f) {
+            return;
+        }
+        struct Entry {
+            int dst;                    // Node in this tree
+            int src;                    // Node in src tree. -1 if src is already a leaf.
+            std::array<Float, 4> sums;  // Energy of the quadrants
+            int depth;
+        };
+        std::vector<Entry> queue;
+        queue.push_back({ 0, 0, { src.nodes_[0].sum(0), src.nodes_[0].sum(1), src.nodes_[0].sum(2), src.nodes_[0].sum(3) }, 1 });
+        for (size_t head = 0; head < queue.size(); head++) {
+            const auto e = queue[head];
+            for (int q = 0; q < 4; q++) {
+                if (e.depth >= maxDepth || e.sums[q] / total <= threshold) {
+                    continue;
+                }
+                if (nodes_.size() >= maxNodes) {
+                    return;
+                }
+                const int c = int(nodes_.size());
+                nodes_.emplace_back();
+                nodes_[e.dst].children[q] = c;
+                const int srcChild = e.src >= 0 ? src.nodes_[e.src].children[q] : 0;
+                std::array<Float, 4> sums;
+                for (int i = 0; i < 4; i++) {
+                    // Assume uniform distribution inside the leaf of src
+                    sums[i] = srcChild > 0 ? src.nodes_[srcChild].sum(i) : e.sums[q] * .25_f;
+                }
+                queue.push_back({ c, srcChild > 0 ? srcChild : -1, sums, e.depth + 1 });
+            }
+        }
+    }
+
+private:
+    // Compute quadrant of p and map p into the quadrant
+    static int quadrant(Vec2& p) {
+        const int x = p.x >= .5_f;
+        const int y = p.y >= .5_f;
+        p = glm::clamp(p * 2_f - Vec2(x, y), 0_f, 1_f);
+        return x + 2 * y;
+    }
+};
+
+// Directional distribution associated to a leaf of the spatial tree
+struct DTreeWrapper {
+    DTree sampling;                     // Distribution learned in the previous iteration
+    DTree building;                     // Distribution learned in the current iteration
+    std::atomic<long long> count = 0;   // Number of recorded samples in the current iteration
+
+    DTreeWrapper() = default;
+
+    DTreeWrapper(const DTreeWrapper& o)
+        : sampling(o.sampling)
+        , building(o.building)
+        , count(o.count.load()) {}
+
+    size_t memory() const {
+        return (sampling.numNodes() + building.numNodes()) * sizeof(DTreeNode);
+    }
+};
+
+// Spatial binary tree subdividing the scene bound.
+// Leaves are associated with directional distributions.
+class STree {
+private:
+    struct Node {
+        int axis;                       // Split axis
+        std::array<int, 2> children;    // Index to the child nodes. -1 if leaf.
+        int dtree;                      // Index to the directional distribution (leaf only)
+    };
+
+    Bound bound_;
+    std::vector<Node> nodes_;
+    std::vector<DTreeWrapper> dtrees_;
+
+public:
+    STree(Bound b) {
+        // Use cubic bound slightly larger than the scene
+        const auto size = glm::compMax(b.ma - b.mi) * 1.01_f;
+        const auto c = b.center();
+        bound_ = { c - size * .5_f, c + size * .5_f };
+        nodes_.push_back({ 0, { -1, -1 }, 0 });
+        dtrees_.emplace_back();
+    }
+
+    int numNodes() const {
+        return int(nodes_.size());
+    }
+
+    size_t memory() const {
+        size_t bytes = nodes_.size() * sizeof(Node);
+        for (const auto& dt : dtrees_) {
+            bytes += dt.memory();
+        }
+        return bytes;
+    }
+
+    // Find the distribution associated with the point
+    DTreeWrapper& lookup(Vec3 p) {
+        auto lp = glm::clamp((p - bound_.mi) / (bound_.ma - bound_.mi), 0_f, 1_f);
+        int i = 0;
+        while (nodes_[i].children[0] >= 0) {
+            const int axis = nodes_[i].axis;
+            const int c = lp[axis] >= .5_f;
+            lp[axis] = lp[axis] * 2_f - Float(c);
+            i = nodes_[i].children[c];
+        }
+        return dtrees_[nodes_[i].dtree];
+    }
+
+    // Subdivide the leaves having more samples than the threshold.
+    // The children inherit the distribution and the half of the samples.
+    // Subdivision stops when the memory usage exceeds maxMemory.
+    void refine(Float threshold, size_t maxMemory) {
+        auto memory = this->memory();
+        std::vector<int> stack{ 0 };
+        while (!stack.empty()) {
+            const int i = stack.back();
+            stack.pop_back();
+            if (nodes_[i].children[0] >= 0) {
+                stack.push_back(nodes_[i].children[0]);
+                stack.push_back(nodes_[i].children[1]);
+                continue;
+            }
+            const int d0 = nodes_[i].dtree;
+            const auto count = dtrees_[d0].count.load();
+            const auto bytes = dtrees_[d0].memory() + 2 * sizeof(Node);
+            if (Float(count) <= threshold || memory + bytes > maxMemory) {
+                continue;
+            }
+            memory += bytes;
+            dtrees_[d0].count = count / 2;
+            DTreeWrapper dt(dtrees_[d0]);
+            const int d1 = int(dtrees_.size());
+            dtrees_.push_back(std::move(dt));
+            const int c0 = int(nodes_.size());
+            const int axis = (nodes_[i].axis + 1) % 3;
+            nodes_.push_back({ axis, { -1, -1 }, d0 });
+            nodes_.push_back({ axis, { -1, -1 }, d1 });
+            nodes_[i].children = { c0, c0 + 1 };
+            stack.push_back(c0);
+            stack.push_back(c0 + 1);
+        }
+    }
+
+    // Use the distributions learned in the current iteration for sampling
+    // and rebuild the structures for the next iteration.
+    // The memory left by the spatial tree and the sampling distributions
+    // is divided equally among the rebuilt directional trees.
+    void update(Float threshold, int maxDepth, size_t maxMemory) {
+        size_t used = nodes_.size() * sizeof(Node);
+        for (const auto& dt : dtrees_) {
+            used += dt.building.numNodes() * sizeof(DTreeNode);
+        }
+        const auto available = used < maxMemory ? maxMemory - used : 0;
+        const auto maxNodes = std::max<size_t>(1, available / sizeof(DTreeNode) / dtrees_.size());
+        parallel::foreach(dtrees_.size(), [&](long long i, int) {
+            auto& dt = dtrees_[i];
+            dt.sampling = dt.building;
+            dt.building.refineFrom(dt.sampling, threshold, maxDepth, maxNodes);
+            dt.count = 0;
+        });
+    }
+};
+
+// Vertex of a path recorded for training
+struct GuidedVertex {
+    DTreeWrapper* dtree;    // Distribution associated with the vertex
+    Vec2 dir;               // Sampled direction in the canonical square
+    Float pdf;              // Density of the sampled direction w.r.t. solid angle measure
+    Vec3 throughput;        // Throughput after the vertex
+    Vec3 radiance;          // Incident radiance from the sampled direction
+};
+
+// Compute the bound of the triangles and the shapes in the scene
+Bound sceneBound(const Scene* scene) {
+    Bound bound;
+    scene->traverseNodes([&](const SceneNode& node, Mat4 globalTransform) {
+        if (node.type != SceneNodeType::Primitive || !node.primitive.mesh) {
+            return;
+        }
+        node.primitive.mesh->foreachTriangle([&](int, const Mesh::Tri& tri) {
+            bound = merge(bound, Vec3(globalTransform * Vec4(tri.p1.p, 1_f)));
+            bound = merge(bound, Vec3(globalTransform * Vec4(tri.p2.p, 1_f)));
+            bound = merge(bound, Vec3(globalTransform * Vec4(tri.p3.p, 1_f)));
+        });
+        const Transform transform(globalTransform);
+        node.primitive.mesh->foreachShape([&](int, const Mesh::Shape& shape) {
+            bound = merge(bound, mesh::shapeBound(mesh::transformShape(shape, transform)));
+        });
+    });
+    return bound;
+}
+
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/*
+\rst
+.. function:: renderer::pt::guided
+
+   Path tracing with practical path guiding [Müller2017]_.
+
+   :param str output: Underlying film specified by asset name or locator.
+   :param int max_length: Maximum number of path vertices.
+   :param int seed: Random seed. Optional.
+   :param str scheduler: Scheduler of the final pass, e.g., ``sample`` or ``time``. Default: ``sample``.
+   :param str sampler: Sample generator of the final pass. Optional.
+   :param int spp: Samples per pixel of the final pass with ``sample`` scheduler.
+   :param int training_iterations: Number of training passes. Default: 5.
+   :param float bsdf_fraction: Probability to sample directions from BSDF. Default: 0.5.
+   :param float spatial_threshold: Spatial subdivision threshold :math:`c`. Default: 12000.
+   :param float directional_threshold: Directional subdivision threshold :math:`\rho`. Default: 0.01.
+   :param int max_depth: Maximum depth of the directional trees. Default: 20.
+   :param float max_memory: Memory budget of the trees in megabytes. Default: 256.
+
+   The renderer learns the incident radiance with the SD-tree,
+   a binary tree over the scene bound whose leaves hold quadtrees over the directions.
+   The :math:`k`-th training pass renders :math:`2^k` samples per pixel,
+   records the radiance of the paths, and refines the trees for the next pass.
+   The final pass is dispatched by the scheduler with the learned distribution,
+   e.g., ``spp`` samples per pixel, or for ``render_time`` seconds with ``time`` scheduler.
+   On non-specular surfaces the direction is sampled from a mixture of
+   BSDF sampling and the learned distribution (one-sample MIS),
+   which is combined with next event estimation by multiple importance sampling.
+
+   The radiance is recorded with atomic updates of the trees, so the threads
+   are not serialized during training. Spatial subdivision stops
+   when the trees reach the memory budget, and the directional trees
+   share the rest of the budget equally.
+   The peak memory of the trees in the last rendering is queried by
+   ``underlyingValue("memory")`` in bytes.
+
+   .. [Müller2017] T. Müller, M. Gross, J. Novák.
+                   Practical Path Guiding for Efficient Light-Transport Simulation.
+                   Computer Graphics Forum. 36(4):91--100. 2017.
+\endrst
+*/
+class Renderer_PT_Guided final : public Renderer {
+private:
+    Film* film_;
+    int maxLength_;
+    std::optional<unsigned int> seed_;
+    Component::Ptr<scheduler::Scheduler> sched_;
+    Component::Ptr<Sampler> sampler_;
+    int numIterations_;
+    Float bsdfFraction_;
+    Float spatialThreshold_;
+    Float directionalThreshold_;
+    int maxDepth_;
+    long long maxMemory_;   // In bytes
+    mutable long long memory_ = 0;  // Peak memory of the trees in the last rendering
+
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(film_, maxLength_, seed_, sched_, sampler_, numIterations_, bsdfFraction_,
+            spatialThreshold_, directionalThreshold_, maxDepth_, maxMemory_);
+    }
+
+    virtual void foreachUnderlying(const ComponentVisitor& visit) override {
+        comp::visit(visit, film_);
+        comp::visit(visit, sched_);
+        comp::visit(visit, sampler_);
+    }
+
+    virtual Json underlyingValue(const std::string& query) const override {
+        if (query == "memory") {
+            return memory_;
+        }
+        return {};
+    }
+
+public:
+    virtual bool construct(const Json& prop) override {
+        film_ = json::compRef<Film>(prop, "output");
+        maxLength_ = json::value<int>(prop, "max_length");
+        seed_ = json::valueOrNone<unsigned int>(prop, "seed");
+        numIterations_ = json::value<int>(prop, "training_iterations", 5);
+        bsdfFraction_ = json::value<Float>(prop, "bsdf_fraction", .5_f);
+        spatialThreshold_ = json::value<Float>(prop, "spatial_threshold", 12000_f);
+        directionalThreshold_ = json::value<Float>(prop, "directional_threshold", .01_f);
+        maxDepth_ = json::value<int>(prop, "max_depth", 20);
+        maxMemory_ = (long long)(json::value<Float>(prop, "max_memory", 256_f) * 1024 * 1024);
+        if (bsdfFraction_ < 0_f || bsdfFraction_ > 1_f) {
+            LM_ERROR("bsdf_fraction must be in [0,1] [bsdf_fraction={}]", bsdfFraction_);
+            return false;
+        }
+        sched_ = comp::create<scheduler::Scheduler>(
+            "scheduler::spp::" + json::value<std::string>(prop, "scheduler", "sample"), makeLoc("scheduler"), prop);
+        if (!sched_) {
+            return false;
+        }
+        if (const auto samplerName = json::valueOrNone<std::string>(prop, "sampler")) {
+            sampler_ = comp::create<Sampler>("sampler::" + *samplerName, makeLoc("sampler"), prop);
+            if (!sampler_) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    virtual void continueSamples(bool enable) override {
+        sched_->continueSamples(enable);
+    }
+
+    virtual void render(const Scene* scene) const override {
+        film_->clear();
+        const auto size = film_->size();
+        const auto numPixels = film_->numPixels();
+
+        // Spatio-directional tree
+        STree stree(sceneBound(scene));
+        memory_ = (long long)(stree.memory());
+
+        // Pixel window of the primary ray
+        const auto window = [&](long long pixelIndex) -> Vec4 {
+            const int x = int(pixelIndex % size.w);
+            const int y = int(pixelIndex / size.w);
+            const auto dx = 1_f / size.w;
+            const auto dy = 1_f / size.h;
+            return { dx * x, dy * y, dx, dy };
+        };
+
+        // Training passes. The samples are not recorded to the film.
+        {
+            long long total = 0;
+            for (int i = 0; i < numIterations_; i++) {
+                total += numPixels << i;
+            }
+            progress::ScopedReport progress_(total);
+            long long processed = 0;
+            scheduler::ThreadRngs rngs(seed_);
+            for (int iteration = 0; iteration < numIterations_; iteration++) {
+                const long long spp = 1LL << iteration;
+                parallel::foreach(numPixels * spp, [&](long long index, int threadid) {
+                    samplePath(scene, stree, rngs[threadid], window(index / spp), true);
+                }, [&](long long p) {
+                    progress::update(processed + p);
+                });
+                processed += numPixels * spp;
+                if (parallel::cancelRequested()) {
+                    return;
+                }
+
+                // Refine the trees for the next iteration
+                stree.refine(spatialThreshold_ * std::sqrt(Float(spp)), size_t(maxMemory_));
+                stree.update(directionalThreshold_, maxDepth_, size_t(maxMemory_));
+                memory_ = std::max(memory_, (long long)(stree.memory()));
+                LM_INFO("Training iteration {} [spp={}, nodes={}, memory={:.1f}MB]",
+                    iteration, spp, stree.numNodes(), stree.memory() / (1024.0 * 1024.0));
+            }
+        }
+
+        // Final pass with the learned distribution
+        scheduler::ThreadRngs rngs(seed_, sched_.get());
+        const auto processed = sched_->run([&](long long pixelIndex, long long sampleIndex, int threadid) {
+            auto& rng = rngs[threadid];
+            rng.attach(sampler_.get(), int(pixelIndex % size.w), int(pixelIndex / size.w), sampleIndex);
+            samplePath(scene, stree, rng, window(pixelIndex), false);
+        });
+        if (processed > 0) {
+            film_->rescale(1_f / processed);
+        }
+    }
+
+private:
+    // Sample a path from the pixel window and accumulate the contribution to the film.
+    // In training passes, the incident radiance at the vertices is recorded to the trees instead.
+    void samplePath(const Scene* scene, STree& stree, Rng& rng, Vec4 window, bool training) const {
+        // Vertices of the current path used for training
+        thread_local std::vector<GuidedVertex> vertices;
+        vertices.clear();
+
+        // Add contribution of a path. The first numVertices vertices receive the radiance.
+        Vec2 rasterPos{};
+        const auto addContrb = [&](Vec3 C, size_t numVertices) {
+            if (!training) {
+                film_->splat(rasterPos, C);
+                return;
+            }
+            for (size_t i = 0; i < numVertices; i++) {
+                auto& v = vertices[i];
+                for (int c = 0; c < 3; c++) {
+                    if (v.throughput[c] > 0_f) {
+                        v.radiance[c] += C[c] / v.throughput[c];
+                    }
+                }
+            }
+        };
+
+        // Path throughput
+        Vec3 throughput(1_f);
+
+        // Incident direction and current surface point
+        Vec3 wi = {};
+        auto sp = SceneInteraction::makeCameraTerminator(window, film_->aspectRatio());
+
+        // Perform random walk
+        for (int length = 0; length < maxLength_; length++) {
+            // Sample BSDF. This also selects the component.
+            const auto sB = scene->sampleRay(rng, sp, wi);
+            if (!sB || math::isZero(sB->weight)) {
+                break;
+            }
+
+            // Distribution of the incident radiance.
+            // Guiding is used only if the distribution is learned.
+            const bool specular = scene->isSpecular(sB->sp);
+            DTreeWrapper* dtree = length > 0 && !specular ? &stree.lookup(sp.geom.p) : nullptr;
+            const bool guided = dtree && dtree->sampling.total() > 0_f;
+            const auto pdfGuide = [&](Vec3 wo) -> Float {
+                // Density w.r.t. projected solid angle measure
+                const auto cos = std::abs(glm::dot(sB->sp.geom.n, wo));
+                return cos > 0_f ? dtree->sampling.pdf(dirToCanonical(wo)) / (4_f * Pi * cos) : 0_f;
+            };
+
+            // Density of the direction sampling w.r.t. projected solid angle measure
+            const auto pdfDir = [&](Vec3 wo) -> Float {
+                const auto pB = scene->pdf(sB->sp, wi, wo);
+                if (!guided) {
+                    return pB;
+                }
+                return bsdfFraction_ * pB + (1_f - bsdfFraction_) * pdfGuide(wo);
+            };
+
+            // Sample a direction with the mixture of BSDF and the learned distribution
+            const auto s = [&]() -> std::optional<RaySample> {
+                if (!guided) {
+                    return sB;
+                }
+                const auto wo = rng.u() < bsdfFraction_ ? sB->wo : canonicalToDir(dtree->sampling.sample(rng));
+                const auto pdf = pdfDir(wo);
+                if (pdf <= 0_f) {
+                    return {};
+                }
+                const auto f = scene->evalContrb(sB->sp, wi, wo);
+                return RaySample{ sB->sp, wo, f / (scene->pdfComp(sB->sp, wi) * pdf) };
+            }();
+            if (!s || math::isZero(s->weight)) {
+                break;
+            }
+
+            // Compute raster position for the primary ray
+            if (length == 0) {
+                rasterPos = *scene->rasterPosition(s->wo, film_->aspectRatio());
+            }
+
+            // ------------------------------------------------------------------------------------
+
+            // Next event estimation
+            const bool nee = length > 0 && !specular;
+            if (nee) [&] {
+                const auto sL = scene->sampleLight(rng, s->sp);
+                if (!sL) {
+                    return;
+                }
+                if (!scene->visible(s->sp, sL->sp)) {
+                    return;
+                }
+                const bool directL = !scene->isSpecular(sL->sp) && !sL->sp.geom.degenerated;
+                const auto wo = -sL->wo;
+                const auto fs = scene->evalContrb(s->sp, wi, wo);
+                const auto pdfSel = scene->pdfComp(s->sp, wi);
+                const auto misw = directL
+                    ? math::balanceHeuristic(scene->pdfLight(s->sp, sL->sp, sL->wo), pdfDir(wo))
+                    : 1_f;
+                const auto C = throughput / pdfSel * fs * sL->weight * misw;
+
+                // The light is not in the sampled direction of the current vertex
+                addContrb(C, vertices.size());
+            }();
+
+            // ------------------------------------------------------------------------------------
+
+            // Record the vertex
+            const auto pdfDirCurr = nee ? pdfDir(s->wo) : 0_f;
+            if (training && dtree) {
+                const auto cos = std::abs(glm::dot(s->sp.geom.n, s->wo));
+                vertices.push_back({
+                    dtree,
+                    dirToCanonical(s->wo),
+                    pdfDirCurr * cos,
+                    throughput * s->weight,
+                    Vec3(0_f)
+                });
+            }
+
+            // Intersection to next surface
+            const auto hit = scene->intersect(s->ray());
+            if (!hit) {
+                break;
+            }
+
+            // Update throughput
+            throughput *= s->weight;
+
+            // Accumulate contribution from light
+            if (scene->isLight(*hit)) {
+                const auto woL = -s->wo;
+                const auto fs = scene->evalContrbEndpoint(*hit, woL);
+                const auto misw = nee
+                    ? math::balanceHeuristic(pdfDirCurr, scene->pdfLight(s->sp, *hit, woL))
+                    : 1_f;
+                addContrb(throughput * fs * misw, vertices.size());
+            }
+
+            // Russian roulette
+            if (length > 3) {
+                const auto q = glm::max(.2_f, 1_f - glm::compMax(throughput));
+                if (rng.u() < q) {
+                    break;
+                }
+                throughput /= 1_f - q;
+            }
+
+            // Update
+            wi = -s->wo;
+            sp = *hit;
+        }
+
+        // Record the incident radiance to the trees.
+        // The energy is the radiance divided by the density,
+        // i.e., the estimate of the integral of the radiance over the directions.
+        for (const auto& v : vertices) {
+            if (v.pdf > 0_f) {
+                v.dtree->building.record(v.dir, glm::compAdd(v.radiance) / 3_f / v.pdf);
+            }
+            v.dtree->count++;
+        }
+    }
+};
+
+LM_COMP_REG_IMPL(Renderer_PT_Guided, "renderer::pt::guided");
+
+LM_NAMESPACE_END(LM_NAMESPACE)
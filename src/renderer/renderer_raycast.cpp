@@ -58,8 +58,10 @@ public:
         sched_->run([&](long long index, long long, int) {
             const int x = int(index % size.w);
             const int y = int(index / size.w);
-            const auto ray = scene->primaryRay({(x+.5_f)/size.w, (y+.5_f)/size.h}, film_->aspectRatio());
-            const auto sp = scene->intersect(ray);
+            const auto rp = Vec2((x+.5_f)/size.w, (y+.5_f)/size.h);
+            const auto ray = scene->primaryRay(rp, film_->aspectRatio());
+            const auto rd = scene->primaryRayDifferential(rp, Vec2(1_f/size.w, 1_f/size.h), film_->aspectRatio());
+            const auto sp = rd ? scene->intersect(ray, *rd) : scene->intersect(ray);
             if (!sp) {
                 film_->setPixel(x, y, bgColor_);
                 return;
@@ -9,6 +9,8 @@
 #include <lm/scene.h>
 #include <lm/film.h>
 #include <lm/scheduler.h>
+#include <lm/parallel.h>
+#include <lm/sampler.h>
 
 #define VOLPT_DEBUG_VIS 0
 #define VOLPT_IMAGE_SAMPLNG 0
@@ -22,6 +24,7 @@ private:
     Float rrProb_;
     std::optional<unsigned int> seed_;
     Component::Ptr<scheduler::Scheduler> sched_;
+    Component::Ptr<Sampler> sampler_;
 
     #if VOLPT_DEBUG_VIS
     mutable std::vector<Ray> sampledRays_;
@@ -29,7 +32,7 @@ private:
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(film_, maxLength_, rrProb_, sched_);
+        ar(film_, maxLength_, rrProb_, sched_, sampler_);
         #if VOLPT_DEBUG_VIS
         ar(sampledRays_);
         #endif
@@ -38,6 +41,7 @@ public:
     virtual void foreachUnderlying(const ComponentVisitor& visit) override {
         comp::visit(visit, film_);
         comp::visit(visit, sched_);
+        comp::visit(visit, sampler_);
     }
 
     #if VOLPT_DEBUG_VIS
@@ -63,15 +67,34 @@ public:
         sched_ = comp::create<scheduler::Scheduler>(
             "scheduler::spp::" + schedName, makeLoc("scheduler"), prop);
 #endif
+
+        // Sample generator. Use the pseudo random number generator if not specified.
+        if (const auto samplerName = json::valueOrNone<std::string>(prop, "sampler")) {
+            sampler_ = comp::create<Sampler>("sampler::" + *samplerName, makeLoc("sampler"), prop);
+            if (!sampler_) {
+                return false;
+            }
+#if VOLPT_IMAGE_SAMPLNG
+            // The sample generators are indexed by pixels, which are not known
+            // before the primary ray is sampled in the image sample mode.
+            LM_ERROR("Sample generator is not supported in the image sample mode");
+            return false;
+#endif
+        }
         return true;
     }
 
+    virtual void continueSamples(bool enable) override {
+        sched_->continueSamples(enable);
+    }
+
     virtual void render(const Scene* scene) const override {
         film_->clear();
         const auto size = film_->size();
-        const auto processed = sched_->run([&](long long pixelIndex, long long, int threadid) {
-            // Per-thread random number generator
-            thread_local Rng rng(seed_ ? *seed_ + threadid : math::rngSeed());
+        scheduler::ThreadRngs rngs(seed_, sched_.get());
+        const auto processed = sched_->run([&](long long pixelIndex, long long sampleIndex, int threadid) {
+            auto& rng = rngs[threadid];
+            rng.attach(sampler_.get(), int(pixelIndex % size.w), int(pixelIndex / size.w), sampleIndex);
 
 #if VOLPT_IMAGE_SAMPLNG
             LM_UNUSED(pixelIndex);
@@ -183,11 +206,13 @@ public:
             }
         });
 
+        if (processed > 0) {
 #if VOLPT_IMAGE_SAMPLNG
-        film_->rescale(Float(size.w* size.h) / processed);
+            film_->rescale(Float(size.w* size.h) / processed);
 #else
-        film_->rescale(1_f / processed);
+            film_->rescale(1_f / processed);
 #endif
+        }
     }
 };
 
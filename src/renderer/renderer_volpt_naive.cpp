@@ -9,7 +9,8 @@
 #include <lm/scene.h>
 #include <lm/film.h>
 #include <lm/scheduler.h>
-#include <lm/debug.h>
+#include <lm/parallel.h>
+#include <lm/sampler.h>
 
 #define VOLPT_IMAGE_SAMPLNG 0
 
@@ -22,15 +23,17 @@ private:
     Float rrProb_;
     std::optional<unsigned int> seed_;
     Component::Ptr<scheduler::Scheduler> sched_;
+    Component::Ptr<Sampler> sampler_;
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(film_, maxLength_, rrProb_, sched_);
+        ar(film_, maxLength_, rrProb_, sched_, sampler_);
     }
 
     virtual void foreachUnderlying(const ComponentVisitor& visit) override {
         comp::visit(visit, film_);
         comp::visit(visit, sched_);
+        comp::visit(visit, sampler_);
     }
 
 public:
@@ -47,15 +50,34 @@ public:
         sched_ = comp::create<scheduler::Scheduler>(
             "scheduler::spp::" + schedName, makeLoc("scheduler"), prop);
 #endif
+
+        // Sample generator. Use the pseudo random number generator if not specified.
+        if (const auto samplerName = json::valueOrNone<std::string>(prop, "sampler")) {
+            sampler_ = comp::create<Sampler>("sampler::" + *samplerName, makeLoc("sampler"), prop);
+            if (!sampler_) {
+                return false;
+            }
+#if VOLPT_IMAGE_SAMPLNG
+            // The sample generators are indexed by pixels, which are not known
+            // before the primary ray is sampled in the image sample mode.
+            LM_ERROR("Sample generator is not supported in the image sample mode");
+            return false;
+#endif
+        }
         return true;
     }
 
+    virtual void continueSamples(bool enable) override {
+        sched_->continueSamples(enable);
+    }
+
     virtual void render(const Scene* scene) const override {
         film_->clear();
         const auto size = film_->size();
-        const auto processed = sched_->run([&](long long pixelIndex, long long, int threadid) {
-            // Per-thread random number generator
-            thread_local Rng rng(seed_ ? *seed_ + threadid : math::rngSeed());
+        scheduler::ThreadRngs rngs(seed_, sched_.get());
+        const auto processed = sched_->run([&](long long pixelIndex, long long sampleIndex, int threadid) {
+            auto& rng = rngs[threadid];
+            rng.attach(sampler_.get(), int(pixelIndex % size.w), int(pixelIndex / size.w), sampleIndex);
 
 #if VOLPT_IMAGE_SAMPLNG
             LM_UNUSED(pixelIndex);
@@ -69,26 +91,22 @@ public:
             const Vec4 window(dx * x, dy * y, dx, dy);
 #endif
 
+            // Incident ray direction
+            Vec3 wi{};
+
+            // Current scene interaction.
+            // Primary ray is sampled from the camera terminator.
+            auto sp = SceneInteraction::makeCameraTerminator(window, film_->aspectRatio());
+
             // Path throughput
             Vec3 throughput(1_f);
 
-            // Initial sampleRay function
-            std::function<std::optional<RaySample>()> sampleRay = [&]() {
-                return scene->samplePrimaryRay(rng, window, film_->aspectRatio());
-            };
-
             // Perform random walk
             Vec3 L(0_f);
             Vec2 rasterPos{};
             for (int length = 0; length < maxLength_; length++) {
-                #if LM_DEBUG_MODE
-                if (x == 70 && y == 16) {
-                    __debugbreak();
-                }
-                #endif
-
                 // Sample a ray
-                const auto s = sampleRay();
+                const auto s = scene->sampleRay(rng, sp, wi);
                 if (!s || math::isZero(s->weight)) {
                     break;
                 }
@@ -107,10 +125,6 @@ public:
                 // Update throughput
                 throughput *= s->weight * sd->weight;
 
-                if (x == 70 && y == 16) {
-                    debug::pollFloat("throughput", glm::compMax(throughput));
-                }
-
                 // Accumulate contribution from emissive interaction
                 if (scene->isLight(sd->sp)) {
                     const auto C = throughput * scene->evalContrbEndpoint(sd->sp, -s->wo);
@@ -127,20 +141,21 @@ public:
                 }
 
                 // Update
-                sampleRay = [scene, wi = -s->wo, sp = sd->sp]() {
-                    return scene->sampleRay(rng, sp, wi);
-                };
+                wi = -s->wo;
+                sp = sd->sp;
             }
 
             // Accumulate contribution
             film_->splat(rasterPos, L);
         });
 
+        if (processed > 0) {
 #if VOLPT_IMAGE_SAMPLNG
-        film_->rescale(Float(size.w * size.h) / processed);
+            film_->rescale(Float(size.w * size.h) / processed);
 #else
-        film_->rescale(1_f / processed);
+            film_->rescale(1_f / processed);
 #endif
+        }
     }
 };
 
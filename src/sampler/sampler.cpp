@@ -0,0 +1,319 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include <lm/sampler.h>
+#include <lm/json.h>
+#include <lm/serial.h>
+#include <lm/logger.h>
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE)
+
+LM_NAMESPACE_BEGIN(detail)
+
+LM_PUBLIC_API double samplerU(const Sampler* sampler, int x, int y, long long sampleIndex, int dim) {
+    return double(sampler->u(x, y, sampleIndex, dim));
+}
+
+LM_NAMESPACE_END(detail)
+
+// ------------------------------------------------------------------------------------------------
+
+namespace {
+
+// Integer hash function (lowbias32) [Wellons 2018]
+std::uint32_t mix(std::uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+// Combine a value to the hash
+std::uint32_t hash(std::uint32_t h, std::uint32_t v) {
+    return mix(h ^ (v + 0x9e3779b9U + (h << 6) + (h >> 2)));
+}
+
+std::uint32_t hash(std::uint32_t h, long long v) {
+    const auto u = static_cast<unsigned long long>(v);
+    return hash(hash(h, std::uint32_t(u)), std::uint32_t(u >> 32));
+}
+
+// Convert 32-bit fixed point value to [0,1)
+Float toUnit(std::uint32_t v) {
+    return glm::min(Float(v * (1.0 / 4294967296.0)), Float(0x1.fffffep-1));
+}
+
+std::uint32_t reverseBits(std::uint32_t x) {
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffU) << 8) | ((x & 0xff00ff00U) >> 8);
+    x = ((x & 0x0f0f0f0fU) << 4) | ((x & 0xf0f0f0f0U) >> 4);
+    x = ((x & 0x33333333U) << 2) | ((x & 0xccccccccU) >> 2);
+    x = ((x & 0x55555555U) << 1) | ((x & 0xaaaaaaaaU) >> 1);
+    return x;
+}
+
+// Hash-based nested uniform scrambling [Burley 2020]
+std::uint32_t nestedUniformScramble(std::uint32_t x, std::uint32_t seed) {
+    x = reverseBits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cU;
+    x ^= x * 0xb82f1e52U;
+    x ^= x * 0xc7afe638U;
+    x ^= x * 0x8d22f6e6U;
+    return reverseBits(x);
+}
+
+// First two dimensions of Sobol sequence.
+// The second dimension uses the direction numbers v_i given by v_{i+1} = v_i ^ (v_i >> 1).
+std::uint32_t sobol2D(std::uint32_t index, int dim) {
+    if (dim == 0) {
+        return reverseBits(index);
+    }
+    std::uint32_t v = 1U << 31;
+    std::uint32_t result = 0;
+    for (; index; index >>= 1, v ^= v >> 1) {
+        if (index & 1) {
+            result ^= v;
+        }
+    }
+    return result;
+}
+
+// Padded Owen-scrambled Sobol sequence.
+// The dimensions are grouped by pairs, each of which is
+// a shuffled and scrambled 2d Sobol sequence with independent seeds.
+Float owenSobol(std::uint32_t seed, long long sampleIndex, int dim) {
+    const auto pairSeed = hash(seed, std::uint32_t(dim / 2));
+    const auto index = nestedUniformScramble(std::uint32_t(sampleIndex), pairSeed);
+    const auto v = sobol2D(index, dim % 2);
+    return toUnit(nestedUniformScramble(v, hash(pairSeed, std::uint32_t(dim % 2))));
+}
+
+// Random permutation of [0,n) [Kensler 2013]
+std::uint32_t permute(std::uint32_t i, std::uint32_t n, std::uint32_t p) {
+    auto w = n - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do {
+        i ^= p; i *= 0xe170893dU;
+        i ^= p >> 16;
+        i ^= (i & w) >> 4;
+        i ^= p >> 8; i *= 0x0929eb3fU;
+        i ^= p >> 23;
+        i ^= (i & w) >> 1; i *= 1 | p >> 27;
+        i *= 0x6935fa69U;
+        i ^= (i & w) >> 11; i *= 0x74dcb303U;
+        i ^= (i & w) >> 2; i *= 0x9e501cc3U;
+        i ^= (i & w) >> 2; i *= 0xc860a3dfU;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= n);
+    return (i + p) % n;
+}
+
+}
+
+// ------------------------------------------------------------------------------------------------
+
+// Independent samples.
+// The samples are generated by hashing the index of the sample,
+// so the result does not depend on the order of the evaluation.
+class Sampler_Independent final : public Sampler {
+private:
+    std::uint32_t seed_;
+
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(seed_);
+    }
+
+public:
+    virtual bool construct(const Json& prop) override {
+        seed_ = json::value<unsigned int>(prop, "seed", 0);
+        return true;
+    }
+
+    virtual Float u(int x, int y, long long sampleIndex, int dim) const override {
+        auto h = hash(seed_, std::uint32_t(x));
+        h = hash(h, std::uint32_t(y));
+        h = hash(h, sampleIndex);
+        return toUnit(hash(h, std::uint32_t(dim)));
+    }
+};
+
+LM_COMP_REG_IMPL(Sampler_Independent, "sampler::independent");
+
+// ------------------------------------------------------------------------------------------------
+
+// Stratified samples.
+// Each dimension is divided into spp strata and the samples of a pixel are
+// assigned to the strata with a random permutation independent for each dimension.
+// The samples beyond spp start a new set of strata.
+class Sampler_Stratified final : public Sampler {
+private:
+    std::uint32_t seed_;
+    std::uint32_t strata_;
+
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(seed_, strata_);
+    }
+
+public:
+    virtual bool construct(const Json& prop) override {
+        seed_ = json::value<unsigned int>(prop, "seed", 0);
+        const auto spp = json::valueOrNone<long long>(prop, "spp");
+        if (!spp) {
+            LM_ERROR("Stratified sampler requires 'spp'");
+            return false;
+        }
+        if (*spp <= 0 || *spp > std::numeric_limits<std::uint32_t>::max()) {
+            LM_ERROR("Invalid number of strata [spp='{}']", *spp);
+            return false;
+        }
+        strata_ = std::uint32_t(*spp);
+        return true;
+    }
+
+    virtual Float u(int x, int y, long long sampleIndex, int dim) const override {
+        auto h = hash(seed_, std::uint32_t(x));
+        h = hash(h, std::uint32_t(y));
+        h = hash(h, std::uint32_t(dim));
+        h = hash(h, sampleIndex / strata_);
+        const auto stratum = permute(std::uint32_t(sampleIndex % strata_), strata_, h);
+        const auto jitter = toUnit(hash(h, sampleIndex));
+        return glm::min((Float(stratum) + jitter) / Float(strata_), Float(0x1.fffffep-1));
+    }
+};
+
+LM_COMP_REG_IMPL(Sampler_Stratified, "sampler::stratified");
+
+// ------------------------------------------------------------------------------------------------
+
+// Owen-scrambled Sobol sequence [Burley 2020].
+// The sequences are scrambled independently for each pixel.
+class Sampler_Sobol final : public Sampler {
+private:
+    std::uint32_t seed_;
+
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(seed_);
+    }
+
+public:
+    virtual bool construct(const Json& prop) override {
+        seed_ = json::value<unsigned int>(prop, "seed", 0);
+        return true;
+    }
+
+    virtual Float u(int x, int y, long long sampleIndex, int dim) const override {
+        const auto h = hash(hash(seed_, std::uint32_t(x)), std::uint32_t(y));
+        return owenSobol(h, sampleIndex, dim);
+    }
+};
+
+LM_COMP_REG_IMPL(Sampler_Sobol, "sampler::sobol");
+
+// ------------------------------------------------------------------------------------------------
+
+/*
+    Blue-noise permuted Owen-scrambled Sobol sequence.
+    - The pixels share the same sequence and each pixel shifts the sequence
+      toroidally by the value of a blue-noise mask [Georgiev & Fajardo 2016],
+      which distributes the error as blue noise in the screen space.
+    - The mask is tiled over the image and shifted randomly for each dimension.
+    - The mask is generated on construction by the void filling step
+      of the void-and-cluster method [Ulichney 1993], that is,
+      the pixels are ranked by inserting a point into the largest void one by one.
+*/
+class Sampler_BlueNoise final : public Sampler {
+private:
+    std::uint32_t seed_;
+    int size_;                  // Size of the tile
+    std::vector<Float> mask_;   // Blue-noise mask with the values in [0,1)
+
+public:
+    LM_SERIALIZE_IMPL(ar) {
+        ar(seed_, size_, mask_);
+    }
+
+public:
+    virtual bool construct(const Json& prop) override {
+        seed_ = json::value<unsigned int>(prop, "seed", 0);
+        size_ = json::value<int>(prop, "tile_size", 64);
+        if (size_ <= 0) {
+            LM_ERROR("Invalid tile size [tile_size='{}']", size_);
+            return false;
+        }
+        generateMask();
+        return true;
+    }
+
+    virtual Float u(int x, int y, long long sampleIndex, int dim) const override {
+        // Toroidal shift of the mask for the dimension
+        const auto h = hash(seed_, std::uint32_t(dim));
+        const auto mx = (std::uint32_t(x) + hash(h, 0U)) % std::uint32_t(size_);
+        const auto my = (std::uint32_t(y) + hash(h, 1U)) % std::uint32_t(size_);
+        const auto offset = mask_[my * size_ + mx];
+
+        // Cranley-Patterson rotation of the shared sequence
+        const auto v = owenSobol(seed_, sampleIndex, dim) + offset;
+        return glm::min(v < 1_f ? v : v - 1_f, Float(0x1.fffffep-1));
+    }
+
+private:
+    void generateMask() {
+        const int n = size_ * size_;
+
+        // Toroidal Gaussian kernel
+        constexpr Float Sigma = 1.5_f;
+        std::vector<Float> kernel(n);
+        for (int dy = 0; dy < size_; dy++) {
+            for (int dx = 0; dx < size_; dx++) {
+                const auto tx = Float(std::min(dx, size_ - dx));
+                const auto ty = Float(std::min(dy, size_ - dy));
+                kernel[dy * size_ + dx] = std::exp(-(tx*tx + ty*ty) / (2_f * Sigma * Sigma));
+            }
+        }
+
+        // Insert points to the largest void one by one
+        std::vector<Float> energy(n, 0_f);
+        std::vector<bool> filled(n, false);
+        mask_.assign(n, 0_f);
+        int next = int(mix(seed_) % std::uint32_t(n));
+        for (int rank = 0; rank < n; rank++) {
+            if (rank > 0) {
+                next = -1;
+                for (int i = 0; i < n; i++) {
+                    if (!filled[i] && (next < 0 || energy[i] < energy[next])) {
+                        next = i;
+                    }
+                }
+            }
+            filled[next] = true;
+            mask_[next] = (Float(rank) + .5_f) / Float(n);
+            const int px = next % size_;
+            const int py = next / size_;
+            for (int y = 0; y < size_; y++) {
+                for (int x = 0; x < size_; x++) {
+                    const int dx = (x - px + size_) % size_;
+                    const int dy = (y - py + size_) % size_;
+                    energy[y * size_ + x] += kernel[dy * size_ + dx];
+                }
+            }
+        }
+    }
+};
+
+LM_COMP_REG_IMPL(Sampler_BlueNoise, "sampler::bluenoise");
+
+LM_NAMESPACE_END(LM_NAMESPACE)
@@ -28,6 +28,17 @@ struct LightPrimitiveIndex {
     }
 };
 
+struct MediumRegion {
+    Bound bound;    // Bound of the region occupied by the medium
+    int index;      // Primitive node index
+    bool chromatic; // True if the medium is chromatic
+
+    template <typename Archive>
+    void serialize(Archive& ar) {
+        ar(bound, index, chromatic);
+    }
+};
+
 class Scene_ final : public Scene {
 private:
     std::vector<SceneNode> nodes_;                  // Scene nodes
@@ -36,7 +47,13 @@ private:
     std::vector<LightPrimitiveIndex> lights_;       // Primitive node indices of lights and global transforms
     std::unordered_map<int, int> lightIndicesMap_;  // Map from node indices to light indices.
     std::optional<int> envLight_;                   // Environment light index
-    std::optional<int> medium_;                     // Medium index
+    std::vector<int> mediumNodes_;                  // Primitive node indices of media
+    std::vector<MediumRegion> media_;               // Regions of the media updated in build()
+    Bound mediaBound_;                              // Bound of all media
+    bool mediaChromatic_ = false;                   // True if any of the media is chromatic
+    std::string accelName_;                         // Name of the built acceleration structure
+    std::string accelProp_;                         // Serialized property of the acceleration structure
+    std::optional<std::uint64_t> accelHash_;        // Content hash of the scene used to build the acceleration structure if cached
 
 public:
     Scene_() {
@@ -46,7 +63,7 @@ public:
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(nodes_, accel_, camera_, lights_, lightIndicesMap_, envLight_);
+        ar(nodes_, accel_, camera_, lights_, lightIndicesMap_, envLight_, mediumNodes_, media_, mediaBound_, mediaChromatic_, accelName_, accelProp_, accelHash_);
     }
 
     virtual void foreachUnderlying(const ComponentVisitor& visit) override {
@@ -142,8 +159,7 @@ public:
 
             // Medium
             if (medium) {
-                // For now, consider the medium as global asset.
-                medium_ = index;
+                mediumNodes_.push_back(index);
             }
 
             // Create primitive node
@@ -250,6 +266,35 @@ public:
             }
         });
 
+        // Update the regions of the media.
+        // The distance sampling and transmittance evaluation skip
+        // the media whose bounds do not overlap with the ray.
+        media_.clear();
+        mediaBound_ = {};
+        mediaChromatic_ = false;
+        for (int index : mediumNodes_) {
+            const auto* medium = nodes_.at(index).primitive.medium;
+            const auto bound = medium->bound();
+            const auto chromatic = medium->chromatic();
+            media_.push_back({ bound, index, chromatic });
+            mediaBound_ = merge(mediaBound_, bound);
+            mediaChromatic_ |= chromatic;
+        }
+
+        // Reuse the acceleration structure if it is built (or deserialized)
+        // with the same configuration from the scene with the same content.
+        // The content hash is computed only if the cache is enabled
+        // because it visits all triangles in the scene.
+        const auto propStr = prop.dump();
+        std::optional<std::uint64_t> hash;
+        if (json::value<bool>(prop, "cache", false)) {
+            hash = contentHash();
+            if (accel_ && accelName_ == name && accelProp_ == propStr && accelHash_ == hash) {
+                LM_INFO("Reusing acceleration structure [name='{}']", name);
+                return;
+            }
+        }
+
         // Build acceleration structure
         accel_ = comp::create<Accel>(name, makeLoc(loc(), "accel"), prop);
         if (!accel_) {
@@ -258,9 +303,145 @@ public:
         LM_INFO("Building acceleration structure [name='{}']", name);
         LM_INDENT();
         accel_->build(*this);
+        accelName_ = name;
+        accelProp_ = propStr;
+        accelHash_ = hash;
+    }
+
+private:
+    // Compute FNV-1a hash of the scene content relevant to the acceleration structure,
+    // i.e., the structure of the scene graph, transformations, and triangles of the meshes.
+    std::uint64_t contentHash() const {
+        std::uint64_t h = 14695981039346656037ULL;
+        const auto hashBytes = [&](const void* data, size_t size) {
+            const auto* p = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++) {
+                h = (h ^ p[i]) * 1099511628211ULL;
+            }
+        };
+        for (const auto& node : nodes_) {
+            hashBytes(&node.type, sizeof(node.type));
+            if (node.type == SceneNodeType::Primitive) {
+                const auto* mesh = node.primitive.mesh;
+                if (!mesh) {
+                    continue;
+                }
+                hashBytes(mesh->loc().data(), mesh->loc().size());
+                mesh->foreachTriangle([&](int, const Mesh::Tri& tri) {
+                    hashBytes(&tri.p1.p, sizeof(Vec3));
+                    hashBytes(&tri.p2.p, sizeof(Vec3));
+                    hashBytes(&tri.p3.p, sizeof(Vec3));
+                });
+                mesh->foreachShape([&](int, const Mesh::Shape& shape) {
+                    hashBytes(&shape.p1, sizeof(Vec3));
+                    hashBytes(&shape.p2, sizeof(Vec3));
+                    hashBytes(&shape.r, sizeof(Float));
+                });
+            }
+            else if (node.type == SceneNodeType::Group) {
+                hashBytes(node.group.children.data(), sizeof(int) * node.group.children.size());
+                hashBytes(&node.group.instanced, sizeof(bool));
+                if (node.group.localTransform) {
+                    hashBytes(&*node.group.localTransform, sizeof(Mat4));
+                }
+            }
+        }
+        return h;
+    }
+
+    // Distance sampling for the scenes containing chromatic media.
+    // The weight of the surface interaction sampled by a chromatic medium is not one,
+    // so the distance sampling is not consistent with respect to tmax.
+    // We thus find the closest surface first and sample the distance up to the surface.
+    // If the ray overlaps with multiple media, we select one of them uniformly
+    // and account for the others with the transmittance.
+    std::optional<DistanceSample> sampleDistanceChromatic(Rng& rng, Ray ray) const {
+        const auto hit = intersect(ray, Eps, Inf);
+        const auto dist = hit && !hit->geom.infinite ? glm::distance(ray.o, hit->geom.p) : Inf;
+
+        // Count the media overlapping with the ray segment
+        int n = 0;
+        for (const auto& region : media_) {
+            if (region.bound.isect(ray, 0_f, dist)) {
+                n++;
+            }
+        }
+        if (n == 0) {
+            if (!hit) {
+                return {};
+            }
+            return DistanceSample{ *hit, Vec3(1_f) };
+        }
+
+        // Select a medium uniformly
+        const int selected = glm::min(int(rng.u() * n), n - 1);
+        const MediumRegion* selectedRegion = nullptr;
+        int i = 0;
+        for (const auto& region : media_) {
+            if (!region.bound.isect(ray, 0_f, dist)) {
+                continue;
+            }
+            if (i++ == selected) {
+                selectedRegion = &region;
+                break;
+            }
+        }
+
+        // Sample a distance in the selected medium
+        const auto* medium = nodes_.at(selectedRegion->index).primitive.medium;
+        const auto ds = medium->sampleDistance(rng, ray, 0_f, dist);
+        const bool mediumEvent = ds && ds->medium;
+        const auto t = mediumEvent ? glm::distance(ray.o, ds->p) : dist;
+
+        // Transmittance of the other media up to the sampled point
+        Vec3 Tr(1_f);
+        for (const auto& region : media_) {
+            if (&region == selectedRegion || !region.bound.isect(ray, 0_f, t)) {
+                continue;
+            }
+            const auto TrM = nodes_.at(region.index).primitive.medium->evalTransmittance(rng, ray, 0_f, t);
+            if (!TrM) {
+                return {};
+            }
+            Tr *= *TrM;
+        }
+
+        if (mediumEvent) {
+            // Medium interaction
+            return DistanceSample{
+                SceneInteraction::makeMediumInteraction(
+                    selectedRegion->index,
+                    0,
+                    PointGeometry::makeDegenerated(ds->p)
+                ),
+                ds->weight * Tr * Float(n)
+            };
+        }
+
+        // Surface interaction
+        if (!hit) {
+            return {};
+        }
+        return DistanceSample{ *hit, (ds ? ds->weight : Vec3(1_f)) * Tr };
     }
 
+public:
+
     virtual std::optional<SceneInteraction> intersect(Ray ray, Float tmin, Float tmax) const override {
+        return intersectWith(ray, nullptr, tmin, tmax);
+    }
+
+    virtual std::optional<SceneInteraction> intersect(Ray ray, const RayDifferential& rd, Float tmin, Float tmax) const override {
+        return intersectWith(ray, &rd, tmin, tmax);
+    }
+
+    virtual bool occluded(Ray ray, Float tmin, Float tmax) const override {
+        return accel_->occluded(ray, tmin, tmax);
+    }
+
+private:
+    // Intersection with optional ray differential
+    std::optional<SceneInteraction> intersectWith(Ray ray, const RayDifferential* rd, Float tmin, Float tmax) const {
         const auto hit = accel_->intersect(ray, tmin, tmax);
         if (!hit) {
             // Use environment light when tmax = Inf
@@ -275,20 +456,112 @@ public:
                 0,
                 PointGeometry::makeInfinite(-ray.d));
         }
-        const auto [t, uv, globalTransform, primitiveIndex, faceIndex] = *hit;
-        const auto& primitive = nodes_.at(primitiveIndex).primitive;
-        const auto p = primitive.mesh->surfacePoint(faceIndex, uv);
-        return SceneInteraction::makeSurfaceInteraction(
-            primitiveIndex,
-            -1,
-            PointGeometry::makeOnSurface(
-                globalTransform.M * Vec4(p.p, 1_f),
-                globalTransform.normalM * p.n,
-                p.t
-            )
+        return resolve(ray, rd, *hit);
+    }
+
+    // Get the camera of the primitive node. Use the camera of the scene if camera < 0.
+    const Camera* cameraAt(int camera) const {
+        return nodes_.at(camera >= 0 ? camera : *camera_).primitive.camera;
+    }
+
+    // Evaluate the surface attributes of the hit point.
+    // The global transform of the primitive is only queried here.
+    SceneInteraction resolve(Ray ray, const RayDifferential* rd, const Accel::Hit& hit) const {
+        const auto& primitive = nodes_.at(hit.primitive).primitive;
+        const auto globalTransform = accel_->instanceTransform(hit.instance);
+        const bool triangle = primitive.mesh->shapeType() == Mesh::ShapeType::Triangle;
+        const auto uv = [&]() -> Vec2 {
+            if (triangle) {
+                return hit.uv;
+            }
+            // Surface coordinates of the analytic shape from the hit point in the local coordinates.
+            // The inverse of the linear part of the affine transform is the transpose of the normal transform,
+            // so the transform is not inverted for each hit.
+            const auto invLinear = glm::transpose(globalTransform.normalM);
+            const auto p = invLinear * (ray.o + ray.d * hit.t - Vec3(globalTransform.M[3]));
+            const auto d = invLinear * ray.d;
+            return mesh::shapeCoordinates(primitive.mesh->shapeAt(hit.face), p, d);
+        }();
+        const auto p = primitive.mesh->surfacePoint(hit.face, uv);
+
+        // The flat curve faces the ray, so the offset across the ribbon is not in the surface coordinates.
+        // The position is given by the hit point not to place it on the center line.
+        const bool flatCurve = primitive.mesh->shapeType() == Mesh::ShapeType::FlatCurve;
+        auto geom = PointGeometry::makeOnSurface(
+            flatCurve ? ray.o + ray.d * hit.t : Vec3(globalTransform.M * Vec4(p.p, 1_f)),
+            globalTransform.normalM * p.n,
+            p.t
         );
+        if (rd && triangle) {
+            std::tie(geom.dtdx, geom.dtdy) = textureDifferentials(
+                ray, *rd, geom.p, primitive.mesh->triangleAt(hit.face), globalTransform);
+        }
+        return SceneInteraction::makeSurfaceInteraction(hit.primitive, -1, geom);
     }
 
+    // Compute differentials of the texture coordinates at the hit point p on the triangle.
+    // The offset rays are intersected with the plane of the triangle [Igehy 1999].
+    // Returns zeros if the differentials are not available.
+    std::pair<Vec2, Vec2> textureDifferentials(Ray ray, const RayDifferential& rd, Vec3 p, const Mesh::Tri& tri, const Transform& transform) const {
+        const std::pair<Vec2, Vec2> none{ Vec2(0_f), Vec2(0_f) };
+
+        // Triangle in world space
+        const auto p1 = Vec3(transform.M * Vec4(tri.p1.p, 1_f));
+        const auto p2 = Vec3(transform.M * Vec4(tri.p2.p, 1_f));
+        const auto p3 = Vec3(transform.M * Vec4(tri.p3.p, 1_f));
+        const auto n = glm::cross(p2 - p1, p3 - p1);
+
+        // Differentials of the hit point
+        const auto dp = [&](Vec3 dod, Vec3 ddd) -> std::optional<Vec3> {
+            const auto o = ray.o + dod;
+            const auto d = ray.d + ddd;
+            const auto dn = glm::dot(n, d);
+            if (dn == 0_f) {
+                return {};
+            }
+            return o + d * (glm::dot(n, p - o) / dn) - p;
+        };
+        const auto dpdx = dp(rd.dodx, rd.dddx);
+        const auto dpdy = dp(rd.dody, rd.dddy);
+        if (!dpdx || !dpdy) {
+            return none;
+        }
+
+        // Partial derivatives of the position with respect to the texture coordinates
+        const auto duv13 = tri.p1.t - tri.p3.t;
+        const auto duv23 = tri.p2.t - tri.p3.t;
+        const auto dp13 = p1 - p3;
+        const auto dp23 = p2 - p3;
+        const auto det = duv13.x * duv23.y - duv13.y * duv23.x;
+        if (std::abs(det) < 1e-12_f) {
+            return none;
+        }
+        const auto dpdu = (duv23.y * dp13 - duv13.y * dp23) / det;
+        const auto dpdv = (duv13.x * dp23 - duv23.x * dp13) / det;
+
+        // Least-squares solution of dp = dpdu*du + dpdv*dv
+        const auto a00 = glm::dot(dpdu, dpdu);
+        const auto a01 = glm::dot(dpdu, dpdv);
+        const auto a11 = glm::dot(dpdv, dpdv);
+        const auto detA = a00 * a11 - a01 * a01;
+        if (detA == 0_f) {
+            return none;
+        }
+        const auto solve = [&](Vec3 d) {
+            const auto b0 = glm::dot(dpdu, d);
+            const auto b1 = glm::dot(dpdv, d);
+            return Vec2(a11 * b0 - a01 * b1, a00 * b1 - a01 * b0) / detA;
+        };
+        const auto dtdx = solve(*dpdx);
+        const auto dtdy = solve(*dpdy);
+        const auto finite = [](Vec2 v) { return std::isfinite(v.x) && std::isfinite(v.y); };
+        if (!finite(dtdx) || !finite(dtdy)) {
+            return none;
+        }
+        return { dtdx, dtdy };
+    }
+
+public:
     // ------------------------------------------------------------------------
 
     virtual bool isLight(const SceneInteraction& sp) const override {
@@ -317,8 +590,12 @@ public:
 
     // ------------------------------------------------------------------------
 
-    virtual Ray primaryRay(Vec2 rp, Float aspectRatio) const {
-        return nodes_.at(*camera_).primitive.camera->primaryRay(rp, aspectRatio);
+    virtual Ray primaryRay(Vec2 rp, Float aspectRatio, int camera) const override {
+        return cameraAt(camera)->primaryRay(rp, aspectRatio);
+    }
+
+    virtual std::optional<RayDifferential> primaryRayDifferential(Vec2 rp, Vec2 drp, Float aspectRatio, int camera) const override {
+        return cameraAt(camera)->primaryRayDifferential(rp, drp, aspectRatio);
     }
 
     virtual std::optional<RaySample> sampleRay(Rng& rng, const SceneInteraction& sp, Vec3 wi) const override {
@@ -337,14 +614,15 @@ public:
         }
         else if (sp.terminator && sp.terminator == TerminatorType::Camera) {
             // Endpoint
-            const auto* camera = nodes_.at(*camera_).primitive.camera;
+            const int cameraIndex = sp.primitive >= 0 ? sp.primitive : *camera_;
+            const auto* camera = cameraAt(cameraIndex);
             const auto s = camera->samplePrimaryRay(rng, sp.cameraCond.window, sp.cameraCond.aspectRatio);
             if (!s) {
                 return {};
             }
             return RaySample{
                 SceneInteraction::makeCameraEndpoint(
-                    *camera_,
+                    cameraIndex,
                     0,
                     s->geom,
                     sp.cameraCond.window,
@@ -354,6 +632,29 @@ public:
                 s->weight
             };
         }
+        else if (sp.terminator && sp.terminator == TerminatorType::Light) {
+            // Emission from a light
+            const int n = int(lights_.size());
+            if (n == 0) {
+                return {};
+            }
+            const int i = glm::clamp(int(rng.u() * n), 0, n-1);
+            const auto pL = 1_f / n;
+            const auto light = lights_.at(i);
+            const auto s = nodes_.at(light.index).primitive.light->sampleRay(rng, light.globalTransform);
+            if (!s) {
+                return {};
+            }
+            return RaySample{
+                SceneInteraction::makeLightEndpoint(
+                    light.index,
+                    s->comp,
+                    s->geom
+                ),
+                s->wo,
+                s->weight / pL
+            };
+        }
         else {
             // Surface interaction
             const auto& primitive = nodes_.at(sp.primitive).primitive;
@@ -389,14 +690,15 @@ public:
         }
     }
 
-    virtual std::optional<RaySample> samplePrimaryRay(Rng& rng, Vec4 window, Float aspectRatio) const override {
-        const auto s = nodes_.at(*camera_).primitive.camera->samplePrimaryRay(rng, window, aspectRatio);
+    virtual std::optional<RaySample> samplePrimaryRay(Rng& rng, Vec4 window, Float aspectRatio, int camera) const override {
+        const int cameraIndex = camera >= 0 ? camera : *camera_;
+        const auto s = cameraAt(cameraIndex)->samplePrimaryRay(rng, window, aspectRatio);
         if (!s) {
             return {};
         }
         return RaySample{
             SceneInteraction::makeCameraEndpoint(
-                *camera_,
+                cameraIndex,
                 0,
                 s->geom,
                 window,
@@ -407,9 +709,8 @@ public:
         };
     }
 
-    virtual std::optional<Vec2> rasterPosition(Vec3 wo, Float aspectRatio) const override {
-        const auto* camera = nodes_.at(*camera_).primitive.camera;
-        return camera->rasterPosition(wo, aspectRatio);
+    virtual std::optional<Vec2> rasterPosition(Vec3 wo, Float aspectRatio, int camera) const override {
+        return cameraAt(camera)->rasterPosition(wo, aspectRatio);
     }
 
     virtual std::optional<RaySample> sampleLight(Rng& rng, const SceneInteraction& sp) const override {
@@ -443,7 +744,7 @@ public:
         }
         else if (sp.endpoint) {
             if (primitive.light) {
-                LM_TBA_RUNTIME();
+                return primitive.light->pdfDirection(sp.geom, sp.comp, wo);
             }
             else if (primitive.camera) {
                 return primitive.camera->pdf(wo, sp.cameraCond.aspectRatio);
@@ -462,41 +763,89 @@ public:
         return primitive.light->pdf(sp.geom, spL.geom, spL.comp, lightTransform, wo) * pL;
     }
 
+    virtual Float pdfLightPosition(const SceneInteraction& spL) const override {
+        const auto& primitive = nodes_.at(spL.primitive).primitive;
+        const auto lightTransform = lights_.at(lightIndicesMap_.at(spL.primitive)).globalTransform;
+        const auto pL = 1_f / int(lights_.size());
+        return primitive.light->pdfPosition(spL.geom, lightTransform) * pL;
+    }
+
     // ------------------------------------------------------------------------
 
     virtual std::optional<DistanceSample> sampleDistance(Rng& rng, const SceneInteraction& sp, Vec3 wo) const override {
-        // Intersection to next surface
-        const auto hit = intersect({ sp.geom.p, wo }, Eps, Inf);
-        const auto dist = hit && !hit->geom.infinite ? glm::length(hit->geom.p - sp.geom.p) : Inf;
-
-        // Sample a distance
-        const auto* medium = nodes_.at(*medium_).primitive.medium;
-        const auto ds = medium->sampleDistance(rng, { sp.geom.p, wo }, 0_f, dist);
-        if (ds && ds->medium) {
-            // Medium interaction
-            return DistanceSample{
-                SceneInteraction::makeMediumInteraction(
-                    *medium_,
-                    0,
-                    PointGeometry::makeDegenerated(ds->p)
-                ),
-                ds->weight
-            };
+        const Ray ray{ sp.geom.p, wo };
+        if (mediaChromatic_ && mediaBound_.isect(ray, 0_f, Inf)) {
+            return sampleDistanceChromatic(rng, ray);
+        }
+
+        // Sample a distance in the media first, assuming no surface along the ray.
+        // The distance sampling is consistent for any tmax, thus the sample is valid
+        // if no surface is found before the sampled point. We only need to trace the ray
+        // up to the sampled distance, which is cheaper than finding the closest surface
+        // especially in dense media.
+        // If the ray overlaps with multiple media, the distances are sampled independently
+        // for each medium and the closest one is selected. This is equivalent to
+        // the distance sampling according to the sum of the extinction coefficients.
+        int mediumIndex = -1;           // Node index of the medium with the closest interaction
+        Float mediumDist = Inf;         // Distance to the closest medium interaction
+        Vec3 mediumPoint{};             // Position of the closest medium interaction
+        Vec3 mediumWeight(1_f);         // Weight of the closest medium interaction
+        Vec3 surfaceWeight(1_f);        // Weight when passing through the media
+        if (!media_.empty() && mediaBound_.isect(ray, 0_f, Inf)) {
+            for (const auto& region : media_) {
+                if (!region.bound.isect(ray, 0_f, Inf)) {
+                    continue;
+                }
+                const auto* medium = nodes_.at(region.index).primitive.medium;
+                const auto ds = medium->sampleDistance(rng, ray, 0_f, Inf);
+                if (!ds) {
+                    continue;
+                }
+                if (!ds->medium) {
+                    surfaceWeight *= ds->weight;
+                    continue;
+                }
+                const auto t = glm::distance(ds->p, sp.geom.p);
+                if (t < mediumDist) {
+                    mediumIndex = region.index;
+                    mediumDist = t;
+                    mediumPoint = ds->p;
+                    mediumWeight = ds->weight;
+                }
+            }
         }
-        else {
-            // Surface interaction
-            return DistanceSample{
-                *hit,
-                ds ? ds->weight : Vec3(1_f)
-            };
+        if (mediumIndex >= 0) {
+            const auto hit = intersect(ray, Eps, mediumDist);
+            if (!hit) {
+                // Medium interaction
+                return DistanceSample{
+                    SceneInteraction::makeMediumInteraction(
+                        mediumIndex,
+                        0,
+                        PointGeometry::makeDegenerated(mediumPoint)
+                    ),
+                    mediumWeight
+                };
+            }
+
+            // Surface interaction before the sampled point
+            return DistanceSample{ *hit, Vec3(1_f) };
+        }
+
+        // Surface interaction.
+        // The sampled distance passes through the media so we need the closest hit.
+        const auto hit = intersect(ray, Eps, Inf);
+        if (!hit) {
+            return {};
         }
+        return DistanceSample{ *hit, surfaceWeight };
     }
 
     virtual std::optional<Vec3> evalTransmittance(Rng& rng, const SceneInteraction& sp1, const SceneInteraction& sp2) const override {
         if (!visible(sp1, sp2)) {
             return {};
         }
-        if (!medium_) {
+        if (media_.empty()) {
             return Vec3(1_f);
         }
         
@@ -508,9 +857,25 @@ public:
         const auto wo = !sp2.geom.infinite
             ? glm::normalize(sp2.geom.p - sp1.geom.p)
             : -sp2.geom.wo;
+        const Ray ray{ sp1.geom.p, wo };
+        if (!mediaBound_.isect(ray, 0_f, dist)) {
+            return Vec3(1_f);
+        }
 
-        const auto* medium = nodes_.at(*medium_).primitive.medium;
-        return medium->evalTransmittance(rng, { sp1.geom.p, wo }, 0_f, dist);
+        // Product of the transmittance of the overlapping media
+        Vec3 Tr(1_f);
+        for (const auto& region : media_) {
+            if (!region.bound.isect(ray, 0_f, dist)) {
+                continue;
+            }
+            const auto* medium = nodes_.at(region.index).primitive.medium;
+            const auto TrM = medium->evalTransmittance(rng, ray, 0_f, dist);
+            if (!TrM) {
+                return {};
+            }
+            Tr *= *TrM;
+        }
+        return Tr;
     }
 
     // ------------------------------------------------------------------------
@@ -10,18 +10,179 @@
 #include <lm/progress.h>
 #include <lm/serial.h>
 #include <lm/film.h>
+#include <lm/logger.h>
+#include <future>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE::scheduler)
 
+namespace {
+
+/*
+    Periodic checkpoint of the pixel-based schedulers.
+    The checkpoint contains the number of processed samples per pixel,
+    the elapsed time, and the film before rescaling.
+    The film is serialized into the memory between the passes
+    where no thread writes to the film, and the serialized data
+    is written to the file in a background thread not to stall the rendering.
+*/
+class Checkpoint {
+private:
+    std::string path_;
+    double interval_ = 0;
+    std::chrono::high_resolution_clock::time_point last_;
+    std::future<bool> writing_;
+
+public:
+    Checkpoint(const std::string& path, double interval)
+        : path_(path)
+        , interval_(interval)
+        , last_(std::chrono::high_resolution_clock::now())
+    {}
+
+    ~Checkpoint() {
+        wait();
+    }
+
+    bool enabled() const {
+        return !path_.empty();
+    }
+
+    // Restore the state from the checkpoint. Returns false if not available.
+    // A broken checkpoint, e.g., truncated by a crash, is ignored and the rendering starts from scratch.
+    bool restore(Film* film, long long& spp, double& elapsed) const {
+        if (!enabled() || !fs::exists(path_)) {
+            return false;
+        }
+        try {
+            std::ifstream is(path_, std::ios::in | std::ios::binary);
+            InputArchive ar(is);
+            int w, h;
+            ar(spp, elapsed, w, h);
+            if (const auto size = film->size(); size.w != w || size.h != h) {
+                LM_ERROR("Film size is different from the checkpoint [path='{}', film='({},{})', checkpoint='({},{})']",
+                    path_, size.w, size.h, w, h);
+                return false;
+            }
+            film->load(ar);
+        }
+        catch (const std::exception& e) {
+            LM_WARN("Failed to read checkpoint. Starting from scratch [path='{}', error='{}']", path_, e.what());
+            film->clear();
+            return false;
+        }
+        LM_INFO("Resumed from checkpoint [path='{}', spp={}, elapsed={:.3f}s]", path_, spp, elapsed);
+        return true;
+    }
+
+    // Write the checkpoint if the interval has passed since the last one, or forcibly
+    void update(Film* film, long long spp, double elapsed, bool force = false) {
+        if (!enabled()) {
+            return;
+        }
+        const auto now = std::chrono::high_resolution_clock::now();
+        if (!force && std::chrono::duration<double>(now - last_).count() < interval_) {
+            return;
+        }
+        last_ = now;
+
+        // Serialize the state
+        std::ostringstream os(std::ios::out | std::ios::binary);
+        {
+            OutputArchive ar(os);
+            const auto size = film->size();
+            ar(spp, elapsed, size.w, size.h);
+            film->save(ar);
+        }
+
+        // Write to the temporary file and replace the checkpoint with it,
+        // so that the checkpoint is not broken when the process is killed while writing.
+        wait();
+        writing_ = std::async(std::launch::async, [path = path_, data = os.str()]() -> bool {
+            const auto temp = path + ".tmp";
+            {
+                std::ofstream out(temp, std::ios::out | std::ios::binary);
+                out.write(data.data(), data.size());
+                if (!out) {
+                    return false;
+                }
+            }
+            std::error_code ec;
+            fs::rename(temp, path, ec);
+            return !ec;
+        });
+    }
+
+    // Wait for the completion of the writing
+    void wait() {
+        if (!writing_.valid()) {
+            return;
+        }
+        if (!writing_.get()) {
+            LM_WARN("Failed to write checkpoint [path='{}']", path_);
+        }
+    }
+};
+
+// Offset of the sample indices continued over the runs of a scheduler
+class SampleOffset {
+private:
+    bool continue_ = false;
+    long long offset_ = 0;  // First sample index of the last run
+    long long next_ = 0;    // First sample index of the next run if continued
+
+public:
+    void setContinue(bool enable) {
+        continue_ = enable;
+    }
+
+    // Start a run. Returns the offset of the run.
+    long long begin() {
+        offset_ = continue_ ? next_ : 0;
+        return offset_;
+    }
+
+    // End a run with the number of processed sample indices
+    void end(long long processed) {
+        next_ = offset_ + processed;
+    }
+
+    long long offset() const {
+        return offset_;
+    }
+};
+
+// The pass interrupted by the cancellation leaves the partial samples on the film.
+// Restore the film to the last completed pass and keep it in the checkpoint.
+// Returns the number of completed passes.
+long long discardCancelledPass(Film* film, Checkpoint& checkpoint, SampleOffset& offset, long long spp, double elapsed) {
+    if (!film->restoreSnapshot()) {
+        LM_WARN("Film does not support snapshots. Discarding the samples of the cancelled rendering.");
+        film->clear();
+        offset.end(0);
+        return 0;
+    }
+    checkpoint.update(film, spp, elapsed, true);
+    offset.end(spp);
+    return spp;
+}
+
+}
+
+// ----------------------------------------------------------------------------
+
 // Sample-based SPPScheduler
 class Scheduler_SPP_Sample : public Scheduler {
 private:
     long long spp_;
     Film* film_;
+    std::string checkpoint_;
+    double checkpointInterval_;
+    mutable long long restored_ = 0;
+    mutable SampleOffset offset_;
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(spp_, film_);
+        ar(spp_, film_, checkpoint_, checkpointInterval_);
     }
 
     virtual void foreachUnderlying(const ComponentVisitor& visit) override {
@@ -32,21 +193,68 @@ public:
     virtual bool construct(const Json& prop) override {
         spp_ = json::value<long long>(prop, "spp");
         film_ = json::compRef<Film>(prop, "output");
+        checkpoint_ = json::value<std::string>(prop, "checkpoint", "");
+        checkpointInterval_ = json::value<Float>(prop, "checkpoint_interval", 600_f);
         return true;
     }
 
+    virtual long long restoredSamples() const override {
+        return restored_;
+    }
+
+    virtual void continueSamples(bool enable) override {
+        offset_.setContinue(enable);
+    }
+
+    virtual long long sampleOffset() const override {
+        return offset_.offset();
+    }
+
     virtual long long run(const ProcessFunc& process) const override {
         const auto numPixels = film_->numPixels();
         progress::ScopedReport progress_ctx_(numPixels * spp_);
-        
-        // Parallel loop for each pixel
-        parallel::foreach(numPixels * spp_, [&](long long index, int threadid) {
-            process(index / spp_, index % spp_, threadid);
-        }, [&](long long processed) {
-            progress::update(processed);
-        });
 
-        return spp_;
+        // Restore the state from the checkpoint if available
+        const auto offset = offset_.begin();
+        Checkpoint checkpoint(checkpoint_, checkpointInterval_);
+        long long spp = 0;
+        double restoredTime = 0;
+        if (!checkpoint.restore(film_, spp, restoredTime)) {
+            spp = 0;
+            restoredTime = 0;
+        }
+        restored_ = spp;
+        const auto start = std::chrono::high_resolution_clock::now();
+        const auto elapsed = [&]() {
+            const auto curr = std::chrono::high_resolution_clock::now();
+            return restoredTime + std::chrono::duration<double>(curr - start).count();
+        };
+
+        // Process a pass of one sample per pixel at a time so that the checkpoint
+        // can be written and the film can be restored between the passes.
+        // The callbacks are created once not to allocate for each pass.
+        const parallel::ParallelProcessFunc processPass = [&](long long index, int threadid) {
+            process(index, offset + spp, threadid);
+        };
+        const parallel::ProgressUpdateFunc updatePass = [&](long long processed) {
+            progress::update(spp * numPixels + processed);
+        };
+        film_->takeSnapshot();
+        double completedTime = restoredTime;
+        while (spp < spp_) {
+            parallel::foreach(numPixels, processPass, updatePass);
+            if (parallel::cancelRequested()) {
+                return discardCancelledPass(film_, checkpoint, offset_, spp, completedTime);
+            }
+            spp++;
+            completedTime = elapsed();
+            film_->takeSnapshot();
+            checkpoint.update(film_, spp, completedTime);
+        }
+        checkpoint.update(film_, spp, elapsed(), true);
+
+        offset_.end(spp);
+        return spp;
     }
 };
 
@@ -59,10 +267,14 @@ class Scheduler_SPP_Time : public Scheduler {
 private:
     double renderTime_;
     Film* film_;
+    std::string checkpoint_;
+    double checkpointInterval_;
+    mutable long long restored_ = 0;
+    mutable SampleOffset offset_;
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(renderTime_, film_);
+        ar(renderTime_, film_, checkpoint_, checkpointInterval_);
     }
 
     virtual void foreachUnderlying(const ComponentVisitor& visit) override {
@@ -73,37 +285,80 @@ public:
     virtual bool construct(const Json& prop) override {
         renderTime_ = json::value<Float>(prop, "render_time");
         film_ = json::compRef<Film>(prop, "output");
+        checkpoint_ = json::value<std::string>(prop, "checkpoint", "");
+        checkpointInterval_ = json::value<Float>(prop, "checkpoint_interval", 600_f);
         return true;
     }
+
+    virtual long long restoredSamples() const override {
+        return restored_;
+    }
+
+    virtual void continueSamples(bool enable) override {
+        offset_.setContinue(enable);
+    }
+
+    virtual long long sampleOffset() const override {
+        return offset_.offset();
+    }
     
     virtual long long run(const ProcessFunc& process) const override {
         const auto numPixels = film_->numPixels();
         progress::ScopedTimeReport progress_ctx_(renderTime_);
-        
-        const auto start = std::chrono::high_resolution_clock::now();
+
+        // The render time includes the time elapsed before the checkpoint
+        Checkpoint checkpoint(checkpoint_, checkpointInterval_);
         long long spp = 0;
+        double restoredTime = 0;
+        if (!checkpoint.restore(film_, spp, restoredTime)) {
+            spp = 0;
+            restoredTime = 0;
+        }
+        restored_ = spp;
+        const auto offset = offset_.begin();
+        if (spp > 0 && restoredTime > renderTime_) {
+            offset_.end(spp);
+            return spp;
+        }
+        
+        const auto start = std::chrono::high_resolution_clock::now() -
+            std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+                std::chrono::duration<double>(restoredTime));
+        const auto elapsed = [&]() {
+            const auto curr = std::chrono::high_resolution_clock::now();
+            return (double)(std::chrono::duration_cast<std::chrono::milliseconds>(curr - start).count()) / 1000.0;
+        };
+
+        // The callbacks are created once not to allocate for each pass
+        const parallel::ParallelProcessFunc processPass = [&](long long index, int threadid) {
+            process(index, offset + spp, threadid);
+        };
+        const parallel::ProgressUpdateFunc updatePass = [&](long long) {
+            progress::updateTime(elapsed());
+        };
+        film_->takeSnapshot();
+        double completedTime = restoredTime;
         while (true) {
             // Parallel loop for each pixel
-            parallel::foreach(numPixels, [&](long long index, int threadid) {
-                process(index, spp, threadid);
-            }, [&](long long) {
-                using namespace std::chrono;
-                const auto now = high_resolution_clock::now();
-                const auto elapsed = duration_cast<milliseconds>(now - start).count() / 1000.0;
-                progress::updateTime(elapsed);
-            });
+            parallel::foreach(numPixels, processPass, updatePass);
+            if (parallel::cancelRequested()) {
+                return discardCancelledPass(film_, checkpoint, offset_, spp, completedTime);
+            }
 
             // Update processed spp
             spp++;
+            completedTime = elapsed();
+            film_->takeSnapshot();
 
             // Check termination
-            const auto curr = std::chrono::high_resolution_clock::now();
-            const double elapsed = (double)(std::chrono::duration_cast<std::chrono::milliseconds>(curr - start).count()) / 1000.0;
-            if (elapsed > renderTime_) {
+            if (completedTime > renderTime_) {
+                checkpoint.update(film_, spp, completedTime, true);
                 break;
             }
+            checkpoint.update(film_, spp, completedTime);
         }
 
+        offset_.end(spp);
         return spp;
     }
 };
@@ -116,6 +371,7 @@ LM_COMP_REG_IMPL(Scheduler_SPP_Time, "scheduler::spp::time");
 class Scheduler_SPI_Sample : public Scheduler {
 private:
     long long numSamples_;
+    mutable SampleOffset offset_;
 
 public:
     LM_SERIALIZE_IMPL(ar) {
@@ -128,14 +384,24 @@ public:
         return true;
     }
 
+    virtual void continueSamples(bool enable) override {
+        offset_.setContinue(enable);
+    }
+
+    virtual long long sampleOffset() const override {
+        return offset_.offset();
+    }
+
     virtual long long run(const ProcessFunc& process) const override {
         progress::ScopedReport progress_ctx_(numSamples_);
+        const auto offset = offset_.begin();
         parallel::foreach(numSamples_, [&](long long index, int threadid) {
-            process(0, index, threadid);
+            process(0, offset + index, threadid);
         }, [&](long long processed) {
             progress::update(processed);
         });
 
+        offset_.end(numSamples_);
         return numSamples_;
     }
 };
@@ -149,6 +415,7 @@ class Scheduler_SPI_Time : public Scheduler {
 private:
     double renderTime_;
     long long samplesPerIter_;
+    mutable SampleOffset offset_;
 
 public:
     LM_SERIALIZE_IMPL(ar) {
@@ -162,14 +429,23 @@ public:
         return true;
     }
 
+    virtual void continueSamples(bool enable) override {
+        offset_.setContinue(enable);
+    }
+
+    virtual long long sampleOffset() const override {
+        return offset_.offset();
+    }
+
     virtual long long run(const ProcessFunc& process) const override {
         progress::ScopedTimeReport progress_ctx_(renderTime_);
         const auto start = std::chrono::high_resolution_clock::now();
+        const auto offset = offset_.begin();
         long long processed = 0;
         while (true) {
             // Parallel loop
             parallel::foreach(samplesPerIter_, [&](long long index, int threadid) {
-                process(0, processed + index, threadid);
+                process(0, offset + processed + index, threadid);
             }, [&](long long) {
                 using namespace std::chrono;
                 const auto now = high_resolution_clock::now();
@@ -181,12 +457,16 @@ public:
             processed += samplesPerIter_;
 
             // Check termination
+            if (parallel::cancelRequested()) {
+                break;
+            }
             const auto curr = std::chrono::high_resolution_clock::now();
             const double elapsed = (double)(std::chrono::duration_cast<std::chrono::milliseconds>(curr - start).count()) / 1000.0;
             if (elapsed > renderTime_) {
                 break;
             }
         }
+        offset_.end(processed);
         return processed;
     }
 };
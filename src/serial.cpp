@@ -3,4 +3,133 @@
     Distributed under MIT license. See LICENSE file for details.
 */
 
-#include <pch.h>
\ No newline at end of file
+#include <pch.h>
+#include <lm/serial.h>
+
+#if LM_PLATFORM_WINDOWS
+#include <Windows.h>
+#elif LM_PLATFORM_LINUX || LM_PLATFORM_APPLE
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+LM_NAMESPACE_BEGIN(LM_NAMESPACE::serial)
+
+// ----------------------------------------------------------------------------
+
+// Platform-independent abstraction of read-only memory-mapped file.
+class MappedFile_ final : public MappedFile {
+public:
+    ~MappedFile_() {
+        unmap();
+    }
+
+    bool map(const std::string& path) {
+        #if LM_PLATFORM_WINDOWS
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            LM_ERROR("Failed to open file [path='{}']", path);
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size)) {
+            LM_ERROR("Failed to get file size [path='{}']", path);
+            return false;
+        }
+        size_ = std::size_t(size.QuadPart);
+        if (size_ == 0) {
+            return true;
+        }
+        mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping_) {
+            LM_ERROR("Failed to create file mapping [path='{}']", path);
+            return false;
+        }
+        data_ = (const char*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (!data_) {
+            LM_ERROR("Failed to map file [path='{}']", path);
+            return false;
+        }
+        #elif LM_PLATFORM_LINUX || LM_PLATFORM_APPLE
+        fd_ = open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            LM_ERROR("Failed to open file [path='{}']", path);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            LM_ERROR("Failed to get file size [path='{}']", path);
+            return false;
+        }
+        size_ = std::size_t(st.st_size);
+        if (size_ == 0) {
+            return true;
+        }
+        // Shared mapping of read-only pages, so that the physical pages
+        // are shared among the processes mapping the same file.
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) {
+            LM_ERROR("Failed to map file [path='{}']", path);
+            return false;
+        }
+        data_ = (const char*)p;
+        #endif
+        return true;
+    }
+
+    virtual const char* data() const override {
+        return data_;
+    }
+
+    virtual std::size_t size() const override {
+        return size_;
+    }
+
+private:
+    void unmap() {
+        #if LM_PLATFORM_WINDOWS
+        if (data_) {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_) {
+            CloseHandle(mapping_);
+        }
+        if (file_ != INVALID_HANDLE_VALUE) {
+            CloseHandle(file_);
+        }
+        #elif LM_PLATFORM_LINUX || LM_PLATFORM_APPLE
+        if (data_) {
+            munmap((void*)data_, size_);
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+        #endif
+    }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    #if LM_PLATFORM_WINDOWS
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = NULL;
+    #elif LM_PLATFORM_LINUX || LM_PLATFORM_APPLE
+    int fd_ = -1;
+    #endif
+};
+
+// ----------------------------------------------------------------------------
+
+LM_PUBLIC_API std::shared_ptr<MappedFile> mapFile(const std::string& path) {
+    auto file = std::make_shared<MappedFile_>();
+    if (!file->map(path)) {
+        return nullptr;
+    }
+    return file;
+}
+
+// ----------------------------------------------------------------------------
+
+LM_NAMESPACE_END(LM_NAMESPACE::serial)
@@ -19,16 +19,47 @@ std::string sanitizeDirectorySeparator(std::string p) {
     return p;
 }
 
+/*
+\rst
+.. function:: texture::bitmap
+
+   Bitmap texture.
+
+   :param str path: Path to the image.
+   :param bool flip: Flip the image vertically. Default: ``true``.
+   :param str filter: Filter used by the lookup with ray differentials.
+                      ``trilinear`` (default) or ``nearest``.
+
+   Lookups without ray differentials use the nearest texel.
+   With ``trilinear`` filter, lookups with ray differentials
+   interpolate two nearest levels of MIP map bilinearly,
+   where the level is selected by the longer axis of the footprint.
+\endrst
+*/
 class Texture_Bitmap final : public Texture {
+private:
+    // Level of MIP map
+    struct MipLevel {
+        int w;
+        int h;
+        std::vector<float> data;
+
+        template <typename Archive>
+        void serialize(Archive& ar) {
+            ar(w, h, serial::raw(data));
+        }
+    };
+
 private:
     int w_;     // Width of the image
     int h_;     // Height of the image
     int c_;     // Number of components
     std::vector<float> data_;
+    std::vector<MipLevel> mips_;    // Levels of MIP map except for the original image. Empty if not filtered.
 
 public:
     LM_SERIALIZE_IMPL(ar) {
-        ar(w_, h_, c_, data_);
+        ar(w_, h_, c_, serial::raw(data_), mips_);
     }
 
 public:
@@ -54,6 +85,16 @@ public:
         data_.assign(data, data + (w_*h_*c_));
         stbi_image_free(data);
 
+        // Build MIP map
+        const auto filter = json::value<std::string>(prop, "filter", "trilinear");
+        if (filter == "trilinear") {
+            buildMipmap();
+        }
+        else if (filter != "nearest") {
+            LM_ERROR("Invalid filter [filter='{}']", filter);
+            return false;
+        }
+
         return true;
     }
 
@@ -66,6 +107,21 @@ public:
         return Vec3(data_[c_*i], data_[c_*i+1], data_[c_*i+2]);
     }
 
+    virtual Vec3 eval(Vec2 t, Vec2 dtdx, Vec2 dtdy) const override {
+        if (mips_.empty() || (dtdx == Vec2(0_f) && dtdy == Vec2(0_f))) {
+            return eval(t);
+        }
+
+        // Select the level by the width of the footprint in texels
+        const auto size = Vec2(w_, h_);
+        const auto width = std::max(glm::length(dtdx * size), glm::length(dtdy * size));
+        const auto maxLevel = Float(mips_.size());
+        const auto lod = std::clamp(std::log2(std::max(width, 1e-8_f)), 0_f, maxLevel);
+        const int l0 = std::min(int(lod), int(mips_.size()) - 1);
+        const auto f = lod - Float(l0);
+        return glm::mix(bilinear(l0, t), bilinear(l0 + 1, t), f);
+    }
+
     virtual Vec3 evalByPixelCoords(int x, int y) const override {
         const int i = w_*y + x;
         return Vec3(data_[c_*i], data_[c_*i+1], data_[c_*i+2]);
@@ -87,6 +143,68 @@ public:
     virtual TextureBuffer buffer() override {
         return { w_, h_, c_, data_.data() };
     }
+
+private:
+    // Get the buffer of the level. Level 0 is the original image.
+    TextureBuffer level(int l) const {
+        if (l == 0) {
+            return { w_, h_, c_, const_cast<float*>(data_.data()) };
+        }
+        const auto& mip = mips_[l-1];
+        return { mip.w, mip.h, c_, const_cast<float*>(mip.data.data()) };
+    }
+
+    // Build the levels by 2x2 box filter until the size becomes 1x1
+    void buildMipmap() {
+        mips_.clear();
+        for (int l = 0; ; l++) {
+            const auto src = level(l);
+            if (src.w == 1 && src.h == 1) {
+                break;
+            }
+            MipLevel mip;
+            mip.w = std::max(1, src.w / 2);
+            mip.h = std::max(1, src.h / 2);
+            mip.data.resize(size_t(mip.w) * mip.h * c_);
+            for (int y = 0; y < mip.h; y++) {
+                for (int x = 0; x < mip.w; x++) {
+                    const int x0 = std::min(2*x, src.w-1);
+                    const int x1 = std::min(2*x+1, src.w-1);
+                    const int y0 = std::min(2*y, src.h-1);
+                    const int y1 = std::min(2*y+1, src.h-1);
+                    for (int c = 0; c < c_; c++) {
+                        const auto at = [&](int sx, int sy) { return src.data[c_*(src.w*sy + sx) + c]; };
+                        mip.data[c_*(mip.w*y + x) + c] = .25f * (at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1));
+                    }
+                }
+            }
+            mips_.push_back(std::move(mip));
+        }
+    }
+
+    // Bilinear interpolation of the level with repeat wrapping
+    Vec3 bilinear(int l, Vec2 t) const {
+        const auto b = level(l);
+        const auto u = (t.x - floor(t.x)) * b.w - .5_f;
+        const auto v = (t.y - floor(t.y)) * b.h - .5_f;
+        const auto fu = floor(u);
+        const auto fv = floor(v);
+        const auto du = u - fu;
+        const auto dv = v - fv;
+        const auto wrap = [](int i, int n) { return (i % n + n) % n; };
+        const int x0 = wrap(int(fu), b.w);
+        const int x1 = wrap(int(fu) + 1, b.w);
+        const int y0 = wrap(int(fv), b.h);
+        const int y1 = wrap(int(fv) + 1, b.h);
+        const auto at = [&](int x, int y) {
+            const int i = b.w * y + x;
+            return Vec3(b.data[c_*i], b.data[c_*i+1], b.data[c_*i+2]);
+        };
+        return glm::mix(
+            glm::mix(at(x0, y0), at(x1, y0), du),
+            glm::mix(at(x0, y1), at(x1, y1), du),
+            dv);
+    }
 };
 
 LM_COMP_REG_IMPL(Texture_Bitmap, "texture::bitmap");
@@ -12,9 +12,12 @@
 #include <lm/renderer.h>
 #include <lm/film.h>
 #include <lm/parallel.h>
+#include <lm/cpu.h>
 #include <lm/progress.h>
 #include <lm/debugio.h>
 #include <lm/objloader.h>
+#include <array>
+#include <future>
 
 LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 
@@ -29,12 +32,23 @@ LM_NAMESPACE_BEGIN(LM_NAMESPACE)
 */
 class UserContext_Default : public user::detail::UserContext {
 public:
-    UserContext_Default() {
-        // User context is the root of the object tree
-        comp::detail::registerRootComp(this);
-    }
-
     ~UserContext_Default() {
+        // Terminate the session thread
+        stopSession();
+        if (sessionThread_.joinable()) {
+            {
+                std::unique_lock<std::mutex> lock(sessionMutex_);
+                sessionExit_ = true;
+                sessionCond_.notify_all();
+            }
+            sessionThread_.join();
+        }
+
+        // Child contexts share the subsystems of the root context
+        contexts_.clear();
+        if (!root_) {
+            return;
+        }
         objloader::shutdown();
         debugio::shutdown();
         debugio::server::shutdown();
@@ -46,12 +60,26 @@ public:
 
 public:
     virtual bool construct(const Json& prop) override {
+        // The default context is the root of the object tree.
+        // Other contexts are the children of the default context.
+        root_ = loc() == "$";
+        if (!root_) {
+            reset();
+            return true;
+        }
+        comp::detail::registerRootComp(this);
+
         // Exception subsystem
         exception::init();
 
         // Logger subsystem
         log::init(json::value<std::string>(prop, "logger", log::DefaultType));
 
+        // ISA of the kernels
+        if (!cpu::select(json::value<std::string>(prop, "isa", "auto"))) {
+            return false;
+        }
+
         // Parallel subsystem
         parallel::init("parallel::openmp", prop);
         if (auto it = prop.find("progress");  it != prop.end()) {
@@ -93,13 +121,34 @@ public:
         else if (name == "renderer") {
             return renderer_.get();
         }
+        std::lock_guard<std::mutex> lock(contextsMutex_);
+        if (const auto it = contexts_.find(name); it != contexts_.end()) {
+            return it->second.get();
+        }
         return nullptr;
     }
 
     virtual void foreachUnderlying(const ComponentVisitor& visit) override {
-        lm::comp::visit(visit, assets_);
-        lm::comp::visit(visit, scene_);
-        lm::comp::visit(visit, renderer_);
+        {
+            std::lock_guard<std::recursive_mutex> lock(stateMutex_);
+            lm::comp::visit(visit, assets_);
+            lm::comp::visit(visit, scene_);
+            lm::comp::visit(visit, renderer_);
+        }
+
+        // The child contexts are visited without holding the lock of the context map,
+        // because the visit waits for the lock of each context held by the thread bound to it,
+        // which might query the components via the context map.
+        std::vector<Component*> contexts;
+        {
+            std::lock_guard<std::mutex> lock(contextsMutex_);
+            for (auto& [name, context] : contexts_) {
+                contexts.push_back(context.get());
+            }
+        }
+        for (auto* context : contexts) {
+            visit(context, false);
+        }
     }
 
 public:
@@ -109,9 +158,15 @@ public:
             version::formatted(),
             version::platform(),
             version::architecture());
+        LM_INFO("CPU ISA -- Detected {}, Selected {}",
+            cpu::name(cpu::detect()),
+            cpu::name(cpu::selected()));
     }
 
     virtual void reset() override {
+        stopSession();
+        std::lock_guard<std::recursive_mutex> lock(stateMutex_);
+        sequenceAssets_.clear();
         assets_ = comp::create<Assets>("assets::default", makeLoc("assets"));
         assert(assets_);
         scene_ = comp::create<Scene>("scene::default", makeLoc("scene"));
@@ -120,10 +175,24 @@ public:
     }
 
     virtual std::string asset(const std::string& name, const std::string& implKey, const Json& prop) override {
+        stopSession();
+        std::lock_guard<std::recursive_mutex> lock(stateMutex_);
+
+        // Reuse the asset created with the same properties in the previous frame of the sequence
+        const Json desc = {{"key", implKey}, {"prop", prop}};
+        if (sequenceFrame_) {
+            if (const auto it = sequenceAssets_.find(name); it != sequenceAssets_.end() && it->second == desc) {
+                return assets_->makeLoc(name);
+            }
+        }
+
         const auto loc = assets_->loadAsset(name, implKey, prop);
         if (!loc) {
             THROW_RUNTIME_ERROR();
         }
+        if (sequenceFrame_) {
+            sequenceAssets_[name] = desc;
+        }
         return *loc;
     }
 
@@ -132,10 +201,15 @@ public:
     }
 
     void build(const std::string& accelName, const Json& prop) {
+        stopSession();
+        std::lock_guard<std::recursive_mutex> lock(stateMutex_);
+        parallel::ScopedCancelFlag cancelGuard(&cancel_);
         scene_->build(accelName, prop);
     }
 
     virtual void renderer(const std::string& rendererName, const Json& prop) override {
+        stopSession();
+        std::lock_guard<std::recursive_mutex> lock(stateMutex_);
         renderer_ = lm::comp::create<Renderer>(rendererName, makeLoc("renderer"), prop);
         if (!renderer_) {
             LM_ERROR("Failed to render [renderer='{}']", rendererName);
@@ -144,6 +218,9 @@ public:
     }
 
     virtual void render(bool verbose) override {
+        stopSession();
+        std::lock_guard<std::recursive_mutex> lock(stateMutex_);
+        parallel::ScopedCancelFlag cancelGuard(&cancel_);
         if (verbose) {
             LM_INFO("Starting render [name='{}']", renderer_->key());
             LM_INDENT();
@@ -172,6 +249,67 @@ public:
         return film->buffer();
     }
 
+    virtual void startSession(const std::string& filmName) override {
+        stopSession();
+        if (!renderer_) {
+            LM_ERROR("Renderer is not specified");
+            THROW_RUNTIME_ERROR();
+        }
+        if (renderer_->requiresScene() && !scene_->renderable()) {
+            THROW_RUNTIME_ERROR();
+        }
+        auto* film = comp::get<Film>(filmName);
+        if (!film) {
+            THROW_RUNTIME_ERROR();
+        }
+        LM_INFO("Starting session [renderer='{}']", renderer_->key());
+
+        // Launch the session thread if not available.
+        // The thread is kept alive across the sessions so that the threads
+        // of the parallel subsystem spawned from the thread are also reused.
+        if (!sessionThread_.joinable()) {
+            sessionThread_ = std::thread([this]() { runSession(); });
+        }
+
+        // Clear accumulated image and notify the thread to start the session
+        std::unique_lock<std::mutex> lock(sessionMutex_);
+        const auto size = film->size();
+        sessionSize_ = size;
+        sessionAccum_.assign(size_t(size.w) * size.h * 3, 0_f);
+        sessionPasses_ = 0;
+        sessionFilm_ = film;
+        sessionActive_ = true;
+        sessionCond_.notify_all();
+    }
+
+    virtual void stopSession() override {
+        std::unique_lock<std::mutex> lock(sessionMutex_);
+        if (!sessionActive_) {
+            return;
+        }
+
+        // Cancel in-flight pass and wait for the thread to be idle.
+        // Only the parallel loops of this context are cancelled.
+        sessionActive_ = false;
+        cancel_ = true;
+        sessionCond_.wait(lock, [&] { return !sessionRunning_; });
+        cancel_ = false;
+    }
+
+    virtual FilmBuffer sessionBuffer() override {
+        std::unique_lock<std::mutex> lock(sessionMutex_);
+        sessionBuffer_.resize(sessionAccum_.size());
+        const auto invPasses = sessionPasses_ > 0 ? 1_f / Float(sessionPasses_) : 0_f;
+        for (size_t i = 0; i < sessionAccum_.size(); i++) {
+            sessionBuffer_[i] = sessionAccum_[i] * invPasses;
+        }
+        return FilmBuffer{ sessionSize_.w, sessionSize_.h, sessionBuffer_.data() };
+    }
+
+    virtual long long sessionPasses() override {
+        return sessionPasses_;
+    }
+
     virtual void serialize(std::ostream& os) override {
         LM_INFO("Saving state to stream");
         serial::save(os, assets_);
@@ -180,48 +318,371 @@ public:
     }
 
     virtual void deserialize(std::istream& is) override {
+        stopSession();
+        std::lock_guard<std::recursive_mutex> lock(stateMutex_);
         LM_INFO("Loading state from stream");
         serial::load(is, assets_);
         serial::load(is, scene_);
         serial::load(is, renderer_);
     }
 
+    virtual void serializeSnapshot(const std::string& path) override {
+        LM_INFO("Saving snapshot [path='{}']", path);
+        LM_INDENT();
+        std::ofstream os(path, std::ios::out | std::ios::binary);
+        if (!os) {
+            LM_ERROR("Failed to open file [path='{}']", path);
+            THROW_RUNTIME_ERROR();
+        }
+
+        // Reserve the header. The offsets are filled later.
+        serial::SnapshotHeader header{};
+        std::copy(std::begin(serial::SnapshotMagic), std::end(serial::SnapshotMagic), header.magic);
+        header.marker = serial::detail::RawBlockMarker;
+        header.version = serial::SnapshotVersion;
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        // Assets are stored in independent blocks
+        const auto toc = assets_->saveSnapshot(os);
+
+        // Scene and renderer
+        header.stateOffset = serial::padSnapshot(os);
+        serial::save(os, scene_);
+        serial::save(os, renderer_);
+        header.stateSize = std::uint64_t(os.tellp()) - header.stateOffset;
+
+        // Table of contents
+        header.tocOffset = serial::padSnapshot(os);
+        serial::save(os, toc);
+        header.tocSize = std::uint64_t(os.tellp()) - header.tocOffset;
+
+        // Write the header again with the offsets
+        os.seekp(0);
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    virtual void deserializeSnapshot(const std::string& path) override {
+        stopSession();
+        std::lock_guard<std::recursive_mutex> lock(stateMutex_);
+        LM_INFO("Loading snapshot [path='{}']", path);
+        LM_INDENT();
+        const auto file = serial::mapFile(path);
+        if (!file) {
+            THROW_RUNTIME_ERROR();
+        }
+
+        // Validate the header
+        serial::SnapshotHeader header;
+        if (file->size() < sizeof(header)) {
+            LM_ERROR("Invalid snapshot [path='{}']", path);
+            THROW_RUNTIME_ERROR();
+        }
+        std::memcpy(&header, file->data(), sizeof(header));
+        if (!std::equal(std::begin(serial::SnapshotMagic), std::end(serial::SnapshotMagic), header.magic)) {
+            LM_ERROR("Invalid snapshot [path='{}']", path);
+            THROW_RUNTIME_ERROR();
+        }
+        if (header.marker != serial::detail::RawBlockMarker) {
+            LM_ERROR("Snapshot is created on the platform with different byte order [path='{}']", path);
+            THROW_RUNTIME_ERROR();
+        }
+        if (header.version != serial::SnapshotVersion) {
+            LM_ERROR("Unsupported snapshot version [expected='{}', actual='{}']", serial::SnapshotVersion, header.version);
+            THROW_RUNTIME_ERROR();
+        }
+        if (header.tocOffset + header.tocSize > file->size() || header.stateOffset + header.stateSize > file->size()) {
+            LM_ERROR("Snapshot is truncated [path='{}']", path);
+            THROW_RUNTIME_ERROR();
+        }
+
+        // Register assets with table of contents
+        std::vector<serial::SnapshotEntry> toc;
+        {
+            serial::MemoryStreamBuf buf(file->data() + header.tocOffset, std::size_t(header.tocSize));
+            std::istream is(&buf);
+            serial::load(is, toc);
+        }
+        assets_->loadSnapshot(file, toc);
+
+        // Load scene and renderer.
+        // Assets referenced from them are loaded here.
+        {
+            serial::MemoryStreamBuf buf(file->data() + header.stateOffset, std::size_t(header.stateSize));
+            std::istream is(&buf);
+            serial::load(is, scene_);
+            serial::load(is, renderer_);
+        }
+    }
+
     virtual int rootNode() override {
         return scene_->rootNode();
     }
 
     virtual int primitiveNode(const Json& prop) override {
+        stopSession();
+        std::lock_guard<std::recursive_mutex> lock(stateMutex_);
         return scene_->createNode(SceneNodeType::Primitive, prop);
     }
 
     virtual int groupNode() override {
+        stopSession();
+        std::lock_guard<std::recursive_mutex> lock(stateMutex_);
         return scene_->createNode(SceneNodeType::Group, {});
     }
 
     virtual int instanceGroupNode() override {
+        stopSession();
+        std::lock_guard<std::recursive_mutex> lock(stateMutex_);
         return scene_->createNode(SceneNodeType::Group, {
             {"instanced", true}
         });
     }
 
+    virtual void createContext(const std::string& name, const Json& prop) override {
+        if (!root_) {
+            LM_ERROR("Contexts can only be created from the default context [name='{}']", name);
+            THROW_RUNTIME_ERROR();
+        }
+        if (name.empty() || name.find('.') != std::string::npos || name == "assets" || name == "scene" || name == "renderer") {
+            LM_ERROR("Invalid context name [name='{}']", name);
+            THROW_RUNTIME_ERROR();
+        }
+        if (this->context(name)) {
+            LM_ERROR("Context already exists [name='{}']", name);
+            THROW_RUNTIME_ERROR();
+        }
+        auto context = comp::create<UserContext>(key(), makeLoc(name), prop);
+        if (!context) {
+            THROW_RUNTIME_ERROR();
+        }
+        std::lock_guard<std::mutex> lock(contextsMutex_);
+        contexts_[name] = std::move(context);
+    }
+
+    virtual void releaseContext(const std::string& name) override {
+        Ptr<UserContext> context;
+        {
+            std::lock_guard<std::mutex> lock(contextsMutex_);
+            const auto it = contexts_.find(name);
+            if (it == contexts_.end()) {
+                LM_ERROR("Missing context [name='{}']", name);
+                THROW_RUNTIME_ERROR();
+            }
+            context = std::move(it->second);
+            contexts_.erase(it);
+        }
+    }
+
+    virtual UserContext* context(const std::string& name) override {
+        std::lock_guard<std::mutex> lock(contextsMutex_);
+        const auto it = contexts_.find(name);
+        return it != contexts_.end() ? it->second.get() : nullptr;
+    }
+
+    virtual void renderSequence(int numFrames, const SequenceFrameFunc& setupFrame, const std::string& filmName, const std::string& outpath) override {
+        if (!root_) {
+            LM_ERROR("Sequence can only be rendered from the default context");
+            THROW_RUNTIME_ERROR();
+        }
+        stopSession();
+        LM_INFO("Rendering sequence [frames={}]", numFrames);
+        LM_INDENT();
+
+        // Contexts of the frames being prepared, rendered, and saved, used in rotation.
+        // The contexts are kept across the frames so that the unchanged assets are reused.
+        constexpr int NumStages = 3;
+        std::array<std::string, NumStages> names;
+        std::array<UserContext_Default*, NumStages> frames;
+        for (int i = 0; i < NumStages; i++) {
+            names[i] = fmt::format("sequence{}", i);
+            createContext(names[i], {});
+            frames[i] = dynamic_cast<UserContext_Default*>(context(names[i]));
+            frames[i]->sequenceFrame_ = true;
+        }
+
+        // Prepare the frame in a separate thread
+        const auto prepare = [&](int frame) {
+            return std::async(std::launch::async, [&, frame] {
+                const int i = frame % NumStages;
+                ScopedContext ctx_(names[i]);
+                frames[i]->scene_ = comp::create<Scene>("scene::default", frames[i]->makeLoc("scene"));
+                setupFrame(frame);
+            });
+        };
+
+        // Save the frame in a separate thread
+        const auto save = [&](int frame) {
+            return std::async(std::launch::async, [&, frame] {
+                auto* frameContext = frames[frame % NumStages];
+                frameContext->save(frameContext->asset(filmName), fmt::format(outpath, frame));
+            });
+        };
+
+        std::future<void> preparing;
+        std::future<void> saving;
+        try {
+            if (numFrames > 0) {
+                preparing = prepare(0);
+            }
+            for (int frame = 0; frame < numFrames; frame++) {
+                // Wait for the preparation of the frame and start the next one.
+                // The context of the next frame has been used by the frame saved in the previous iteration.
+                preparing.get();
+                if (frame + 1 < numFrames) {
+                    preparing = prepare(frame + 1);
+                }
+
+                // Render the frame
+                LM_INFO("Rendering frame [frame={}]", frame);
+                auto* frameContext = frames[frame % NumStages];
+                if (!frameContext->renderer_) {
+                    LM_ERROR("Renderer is not specified [frame={}]", frame);
+                    THROW_RUNTIME_ERROR();
+                }
+                frameContext->render(false);
+
+                // Wait for the previous frame to be saved and save the frame
+                if (saving.valid()) {
+                    saving.get();
+                }
+                saving = save(frame);
+            }
+            if (saving.valid()) {
+                saving.get();
+            }
+        }
+        catch (...) {
+            if (preparing.valid()) {
+                preparing.wait();
+            }
+            if (saving.valid()) {
+                saving.wait();
+            }
+            for (const auto& name : names) {
+                releaseContext(name);
+            }
+            throw;
+        }
+        for (const auto& name : names) {
+            releaseContext(name);
+        }
+    }
+
     virtual int transformNode(Mat4 transform) override {
+        stopSession();
+        std::lock_guard<std::recursive_mutex> lock(stateMutex_);
         return scene_->createNode(SceneNodeType::Group, {
             {"transform", transform}
         });
     }
 
     virtual void addChild(int parent, int child) override {
+        stopSession();
+        std::lock_guard<std::recursive_mutex> lock(stateMutex_);
         scene_->addChild(parent, child);
     }
 
     virtual void addChildFromModel(int parent, const std::string& modelLoc) override {
+        stopSession();
+        std::lock_guard<std::recursive_mutex> lock(stateMutex_);
         scene_->addChildFromModel(parent, modelLoc);
     }
 
 private:
+    // Main loop of the session thread
+    void runSession() {
+        parallel::bindCancelFlag(&cancel_);
+        std::unique_lock<std::mutex> lock(sessionMutex_);
+        while (true) {
+            // Wait for a session to start
+            sessionCond_.wait(lock, [&] { return sessionActive_ || sessionExit_; });
+            if (sessionExit_) {
+                break;
+            }
+
+            // Dispatch rendering passes until the session is stopped
+            sessionRunning_ = true;
+            auto* film = sessionFilm_;
+            bool firstPass = true;
+            while (sessionActive_) {
+                lock.unlock();
+                try {
+                    // The passes after the first one continue the sample indices of the previous pass.
+                    // Otherwise the passes repeat the same samples with the sample generators or the fixed seed.
+                    std::lock_guard<std::recursive_mutex> stateLock(stateMutex_);
+                    renderer_->continueSamples(!firstPass);
+                    firstPass = false;
+                    renderer_->render(scene_.get());
+                    renderer_->continueSamples(false);
+                }
+                catch (const std::exception& e) {
+                    LM_ERROR("Session is terminated [error='{}']", e.what());
+                    {
+                        std::lock_guard<std::recursive_mutex> stateLock(stateMutex_);
+                        renderer_->continueSamples(false);
+                    }
+                    lock.lock();
+                    sessionActive_ = false;
+                    break;
+                }
+                lock.lock();
+
+                // Discard the pass interrupted by the cancellation
+                if (!sessionActive_) {
+                    break;
+                }
+
+                // Accumulate the pass
+                const auto buf = film->buffer();
+                if (buf.w != sessionSize_.w || buf.h != sessionSize_.h) {
+                    LM_ERROR("Film size has been changed during the session");
+                    sessionActive_ = false;
+                    break;
+                }
+                for (size_t i = 0; i < sessionAccum_.size(); i++) {
+                    sessionAccum_[i] += buf.data[i];
+                }
+                sessionPasses_++;
+            }
+            sessionRunning_ = false;
+            sessionCond_.notify_all();
+        }
+    }
+
+private:
+    bool root_ = false;                     // True if the context is the default context
     Component::Ptr<Assets> assets_;
     Component::Ptr<Scene> scene_;
     Component::Ptr<Renderer> renderer_;
+
+    // Guards the object tree of the context, e.g., against the traversal on asset replacement
+    // from the other threads. stopSession() must be called before locking it
+    // because the session thread takes it for each pass.
+    std::recursive_mutex stateMutex_;
+
+    // Cancellation flag of the parallel loops dispatched by the context
+    parallel::CancelFlag cancel_ = false;
+
+    // Child contexts created by createContext()
+    mutable std::mutex contextsMutex_;
+    std::unordered_map<std::string, Ptr<UserContext>> contexts_;
+
+    // Frame of a sequence rendered by renderSequence()
+    bool sequenceFrame_ = false;                        // True if the context is used for the frames
+    std::unordered_map<std::string, Json> sequenceAssets_;  // Type and properties of the created assets
+
+    // Interactive render session
+    std::thread sessionThread_;             // Thread dispatching rendering passes
+    std::mutex sessionMutex_;               // Guards the session states
+    std::condition_variable sessionCond_;   // Notifies the changes of the session states
+    bool sessionActive_ = false;            // True if the session is requested to run
+    bool sessionRunning_ = false;           // True if the session thread is running passes
+    bool sessionExit_ = false;              // True if the session thread is requested to exit
+    Film* sessionFilm_ = nullptr;           // Film which the renderer outputs to
+    FilmSize sessionSize_{};                // Size of the accumulated image
+    std::vector<Float> sessionAccum_;       // Sum of the images of completed passes
+    std::vector<Float> sessionBuffer_;      // Averaged image returned by sessionBuffer()
+    std::atomic<long long> sessionPasses_ = 0;  // Number of completed passes
 };
 
 LM_COMP_REG_IMPL(UserContext_Default, "user::default");
@@ -230,84 +691,123 @@ LM_COMP_REG_IMPL(UserContext_Default, "user::default");
 
 using Instance = comp::detail::ContextInstance<user::detail::UserContext>;
 
+namespace {
+
+// User context bound to the current thread. nullptr for the default context.
+thread_local user::detail::UserContext* BoundContext = nullptr;
+thread_local std::string BoundContextName;
+
+// Get the user context the API calls in the current thread operate on
+user::detail::UserContext& context() {
+    return BoundContext ? *BoundContext : Instance::get();
+}
+
+}
+
 LM_PUBLIC_API void init(const std::string& type, const Json& prop) {
     Instance::init(type, prop);
 }
 
 LM_PUBLIC_API void shutdown() {
+    BoundContext = nullptr;
+    BoundContextName.clear();
     Instance::shutdown();
 }
 
 LM_PUBLIC_API void reset() {
-    Instance::get().reset();
+    context().reset();
 }
 
 LM_PUBLIC_API void info() {
-    Instance::get().info();
+    context().info();
 }
 
 LM_PUBLIC_API std::string asset(const std::string& name, const std::string& implKey, const Json& prop) {
-    return Instance::get().asset(name, implKey, prop);
+    return context().asset(name, implKey, prop);
 }
 
 LM_PUBLIC_API std::string asset(const std::string& name) {
-    return Instance::get().asset(name);
+    return context().asset(name);
 }
 
 LM_PUBLIC_API void build(const std::string& accelName, const Json& prop) {
-    Instance::get().build(accelName, prop);
+    context().build(accelName, prop);
 }
 
 LM_PUBLIC_API void renderer(const std::string& rendererName, const Json& prop) {
-    Instance::get().renderer(rendererName, prop);
+    context().renderer(rendererName, prop);
 }
 
 LM_PUBLIC_API void render(bool verbose) {
-    Instance::get().render(verbose);
+    context().render(verbose);
 }
 
 LM_PUBLIC_API void save(const std::string& filmName, const std::string& outpath) {
-    Instance::get().save(filmName, outpath);
+    context().save(filmName, outpath);
 }
 
 LM_PUBLIC_API FilmBuffer buffer(const std::string& filmName) {
-    return Instance::get().buffer(filmName);
+    return context().buffer(filmName);
+}
+
+LM_PUBLIC_API void startSession(const std::string& filmName) {
+    context().startSession(filmName);
+}
+
+LM_PUBLIC_API void stopSession() {
+    context().stopSession();
+}
+
+LM_PUBLIC_API FilmBuffer sessionBuffer() {
+    return context().sessionBuffer();
+}
+
+LM_PUBLIC_API long long sessionPasses() {
+    return context().sessionPasses();
 }
 
 LM_PUBLIC_API void serialize(std::ostream& os) {
-    Instance::get().serialize(os);
+    context().serialize(os);
 }
 
 LM_PUBLIC_API void deserialize(std::istream& is) {
-    Instance::get().deserialize(is);
+    context().deserialize(is);
+}
+
+LM_PUBLIC_API void serializeSnapshot(const std::string& path) {
+    context().serializeSnapshot(path);
+}
+
+LM_PUBLIC_API void deserializeSnapshot(const std::string& path) {
+    context().deserializeSnapshot(path);
 }
 
 LM_PUBLIC_API int rootNode() {
-    return Instance::get().rootNode();
+    return context().rootNode();
 }
 
 LM_PUBLIC_API int primitiveNode(const Json& prop) {
-    return Instance::get().primitiveNode(prop);
+    return context().primitiveNode(prop);
 }
 
 LM_PUBLIC_API int groupNode() {
-    return Instance::get().groupNode();
+    return context().groupNode();
 }
 
 LM_PUBLIC_API int instanceGroupNode() {
-    return Instance::get().instanceGroupNode();
+    return context().instanceGroupNode();
 }
 
 LM_PUBLIC_API int transformNode(Mat4 transform) {
-    return Instance::get().transformNode(transform);
+    return context().transformNode(transform);
 }
 
 LM_PUBLIC_API void addChild(int parent, int child) {
-    Instance::get().addChild(parent, child);
+    context().addChild(parent, child);
 }
 
 LM_PUBLIC_API void addChildFromModel(int parent, const std::string& modelLoc) {
-    Instance::get().addChildFromModel(parent, modelLoc);
+    context().addChildFromModel(parent, modelLoc);
 }
 
 LM_PUBLIC_API void primitive(Mat4 transform, const Json& prop) {
@@ -321,4 +821,41 @@ LM_PUBLIC_API void primitive(Mat4 transform, const Json& prop) {
     addChild(rootNode(), t);
 }
 
+// ----------------------------------------------------------------------------
+
+LM_PUBLIC_API void createContext(const std::string& name, const Json& prop) {
+    Instance::get().createContext(name, prop);
+}
+
+LM_PUBLIC_API void releaseContext(const std::string& name) {
+    if (name == BoundContextName) {
+        LM_ERROR("Context is bound to the current thread [name='{}']", name);
+        THROW_RUNTIME_ERROR();
+    }
+    Instance::get().releaseContext(name);
+}
+
+LM_PUBLIC_API void renderSequence(int numFrames, const SequenceFrameFunc& setupFrame, const std::string& filmName, const std::string& outpath) {
+    context().renderSequence(numFrames, setupFrame, filmName, outpath);
+}
+
+LM_PUBLIC_API void bindContext(const std::string& name) {
+    if (name.empty()) {
+        BoundContext = nullptr;
+        BoundContextName.clear();
+        return;
+    }
+    auto* context = Instance::get().context(name);
+    if (!context) {
+        LM_ERROR("Missing context [name='{}']", name);
+        THROW_RUNTIME_ERROR();
+    }
+    BoundContext = context;
+    BoundContextName = name;
+}
+
+LM_PUBLIC_API std::string boundContext() {
+    return BoundContextName;
+}
+
 LM_NAMESPACE_END(LM_NAMESPACE)
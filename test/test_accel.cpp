@@ -0,0 +1,145 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/lm.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+namespace {
+
+// Two quads and a transformed copy of them
+void setupScene() {
+    lm::asset("mesh", "mesh::raw", {
+        {"ps", {-1,-1,0, 1,-1,0, 1,1,0, -1,1,0, -1,-1,-1, 1,-1,-1, 1,1,-1, -1,1,-1}},
+        {"ns", {0,0,1}},
+        {"ts", {0,0}},
+        {"fs", {
+            {"p", {0,1,2, 0,2,3, 4,5,6, 4,6,7}},
+            {"n", {0,0,0, 0,0,0, 0,0,0, 0,0,0}},
+            {"t", {0,0,0, 0,0,0, 0,0,0, 0,0,0}}
+        }}
+    });
+    lm::asset("material", "material::diffuse", {{"Kd", {1,1,1}}});
+    const lm::Json prop = {
+        {"mesh", lm::asset("mesh")},
+        {"material", lm::asset("material")}
+    };
+    lm::primitive(glm::scale(lm::Vec3(.5)), prop);
+    lm::primitive(glm::translate(lm::Vec3(.7,.3,.5)) * glm::rotate(lm::Float(.3), lm::Vec3(0,1,0)), prop);
+}
+
+// Rays through a grid over the scene
+std::vector<lm::Ray> gridRays() {
+    std::vector<lm::Ray> rays;
+    const int n = 16;
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            const lm::Vec3 target(lm::Float(x)/n*4-2, lm::Float(y)/n*4-2, 0);
+            const lm::Vec3 o(0,0,5);
+            rays.push_back({ o, glm::normalize(target - o) });
+        }
+    }
+    return rays;
+}
+
+}
+
+TEST_CASE("Acceleration structure serialization") {
+    // The accels in the plugins are tested only if the plugins are built
+    ScopedLoadOptionalPlugins plugins_({ "accel_nanort", "accel_embree" });
+    lm::ScopedInit init_;
+    setupScene();
+
+    for (const std::string name : { "accel::sahbvh", "accel::nanort", "accel::embree", "accel::embreeinstanced" }) {
+        if (!registered(name)) {
+            continue;
+        }
+        CAPTURE(name);
+        lm::build(name);
+        auto* accel = lm::comp::get<lm::Accel>("$.scene.accel");
+        REQUIRE(accel);
+
+        // Save the built accel and restore it into a new instance
+        std::stringstream ss;
+        {
+            lm::OutputArchive ar(ss);
+            accel->save(ar);
+        }
+        auto loaded = lm::comp::create<lm::Accel>(name, "");
+        REQUIRE(loaded);
+        {
+            lm::InputArchive ar(ss);
+            loaded->load(ar);
+        }
+
+        // The restored accel must give the same hits
+        int numHits = 0;
+        for (const auto& ray : gridRays()) {
+            const auto hit1 = accel->intersect(ray, lm::Eps, lm::Inf);
+            const auto hit2 = loaded->intersect(ray, lm::Eps, lm::Inf);
+            REQUIRE(bool(hit1) == bool(hit2));
+            if (!hit1) {
+                continue;
+            }
+            numHits++;
+            CHECK(hit1->t == doctest::Approx(hit2->t));
+            CHECK(hit1->uv.x == doctest::Approx(hit2->uv.x));
+            CHECK(hit1->uv.y == doctest::Approx(hit2->uv.y));
+            CHECK(hit1->primitive == hit2->primitive);
+            CHECK(hit1->face == hit2->face);
+            const auto M1 = accel->instanceTransform(hit1->instance).M;
+            const auto M2 = loaded->instanceTransform(hit2->instance).M;
+            CHECK(M1 == M2);
+        }
+        CHECK(numHits > 0);
+    }
+}
+
+TEST_CASE("Occlusion query") {
+    ScopedLoadOptionalPlugins plugins_({ "accel_nanort", "accel_embree" });
+    lm::ScopedInit init_;
+    setupScene();
+
+    for (const std::string name : { "accel::sahbvh", "accel::nanort", "accel::embree", "accel::embreeinstanced" }) {
+        if (!registered(name)) {
+            continue;
+        }
+        CAPTURE(name);
+        lm::build(name);
+        auto* accel = lm::comp::get<lm::Accel>("$.scene.accel");
+        REQUIRE(accel);
+
+        // The occlusion must agree with the closest hit, also for the segments ending before the hit
+        int numOccluded = 0;
+        for (const auto& ray : gridRays()) {
+            const auto hit = accel->intersect(ray, lm::Eps, lm::Inf);
+            CHECK(accel->occluded(ray, lm::Eps, lm::Inf) == bool(hit));
+            if (!hit) {
+                continue;
+            }
+            numOccluded++;
+            CHECK(accel->occluded(ray, lm::Eps, hit->t * lm::Float(1.01)));
+            CHECK(!accel->occluded(ray, lm::Eps, hit->t * lm::Float(.99)));
+        }
+        CHECK(numOccluded > 0);
+    }
+}
+
+TEST_CASE("Acceleration structure cache") {
+    lm::ScopedInit init_;
+    setupScene();
+
+    // The accel is reused only if the cache is enabled
+    lm::build("accel::sahbvh", {{"cache", true}});
+    const auto* accel1 = lm::comp::get<lm::Accel>("$.scene.accel");
+    lm::build("accel::sahbvh", {{"cache", true}});
+    CHECK(lm::comp::get<lm::Accel>("$.scene.accel") == accel1);
+    lm::build("accel::sahbvh");
+    CHECK(lm::comp::get<lm::Accel>("$.scene.accel") != accel1);
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -28,6 +28,10 @@ struct TestAsset_Simple final : public TestAsset {
     virtual int f() const override {
         return v;
     }
+
+    LM_SERIALIZE_IMPL(ar) {
+        ar(v);
+    }
 };
 
 struct TestAsset_Dependent final : public TestAsset {
@@ -48,6 +52,10 @@ struct TestAsset_Dependent final : public TestAsset {
     virtual int f() const override {
         return other->f() + 1;
     }
+
+    LM_SERIALIZE_IMPL(ar) {
+        ar(other);
+    }
 };
 
 LM_COMP_REG_IMPL(TestAsset_Simple, "testasset::simple");
@@ -119,6 +127,66 @@ TEST_CASE("Assets") {
             REQUIRE(a);
             CHECK(a->f() == 2);
         }
+        {
+            // Replace asset1 again with the index of the weak references updated by the last replacement
+            CHECK(assets->loadAsset("asset1", "testasset::simple", { {"v", 5} }));
+            auto* a = dynamic_cast<TestAsset*>(assets->underlying("asset2"));
+            REQUIRE(a);
+            CHECK(a->f() == 6);
+        }
+        {
+            // The referrer is destructed when asset2 is replaced, so asset1 is no longer referenced
+            CHECK(assets->loadAsset("asset2", "testasset::simple", { {"v", 7} }));
+            CHECK(assets->loadAsset("asset1", "testasset::simple", { {"v", 8} }));
+            CHECK(assets->loadAsset("asset3", "testasset::dependent", {}));
+            auto* a = dynamic_cast<TestAsset*>(assets->underlying("asset3"));
+            REQUIRE(a);
+            CHECK(a->f() == 9);
+            CHECK(assets->loadAsset("asset1", "testasset::simple", { {"v", 10} }));
+            CHECK(a->f() == 11);
+            auto* b = dynamic_cast<TestAsset*>(assets->underlying("asset2"));
+            REQUIRE(b);
+            CHECK(b->f() == 7);
+        }
+    }
+
+    SUBCASE("Snapshot") {
+        CHECK(assets->loadAsset("asset1", "testasset::simple", { {"v", 42} }));
+        CHECK(assets->loadAsset("asset2", "testasset::dependent", {}));
+
+        // Save assets to a snapshot
+        const std::string path = "test_assets_snapshot";
+        std::vector<lm::serial::SnapshotEntry> toc;
+        {
+            std::ofstream os(path, std::ios::out | std::ios::binary);
+            toc = assets->saveSnapshot(os);
+        }
+        REQUIRE(toc.size() == 2);
+        CHECK(toc[0].name == "asset1");
+        CHECK(toc[1].name == "asset2");
+        CHECK(toc[0].offset % lm::serial::SnapshotAlignment == 0);
+        CHECK(toc[1].offset % lm::serial::SnapshotAlignment == 0);
+
+        {
+            // Load the snapshot to another assets
+            auto loaded = lm::comp::create<lm::Assets>("assets::default", "$");
+            REQUIRE(loaded);
+            lm::comp::detail::registerRootComp(loaded.get());
+            auto file = lm::serial::mapFile(path);
+            REQUIRE(file);
+            loaded->loadSnapshot(file, toc);
+
+            // asset1 is loaded via the weak reference from asset2
+            auto* a = dynamic_cast<TestAsset*>(loaded->underlying("asset2"));
+            REQUIRE(a);
+            CHECK(a->f() == 43);
+            auto* b = dynamic_cast<TestAsset*>(loaded->underlying("asset1"));
+            REQUIRE(b);
+            CHECK(b->f() == 42);
+        }
+
+        lm::comp::detail::registerRootComp(assets.get());
+        fs::remove(path);
     }
 }
 
@@ -5,11 +5,48 @@
 
 #include <pch.h>
 #include "test_common.h"
+#include <lm/component.h>
 #include <iostream>
 #include <sstream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<bool> allocationCounting_ = false;
+std::atomic<long long> allocationCount_ = 0;
+}
+
+// Replace global allocation functions to count allocations
+void* operator new(std::size_t size) {
+    if (allocationCounting_) {
+        allocationCount_++;
+    }
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
 
 LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
 
+ScopedAllocationCounter::ScopedAllocationCounter() {
+    allocationCount_ = 0;
+    allocationCounting_ = true;
+}
+
+ScopedAllocationCounter::~ScopedAllocationCounter() {
+    allocationCounting_ = false;
+}
+
+long long ScopedAllocationCounter::count() const {
+    return allocationCount_;
+}
+
 std::string captureStdout(const std::function<void()>& testFunc) {
     std::stringstream ss;
     auto* old = std::cout.rdbuf(ss.rdbuf());
@@ -19,4 +56,22 @@ std::string captureStdout(const std::function<void()>& testFunc) {
     return text;
 }
 
+ScopedLoadOptionalPlugins::ScopedLoadOptionalPlugins(std::initializer_list<std::string> names) {
+    for (const auto& name : names) {
+        lm::comp::detail::loadPlugin(name);
+    }
+}
+
+ScopedLoadOptionalPlugins::~ScopedLoadOptionalPlugins() {
+    lm::comp::detail::unloadPlugins();
+}
+
+bool registered(const std::string& key) {
+    bool found = false;
+    lm::comp::detail::foreachRegistered([&](const std::string& name) {
+        found |= name == key;
+    });
+    return found;
+}
+
 LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -8,6 +8,8 @@
 #include <lm/common.h>
 #include <lm/logger.h>
 #include <functional>
+#include <initializer_list>
+#include <string>
 #include <doctest/doctest.h>
 
 #define LM_TEST_NAMESPACE lmtest
@@ -17,4 +19,25 @@ LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
 // Captures outputs from std::cout
 std::string captureStdout(const std::function<void()>& testFunc);
 
+// Counts heap allocations via global operator new while the instance is alive.
+// The allocations in all threads are counted.
+class ScopedAllocationCounter {
+public:
+    ScopedAllocationCounter();
+    ~ScopedAllocationCounter();
+    long long count() const;
+};
+
+// Loads the plugins which might not be built, e.g., the plugins with external dependencies.
+// The missing plugins are ignored. The loaded plugins are unloaded at the end of the scope,
+// so the instance must outlive the components created from the plugins.
+class ScopedLoadOptionalPlugins {
+public:
+    ScopedLoadOptionalPlugins(std::initializer_list<std::string> names);
+    ~ScopedLoadOptionalPlugins();
+};
+
+// Check if the component implementation with the key is registered
+bool registered(const std::string& key);
+
 LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -147,6 +147,10 @@ struct H_Root_ : public H {
         if (name == "p1") {
             return p1.get();
         }
+        if (name == "alias") {
+            // Alias to the component p2 in the hierarchy
+            return p1 ? p1->underlying("p2") : nullptr;
+        }
         return nullptr;
     }
 };
@@ -194,6 +198,7 @@ TEST_CASE("Component query") {
     // - $
     //   - p1
     //     - p2
+    //   - alias (= p2)
 
     SUBCASE("get") {
         // Root component
@@ -211,6 +216,35 @@ TEST_CASE("Component query") {
         CHECK(p2);
         CHECK(p2->name() == "p2");
     }
+
+    SUBCASE("get after replacement") {
+        // Query once to cache the instances
+        CHECK(lm::comp::get<H>("$.p1.p2"));
+
+        // Replace p1 with a new instance with the same locator
+        auto* r = dynamic_cast<H_Root_*>(root.get());
+        r->p1 = lm::comp::create<H>("test::comp::h_p1_", "$.p1", {});
+        REQUIRE(r->p1);
+
+        // Queries must return the new instances
+        const auto* p1 = lm::comp::get<H>("$.p1");
+        CHECK(p1 == r->p1.get());
+        const auto* p2 = lm::comp::get<H>("$.p1.p2");
+        CHECK(p2 == r->p1->underlying("p2"));
+    }
+
+    SUBCASE("get via alias") {
+        // The alias gives the instance with the different locator
+        const auto* p2 = lm::comp::get<H>("$.alias");
+        REQUIRE(p2);
+        CHECK(p2->loc() == "$.p1.p2");
+
+        // The query via the alias must not return the destroyed instance
+        auto* r = dynamic_cast<H_Root_*>(root.get());
+        r->p1.reset();
+        CHECK(!lm::comp::get<H>("$.alias"));
+        CHECK(!lm::comp::get<H>("$.p1.p2"));
+    }
 }
 
 // ----------------------------------------------------------------------------
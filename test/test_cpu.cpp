@@ -0,0 +1,96 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/lm.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+TEST_CASE("CPU dispatch") {
+    lm::ScopedInit init_;
+
+    SUBCASE("ISA selection") {
+        const auto detected = lm::cpu::detect();
+        CHECK(lm::cpu::selected() == detected);
+        CHECK(lm::cpu::select("baseline"));
+        CHECK(lm::cpu::selected() == lm::cpu::ISA::Baseline);
+        CHECK(!lm::cpu::select("mmx"));
+        CHECK(lm::cpu::selected() == lm::cpu::ISA::Baseline);
+
+        // Unsupported ISA is capped by the detected one
+        CHECK(lm::cpu::select("avx512"));
+        CHECK(int(lm::cpu::selected()) <= int(detected));
+        CHECK(lm::cpu::select("auto"));
+        CHECK(lm::cpu::selected() == detected);
+    }
+
+    SUBCASE("Same intersections for all ISAs") {
+        // Random triangles in the unit cube
+        lm::Rng rng(42);
+        std::vector<lm::Float> ps;
+        std::vector<int> fs;
+        for (int i = 0; i < 300; i++) {
+            const auto c = lm::Vec3(rng.u(), rng.u(), rng.u()) - lm::Float(.5);
+            for (int j = 0; j < 3; j++) {
+                const auto p = c + (lm::Vec3(rng.u(), rng.u(), rng.u()) - lm::Float(.5)) * lm::Float(.3);
+                ps.insert(ps.end(), { p.x, p.y, p.z });
+                fs.push_back(3*i + j);
+            }
+        }
+        lm::asset("mesh", "mesh::raw", {
+            {"ps", ps},
+            {"ns", {0,0,1}},
+            {"ts", {0,0}},
+            {"fs", {
+                {"p", fs},
+                {"n", std::vector<int>(fs.size(), 0)},
+                {"t", std::vector<int>(fs.size(), 0)}
+            }}
+        });
+        lm::asset("material", "material::diffuse", {{"Kd", {1,1,1}}});
+        lm::primitive(lm::Mat4(1), {
+            {"mesh", lm::asset("mesh")},
+            {"material", lm::asset("material")}
+        });
+        lm::build("accel::sahbvh");
+        const auto* scene = lm::comp::get<lm::Scene>("$.scene");
+        REQUIRE(scene);
+
+        std::vector<lm::Ray> rays;
+        for (int i = 0; i < 500; i++) {
+            const auto o = lm::math::sampleUniformSphere(rng) * lm::Float(3);
+            const auto target = lm::Vec3(rng.u(), rng.u(), rng.u()) - lm::Float(.5);
+            rays.push_back({ o, glm::normalize(target - o) });
+        }
+
+        // Intersections with the baseline kernel as reference
+        const auto intersectAll = [&]() {
+            std::vector<std::optional<lm::SceneInteraction>> hits;
+            for (const auto& ray : rays) {
+                hits.push_back(scene->intersect(ray));
+            }
+            return hits;
+        };
+        REQUIRE(lm::cpu::select("baseline"));
+        const auto ref = intersectAll();
+        for (const std::string isa : { "sse42", "avx2", "avx512" }) {
+            CAPTURE(isa);
+            REQUIRE(lm::cpu::select(isa));
+            const auto hits = intersectAll();
+            for (size_t i = 0; i < rays.size(); i++) {
+                REQUIRE(bool(hits[i]) == bool(ref[i]));
+                if (ref[i]) {
+                    CHECK(hits[i]->geom.p.x == doctest::Approx(ref[i]->geom.p.x));
+                    CHECK(hits[i]->geom.p.y == doctest::Approx(ref[i]->geom.p.y));
+                    CHECK(hits[i]->geom.p.z == doctest::Approx(ref[i]->geom.p.z));
+                }
+            }
+        }
+        lm::cpu::select("auto");
+    }
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
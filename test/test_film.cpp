@@ -0,0 +1,142 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/lm.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+TEST_CASE("Film layers") {
+    lm::ScopedInit init_;
+
+    SUBCASE("Layers of bitmap film") {
+        auto* film = lm::comp::get<lm::Film>(lm::asset("film", "film::bitmap", {
+            {"w", 4},
+            {"h", 2},
+            {"aovs", {"albedo", "depth"}}
+        }));
+        REQUIRE(film);
+        CHECK(film->layerIndex("color") == 0);
+        CHECK(film->layerIndex("albedo") == 1);
+        CHECK(film->layerIndex("depth") == 2);
+        CHECK(film->layerIndex("normal") == -1);
+
+        // Layers are independent of the color
+        film->splatLayer(1, 1, 1, lm::Vec3(2));
+        film->splatLayer(1, 1, 1, lm::Vec3(4));
+        film->setLayerPixel(2, 3, 0, lm::Vec3(1));
+        CHECK(film->layerPixel(0, 1, 1) == lm::Vec3(0));
+        CHECK(film->layerPixel(1, 1, 1) == lm::Vec3(6));
+        CHECK(film->layerPixel(2, 3, 0) == lm::Vec3(1));
+
+        // Rescale and clear apply to all layers
+        film->rescale(.5);
+        CHECK(film->layerPixel(1, 1, 1) == lm::Vec3(3));
+        const auto buf = film->layerBuffer(1);
+        CHECK(buf.data[3*(1*4+1)] == 3);
+        film->clear();
+        CHECK(film->layerPixel(1, 1, 1) == lm::Vec3(0));
+        CHECK(film->layerPixel(2, 3, 0) == lm::Vec3(0));
+    }
+
+    SUBCASE("Duplicated layer") {
+        CHECK_THROWS(lm::asset("film", "film::bitmap", {
+            {"w", 4},
+            {"h", 2},
+            {"aovs", {"albedo", "albedo"}}
+        }));
+    }
+
+    SUBCASE("Denoising preserves constant image") {
+        auto* film = lm::comp::get<lm::Film>(lm::asset("film", "film::bitmap", {
+            {"w", 16},
+            {"h", 16},
+            {"aovs", {"albedo", "normal", "depth", "variance"}}
+        }));
+        REQUIRE(film);
+        for (int y = 0; y < 16; y++) {
+            for (int x = 0; x < 16; x++) {
+                film->setPixel(x, y, lm::Vec3(.25, .5, .75));
+                film->setLayerPixel(film->layerIndex("albedo"), x, y, lm::Vec3(.5));
+                film->setLayerPixel(film->layerIndex("normal"), x, y, lm::Vec3(0,0,1));
+                film->setLayerPixel(film->layerIndex("depth"), x, y, lm::Vec3(x < 8 ? 1 : 10));
+                film->setLayerPixel(film->layerIndex("variance"), x, y, lm::Vec3(.01));
+            }
+        }
+        lm::render("renderer::denoise", {
+            {"input", lm::asset("film")},
+            {"tile_size", 5}
+        });
+        for (int y = 0; y < 16; y++) {
+            for (int x = 0; x < 16; x++) {
+                const auto v = film->layerPixel(0, x, y);
+                CHECK(v.x == doctest::Approx(.25));
+                CHECK(v.y == doctest::Approx(.5));
+                CHECK(v.z == doctest::Approx(.75));
+            }
+        }
+    }
+
+    SUBCASE("Denoising reduces noise and preserves feature edges") {
+        // Two regions split at x=16 with different albedos and normals.
+        // The noise-free image is the albedo.
+        const int w = 32;
+        const int h = 16;
+        auto* film = lm::comp::get<lm::Film>(lm::asset("film", "film::bitmap", {
+            {"w", w},
+            {"h", h},
+            {"aovs", {"albedo", "normal", "variance"}}
+        }));
+        REQUIRE(film);
+        const auto albedo = [](int x) { return lm::Float(x < 16 ? .2 : .8); };
+        lm::Rng rng(42);
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                const auto a = albedo(x);
+                film->setPixel(x, y, lm::Vec3(a * (lm::Float(.5) + rng.u())));
+                film->setLayerPixel(film->layerIndex("albedo"), x, y, lm::Vec3(a));
+                film->setLayerPixel(film->layerIndex("normal"), x, y, x < 16 ? lm::Vec3(0,0,1) : lm::Vec3(1,0,0));
+                film->setLayerPixel(film->layerIndex("variance"), x, y, lm::Vec3(a * a / 12));
+            }
+        }
+
+        // Mean and variance of the pixels in the columns [x0,x1)
+        const auto stats = [&](int x0, int x1) -> std::pair<lm::Float, lm::Float> {
+            lm::Float sum = 0, sum2 = 0;
+            const int n = (x1 - x0) * h;
+            for (int y = 0; y < h; y++) {
+                for (int x = x0; x < x1; x++) {
+                    const auto v = film->layerPixel(0, x, y).x;
+                    sum += v;
+                    sum2 += v * v;
+                }
+            }
+            const auto mean = sum / n;
+            return { mean, sum2 / n - mean * mean };
+        };
+        const auto left = stats(0, 16);
+        const auto right = stats(16, 32);
+
+        lm::render("renderer::denoise", {
+            {"input", lm::asset("film")},
+            {"tile_size", 5}
+        });
+
+        // The variance drops in both regions and the means are kept
+        const auto left2 = stats(0, 16);
+        const auto right2 = stats(16, 32);
+        CHECK(left2.second < left.second * lm::Float(.25));
+        CHECK(right2.second < right.second * lm::Float(.25));
+        CHECK(left2.first == doctest::Approx(left.first).epsilon(.05));
+        CHECK(right2.first == doctest::Approx(right.first).epsilon(.05));
+
+        // The columns next to the edge are not blurred across the edge
+        CHECK(stats(15, 16).first == doctest::Approx(albedo(15)).epsilon(.1));
+        CHECK(stats(16, 17).first == doctest::Approx(albedo(16)).epsilon(.1));
+    }
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
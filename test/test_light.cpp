@@ -0,0 +1,111 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/lm.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+namespace {
+
+// Write a small environment map with varying colors
+void writeEnvmap(const std::string& path) {
+    const int w = 8;
+    const int h = 4;
+    std::ofstream os(path, std::ios::out | std::ios::binary);
+    os << "P6\n" << w << " " << h << "\n255\n";
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            const unsigned char c[] = { (unsigned char)(32*x), (unsigned char)(64*y), 128 };
+            os.write(reinterpret_cast<const char*>(c), 3);
+        }
+    }
+}
+
+// Number of files in the directory with the extension
+int countFiles(const std::string& dir, const std::string& ext) {
+    if (!fs::exists(dir)) {
+        return 0;
+    }
+    int count = 0;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.path().extension() == ext) {
+            count++;
+        }
+    }
+    return count;
+}
+
+}
+
+TEST_CASE("Environment light with portals") {
+    lm::ScopedInit init_;
+    const std::string envmap = "test_envportal.ppm";
+    const std::string cacheDir = "test_envportal_cache";
+    writeEnvmap(envmap);
+    fs::remove_all(cacheDir);
+
+    const auto create = [&](const std::string& name) {
+        return lm::asset(name, "light::envportal", {
+            {"path", envmap},
+            {"portal", {{-1,-1,1}, {1,-1,1}, {1,1,1}, {-1,1,1}}},
+            {"dist_size", 16},
+            {"cache_dir", cacheDir}
+        });
+    };
+
+    // Weights and pdfs of the samples from the surface at the origin facing the portal
+    const auto samples = [](const std::string& loc) {
+        const auto* light = lm::comp::get<lm::Light>(loc);
+        REQUIRE(light);
+        lm::Rng rng(42);
+        const lm::Transform transform(lm::Mat4(1));
+        const auto geom = lm::PointGeometry::makeOnSurface(lm::Vec3(0), lm::Vec3(0,0,1));
+        std::vector<lm::Vec4> ws;
+        for (int i = 0; i < 100; i++) {
+            const auto s = light->sample(rng, geom, transform);
+            REQUIRE(s);
+            const auto pdf = light->pdf(geom, s->geom, s->comp, transform, s->wo);
+            CHECK(std::isfinite(s->weight.x));
+            CHECK(std::isfinite(s->weight.y));
+            CHECK(std::isfinite(s->weight.z));
+            CHECK(glm::compMax(s->weight) > 0);
+            CHECK(std::isfinite(pdf));
+            CHECK(pdf > 0);
+            ws.push_back(lm::Vec4(s->weight, pdf));
+        }
+        return ws;
+    };
+
+    SUBCASE("Cache gives the same distributions") {
+        const auto expected = samples(create("env1"));
+        CHECK(countFiles(cacheDir, ".bin") == 1);
+        CHECK(countFiles(cacheDir, ".tmp") == 0);
+        CHECK(samples(create("env2")) == expected);
+    }
+
+    SUBCASE("Broken cache is recomputed") {
+        const auto expected = samples(create("env1"));
+        for (const auto& entry : fs::directory_iterator(cacheDir)) {
+            std::ofstream os(entry.path().string(), std::ios::out | std::ios::binary | std::ios::trunc);
+            os << "broken";
+        }
+        CHECK(samples(create("env2")) == expected);
+    }
+
+    SUBCASE("Cancelled precomputation is not cached") {
+        lm::parallel::CancelFlag flag = true;
+        lm::parallel::ScopedCancelFlag cancelGuard(&flag);
+        CHECK_THROWS(create("env1"));
+        CHECK(countFiles(cacheDir, ".bin") == 0);
+        CHECK(countFiles(cacheDir, ".tmp") == 0);
+    }
+
+    fs::remove_all(cacheDir);
+    fs::remove(envmap);
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -0,0 +1,56 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/lm.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+TEST_CASE("Cancellation of parallel loops") {
+    lm::ScopedInit init_;
+    const long long N = 10000;
+
+    SUBCASE("Cancellation is limited to the bound flag") {
+        // Cancel the loops of the main thread
+        lm::parallel::CancelFlag flag = false;
+        lm::parallel::ScopedCancelFlag cancelGuard(&flag);
+        lm::parallel::requestCancel();
+        CHECK(lm::parallel::cancelRequested());
+
+        // The loop in the thread with another flag is not affected
+        std::atomic<long long> count1 = 0;
+        std::thread th([&]() {
+            lm::parallel::CancelFlag flag2 = false;
+            lm::parallel::ScopedCancelFlag cancelGuard2(&flag2);
+            CHECK(!lm::parallel::cancelRequested());
+            lm::parallel::foreach(N, [&](long long, int) {
+                count1++;
+            });
+        });
+        th.join();
+        CHECK(count1 == N);
+
+        // The loop of the main thread skips all iterations
+        std::atomic<long long> count2 = 0;
+        lm::parallel::foreach(N, [&](long long, int) {
+            count2++;
+        });
+        CHECK(count2 == 0);
+        lm::parallel::resetCancel();
+    }
+
+    SUBCASE("Default flag is restored") {
+        lm::parallel::CancelFlag flag = false;
+        {
+            lm::parallel::ScopedCancelFlag cancelGuard(&flag);
+            lm::parallel::requestCancel();
+        }
+        CHECK(flag);
+        CHECK(!lm::parallel::cancelRequested());
+    }
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
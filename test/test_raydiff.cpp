@@ -0,0 +1,77 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/lm.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+TEST_CASE("Ray differentials") {
+    lm::ScopedInit init_;
+
+    // Quad of size 2x2 on z=0 with texture coordinates in [0,1]^2,
+    // seen from the pinhole camera at distance 5.
+    lm::asset("film", "film::bitmap", {{"w", 16}, {"h", 16}});
+    lm::asset("camera", "camera::pinhole", {
+        {"film", lm::asset("film")},
+        {"position", {0,0,5}},
+        {"center", {0,0,0}},
+        {"up", {0,1,0}},
+        {"vfov", 30}
+    });
+    lm::asset("mesh", "mesh::raw", {
+        {"ps", {-1,-1,0,1,-1,0,1,1,0,-1,1,0}},
+        {"ns", {0,0,1}},
+        {"ts", {0,0,1,0,1,1,0,1}},
+        {"fs", {
+            {"p", {0,1,2,0,2,3}},
+            {"n", {0,0,0,0,0,0}},
+            {"t", {0,1,2,0,2,3}}
+        }}
+    });
+    lm::asset("material", "material::diffuse", {{"Kd", {1,1,1}}});
+    lm::primitive(lm::Mat4(1), {{"camera", lm::asset("camera")}});
+    lm::primitive(lm::Mat4(1), {
+        {"mesh", lm::asset("mesh")},
+        {"material", lm::asset("material")}
+    });
+    lm::build("accel::sahbvh");
+    const auto* scene = lm::comp::get<lm::Scene>("$.scene");
+    REQUIRE(scene);
+
+    // Primary ray through the center of the screen
+    const lm::Vec2 rp(.5, .5);
+    const lm::Vec2 drp(1./16, 1./16);
+    const auto ray = scene->primaryRay(rp, 1);
+    const auto rd = scene->primaryRayDifferential(rp, drp, 1);
+    REQUIRE(rd);
+    const auto hit = scene->intersect(ray, *rd);
+    REQUIRE(hit);
+
+    // One pixel spans 2*5*tan(15deg)/16 in world space, which is the half in texture space
+    const auto expected = 5 * std::tan(15 * lm::Pi / 180) / 16;
+    CHECK(hit->geom.dtdx.x == doctest::Approx(expected));
+    CHECK(hit->geom.dtdx.y == doctest::Approx(0));
+    CHECK(hit->geom.dtdy.x == doctest::Approx(0));
+    CHECK(hit->geom.dtdy.y == doctest::Approx(expected));
+
+    // No differentials without ray differential
+    const auto hit2 = scene->intersect(ray);
+    REQUIRE(hit2);
+    CHECK(hit2->geom.dtdx == lm::Vec2(0));
+    CHECK(hit2->geom.dtdy == lm::Vec2(0));
+}
+
+TEST_CASE("Differentials of points off the surfaces") {
+    const auto geom1 = lm::PointGeometry::makeDegenerated(lm::Vec3(1,2,3));
+    CHECK(geom1.dtdx == lm::Vec2(0));
+    CHECK(geom1.dtdy == lm::Vec2(0));
+    const auto geom2 = lm::PointGeometry::makeInfinite(lm::Vec3(0,0,1));
+    CHECK(geom2.dtdx == lm::Vec2(0));
+    CHECK(geom2.dtdy == lm::Vec2(0));
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
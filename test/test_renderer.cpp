@@ -0,0 +1,175 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/lm.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+namespace {
+
+// Diffuse floor lit by a small area light facing down.
+// Most of the image is the indirect illumination from the light.
+void setupFloorScene() {
+    lm::asset("film", "film::bitmap", {{"w", 32}, {"h", 32}});
+    lm::asset("camera", "camera::pinhole", {
+        {"film", lm::asset("film")},
+        {"position", {0,2,3}},
+        {"center", {0,0,0}},
+        {"up", {0,1,0}},
+        {"vfov", 45}
+    });
+    lm::asset("floor", "mesh::raw", {
+        {"ps", {-1,0,-1, 1,0,-1, 1,0,1, -1,0,1}},
+        {"ns", {0,1,0}},
+        {"ts", {0,0}},
+        {"fs", {
+            {"p", {0,1,2,0,2,3}},
+            {"n", {0,0,0,0,0,0}},
+            {"t", {0,0,0,0,0,0}}
+        }}
+    });
+    lm::asset("emitter", "mesh::raw", {
+        {"ps", {-.3,1,-.3, .3,1,-.3, .3,1,.3, -.3,1,.3}},
+        {"ns", {0,-1,0}},
+        {"ts", {0,0}},
+        {"fs", {
+            {"p", {0,1,2,0,2,3}},
+            {"n", {0,0,0,0,0,0}},
+            {"t", {0,0,0,0,0,0}}
+        }}
+    });
+    lm::asset("material", "material::diffuse", {{"Kd", {.8,.8,.8}}});
+    lm::asset("light", "light::area", {
+        {"Ke", {5,5,5}},
+        {"mesh", lm::asset("emitter")}
+    });
+    lm::primitive(lm::Mat4(1), {{"camera", lm::asset("camera")}});
+    lm::primitive(lm::Mat4(1), {
+        {"mesh", lm::asset("floor")},
+        {"material", lm::asset("material")}
+    });
+    lm::primitive(lm::Mat4(1), {
+        {"mesh", lm::asset("emitter")},
+        {"material", lm::asset("material")},
+        {"light", lm::asset("light")}
+    });
+    lm::build("accel::sahbvh");
+}
+
+// Mean of the pixel values of the film
+lm::Float mean(const std::string& film) {
+    const auto buf = lm::buffer(lm::asset(film));
+    lm::Float sum(0);
+    for (int i = 0; i < buf.w * buf.h * 3; i++) {
+        sum += buf.data[i];
+    }
+    return sum / (buf.w * buf.h * 3);
+}
+
+}
+
+TEST_CASE("Path guiding") {
+    lm::ScopedInit init_;
+    setupFloorScene();
+
+    // Reference by path tracing
+    lm::renderer("renderer::pt", {
+        {"output", lm::asset("film")},
+        {"scheduler", "sample"},
+        {"spp", 64},
+        {"max_length", 5}
+    });
+    lm::render(false);
+    const auto expected = mean("film");
+    REQUIRE(expected > 0);
+
+    // The guided distribution changes the variance but not the expectation,
+    // so the energy of the image must agree with the path tracing
+    SUBCASE("Energy is preserved") {
+        lm::renderer("renderer::pt::guided", {
+            {"output", lm::asset("film")},
+            {"spp", 64},
+            {"max_length", 5},
+            {"training_iterations", 3}
+        });
+        lm::render(false);
+        CHECK(mean("film") == doctest::Approx(expected).epsilon(.05));
+    }
+
+    // The spatial and directional trees do not exceed the memory budget
+    // even if the thresholds subdivide them finely
+    SUBCASE("Memory budget") {
+        const lm::Float maxMemory = .02;
+        lm::renderer("renderer::pt::guided", {
+            {"output", lm::asset("film")},
+            {"spp", 4},
+            {"max_length", 5},
+            {"training_iterations", 5},
+            {"spatial_threshold", 10},
+            {"directional_threshold", .0001},
+            {"max_memory", maxMemory}
+        });
+        lm::render(false);
+        const auto* renderer = lm::comp::get<lm::Renderer>("$.renderer");
+        REQUIRE(renderer);
+        const long long memory = renderer->underlyingValue("memory");
+        CHECK(memory > 0);
+        CHECK(memory <= (long long)(maxMemory * 1024 * 1024));
+        CHECK(mean("film") > 0);
+    }
+
+    // The final pass is dispatched by the scheduler with the sample generator
+    SUBCASE("Final pass with the sample generator is deterministic") {
+        const auto render = []() {
+            lm::renderer("renderer::pt::guided", {
+                {"output", lm::asset("film")},
+                {"spp", 4},
+                {"max_length", 5},
+                {"training_iterations", 0},
+                {"sampler", "sobol"}
+            });
+            lm::render(false);
+            const auto buf = lm::buffer(lm::asset("film"));
+            return std::vector<lm::Float>(buf.data, buf.data + buf.w * buf.h * 3);
+        };
+        const auto image1 = render();
+        const auto image2 = render();
+        REQUIRE(image1.size() == image2.size());
+        for (size_t i = 0; i < image1.size(); i++) {
+            CHECK(image1[i] == doctest::Approx(image2[i]));
+        }
+    }
+}
+
+// All strategies (s,t) of the bidirectional path tracing are combined by MIS weights,
+// so the image must agree with the path tracing.
+// Wrong weights, e.g., not summing up to one over the strategies, bias the energy.
+TEST_CASE("Bidirectional path tracing") {
+    lm::ScopedInit init_;
+    setupFloorScene();
+
+    lm::renderer("renderer::pt", {
+        {"output", lm::asset("film")},
+        {"scheduler", "sample"},
+        {"spp", 64},
+        {"max_length", 5}
+    });
+    lm::render(false);
+    const auto expected = mean("film");
+    REQUIRE(expected > 0);
+
+    lm::renderer("renderer::bdpt", {
+        {"output", lm::asset("film")},
+        {"scheduler", "sample"},
+        {"spp", 64},
+        {"max_length", 5}
+    });
+    lm::render(false);
+    CHECK(mean("film") == doctest::Approx(expected).epsilon(.05));
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -0,0 +1,83 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/lm.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+TEST_CASE("Sampler") {
+    lm::ScopedInit init_;
+
+    SUBCASE("Range and order independence") {
+        for (const std::string name : { "independent", "stratified", "sobol", "bluenoise" }) {
+            CAPTURE(name);
+            const auto sampler = lm::comp::create<lm::Sampler>("sampler::" + name, "", {
+                {"spp", 16},
+                {"tile_size", 16}
+            });
+            REQUIRE(sampler);
+
+            // Generate the samples in some order and again in the reverse order
+            std::vector<lm::Float> vs;
+            for (long long i = 0; i < 16; i++) {
+                for (int d = 0; d < 8; d++) {
+                    const auto v = sampler->u(3, 5, i, d);
+                    CHECK(v >= 0);
+                    CHECK(v < 1);
+                    vs.push_back(v);
+                }
+            }
+            for (long long i = 15; i >= 0; i--) {
+                for (int d = 7; d >= 0; d--) {
+                    CHECK(sampler->u(3, 5, i, d) == vs[i * 8 + d]);
+                }
+            }
+        }
+    }
+
+    SUBCASE("Stratification") {
+        // Each stratum contains exactly one sample in every dimension
+        for (const std::string name : { "stratified", "sobol" }) {
+            CAPTURE(name);
+            const auto sampler = lm::comp::create<lm::Sampler>("sampler::" + name, "", {
+                {"spp", 16}
+            });
+            REQUIRE(sampler);
+            for (int d = 0; d < 8; d++) {
+                std::vector<int> count(16, 0);
+                for (long long i = 0; i < 16; i++) {
+                    count[int(sampler->u(7, 2, i, d) * 16)]++;
+                }
+                for (int c : count) {
+                    CHECK(c == 1);
+                }
+            }
+        }
+    }
+
+    SUBCASE("Image sample mode is rejected") {
+        // The samples are indexed by pixels, which are unknown in the image sample mode
+        lm::asset("film", "film::bitmap", {{"w", 4}, {"h", 4}});
+        CHECK_THROWS(lm::renderer("renderer::pt", {
+            {"output", lm::asset("film")},
+            {"scheduler", "sample"},
+            {"image_sample_mode", "image"},
+            {"num_samples", 16},
+            {"max_length", 1},
+            {"sampler", "sobol"}
+        }));
+        CHECK_NOTHROW(lm::renderer("renderer::pt", {
+            {"output", lm::asset("film")},
+            {"scheduler", "sample"},
+            {"spp", 1},
+            {"max_length", 1},
+            {"sampler", "sobol"}
+        }));
+    }
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
@@ -233,6 +233,40 @@ TEST_CASE("Serialization") {
         });
     }
 
+    SUBCASE("Raw block") {
+        SUBCASE("Vector") {
+            std::vector<lm::Vec3> orig{ lm::Vec3(1,2,3), lm::Vec3(4,5,6) };
+            std::stringstream ss;
+            lm::serial::save(ss, lm::serial::raw(orig));
+            std::vector<lm::Vec3> loaded;
+            auto loadedRaw = lm::serial::raw(loaded);
+            lm::serial::load(ss, loadedRaw);
+            CHECK(orig == loaded);
+        }
+        SUBCASE("Struct") {
+            std::vector<TestSerial_SimpleStruct> orig{ { 42, 43 }, { 1, 2 } };
+            std::stringstream ss;
+            lm::serial::save(ss, lm::serial::raw(orig));
+            std::vector<TestSerial_SimpleStruct> loaded;
+            auto loadedRaw = lm::serial::raw(loaded);
+            lm::serial::load(ss, loadedRaw);
+            REQUIRE(loaded.size() == 2);
+            CHECK(loaded[0].v1 == 42);
+            CHECK(loaded[0].v2 == 43);
+            CHECK(loaded[1].v1 == 1);
+            CHECK(loaded[1].v2 == 2);
+        }
+        SUBCASE("Empty") {
+            std::vector<int> orig;
+            std::stringstream ss;
+            lm::serial::save(ss, lm::serial::raw(orig));
+            std::vector<int> loaded{ 1, 2, 3 };
+            auto loadedRaw = lm::serial::raw(loaded);
+            lm::serial::load(ss, loadedRaw);
+            CHECK(loaded.empty());
+        }
+    }
+
     SUBCASE("Simple struct") {
         SUBCASE("Simple") {
             TestSerial_SimpleStruct orig{ 42, 43 };
@@ -0,0 +1,186 @@
+/*
+    Lightmetrica - Copyright (c) 2019 Hisanari Otsu
+    Distributed under MIT license. See LICENSE file for details.
+*/
+
+#include <pch.h>
+#include "test_common.h"
+#include <lm/lm.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+namespace {
+
+// Build the scene with a primitive of the mesh and get the scene
+const lm::Scene* buildScene(const std::string& mesh, lm::Mat4 transform = lm::Mat4(1), const std::string& accel = "accel::sahbvh") {
+    lm::asset("material", "material::diffuse", {{"Kd", {1,1,1}}});
+    lm::primitive(transform, {
+        {"mesh", mesh},
+        {"material", lm::asset("material")}
+    });
+    lm::build(accel);
+    return lm::comp::get<lm::Scene>("$.scene");
+}
+
+void checkVec3(lm::Vec3 a, lm::Vec3 b) {
+    CHECK(a.x == doctest::Approx(b.x));
+    CHECK(a.y == doctest::Approx(b.y));
+    CHECK(a.z == doctest::Approx(b.z));
+}
+
+}
+
+TEST_CASE("Analytic shapes") {
+    lm::ScopedInit init_;
+
+    SUBCASE("Sphere") {
+        const auto* scene = buildScene(lm::asset("mesh", "mesh::spheres", {
+            {"ps", {0,0,0, 3,0,0}},
+            {"rs", {1, .5}}
+        }));
+        REQUIRE(scene);
+        const auto hit = scene->intersect({ lm::Vec3(3,0,5), lm::Vec3(0,0,-1) });
+        REQUIRE(hit);
+        checkVec3(hit->geom.p, lm::Vec3(3,0,.5));
+        checkVec3(hit->geom.n, lm::Vec3(0,0,1));
+
+        // Ray from inside hits the far side
+        const auto hit2 = scene->intersect({ lm::Vec3(0), lm::Vec3(1,0,0) });
+        REQUIRE(hit2);
+        checkVec3(hit2->geom.p, lm::Vec3(1,0,0));
+        CHECK(!scene->intersect({ lm::Vec3(1.6,0,5), lm::Vec3(0,0,-1) }));
+    }
+
+    SUBCASE("Sphere with transform") {
+        const auto* scene = buildScene(lm::asset("mesh", "mesh::spheres", {
+            {"ps", {0,0,0}},
+            {"radius", 1}
+        }), glm::translate(lm::Vec3(0,0,-2)) * glm::scale(lm::Vec3(2)));
+        REQUIRE(scene);
+        const auto hit = scene->intersect({ lm::Vec3(0,0,5), lm::Vec3(0,0,-1) });
+        REQUIRE(hit);
+        checkVec3(hit->geom.p, lm::Vec3(0,0,0));
+        checkVec3(hit->geom.n, lm::Vec3(0,0,1));
+    }
+
+    SUBCASE("Disk") {
+        const auto* scene = buildScene(lm::asset("mesh", "mesh::disks", {
+            {"ps", {0,0,0}},
+            {"ns", {0,0,1}},
+            {"radius", 1}
+        }));
+        REQUIRE(scene);
+        const auto hit = scene->intersect({ lm::Vec3(.5,.5,5), lm::Vec3(0,0,-1) });
+        REQUIRE(hit);
+        checkVec3(hit->geom.p, lm::Vec3(.5,.5,0));
+        checkVec3(hit->geom.n, lm::Vec3(0,0,1));
+        CHECK(!scene->intersect({ lm::Vec3(.8,.8,5), lm::Vec3(0,0,-1) }));
+    }
+
+    SUBCASE("Round curve") {
+        const auto* scene = buildScene(lm::asset("mesh", "mesh::curves", {
+            {"ps", {-1,0,0, 0,0,0, 1,0,0}},
+            {"radius", .1}
+        }));
+        REQUIRE(scene);
+        const auto hit = scene->intersect({ lm::Vec3(.5,0,5), lm::Vec3(0,0,-1) });
+        REQUIRE(hit);
+        checkVec3(hit->geom.p, lm::Vec3(.5,0,.1));
+        checkVec3(hit->geom.n, lm::Vec3(0,0,1));
+
+        // Spherical cap at the end point
+        const auto hit2 = scene->intersect({ lm::Vec3(5,0,0), lm::Vec3(-1,0,0) });
+        REQUIRE(hit2);
+        CHECK(hit2->geom.p.x == doctest::Approx(1.1));
+        CHECK(!scene->intersect({ lm::Vec3(.5,.2,5), lm::Vec3(0,0,-1) }));
+    }
+
+    SUBCASE("Flat curve") {
+        const auto* scene = buildScene(lm::asset("mesh", "mesh::curves", {
+            {"ps", {-1,0,0, 1,0,0}},
+            {"radius", .1},
+            {"mode", "flat"}
+        }));
+        REQUIRE(scene);
+        const auto hit = scene->intersect({ lm::Vec3(.5,.05,5), lm::Vec3(0,0,-1) });
+        REQUIRE(hit);
+        checkVec3(hit->geom.p, lm::Vec3(.5,.05,0));
+        checkVec3(hit->geom.n, lm::Vec3(0,0,1));
+
+        // The point is on the ray hitting the ribbon off the center line
+        const lm::Ray ray{ lm::Vec3(-.3,-.08,2), glm::normalize(lm::Vec3(.1,0,-1)) };
+        const auto hit2 = scene->intersect(ray);
+        REQUIRE(hit2);
+        const auto q = hit2->geom.p - ray.o;
+        checkVec3(glm::cross(q, ray.d), lm::Vec3(0));
+        CHECK(hit2->geom.p.y == doctest::Approx(-.08));
+        CHECK(!scene->intersect({ lm::Vec3(.5,.2,5), lm::Vec3(0,0,-1) }));
+    }
+
+    SUBCASE("Invalid radii") {
+        CHECK_THROWS(lm::asset("mesh", "mesh::spheres", {
+            {"ps", {0,0,0, 1,0,0}},
+            {"rs", {1}}
+        }));
+    }
+}
+
+TEST_CASE("Analytic shapes with embree") {
+    // Only tested if the plugin is built
+    ScopedLoadOptionalPlugins plugins_({ "accel_embree" });
+    if (!registered("accel::embree")) {
+        return;
+    }
+    lm::ScopedInit init_;
+
+    // Transformed shapes intersected by the rays through a grid
+    const auto transform =
+        glm::translate(lm::Vec3(.3,-.2,.1)) *
+        glm::rotate(lm::Float(.4), lm::Vec3(1,1,0)) *
+        glm::scale(lm::Vec3(1.5));
+    const auto hits = [&](const std::string& accel) {
+        const auto* scene = buildScene(lm::asset("mesh"), transform, accel);
+        REQUIRE(scene);
+        std::vector<std::optional<lm::SceneInteraction>> result;
+        const int n = 16;
+        for (int y = 0; y < n; y++) {
+            for (int x = 0; x < n; x++) {
+                const lm::Vec3 o((x + lm::Float(.37)) / n * 6 - 3, (y + lm::Float(.61)) / n * 6 - 3, 10);
+                result.push_back(scene->intersect({ o, lm::Vec3(0,0,-1) }));
+            }
+        }
+        return result;
+    };
+
+    const std::vector<std::pair<std::string, lm::Json>> meshes{
+        { "mesh::spheres", {{"ps", {0,0,0, 1,.5,0}}, {"rs", {.8, .3}}} },
+        { "mesh::disks", {{"ps", {0,0,0}}, {"ns", {0,0,1}}, {"radius", 1}} },
+        { "mesh::curves", {{"ps", {-1,0,0, 0,.5,0, 1,0,0}}, {"radius", .2}} }
+    };
+    for (const auto& mesh : meshes) {
+        CAPTURE(mesh.first);
+        lm::reset();
+        lm::asset("mesh", mesh.first, mesh.second);
+
+        // The shapes of embree must give the same surface attributes as the ones of sahbvh
+        const auto expected = hits("accel::sahbvh");
+        const auto actual = hits("accel::embree");
+        REQUIRE(expected.size() == actual.size());
+        int numHits = 0;
+        for (size_t i = 0; i < expected.size(); i++) {
+            CAPTURE(i);
+            REQUIRE(bool(expected[i]) == bool(actual[i]));
+            if (!expected[i]) {
+                continue;
+            }
+            numHits++;
+            checkVec3(expected[i]->geom.p, actual[i]->geom.p);
+            checkVec3(expected[i]->geom.n, actual[i]->geom.n);
+            CHECK(expected[i]->geom.t.x == doctest::Approx(actual[i]->geom.t.x));
+            CHECK(expected[i]->geom.t.y == doctest::Approx(actual[i]->geom.t.y));
+        }
+        CHECK(numHits > 0);
+    }
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)
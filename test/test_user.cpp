@@ -4,3 +4,478 @@
 */
 
 #include <pch.h>
+#include "test_common.h"
+#include <lm/lm.h>
+
+LM_NAMESPACE_BEGIN(LM_TEST_NAMESPACE)
+
+namespace {
+
+// Quad area light seen from a pinhole camera.
+// The material can be given by the locator of an existing asset.
+void setupQuadScene(const std::string& material = "") {
+    lm::asset("film", "film::bitmap", {{"w", 16}, {"h", 16}});
+    lm::asset("camera", "camera::pinhole", {
+        {"film", lm::asset("film")},
+        {"position", {0,0,5}},
+        {"center", {0,0,0}},
+        {"up", {0,1,0}},
+        {"vfov", 30}
+    });
+    lm::asset("mesh", "mesh::raw", {
+        {"ps", {-1,-1,-1,1,-1,-1,1,1,-1,-1,1,-1}},
+        {"ns", {0,0,1}},
+        {"ts", {0,0,1,0,1,1,0,1}},
+        {"fs", {
+            {"p", {0,1,2,0,2,3}},
+            {"n", {0,0,0,0,0,0}},
+            {"t", {0,1,2,0,2,3}}
+        }}
+    });
+    const auto materialLoc = material.empty()
+        ? lm::asset("material", "material::diffuse", {{"Kd", {1,1,1}}})
+        : material;
+    lm::asset("light", "light::area", {
+        {"Ke", {1,1,1}},
+        {"mesh", lm::asset("mesh")}
+    });
+    lm::primitive(lm::Mat4(1), {{"camera", lm::asset("camera")}});
+    lm::primitive(lm::Mat4(1), {
+        {"mesh", lm::asset("mesh")},
+        {"material", materialLoc},
+        {"light", lm::asset("light")}
+    });
+    lm::build("accel::sahbvh");
+}
+
+// Progress context requesting the cancellation of the rendering
+// when the number of processed samples reaches the given number.
+class ProgressContext_TestCancel : public lm::progress::detail::ProgressContext {
+private:
+    long long cancelAt_;
+
+public:
+    virtual bool construct(const lm::Json& prop) override {
+        cancelAt_ = lm::json::value<long long>(prop, "cancel_at");
+        return true;
+    }
+    virtual void start(lm::progress::ProgressMode, long long, double) override {}
+    virtual void update(long long processed) override {
+        if (processed >= cancelAt_) {
+            lm::parallel::requestCancel();
+        }
+    }
+    virtual void updateTime(lm::Float) override {}
+    virtual void end() override {}
+};
+
+LM_COMP_REG_IMPL(ProgressContext_TestCancel, "progress::test_cancel");
+
+}
+
+TEST_CASE("Render loop allocations") {
+    lm::ScopedInit init_;
+    setupQuadScene();
+
+    // Number of allocations in a render call after warm-up
+    const auto countAllocations = [](const std::string& rendererName, int spp) -> long long {
+        lm::renderer(rendererName, {
+            {"output", lm::asset("film")},
+            {"scheduler", "sample"},
+            {"spp", spp},
+            {"max_length", 10}
+        });
+        lm::render(false);
+        ScopedAllocationCounter counter;
+        lm::render(false);
+        return counter.count();
+    };
+
+    // The number of allocations must not depend on the number of samples
+    for (const auto* name : { "renderer::pt", "renderer::bdpt", "renderer::volpt", "renderer::volpt_naive" }) {
+        CAPTURE(name);
+        const auto one = countAllocations(name, 1);
+        const auto many = countAllocations(name, 16);
+        CHECK(many <= one);
+    }
+}
+
+TEST_CASE("User contexts") {
+    lm::ScopedInit init_;
+    const auto material = lm::asset("shared_material", "material::diffuse", {{"Kd", {1,1,1}}});
+    const std::vector<std::string> names{ "job1", "job2" };
+    for (const auto& name : names) {
+        lm::createContext(name);
+    }
+
+    SUBCASE("Assets are created in the bound context") {
+        {
+            lm::ScopedContext ctx_("job1");
+            CHECK(lm::boundContext() == "job1");
+            CHECK(lm::asset("film", "film::bitmap", {{"w", 4}, {"h", 4}}) == "$.job1.assets.film");
+        }
+        CHECK(lm::boundContext() == "");
+        CHECK(lm::comp::get<lm::Film>("$.job1.assets.film"));
+        CHECK(!lm::comp::get<lm::Film>("$.assets.film"));
+    }
+
+    SUBCASE("Duplicated context") {
+        CHECK_THROWS(lm::createContext("job1"));
+        CHECK_THROWS(lm::createContext("assets"));
+    }
+
+    SUBCASE("Concurrent rendering with shared asset") {
+        std::vector<lm::Float> sums(names.size(), lm::Float(0));
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < names.size(); i++) {
+            threads.emplace_back([&, i]() {
+                lm::ScopedContext ctx_(names[i]);
+                setupQuadScene(material);
+                lm::render("renderer::pt", {
+                    {"output", lm::asset("film")},
+                    {"scheduler", "sample"},
+                    {"spp", 4},
+                    {"max_length", 10}
+                });
+                const auto buf = lm::buffer(lm::asset("film"));
+                for (int j = 0; j < buf.w * buf.h * 3; j++) {
+                    sums[i] += buf.data[j];
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        for (const auto sum : sums) {
+            CHECK(sum > 0);
+        }
+    }
+
+    SUBCASE("Asset replacement while another context is rendering") {
+        // The default context replaces the shared asset while job1 renders with it.
+        // The replacement waits for the render and updates the references in job1.
+        std::atomic<bool> done = false;
+        std::thread th([&]() {
+            lm::ScopedContext ctx_("job1");
+            setupQuadScene(material);
+            for (int i = 0; i < 8; i++) {
+                lm::render("renderer::pt", {
+                    {"output", lm::asset("film")},
+                    {"scheduler", "sample"},
+                    {"spp", 1},
+                    {"max_length", 10}
+                });
+            }
+            done = true;
+        });
+        do {
+            lm::asset("shared_material", "material::diffuse", {{"Kd", {1,1,1}}});
+            lm::asset("unrelated", "material::diffuse", {{"Kd", {1,1,1}}});
+        } while (!done);
+        th.join();
+
+        // The primitive in job1 refers to the latest instance
+        const auto* scene = lm::comp::get<lm::Scene>("$.job1.scene");
+        REQUIRE(scene);
+        int numPrimitives = 0;
+        scene->traverseNodes([&](const lm::SceneNode& node, lm::Mat4) {
+            if (node.type == lm::SceneNodeType::Primitive && node.primitive.material) {
+                CHECK(node.primitive.material == lm::comp::get<lm::Material>(material));
+                numPrimitives++;
+            }
+        });
+        CHECK(numPrimitives == 1);
+    }
+
+    for (const auto& name : names) {
+        lm::releaseContext(name);
+    }
+}
+
+TEST_CASE("Multi-view batch rendering") {
+    lm::ScopedInit init_;
+    setupQuadScene();
+
+    // Second camera looking at the quad from a different position
+    lm::asset("film2", "film::bitmap", {{"w", 8}, {"h", 8}});
+    lm::asset("camera2", "camera::pinhole", {
+        {"film", lm::asset("film2")},
+        {"position", {1,0,5}},
+        {"center", {0,0,0}},
+        {"up", {0,1,0}},
+        {"vfov", 30}
+    });
+    lm::primitive(lm::Mat4(1), {{"camera", lm::asset("camera2")}});
+    lm::build("accel::sahbvh");
+
+    // Render the views in a batch.
+    // The sample generator makes the images independent of the assignment of the tiles to the threads.
+    const auto pixels = [](const std::string& film) {
+        const auto buf = lm::buffer(lm::asset(film));
+        return std::vector<lm::Float>(buf.data, buf.data + buf.w * buf.h * 3);
+    };
+    const std::string path1 = "test_view1.pfm";
+    const std::string path2 = "test_view2.pfm";
+    fs::remove(path1);
+    fs::remove(path2);
+    lm::renderer("renderer::pt", {
+        {"views", {
+            {{"camera", lm::asset("camera")}, {"output", lm::asset("film")}, {"path", path1}},
+            {{"camera", lm::asset("camera2")}, {"output", lm::asset("film2")}, {"path", path2}}
+        }},
+        {"spp", 4},
+        {"tile_size", 5},
+        {"max_length", 10},
+        {"sampler", "sobol"}
+    });
+    lm::render(false);
+    const auto batch1 = pixels("film");
+    const auto batch2 = pixels("film2");
+
+    // Each view is saved when its last tile is finished
+    CHECK(fs::exists(path1));
+    CHECK(fs::exists(path2));
+    fs::remove(path1);
+    fs::remove(path2);
+
+    // Each view matches the rendering of the camera alone
+    const auto checkEqual = [](const std::vector<lm::Float>& a, const std::vector<lm::Float>& b) {
+        REQUIRE(a.size() == b.size());
+        for (size_t i = 0; i < a.size(); i++) {
+            CHECK(a[i] == doctest::Approx(b[i]));
+        }
+    };
+    lm::renderer("renderer::pt", {
+        {"views", {
+            {{"camera", lm::asset("camera")}, {"output", lm::asset("film")}}
+        }},
+        {"spp", 4},
+        {"tile_size", 5},
+        {"max_length", 10},
+        {"sampler", "sobol"}
+    });
+    lm::render(false);
+    checkEqual(batch1, pixels("film"));
+
+    // The last camera primitive is the camera of the scene
+    lm::renderer("renderer::pt", {
+        {"output", lm::asset("film2")},
+        {"scheduler", "sample"},
+        {"spp", 4},
+        {"max_length", 10},
+        {"sampler", "sobol"}
+    });
+    lm::render(false);
+    checkEqual(batch2, pixels("film2"));
+
+    // Both views see the emitter
+    const auto sum = [](const std::vector<lm::Float>& v) { return std::accumulate(v.begin(), v.end(), lm::Float(0)); };
+    CHECK(sum(batch1) > 0);
+    CHECK(sum(batch2) > 0);
+}
+
+TEST_CASE("Checkpoint and resume") {
+    lm::ScopedInit init_;
+    setupQuadScene();
+    const std::string path = "test_checkpoint.bin";
+    fs::remove(path);
+
+    const auto render = [&](int spp) {
+        lm::renderer("renderer::pt", {
+            {"output", lm::asset("film")},
+            {"scheduler", "sample"},
+            {"spp", spp},
+            {"max_length", 10},
+            {"checkpoint", path},
+            {"checkpoint_interval", 0}
+        });
+        lm::render(false);
+        const auto buf = lm::buffer(lm::asset("film"));
+        return std::vector<lm::Float>(buf.data, buf.data + buf.w * buf.h * 3);
+    };
+
+    // Resuming from the finished checkpoint reproduces the image
+    const auto first = render(4);
+    REQUIRE(fs::exists(path));
+    const auto resumed = render(4);
+    CHECK(first == resumed);
+
+    // Continuing the rendering adds the samples to the restored ones
+    const auto more = render(8);
+    CHECK(first != more);
+
+    fs::remove(path);
+}
+
+TEST_CASE("Checkpoint and resume after cancellation") {
+    lm::ScopedInit init_;
+    setupQuadScene();
+    const std::string path = "test_checkpoint_cancel.bin";
+    fs::remove(path);
+
+    // The sample generator makes the image independent of the assignment of the threads
+    const auto render = [&](int spp) {
+        lm::renderer("renderer::pt", {
+            {"output", lm::asset("film")},
+            {"scheduler", "sample"},
+            {"spp", spp},
+            {"max_length", 10},
+            {"sampler", "sobol"},
+            {"checkpoint", path},
+            {"checkpoint_interval", 0}
+        });
+        lm::render(false);
+        const auto buf = lm::buffer(lm::asset("film"));
+        return std::vector<lm::Float>(buf.data, buf.data + buf.w * buf.h * 3);
+    };
+
+    // Uninterrupted rendering
+    const auto completed = render(3);
+    fs::remove(path);
+    const auto expected = render(8);
+    fs::remove(path);
+
+    // Cancel in the middle of the fourth pass. The progress is reported from the rendering thread.
+    // The samples of the interrupted pass are discarded from the film.
+    const long long numPixels = 16 * 16;
+    lm::progress::init("progress::test_cancel", {{"cancel_at", 3 * numPixels + 1}});
+    const auto cancelled = render(8);
+    REQUIRE(fs::exists(path));
+    REQUIRE(cancelled.size() == completed.size());
+    for (size_t i = 0; i < cancelled.size(); i++) {
+        CHECK(cancelled[i] == doctest::Approx(completed[i]));
+    }
+
+    // Resuming from the checkpoint gives the same image as the uninterrupted rendering
+    lm::progress::init(lm::progress::DefaultType);
+    const auto resumed = render(8);
+    CHECK(expected == resumed);
+
+    fs::remove(path);
+}
+
+TEST_CASE("Render session") {
+    lm::ScopedInit init_;
+    setupQuadScene();
+    const auto pixels = []() {
+        const auto buf = lm::buffer(lm::asset("film"));
+        return std::vector<lm::Float>(buf.data, buf.data + buf.w * buf.h * 3);
+    };
+
+    // Accumulate a few passes of one sample per pixel
+    lm::renderer("renderer::pt", {
+        {"output", lm::asset("film")},
+        {"scheduler", "sample"},
+        {"spp", 1},
+        {"max_length", 10},
+        {"sampler", "sobol"}
+    });
+    lm::startSession(lm::asset("film"));
+    while (lm::sessionPasses() < 4) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    lm::stopSession();
+    const auto passes = lm::sessionPasses();
+    const auto buf = lm::sessionBuffer();
+    const std::vector<lm::Float> accum(buf.data, buf.data + buf.w * buf.h * 3);
+
+    // The passes continue the sample indices,
+    // so the accumulation matches the rendering with the samples of all passes
+    lm::renderer("renderer::pt", {
+        {"output", lm::asset("film")},
+        {"scheduler", "sample"},
+        {"spp", passes},
+        {"max_length", 10},
+        {"sampler", "sobol"}
+    });
+    lm::render(false);
+    const auto expected = pixels();
+    REQUIRE(accum.size() == expected.size());
+    for (size_t i = 0; i < accum.size(); i++) {
+        CHECK(accum[i] == doctest::Approx(expected[i]).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("Sequence rendering") {
+    lm::ScopedInit init_;
+
+    // Static mesh shared by the frames
+    const auto mesh = lm::asset("mesh", "mesh::raw", {
+        {"ps", {-1,-1,-1,1,-1,-1,1,1,-1,-1,1,-1}},
+        {"ns", {0,0,1}},
+        {"ts", {0,0,1,0,1,1,0,1}},
+        {"fs", {
+            {"p", {0,1,2,0,2,3}},
+            {"n", {0,0,0,0,0,0}},
+            {"t", {0,1,2,0,2,3}}
+        }}
+    });
+
+    // Camera moves along the frames
+    const int numFrames = 5;
+    std::vector<int> prepared;
+    std::vector<std::string> films;
+    const auto setupFrame = [&](int frame) {
+        prepared.push_back(frame);
+        films.push_back(lm::asset("film", "film::bitmap", {{"w", 8}, {"h", 8}}));
+        lm::asset("camera", "camera::pinhole", {
+            {"film", lm::asset("film")},
+            {"position", {.1 * frame,0,5}},
+            {"center", {0,0,0}},
+            {"up", {0,1,0}},
+            {"vfov", 30}
+        });
+        lm::asset("material", "material::diffuse", {{"Kd", {1,1,1}}});
+        lm::asset("light", "light::area", {
+            {"Ke", {1,1,1}},
+            {"mesh", mesh}
+        });
+        lm::primitive(lm::Mat4(1), {{"camera", lm::asset("camera")}});
+        lm::primitive(lm::Mat4(1), {
+            {"mesh", mesh},
+            {"material", lm::asset("material")},
+            {"light", lm::asset("light")}
+        });
+        lm::build("accel::sahbvh");
+        lm::renderer("renderer::pt", {
+            {"output", lm::asset("film")},
+            {"scheduler", "sample"},
+            {"spp", 1},
+            {"max_length", 10}
+        });
+    };
+
+    SUBCASE("All frames are rendered and saved") {
+        const auto path = [](int frame) { return fmt::format("test_sequence_{}.pfm", frame); };
+        for (int frame = 0; frame < numFrames; frame++) {
+            fs::remove(path(frame));
+        }
+        lm::renderSequence(numFrames, setupFrame, "film", "test_sequence_{}.pfm");
+        CHECK(prepared == std::vector<int>{ 0, 1, 2, 3, 4 });
+        for (int frame = 0; frame < numFrames; frame++) {
+            CHECK(fs::exists(path(frame)));
+            fs::remove(path(frame));
+        }
+
+        // Contexts are used in rotation
+        CHECK(films[0] != films[1]);
+        CHECK(films[0] == films[3]);
+    }
+
+    SUBCASE("Error in a frame is propagated") {
+        CHECK_THROWS(lm::renderSequence(numFrames, [&](int frame) {
+            if (frame == 2) {
+                throw std::runtime_error("error");
+            }
+            setupFrame(frame);
+        }, "film", "test_sequence_{}.pfm"));
+        for (int frame = 0; frame < 2; frame++) {
+            fs::remove(fmt::format("test_sequence_{}.pfm", frame));
+        }
+
+        // Contexts are released
+        CHECK_NOTHROW(lm::createContext("sequence0"));
+    }
+}
+
+LM_NAMESPACE_END(LM_TEST_NAMESPACE)